@@ -0,0 +1,60 @@
+#ifndef TPFPATCH_STORE_BENCH_H
+#define TPFPATCH_STORE_BENCH_H
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "../../main/cpp/patch/triple.h"
+#include "../../main/cpp/dictionary/dictionary_manager.h"
+#include "../../main/cpp/controller/controller.h"
+
+#define BENCHPATH "./"
+
+/**
+ * Create triples over the given number of terms, whose subjects and objects follow a skewed distribution,
+ * and that are encoded in the given dictionary.
+ * @param dict The dictionary to insert the terms in
+ * @param terms The number of distinct subjects and objects
+ * @param count The number of triples
+ * @return The triples in random order.
+ */
+inline std::vector<Triple> generate_triples(std::shared_ptr<DictionaryManager> dict, size_t terms, size_t count) {
+    std::mt19937 random(42);
+    // Most triples share few subjects and predicates, as in real datasets
+    std::geometric_distribution<size_t> skewed(8.0 / terms);
+    std::uniform_int_distribution<size_t> uniform(0, terms - 1);
+    std::vector<Triple> triples;
+    triples.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        std::string s = "<http://example.org/s" + std::to_string(skewed(random) % terms) + ">";
+        std::string p = "<http://example.org/p" + std::to_string(skewed(random) % 64) + ">";
+        std::string o = "\"" + std::to_string(uniform(random)) + "\"";
+        triples.emplace_back(s, p, o, dict);
+    }
+    return triples;
+}
+
+/**
+ * Create a store with a snapshot and a patch, in which one in eight of the given triples is only added in the patch.
+ * @param triples The triples of version 1
+ * @return The controller of the store, to be cleaned up with Controller::cleanup.
+ */
+inline Controller* create_snapshot_and_patch(const std::vector<hdt::TripleString>& triples) {
+    Controller* controller = new Controller(BENCHPATH);
+    PatchBuilder* snapshot_builder = controller->new_patch_bulk();
+    for (size_t i = 0; i < triples.size(); i++) {
+        if (i % 8 != 0) {
+            snapshot_builder->addition(triples[i]);
+        }
+    }
+    snapshot_builder->commit();
+    PatchBuilder* patch_builder = controller->new_patch_bulk();
+    for (size_t i = 0; i < triples.size(); i += 8) {
+        patch_builder->addition(triples[i]);
+    }
+    patch_builder->commit();
+    return controller;
+}
+
+#endif //TPFPATCH_STORE_BENCH_H
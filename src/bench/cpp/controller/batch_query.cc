@@ -0,0 +1,66 @@
+#include <unordered_set>
+#include <benchmark/benchmark.h>
+
+#include "../../../main/cpp/controller/controller.h"
+#include "../bench.h"
+
+// A store with a snapshot and a patch, and patterns over the properties of the most frequent subjects
+class BatchQueryFixture : public benchmark::Fixture {
+protected:
+    Controller* controller;
+    std::vector<StringTriple> patterns;
+public:
+    void SetUp(const benchmark::State& state) override {
+        // The terms are generated with a temporary dictionary that does not belong to a snapshot
+        std::vector<hdt::TripleString> triples;
+        {
+            std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(BENCHPATH, -1);
+            std::unordered_set<std::string> distinct;
+            for (const Triple& triple : generate_triples(dict, 1024, 1 << 14)) {
+                if (distinct.insert(triple.to_string(*dict)).second) {
+                    triples.emplace_back(triple.get_subject(*dict), triple.get_predicate(*dict), triple.get_object(*dict));
+                }
+            }
+        }
+        DictionaryManager::cleanup(BENCHPATH, -1);
+
+        controller = create_snapshot_and_patch(triples);
+
+        // Federated engines ask for several properties of the same subjects at once
+        for (int s = 0; s < state.range(0) / 4; s++) {
+            for (int p = 0; p < 4; p++) {
+                patterns.emplace_back("<http://example.org/s" + std::to_string(s) + ">", "<http://example.org/p" + std::to_string(p) + ">", "");
+            }
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        patterns.clear();
+        Controller::cleanup(BENCHPATH, controller);
+    }
+};
+
+BENCHMARK_DEFINE_F(BatchQueryFixture, Separate)(benchmark::State& state) {
+    for (auto _ : state) {
+        size_t results = 0;
+        for (const StringTriple& pattern : patterns) {
+            TripleIterator* it = controller->get_version_materialized(pattern, 0, 1);
+            Triple triple;
+            while (it->next(&triple)) {
+                results++;
+            }
+            delete it;
+        }
+        benchmark::DoNotOptimize(results);
+    }
+    state.SetItemsProcessed(state.iterations() * patterns.size());
+}
+BENCHMARK_REGISTER_F(BatchQueryFixture, Separate)->RangeMultiplier(4)->Range(4, 256);
+
+BENCHMARK_DEFINE_F(BatchQueryFixture, Batch)(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(controller->get_version_materialized_batch(patterns, 1));
+    }
+    state.SetItemsProcessed(state.iterations() * patterns.size());
+}
+BENCHMARK_REGISTER_F(BatchQueryFixture, Batch)->RangeMultiplier(4)->Range(4, 256);
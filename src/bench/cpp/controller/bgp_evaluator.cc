@@ -0,0 +1,115 @@
+#include <map>
+#include <random>
+#include <unordered_set>
+#include <benchmark/benchmark.h>
+
+#include "../../../main/cpp/controller/controller.h"
+#include "../../../main/cpp/controller/bgp_evaluator.h"
+#include "../bench.h"
+
+// Star and path queries over a graph of entities, in a version with a snapshot and a patch
+class BgpEvaluatorFixture : public benchmark::Fixture {
+protected:
+    Controller* controller;
+    std::vector<StringTriple> star;
+    std::vector<StringTriple> path;
+public:
+    void SetUp(const benchmark::State& state) override {
+        // Every entity knows a few others, and has a type and a name
+        std::mt19937 random(42);
+        std::uniform_int_distribution<int> entities(0, state.range(0) - 1);
+        std::vector<hdt::TripleString> triples;
+        std::unordered_set<std::string> distinct;
+        for (int e = 0; e < state.range(0); e++) {
+            std::string entity = "<http://example.org/e" + std::to_string(e) + ">";
+            triples.emplace_back(entity, "<http://example.org/type>", "<http://example.org/C" + std::to_string(e % 16) + ">");
+            triples.emplace_back(entity, "<http://example.org/name>", "\"" + std::to_string(e) + "\"");
+            for (int i = 0; i < 4; i++) {
+                std::string other = "<http://example.org/e" + std::to_string(entities(random)) + ">";
+                if (distinct.insert(entity + other).second) {
+                    triples.emplace_back(entity, "<http://example.org/knows>", other);
+                }
+            }
+        }
+
+        controller = create_snapshot_and_patch(triples);
+
+        star = {
+                StringTriple("?x", "<http://example.org/type>", "<http://example.org/C0>"),
+                StringTriple("?x", "<http://example.org/name>", "?name"),
+                StringTriple("?x", "<http://example.org/knows>", "?y"),
+        };
+        path = {
+                StringTriple("?x", "<http://example.org/knows>", "?y"),
+                StringTriple("?y", "<http://example.org/knows>", "?z"),
+                StringTriple("?z", "<http://example.org/type>", "<http://example.org/C0>"),
+        };
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        Controller::cleanup(BENCHPATH, controller);
+    }
+
+    // Join the patterns in the given order as a client would, with a string lookup for each binding
+    size_t evaluate_client(const std::vector<StringTriple>& bgp, size_t index, std::map<std::string, std::string>& bindings) {
+        if (index == bgp.size()) {
+            return 1;
+        }
+        std::string terms[3] = {bgp[index].get_subject(), bgp[index].get_predicate(), bgp[index].get_object()};
+        std::string pattern[3];
+        for (int i = 0; i < 3; i++) {
+            auto it = bindings.find(terms[i]);
+            pattern[i] = it != bindings.end() ? it->second : (BgpEvaluator::is_variable(terms[i]) ? "" : terms[i]);
+        }
+        std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(1);
+        TripleIterator* it = controller->get_version_materialized(StringTriple(pattern[0], pattern[1], pattern[2]), 0, 1);
+        size_t solutions = 0;
+        Triple triple;
+        while (it->next(&triple)) {
+            std::string values[3] = {triple.get_subject(*dict), triple.get_predicate(*dict), triple.get_object(*dict)};
+            std::map<std::string, std::string> extended = bindings;
+            for (int i = 0; i < 3; i++) {
+                if (BgpEvaluator::is_variable(terms[i])) {
+                    extended[terms[i]] = values[i];
+                }
+            }
+            solutions += evaluate_client(bgp, index + 1, extended);
+        }
+        delete it;
+        return solutions;
+    }
+};
+
+BENCHMARK_DEFINE_F(BgpEvaluatorFixture, StarClient)(benchmark::State& state) {
+    for (auto _ : state) {
+        std::map<std::string, std::string> bindings;
+        benchmark::DoNotOptimize(evaluate_client(star, 0, bindings));
+    }
+}
+BENCHMARK_REGISTER_F(BgpEvaluatorFixture, StarClient)->RangeMultiplier(4)->Range(256, 16384);
+
+BENCHMARK_DEFINE_F(BgpEvaluatorFixture, StarEvaluator)(benchmark::State& state) {
+    for (auto _ : state) {
+        BgpEvaluator evaluator(controller, 1);
+        BgpSolutions solutions = evaluator.evaluate(star);
+        benchmark::DoNotOptimize(evaluator.project(solutions, {"?x", "?name", "?y"}));
+    }
+}
+BENCHMARK_REGISTER_F(BgpEvaluatorFixture, StarEvaluator)->RangeMultiplier(4)->Range(256, 16384);
+
+BENCHMARK_DEFINE_F(BgpEvaluatorFixture, PathClient)(benchmark::State& state) {
+    for (auto _ : state) {
+        std::map<std::string, std::string> bindings;
+        benchmark::DoNotOptimize(evaluate_client(path, 0, bindings));
+    }
+}
+BENCHMARK_REGISTER_F(BgpEvaluatorFixture, PathClient)->RangeMultiplier(4)->Range(256, 16384);
+
+BENCHMARK_DEFINE_F(BgpEvaluatorFixture, PathEvaluator)(benchmark::State& state) {
+    for (auto _ : state) {
+        BgpEvaluator evaluator(controller, 1);
+        BgpSolutions solutions = evaluator.evaluate(path);
+        benchmark::DoNotOptimize(evaluator.project(solutions, {"?x", "?y", "?z"}));
+    }
+}
+BENCHMARK_REGISTER_F(BgpEvaluatorFixture, PathEvaluator)->RangeMultiplier(4)->Range(256, 16384);
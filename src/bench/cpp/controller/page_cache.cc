@@ -0,0 +1,80 @@
+#include <cstdio>
+#include <unordered_set>
+#include <benchmark/benchmark.h>
+
+#include "../../../main/cpp/controller/controller.h"
+#include "../bench.h"
+
+// The memory budget of the reopened store, of which a quarter is divided among the page caches
+#define PAGE_CACHE_BENCH_BUDGET (1LL << 28)
+
+// Predicate lookups in a reopened store, whose page caches are sized with or without the access counts of the previous session
+class PageCacheFixture : public benchmark::Fixture {
+protected:
+    Controller* controller;
+    std::vector<StringTriple> patterns;
+
+    size_t query() {
+        size_t results = 0;
+        for (const StringTriple& pattern : patterns) {
+            TripleIterator* it = controller->get_version_materialized(pattern, 0, 1);
+            Triple triple;
+            while (it->next(&triple)) {
+                results++;
+            }
+            delete it;
+        }
+        return results;
+    }
+public:
+    void SetUp(const benchmark::State& state) override {
+        // The terms are generated with a temporary dictionary that does not belong to a snapshot
+        std::vector<hdt::TripleString> triples;
+        {
+            std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(BENCHPATH, -1);
+            std::unordered_set<std::string> distinct;
+            for (const Triple& triple : generate_triples(dict, 1 << 14, 1 << 18)) {
+                if (distinct.insert(triple.to_string(*dict)).second) {
+                    triples.emplace_back(triple.get_subject(*dict), triple.get_predicate(*dict), triple.get_object(*dict));
+                }
+            }
+        }
+        DictionaryManager::cleanup(BENCHPATH, -1);
+        controller = create_snapshot_and_patch(triples);
+
+        // Only the POS trees are queried
+        for (int p = 0; p < 64; p++) {
+            patterns.emplace_back("", "<http://example.org/p" + std::to_string(p) + ">", "");
+        }
+        if (state.range(0)) {
+            query();
+        }
+        delete controller;
+        if (!state.range(0)) {
+            std::remove((std::string(BENCHPATH) + BUFFER_POOL_ACCESSES_FILENAME).c_str());
+        }
+        controller = new Controller(BENCHPATH);
+        controller->set_memory_budget(PAGE_CACHE_BENCH_BUDGET);
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        patterns.clear();
+        Controller::cleanup(BENCHPATH, controller);
+    }
+};
+
+// Argument 0 gives all trees equal page caches, 1 sizes them after the queries of the previous session
+BENCHMARK_DEFINE_F(PageCacheFixture, Reopen)(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(query());
+    }
+    size_t pos_page_cache = 0;
+    for (const TreeMetrics& tree : controller->get_patch_tree_manager()->get_tree_metrics()) {
+        if (tree.name.find("_pos_") != std::string::npos) {
+            pos_page_cache += tree.page_cache_capacity;
+        }
+    }
+    state.counters["pos_page_cache"] = pos_page_cache;
+    state.SetItemsProcessed(state.iterations() * patterns.size());
+}
+BENCHMARK_REGISTER_F(PageCacheFixture, Reopen)->Arg(0)->Arg(1);
@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include "../../../main/cpp/controller/controller.h"
+#include "../bench.h"
+
+static void BM_DictionaryManagerCompareComponent(benchmark::State& state) {
+    std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(BENCHPATH, 0);
+    std::vector<Triple> triples = generate_triples(dict, state.range(0), 4096);
+    size_t i = 0;
+    for (auto _ : state) {
+        size_t next = (i + 1) % triples.size();
+        benchmark::DoNotOptimize(dict->compareComponent(triples[i].get_object(), triples[next].get_object(), hdt::OBJECT));
+        i = next;
+    }
+    dict = nullptr;
+    DictionaryManager::cleanup(BENCHPATH, 0);
+}
+BENCHMARK(BM_DictionaryManagerCompareComponent)->RangeMultiplier(16)->Range(256, 65536);
+
+static void BM_DictionaryManagerIdToString(benchmark::State& state) {
+    std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(BENCHPATH, 0);
+    std::vector<Triple> triples = generate_triples(dict, state.range(0), state.range(0));
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dict->idToString(triples[i].get_object(), hdt::OBJECT));
+        i = (i + 1) % triples.size();
+    }
+    dict = nullptr;
+    DictionaryManager::cleanup(BENCHPATH, 0);
+}
+BENCHMARK(BM_DictionaryManagerIdToString)->RangeMultiplier(16)->Range(256, 65536);
+
+static void BM_DictionaryManagerStringToId(benchmark::State& state) {
+    std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(BENCHPATH, 0);
+    std::vector<Triple> triples = generate_triples(dict, state.range(0), state.range(0));
+    std::vector<std::string> objects;
+    for (const Triple& triple : triples) {
+        objects.push_back(triple.get_object(*dict));
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(dict->stringToId(objects[i], hdt::OBJECT));
+        i = (i + 1) % objects.size();
+    }
+    dict = nullptr;
+    DictionaryManager::cleanup(BENCHPATH, 0);
+}
+BENCHMARK(BM_DictionaryManagerStringToId)->RangeMultiplier(16)->Range(256, 65536);
+
+// Encodes the terms of a bound query pattern with a freshly opened snapshot dictionary, as the first query after a load does.
+// With a second argument of 1, the HDT term filter is built first, which is what the first query used to pay for.
+static void BM_DictionaryManagerFirstQueryInsert(benchmark::State& state) {
+    Controller* controller = new Controller(BENCHPATH);
+    std::vector<hdt::TripleString> triples;
+    {
+        std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(BENCHPATH, -1);
+        for (const Triple& triple : generate_triples(dict, state.range(0), state.range(0))) {
+            triples.emplace_back(triple.get_subject(*dict), triple.get_predicate(*dict), triple.get_object(*dict));
+        }
+    }
+    DictionaryManager::cleanup(BENCHPATH, -1);
+    PatchBuilder* builder = controller->new_patch_bulk();
+    for (const hdt::TripleString& triple : triples) {
+        builder->addition(triple);
+    }
+    builder->commit();
+    std::shared_ptr<hdt::HDT> snapshot = controller->get_snapshot_manager()->get_snapshot(0);
+
+    size_t i = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(BENCHPATH, 0, snapshot->getDictionary(), true);
+        state.ResumeTiming();
+        if (state.range(1)) {
+            dict->prepareInsertions();
+        }
+        benchmark::DoNotOptimize(Triple(triples[i].getSubject(), "", "", dict));
+        i = (i + 1) % triples.size();
+        state.PauseTiming();
+        dict = nullptr;
+        state.ResumeTiming();
+    }
+    snapshot = nullptr;
+    Controller::cleanup(BENCHPATH, controller);
+}
+BENCHMARK(BM_DictionaryManagerFirstQueryInsert)->ArgsProduct({{1024, 16384, 65536}, {0, 1}});
@@ -0,0 +1,78 @@
+#include <limits>
+#include <random>
+#include <benchmark/benchmark.h>
+
+#include "../../../main/cpp/patch/interval_list.h"
+
+// A list of patch ids in which a triple is present, the given fraction of patches toggles its presence
+static IntervalList<int> generate_list(int patches, double change_ratio) {
+    std::mt19937 random(42);
+    std::bernoulli_distribution change(change_ratio);
+    IntervalList<int> list(std::numeric_limits<int>::max());
+    bool present = false;
+    for (int patch_id = 0; patch_id < patches; patch_id++) {
+        if (patch_id == 0 || change(random)) {
+            present = !present;
+            present ? list.addition(patch_id) : list.deletion(patch_id);
+        }
+    }
+    return list;
+}
+
+static void BM_IntervalListAddition(benchmark::State& state) {
+    int patches = state.range(0);
+    for (auto _ : state) {
+        IntervalList<int> list(std::numeric_limits<int>::max());
+        for (int patch_id = 0; patch_id < patches; patch_id += 2) {
+            list.addition(patch_id);
+            list.deletion(patch_id + 1);
+        }
+        benchmark::DoNotOptimize(list);
+    }
+    state.SetItemsProcessed(state.iterations() * patches);
+}
+BENCHMARK(BM_IntervalListAddition)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_IntervalListIsIn(benchmark::State& state) {
+    int patches = state.range(0);
+    IntervalList<int> list = generate_list(patches, 0.1);
+    int patch_id = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(list.is_in(patch_id));
+        patch_id = (patch_id + 7) % patches;
+    }
+}
+BENCHMARK(BM_IntervalListIsIn)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_IntervalListGetIndex(benchmark::State& state) {
+    int patches = state.range(0);
+    IntervalList<int> list = generate_list(patches, 0.1);
+    int patch_id = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(list.get_index(patch_id, patches));
+        patch_id = (patch_id + 7) % patches;
+    }
+}
+BENCHMARK(BM_IntervalListGetIndex)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_IntervalListSerialize(benchmark::State& state) {
+    IntervalList<int> list = generate_list(state.range(0), 0.1);
+    for (auto _ : state) {
+        std::pair<const char*, size_t> data = list.serialize();
+        benchmark::DoNotOptimize(data.first);
+        delete[] data.first;
+    }
+}
+BENCHMARK(BM_IntervalListSerialize)->RangeMultiplier(8)->Range(8, 4096);
+
+static void BM_IntervalListDeserialize(benchmark::State& state) {
+    IntervalList<int> list = generate_list(state.range(0), 0.1);
+    std::pair<const char*, size_t> data = list.serialize();
+    IntervalList<int> copy(std::numeric_limits<int>::max());
+    for (auto _ : state) {
+        copy.deserialize(data.first, data.second);
+        benchmark::DoNotOptimize(copy);
+    }
+    delete[] data.first;
+}
+BENCHMARK(BM_IntervalListDeserialize)->RangeMultiplier(8)->Range(8, 4096);
@@ -0,0 +1,44 @@
+#include <benchmark/benchmark.h>
+
+#include "../../../main/cpp/patch/patch_tree_key_comparator.h"
+#include "../bench.h"
+
+static void BM_PatchTreeKeyComparatorCompare(benchmark::State& state) {
+    std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(BENCHPATH, 0);
+    PatchTreeKeyComparator comparator(comp_s, comp_p, comp_o, dict);
+    std::vector<Triple> triples = generate_triples(dict, state.range(0), 4096);
+    size_t i = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(comparator.compare(triples[i], triples[(i + 1) % triples.size()]));
+        i = (i + 1) % triples.size();
+    }
+    dict = nullptr;
+    DictionaryManager::cleanup(BENCHPATH, 0);
+}
+BENCHMARK(BM_PatchTreeKeyComparatorCompare)->RangeMultiplier(16)->Range(256, 65536);
+
+static void BM_PatchTreeKeyComparatorCompareSerialized(benchmark::State& state) {
+    std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(BENCHPATH, 0);
+    PatchTreeKeyComparator comparator(comp_s, comp_p, comp_o, dict);
+    std::vector<Triple> triples = generate_triples(dict, state.range(0), 4096);
+    std::vector<std::pair<const char*, size_t>> keys;
+    for (const Triple& triple : triples) {
+        size_t size;
+        const char* data = triple.serialize(&size);
+        keys.emplace_back(data, size);
+    }
+    size_t i = 0;
+    for (auto _ : state) {
+        // KC compares the serialized keys when it searches its pages
+        auto& key1 = keys[i];
+        auto& key2 = keys[(i + 1) % keys.size()];
+        benchmark::DoNotOptimize(comparator.compare(key1.first, key1.second, key2.first, key2.second));
+        i = (i + 1) % keys.size();
+    }
+    for (auto& key : keys) {
+        delete[] key.first;
+    }
+    dict = nullptr;
+    DictionaryManager::cleanup(BENCHPATH, 0);
+}
+BENCHMARK(BM_PatchTreeKeyComparatorCompareSerialized)->RangeMultiplier(16)->Range(256, 65536);
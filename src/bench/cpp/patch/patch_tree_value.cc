@@ -0,0 +1,82 @@
+#include <benchmark/benchmark.h>
+
+#include "../../../main/cpp/patch/patch_tree_addition_value.h"
+#include "../../../main/cpp/patch/patch_tree_deletion_value.h"
+
+#if defined(COMPRESSED_ADD_VALUES) && defined(COMPRESSED_DEL_VALUES)
+
+// An addition value for a triple that is added and deleted again in some of the given number of patches
+static PatchTreeAdditionValue generate_addition_value(int patches) {
+    PatchTreeAdditionValue value(patches);
+    for (int patch_id = 0; patch_id < patches; patch_id++) {
+        // The triple is present in 3 out of every 4 patches
+        if (patch_id % 4 == 3) {
+            value.del(patch_id);
+        } else {
+            value.add(patch_id);
+        }
+    }
+    return value;
+}
+
+// A deletion value for a triple that is deleted in every patch, with its positions
+static PatchTreeDeletionValue generate_deletion_value(int patches) {
+    PatchTreeDeletionValue value(patches);
+    for (int patch_id = 0; patch_id < patches; patch_id++) {
+        PatchPosition p = patch_id * 10;
+        value.add(PatchTreeDeletionValueElement(patch_id, PatchPositions(p, p + 1, p + 2, p + 3, p + 4, p + 5, p + 6)));
+    }
+    return value;
+}
+
+static void BM_PatchTreeAdditionValueSerialize(benchmark::State& state) {
+    PatchTreeAdditionValue value = generate_addition_value(state.range(0));
+    for (auto _ : state) {
+        size_t size;
+        const char* data = value.serialize(&size);
+        benchmark::DoNotOptimize(data);
+        delete[] data;
+    }
+}
+BENCHMARK(BM_PatchTreeAdditionValueSerialize)->RangeMultiplier(8)->Range(1, 4096);
+
+static void BM_PatchTreeAdditionValueDeserialize(benchmark::State& state) {
+    PatchTreeAdditionValue value = generate_addition_value(state.range(0));
+    size_t size;
+    const char* data = value.serialize(&size);
+    PatchTreeAdditionValue copy(state.range(0));
+    for (auto _ : state) {
+        copy.deserialize(data, size);
+        benchmark::DoNotOptimize(copy);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    delete[] data;
+}
+BENCHMARK(BM_PatchTreeAdditionValueDeserialize)->RangeMultiplier(8)->Range(1, 4096);
+
+static void BM_PatchTreeDeletionValueSerialize(benchmark::State& state) {
+    PatchTreeDeletionValue value = generate_deletion_value(state.range(0));
+    for (auto _ : state) {
+        size_t size;
+        const char* data = value.serialize(&size);
+        benchmark::DoNotOptimize(data);
+        delete[] data;
+    }
+}
+BENCHMARK(BM_PatchTreeDeletionValueSerialize)->RangeMultiplier(8)->Range(1, 4096);
+
+static void BM_PatchTreeDeletionValueDeserialize(benchmark::State& state) {
+    PatchTreeDeletionValue value = generate_deletion_value(state.range(0));
+    size_t size;
+    const char* data = value.serialize(&size);
+    PatchTreeDeletionValue copy(state.range(0));
+    for (auto _ : state) {
+        copy.deserialize(data, size);
+        benchmark::DoNotOptimize(copy);
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+    delete[] data;
+}
+BENCHMARK(BM_PatchTreeDeletionValueDeserialize)->RangeMultiplier(8)->Range(1, 4096);
+
+#endif
@@ -0,0 +1,95 @@
+#include <cstdio>
+#include <benchmark/benchmark.h>
+
+#include "../../../main/cpp/patch/triple_store.h"
+#include "../bench.h"
+
+#define BENCHFILE (BENCHPATH "bench.kct")
+
+// A KC tree configured as in a TripleStore, that is filled with the given number of records
+class KcTreeFixture : public benchmark::Fixture {
+protected:
+    std::shared_ptr<DictionaryManager> dict;
+    PatchTreeKeyComparator* comparator;
+    kyotocabinet::TreeDB* db;
+    std::vector<Triple> triples;
+    const char* value;
+    size_t value_size;
+public:
+    void SetUp(const benchmark::State& state) override {
+        dict = std::make_shared<DictionaryManager>(BENCHPATH, 0);
+        comparator = new PatchTreeKeyComparator(comp_s, comp_p, comp_o, dict);
+        db = new kyotocabinet::TreeDB();
+        db->tune_comparator(comparator);
+        db->tune_map(KC_MEMORY_MAP_SIZE);
+        db->tune_page_cache(KC_PAGE_CACHE_SIZE);
+        db->open(BENCHFILE, kyotocabinet::TreeDB::OWRITER | kyotocabinet::TreeDB::OCREATE | kyotocabinet::TreeDB::OTRUNCATE);
+
+        PatchTreeAdditionValue addition_value(0);
+        addition_value.add(0);
+        value = addition_value.serialize(&value_size);
+        // Twice the number of records, the second half is inserted during the benchmark
+        triples = generate_triples(dict, state.range(0), state.range(0) * 2);
+        for (size_t i = 0; i < triples.size() / 2; i++) {
+            size_t key_size;
+            const char* key = triples[i].serialize(&key_size);
+            db->set(key, key_size, value, value_size);
+            delete[] key;
+        }
+    }
+
+    void TearDown(const benchmark::State& state) override {
+        db->close();
+        delete db;
+        delete comparator;
+        delete[] value;
+        triples.clear();
+        dict = nullptr;
+        std::remove(BENCHFILE);
+        DictionaryManager::cleanup(BENCHPATH, 0);
+    }
+};
+
+BENCHMARK_DEFINE_F(KcTreeFixture, Insert)(benchmark::State& state) {
+    size_t i = triples.size() / 2;
+    for (auto _ : state) {
+        size_t key_size;
+        const char* key = triples[i].serialize(&key_size);
+        db->set(key, key_size, value, value_size);
+        delete[] key;
+        if (++i == triples.size()) {
+            i = triples.size() / 2;
+        }
+    }
+}
+BENCHMARK_REGISTER_F(KcTreeFixture, Insert)->RangeMultiplier(16)->Range(1024, 1 << 18);
+
+BENCHMARK_DEFINE_F(KcTreeFixture, Lookup)(benchmark::State& state) {
+    size_t i = 0;
+    for (auto _ : state) {
+        size_t key_size;
+        size_t found_size;
+        const char* key = triples[i].serialize(&key_size);
+        char* found = db->get(key, key_size, &found_size);
+        benchmark::DoNotOptimize(found);
+        delete[] found;
+        delete[] key;
+        i = (i + 1) % (triples.size() / 2);
+    }
+}
+BENCHMARK_REGISTER_F(KcTreeFixture, Lookup)->RangeMultiplier(16)->Range(1024, 1 << 18);
+
+BENCHMARK_DEFINE_F(KcTreeFixture, CursorJump)(benchmark::State& state) {
+    kyotocabinet::DB::Cursor* cursor = db->cursor();
+    size_t i = 0;
+    for (auto _ : state) {
+        // Queries position a cursor at the first key that matches a triple pattern
+        size_t key_size;
+        const char* key = triples[i].serialize(&key_size);
+        benchmark::DoNotOptimize(cursor->jump(key, key_size));
+        delete[] key;
+        i = (i + 1) % (triples.size() / 2);
+    }
+    delete cursor;
+}
+BENCHMARK_REGISTER_F(KcTreeFixture, CursorJump)->RangeMultiplier(16)->Range(1024, 1 << 18);
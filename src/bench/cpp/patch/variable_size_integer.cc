@@ -0,0 +1,84 @@
+#include <random>
+#include <benchmark/benchmark.h>
+
+#include "../../../main/cpp/patch/variable_size_integer.h"
+
+// Values of the given number of bits, such as patch ids and positions
+static std::vector<uint64_t> generate_values(int bits, size_t count) {
+    std::mt19937_64 random(42);
+    std::vector<uint64_t> values(count);
+    for (auto& value : values) {
+        value = random() >> (64 - bits);
+    }
+    return values;
+}
+
+static void BM_EncodeULEB128(benchmark::State& state) {
+    std::vector<uint64_t> values = generate_values(state.range(0), 1024);
+    std::vector<uint8_t> buffer;
+    buffer.reserve(values.size() * 10);
+    for (auto _ : state) {
+        buffer.clear();
+        for (uint64_t value : values) {
+            encode_ULEB128(value, buffer);
+        }
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_EncodeULEB128)->Arg(7)->Arg(14)->Arg(32)->Arg(63);
+
+static void BM_DecodeULEB128(benchmark::State& state) {
+    std::vector<uint64_t> values = generate_values(state.range(0), 1024);
+    std::vector<uint8_t> buffer;
+    for (uint64_t value : values) {
+        encode_ULEB128(value, buffer);
+    }
+    for (auto _ : state) {
+        const uint8_t* p = buffer.data();
+        uint64_t sum = 0;
+        for (size_t i = 0; i < values.size(); i++) {
+            size_t decode_size;
+            sum += decode_ULEB128(p, &decode_size);
+            p += decode_size;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_DecodeULEB128)->Arg(7)->Arg(14)->Arg(32)->Arg(63);
+
+static void BM_EncodeSLEB128(benchmark::State& state) {
+    std::vector<uint64_t> values = generate_values(state.range(0), 1024);
+    std::vector<uint8_t> buffer;
+    buffer.reserve(values.size() * 10);
+    for (auto _ : state) {
+        buffer.clear();
+        for (uint64_t value : values) {
+            encode_SLEB128((int64_t) value, buffer);
+        }
+        benchmark::DoNotOptimize(buffer.data());
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_EncodeSLEB128)->Arg(7)->Arg(14)->Arg(32)->Arg(62);
+
+static void BM_DecodeSLEB128(benchmark::State& state) {
+    std::vector<uint64_t> values = generate_values(state.range(0), 1024);
+    std::vector<uint8_t> buffer;
+    for (uint64_t value : values) {
+        encode_SLEB128((int64_t) value, buffer);
+    }
+    for (auto _ : state) {
+        const uint8_t* p = buffer.data();
+        int64_t sum = 0;
+        for (size_t i = 0; i < values.size(); i++) {
+            size_t decode_size;
+            sum += decode_SLEB128(p, &decode_size);
+            p += decode_size;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+BENCHMARK(BM_DecodeSLEB128)->Arg(7)->Arg(14)->Arg(32)->Arg(62);
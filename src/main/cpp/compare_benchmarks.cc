@@ -0,0 +1,60 @@
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+#include "evaluate/benchmark_comparison.h"
+
+// The exit code when a query type regressed, errors exit with 1
+#define EXIT_REGRESSION 2
+
+BenchmarkReport read_report(const std::string& file_name) {
+    std::ifstream in(file_name);
+    if (!in.good()) {
+        throw std::runtime_error("Could not open " + file_name);
+    }
+    return BenchmarkReport::read_json(in);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 5) {
+        std::cerr << "Usage: " << argv[0] << " baseline.json candidate.json [alpha [threshold]]" << std::endl;
+        std::cerr << "\tCompares the query latencies of two ostrich-evaluate --json results, and exits with "
+                  << EXIT_REGRESSION << " if the candidate is significantly slower." << std::endl;
+        return 1;
+    }
+
+    try {
+        double alpha = argc > 3 ? std::stod(argv[3]) : BENCHMARK_COMPARISON_DEFAULT_ALPHA;
+        double threshold = argc > 4 ? std::stod(argv[4]) : BENCHMARK_COMPARISON_DEFAULT_THRESHOLD;
+        BenchmarkReport baseline = read_report(argv[1]);
+        BenchmarkReport candidate = read_report(argv[2]);
+
+        // Differences in the environment or parameters make the comparison less meaningful
+        for (const auto& parameter : baseline.get_parameters()) {
+            auto other = candidate.get_parameters().find(parameter.first);
+            if (other != candidate.get_parameters().end() && other->second != parameter.second) {
+                std::cerr << "WARNING: Parameter " << parameter.first << " differs: " << parameter.second << " vs " << other->second << std::endl;
+            }
+        }
+        for (const char* key : {"hostname", "cpus", "assertions", "trace"}) {
+            auto base = baseline.get_environment().find(key);
+            auto other = candidate.get_environment().find(key);
+            if (base != baseline.get_environment().end() && other != candidate.get_environment().end() && base->second != other->second) {
+                std::cerr << "WARNING: Environment " << key << " differs: " << base->second << " vs " << other->second << std::endl;
+            }
+        }
+
+        BenchmarkComparison comparison(baseline, candidate, alpha, threshold);
+        comparison.write(std::cout);
+        std::cout << "store_size," << baseline.get_store_size() << "," << candidate.get_store_size() << std::endl;
+        if (comparison.has_regression()) {
+            std::cerr << "Significant slowdowns were found" << std::endl;
+            return EXIT_REGRESSION;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
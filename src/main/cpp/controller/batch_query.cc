@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <unordered_map>
+#include "batch_query.h"
+#include "controller.h"
+#include "../query_trace.h"
+
+// The positions (subject 0, predicate 1, object 2) of the components in each query order
+static const int* get_positions(hdt::TripleComponentOrder order) {
+    static const int spo[3] = {0, 1, 2};
+    static const int pos[3] = {1, 2, 0};
+    static const int osp[3] = {2, 0, 1};
+    if (order == hdt::POS) return pos;
+    if (order == hdt::OSP) return osp;
+    return spo;
+}
+
+static std::string get_component(const StringTriple& triple_pattern, int position) {
+    if (position == 0) return triple_pattern.get_subject();
+    if (position == 1) return triple_pattern.get_predicate();
+    return triple_pattern.get_object();
+}
+
+BatchQuery::BatchQuery(const Controller* controller, std::vector<StringTriple> triple_patterns)
+        : controller(controller), triple_patterns(std::move(triple_patterns)) {}
+
+const std::vector<StringTriple>& BatchQuery::get_patterns() const {
+    return triple_patterns;
+}
+
+size_t BatchQuery::estimate(const StringTriple& triple_pattern, int patch_id) const {
+    // Only the snapshot is considered, as counting in the patch tree costs as much as the cursor seeks that are saved
+    SnapshotManager* snapshot_manager = controller->get_snapshot_manager();
+    int snapshot_id = snapshot_manager->get_latest_snapshot(patch_id);
+    if (snapshot_id < 0) {
+        return 0;
+    }
+    std::shared_ptr<hdt::HDT> snapshot = snapshot_manager->get_snapshot(snapshot_id);
+    std::shared_ptr<DictionaryManager> dict = snapshot_manager->get_dictionary_manager(snapshot_id);
+    hdt::IteratorTripleID* it = SnapshotManager::search_with_offset(snapshot, triple_pattern.get_as_triple(dict), 0, dict);
+    size_t count = it->estimatedNumResults();
+    delete it;
+    return count;
+}
+
+std::vector<Triple> BatchQuery::encode(const BatchQueryGroup& group, std::shared_ptr<DictionaryManager> dict) const {
+    std::vector<Triple> encoded;
+    for (size_t i : group.patterns) {
+        encoded.push_back(triple_patterns[i].get_as_triple(dict));
+    }
+    return encoded;
+}
+
+std::vector<BatchQueryGroup> BatchQuery::group(int patch_id) const {
+    // Group by query order and the first bound component in that order, in the order of first appearance
+    std::vector<std::vector<size_t>> candidates;
+    std::unordered_map<std::string, size_t> candidate_ids;
+    for (size_t i = 0; i < triple_patterns.size(); i++) {
+        hdt::TripleComponentOrder order = TripleStore::get_query_order(triple_patterns[i]);
+        std::string key = std::to_string(static_cast<int>(order)) + " " + get_component(triple_patterns[i], get_positions(order)[0]);
+        auto it = candidate_ids.find(key);
+        if (it == candidate_ids.end()) {
+            candidate_ids[key] = candidates.size();
+            candidates.push_back({i});
+        } else {
+            candidates[it->second].push_back(i);
+        }
+    }
+
+    std::vector<BatchQueryGroup> groups;
+    for (const std::vector<size_t>& candidate : candidates) {
+        std::vector<StringTriple> patterns;
+        for (size_t i : candidate) {
+            patterns.push_back(triple_patterns[i]);
+        }
+        StringTriple shared = get_shared_pattern(patterns);
+        // If the shared pattern is in the batch, it has to be scanned anyway
+        bool scanned = std::find(patterns.begin(), patterns.end(), shared) != patterns.end();
+        if (scanned || estimate(shared, patch_id) <= candidate.size() * BATCH_QUERY_SHARED_RESULTS_PER_PATTERN) {
+            groups.push_back({shared, candidate});
+            continue;
+        }
+        // The shared prefix is too unselective, only equal patterns share a scan
+        std::unordered_map<std::string, size_t> group_ids;
+        for (size_t i : candidate) {
+            std::string key = triple_patterns[i].to_string();
+            auto it = group_ids.find(key);
+            if (it == group_ids.end()) {
+                group_ids[key] = groups.size();
+                groups.push_back({triple_patterns[i], {i}});
+            } else {
+                groups[it->second].patterns.push_back(i);
+            }
+        }
+    }
+    return groups;
+}
+
+std::vector<std::vector<Triple>> BatchQuery::get_version_materialized(int patch_id) const {
+    TRACE_SPAN("batch_version_materialized");
+    std::vector<std::vector<Triple>> results(triple_patterns.size());
+    if (triple_patterns.empty() || controller->get_snapshot_manager()->get_latest_snapshot(patch_id) < 0) {
+        return results;
+    }
+    std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(patch_id);
+    for (const BatchQueryGroup& group : this->group(patch_id)) {
+        std::vector<Triple> patterns = encode(group, dict);
+        TripleIterator* it = controller->get_version_materialized(group.scan_pattern, 0, patch_id);
+        Triple triple;
+        while (it->next(&triple)) {
+            for (size_t j = 0; j < patterns.size(); j++) {
+                if (matches(patterns[j], triple)) {
+                    results[group.patterns[j]].push_back(triple);
+                }
+            }
+        }
+        delete it;
+    }
+    return results;
+}
+
+std::vector<std::vector<BatchTripleDelta>> BatchQuery::get_delta_materialized(int patch_id_start, int patch_id_end) const {
+    TRACE_SPAN("batch_delta_materialized");
+    std::vector<std::vector<BatchTripleDelta>> results(triple_patterns.size());
+    if (triple_patterns.empty()) {
+        return results;
+    }
+    for (const BatchQueryGroup& group : this->group(patch_id_start)) {
+        // Deltas across delta chains contain triples that are encoded with the dictionary of either snapshot
+        std::vector<std::pair<std::shared_ptr<DictionaryManager>, std::vector<Triple>>> encoded;
+        TripleDeltaIterator* it = controller->get_delta_materialized(group.scan_pattern, 0, patch_id_start, patch_id_end);
+        TripleDelta triple_delta;
+        while (it->next(&triple_delta)) {
+            std::shared_ptr<DictionaryManager> dict = triple_delta.get_dictionary();
+            auto patterns = std::find_if(encoded.begin(), encoded.end(), [&dict](const auto& entry) { return entry.first == dict; });
+            if (patterns == encoded.end()) {
+                encoded.emplace_back(dict, encode(group, dict));
+                patterns = std::prev(encoded.end());
+            }
+            const Triple& triple = *triple_delta.get_triple();
+            for (size_t j = 0; j < patterns->second.size(); j++) {
+                if (matches(patterns->second[j], triple)) {
+                    results[group.patterns[j]].push_back({triple, triple_delta.is_addition(), dict});
+                }
+            }
+        }
+        delete it;
+    }
+    return results;
+}
+
+bool BatchQuery::matches(const Triple& triple_pattern, const Triple& triple) {
+    return (triple_pattern.get_subject() == 0 || triple_pattern.get_subject() == triple.get_subject())
+           && (triple_pattern.get_predicate() == 0 || triple_pattern.get_predicate() == triple.get_predicate())
+           && (triple_pattern.get_object() == 0 || triple_pattern.get_object() == triple.get_object());
+}
+
+StringTriple BatchQuery::get_shared_pattern(const std::vector<StringTriple>& triple_patterns) {
+    std::string components[3];
+    if (triple_patterns.empty()) {
+        return StringTriple("", "", "");
+    }
+    const int* positions = get_positions(TripleStore::get_query_order(triple_patterns[0]));
+    for (int i = 0; i < 3; i++) {
+        std::string component = get_component(triple_patterns[0], positions[i]);
+        bool shared = !component.empty();
+        for (const StringTriple& triple_pattern : triple_patterns) {
+            shared = shared && get_component(triple_pattern, positions[i]) == component;
+        }
+        if (!shared) {
+            break;
+        }
+        components[positions[i]] = component;
+    }
+    return StringTriple(components[0], components[1], components[2]);
+}
@@ -0,0 +1,85 @@
+#ifndef TPFPATCH_STORE_BATCH_QUERY_H
+#define TPFPATCH_STORE_BATCH_QUERY_H
+
+#include <memory>
+#include <vector>
+#include "../patch/triple.h"
+#include "../dictionary/dictionary_manager.h"
+
+// Opening an iterator costs an HDT search, and a deletion and addition cursor seek.
+// A scan is only shared if its estimated number of results per pattern in the group is not larger than this.
+#define BATCH_QUERY_SHARED_RESULTS_PER_PATTERN 256
+
+class Controller;
+
+/**
+ * Patterns of a batch that are answered by a single scan.
+ */
+struct BatchQueryGroup {
+    // The pattern that is scanned, which matches all results of the patterns in the group
+    StringTriple scan_pattern;
+    // The indexes of the patterns in the batch
+    std::vector<size_t> patterns;
+};
+
+/**
+ * An element of a delta in the result of a batch query.
+ */
+struct BatchTripleDelta {
+    Triple triple;
+    bool addition;
+    // The dictionary the triple is encoded with
+    std::shared_ptr<DictionaryManager> dict;
+};
+
+/**
+ * Evaluates a set of triple patterns at once.
+ * Patterns that use the same index order and have the same bound prefix in that order are grouped,
+ * the shared prefix is scanned once and its results are distributed over the patterns in the group.
+ */
+class BatchQuery {
+private:
+    const Controller* controller;
+    std::vector<StringTriple> triple_patterns;
+
+    size_t estimate(const StringTriple& triple_pattern, int patch_id) const;
+    std::vector<Triple> encode(const BatchQueryGroup& group, std::shared_ptr<DictionaryManager> dict) const;
+public:
+    BatchQuery(const Controller* controller, std::vector<StringTriple> triple_patterns);
+    /**
+     * @return The patterns in this batch.
+     */
+    const std::vector<StringTriple>& get_patterns() const;
+    /**
+     * Group the patterns that can share a scan.
+     * @param patch_id The version whose snapshot is used to estimate the size of shared scans.
+     * @return The groups, each pattern is contained in exactly one group.
+     */
+    std::vector<BatchQueryGroup> group(int patch_id) const;
+    /**
+     * Get the triples matching each pattern in a version.
+     * @param patch_id The version.
+     * @return For each pattern, the matching triples, encoded with the dictionary of the version.
+     */
+    std::vector<std::vector<Triple>> get_version_materialized(int patch_id) const;
+    /**
+     * Get the additions and deletions matching each pattern between two versions.
+     * @param patch_id_start The start version.
+     * @param patch_id_end The end version.
+     * @return For each pattern, the matching elements of the delta.
+     */
+    std::vector<std::vector<BatchTripleDelta>> get_delta_materialized(int patch_id_start, int patch_id_end) const;
+    /**
+     * @param triple_pattern A triple pattern in ID space, with 0 for variables.
+     * @param triple A triple.
+     * @return If the triple matches the pattern.
+     */
+    static bool matches(const Triple& triple_pattern, const Triple& triple);
+    /**
+     * @param triple_patterns Triple patterns with the same query order.
+     * @return The pattern that binds the longest prefix, in the query order, that all patterns share.
+     */
+    static StringTriple get_shared_pattern(const std::vector<StringTriple>& triple_patterns);
+};
+
+#endif //TPFPATCH_STORE_BATCH_QUERY_H
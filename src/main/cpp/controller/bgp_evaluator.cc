@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <tuple>
+#include "bgp_evaluator.h"
+#include "controller.h"
+#include "../patch/triple_store.h"
+#include "../query_trace.h"
+
+static inline hdt::TripleComponentRole get_role(int position) {
+    return static_cast<hdt::TripleComponentRole>(position);
+}
+
+static inline size_t get_component(const Triple& triple, int position) {
+    if (position == 0) return triple.get_subject();
+    if (position == 1) return triple.get_predicate();
+    return triple.get_object();
+}
+
+BgpEvaluator::BgpEvaluator(const Controller* controller, int patch_id)
+        : controller(controller), patch_id(patch_id), shared_count(0) {
+    if (controller->get_snapshot_manager()->get_latest_snapshot(patch_id) >= 0) {
+        dict = controller->get_dictionary_manager(patch_id);
+        shared_count = dict->getHdtDict()->getNshared();
+    }
+}
+
+bool BgpEvaluator::is_variable(const std::string& term) {
+    return term.empty() || term[0] == '?';
+}
+
+size_t BgpEvaluator::translate(size_t id, hdt::TripleComponentRole from, hdt::TripleComponentRole to) {
+    if (from == to || id == 0) {
+        return id;
+    }
+    // Terms that are both a subject and an object in the snapshot have the same ID in both roles
+    if (from != hdt::PREDICATE && to != hdt::PREDICATE && id <= shared_count) {
+        return id;
+    }
+    size_t key = id * 9 + from * 3 + to;
+    auto it = translations.find(key);
+    if (it != translations.end()) {
+        return it->second;
+    }
+    size_t translated = 0;
+    std::string term = dict->idToString(id, from);
+    if (!term.empty()) {
+        try {
+            translated = dict->stringToId(term, to);
+        } catch (const std::runtime_error&) {
+            // The term never occurs in the other role
+            translated = 0;
+        }
+    }
+    translations[key] = translated;
+    return translated;
+}
+
+bool BgpEvaluator::extend(const std::vector<size_t>& row, const Triple& triple, const EncodedPattern& pattern,
+                          const std::vector<hdt::TripleComponentRole>& roles, std::vector<size_t>& extended) {
+    extended = row;
+    for (int position = 0; position < 3; position++) {
+        int variable = pattern.variables[position];
+        if (variable < 0) {
+            continue;
+        }
+        size_t id = translate(get_component(triple, position), get_role(position), roles[variable]);
+        if (id == 0 || (extended[variable] != 0 && extended[variable] != id)) {
+            return false;
+        }
+        extended[variable] = id;
+    }
+    return true;
+}
+
+int BgpEvaluator::get_sort_position(const EncodedPattern& pattern) {
+    // Sorted scans follow the query order of the pattern, in which the constants come first
+    static const int spo[3] = {0, 1, 2};
+    static const int pos[3] = {1, 2, 0};
+    static const int osp[3] = {2, 0, 1};
+    hdt::TripleComponentOrder order = TripleStore::get_query_order(Triple(pattern.ids[0], pattern.ids[1], pattern.ids[2]));
+    const int* positions = order == hdt::POS ? pos : (order == hdt::OSP ? osp : spo);
+    for (int i = 0; i < 3; i++) {
+        if (pattern.ids[positions[i]] == 0) {
+            return pattern.variables[positions[i]] >= 0 ? positions[i] : -1;
+        }
+    }
+    return -1;
+}
+
+std::vector<Triple> BgpEvaluator::scan(const EncodedPattern& pattern, bool sorted) const {
+    Triple triple_pattern(pattern.ids[0], pattern.ids[1], pattern.ids[2]);
+    std::vector<Triple> triples;
+    if (sorted) {
+        TripleVersionsIterator* it = controller->get_version_range_ids(triple_pattern, 0, patch_id, patch_id);
+        TripleVersions triple_versions;
+        while (it->next(&triple_versions)) {
+            triples.push_back(*triple_versions.get_triple());
+        }
+        delete it;
+    } else {
+        TripleIterator* it = controller->get_version_materialized_ids(triple_pattern, 0, patch_id);
+        Triple triple;
+        while (it->next(&triple)) {
+            triples.push_back(triple);
+        }
+        delete it;
+    }
+    return triples;
+}
+
+void BgpEvaluator::join_merge(BgpSolutions& solutions, const EncodedPattern& pattern, int position) {
+    int variable = pattern.variables[position];
+    hdt::TripleComponentRole role = get_role(position);
+    std::vector<Triple> triples = scan(pattern, true);
+    const std::vector<std::vector<size_t>>& left = solutions.rows;
+
+    std::vector<std::vector<size_t>> rows;
+    std::vector<size_t> extended;
+    size_t i = 0;
+    size_t j = 0;
+    while (i < left.size() && j < triples.size()) {
+        int comp = dict->compareComponent(left[i][variable], get_component(triples[j], position), role);
+        if (comp < 0) {
+            i++;
+        } else if (comp > 0) {
+            j++;
+        } else {
+            size_t i_end = i;
+            while (i_end < left.size() && left[i_end][variable] == left[i][variable]) i_end++;
+            size_t j_end = j;
+            while (j_end < triples.size() && get_component(triples[j_end], position) == get_component(triples[j], position)) j_end++;
+            for (size_t a = i; a < i_end; a++) {
+                for (size_t b = j; b < j_end; b++) {
+                    if (extend(left[a], triples[b], pattern, solutions.roles, extended)) {
+                        rows.push_back(extended);
+                    }
+                }
+            }
+            i = i_end;
+            j = j_end;
+        }
+    }
+    solutions.rows.swap(rows);
+}
+
+void BgpEvaluator::join_hash(BgpSolutions& solutions, const EncodedPattern& pattern) {
+    std::vector<int> shared_positions;
+    for (int position = 0; position < 3; position++) {
+        int variable = pattern.variables[position];
+        if (variable >= 0 && bound[variable]) {
+            shared_positions.push_back(position);
+        }
+    }
+
+    // Build on the triples, keyed by the shared variables in the roles of the solutions
+    std::vector<Triple> triples = scan(pattern, false);
+    std::unordered_map<size_t, std::vector<size_t>> table;
+    for (size_t i = 0; i < triples.size(); i++) {
+        size_t key = 0;
+        bool valid = true;
+        for (int position : shared_positions) {
+            size_t id = translate(get_component(triples[i], position), get_role(position), solutions.roles[pattern.variables[position]]);
+            valid = valid && id > 0;
+            key = key * 31 + id;
+        }
+        if (valid) {
+            table[key].push_back(i);
+        }
+    }
+
+    // Probe with the solutions, keeping their order; hash collisions are rejected when extending
+    std::vector<std::vector<size_t>> rows;
+    std::vector<size_t> extended;
+    for (const std::vector<size_t>& row : solutions.rows) {
+        size_t key = 0;
+        for (int position : shared_positions) {
+            key = key * 31 + row[pattern.variables[position]];
+        }
+        auto it = table.find(key);
+        if (it == table.end()) {
+            continue;
+        }
+        for (size_t i : it->second) {
+            if (extend(row, triples[i], pattern, solutions.roles, extended)) {
+                rows.push_back(extended);
+            }
+        }
+    }
+    solutions.rows.swap(rows);
+}
+
+void BgpEvaluator::join_bind(BgpSolutions& solutions, const EncodedPattern& pattern) {
+    // Solutions with the same bindings for the pattern share a lookup
+    std::map<std::tuple<size_t, size_t, size_t>, std::vector<Triple>> lookups;
+    std::vector<std::vector<size_t>> rows;
+    std::vector<size_t> extended;
+    for (const std::vector<size_t>& row : solutions.rows) {
+        EncodedPattern bound_pattern = pattern;
+        bool valid = true;
+        for (int position = 0; position < 3; position++) {
+            int variable = pattern.variables[position];
+            if (variable >= 0 && bound[variable]) {
+                bound_pattern.ids[position] = translate(row[variable], solutions.roles[variable], get_role(position));
+                valid = valid && bound_pattern.ids[position] > 0;
+            }
+        }
+        if (!valid) {
+            continue;
+        }
+        auto key = std::make_tuple(bound_pattern.ids[0], bound_pattern.ids[1], bound_pattern.ids[2]);
+        auto it = lookups.find(key);
+        if (it == lookups.end()) {
+            it = lookups.emplace(key, scan(bound_pattern, false)).first;
+        }
+        for (const Triple& triple : it->second) {
+            if (extend(row, triple, pattern, solutions.roles, extended)) {
+                rows.push_back(extended);
+            }
+        }
+    }
+    solutions.rows.swap(rows);
+}
+
+bool BgpEvaluator::encode(const std::vector<StringTriple>& bgp, std::vector<EncodedPattern>& patterns, std::vector<std::string>& variables) const {
+    std::unordered_map<std::string, int> variable_ids;
+    bool known = true;
+    for (const StringTriple& triple_pattern : bgp) {
+        EncodedPattern pattern;
+        std::string terms[3] = {triple_pattern.get_subject(), triple_pattern.get_predicate(), triple_pattern.get_object()};
+        for (int position = 0; position < 3; position++) {
+            pattern.ids[position] = 0;
+            pattern.variables[position] = -1;
+            if (terms[position].empty()) {
+                continue;
+            }
+            if (is_variable(terms[position])) {
+                auto it = variable_ids.find(terms[position]);
+                if (it == variable_ids.end()) {
+                    it = variable_ids.emplace(terms[position], variables.size()).first;
+                    variables.push_back(terms[position]);
+                }
+                pattern.variables[position] = it->second;
+            } else {
+                if (dict) {
+                    try {
+                        pattern.ids[position] = dict->stringToId(terms[position], get_role(position));
+                    } catch (const std::runtime_error&) {
+                        // A term that is not in the dictionary can not match any triple
+                    }
+                }
+                known = known && pattern.ids[position] > 0;
+            }
+        }
+        patterns.push_back(pattern);
+    }
+    return known;
+}
+
+std::vector<std::pair<size_t, size_t>> BgpEvaluator::order(const std::vector<EncodedPattern>& patterns) const {
+    std::vector<size_t> estimates;
+    for (const EncodedPattern& pattern : patterns) {
+        Triple triple_pattern(pattern.ids[0], pattern.ids[1], pattern.ids[2]);
+        estimates.push_back(controller->get_version_materialized_count_ids(triple_pattern, patch_id, true).first);
+    }
+
+    std::vector<std::pair<size_t, size_t>> order;
+    std::vector<bool> used(patterns.size(), false);
+    std::set<int> bound_variables;
+    for (size_t step = 0; step < patterns.size(); step++) {
+        // Patterns that share a variable with the previous ones avoid cartesian products
+        int best = -1;
+        bool best_connected = false;
+        for (size_t i = 0; i < patterns.size(); i++) {
+            if (used[i]) {
+                continue;
+            }
+            bool connected = false;
+            for (int variable : patterns[i].variables) {
+                connected = connected || (variable >= 0 && bound_variables.count(variable) > 0);
+            }
+            if (best < 0 || (connected && !best_connected) || (connected == best_connected && estimates[i] < estimates[best])) {
+                best = i;
+                best_connected = connected;
+            }
+        }
+        used[best] = true;
+        for (int variable : patterns[best].variables) {
+            if (variable >= 0) {
+                bound_variables.insert(variable);
+            }
+        }
+        order.emplace_back(best, estimates[best]);
+    }
+    return order;
+}
+
+BgpSolutions BgpEvaluator::evaluate(const std::vector<StringTriple>& bgp) {
+    TRACE_SPAN("bgp_evaluate");
+    steps.clear();
+    BgpSolutions solutions;
+    solutions.sorted_by = -1;
+
+    // Encode the constants and number the variables
+    std::vector<EncodedPattern> patterns;
+    bool known = encode(bgp, patterns, solutions.variables);
+    solutions.roles.assign(solutions.variables.size(), hdt::SUBJECT);
+    bound.assign(solutions.variables.size(), false);
+    if (!known || !dict) {
+        return solutions;
+    }
+    solutions.rows.emplace_back(solutions.variables.size(), 0);
+
+    std::vector<std::pair<size_t, size_t>> ordered = order(patterns);
+    for (size_t step = 0; step < ordered.size(); step++) {
+        const EncodedPattern& pattern = patterns[ordered[step].first];
+        size_t estimate = ordered[step].second;
+
+        // Variables that are bound for the first time keep the role of their first position
+        std::vector<bool> assigned = bound;
+        for (int position = 0; position < 3; position++) {
+            int variable = pattern.variables[position];
+            if (variable >= 0 && !assigned[variable]) {
+                solutions.roles[variable] = get_role(position);
+                assigned[variable] = true;
+            }
+        }
+        bool connected = false;
+        for (int variable : pattern.variables) {
+            connected = connected || (variable >= 0 && bound[variable]);
+        }
+        int position = get_sort_position(pattern);
+
+        BgpJoinType join;
+        if (step == 0) {
+            // Scan sorted if the next pattern can be merged with this one
+            join = BGP_JOIN_SCAN;
+            bool sorted = false;
+            if (position >= 0 && ordered.size() > 1 && estimate * BGP_BIND_JOIN_LOOKUP_COST >= ordered[1].second) {
+                const EncodedPattern& next = patterns[ordered[1].first];
+                sorted = get_sort_position(next) == position && next.variables[position] == pattern.variables[position];
+            }
+            std::vector<Triple> triples = scan(pattern, sorted);
+            std::vector<std::vector<size_t>> rows;
+            std::vector<size_t> extended;
+            for (const Triple& triple : triples) {
+                if (extend(solutions.rows[0], triple, pattern, solutions.roles, extended)) {
+                    rows.push_back(extended);
+                }
+            }
+            solutions.rows.swap(rows);
+            solutions.sorted_by = sorted ? pattern.variables[position] : -1;
+        } else if (solutions.rows.empty() || (connected && solutions.rows.size() * BGP_BIND_JOIN_LOOKUP_COST < estimate)) {
+            join = BGP_JOIN_BIND;
+            join_bind(solutions, pattern);
+        } else if (position >= 0 && solutions.sorted_by >= 0 && pattern.variables[position] == solutions.sorted_by
+                   && solutions.roles[solutions.sorted_by] == get_role(position)) {
+            join = BGP_JOIN_MERGE;
+            join_merge(solutions, pattern, position);
+        } else {
+            join = BGP_JOIN_HASH;
+            join_hash(solutions, pattern);
+        }
+        bound = assigned;
+        steps.push_back({ordered[step].first, join, estimate});
+    }
+    return solutions;
+}
+
+const std::vector<BgpStep>& BgpEvaluator::get_steps() const {
+    return steps;
+}
+
+std::vector<std::vector<std::string>> BgpEvaluator::project(const BgpSolutions& solutions, const std::vector<std::string>& variables) const {
+    std::vector<size_t> indexes;
+    for (const std::string& variable : variables) {
+        auto it = std::find(solutions.variables.begin(), solutions.variables.end(), variable);
+        if (it == solutions.variables.end()) {
+            throw std::invalid_argument("Unknown variable: " + variable);
+        }
+        indexes.push_back(it - solutions.variables.begin());
+    }
+    std::vector<std::vector<std::string>> projected;
+    for (const std::vector<size_t>& row : solutions.rows) {
+        std::vector<std::string> terms;
+        for (size_t index : indexes) {
+            terms.push_back(dict->idToString(row[index], solutions.roles[index]));
+        }
+        projected.push_back(terms);
+    }
+    return projected;
+}
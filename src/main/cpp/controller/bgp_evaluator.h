@@ -0,0 +1,135 @@
+#ifndef TPFPATCH_STORE_BGP_EVALUATOR_H
+#define TPFPATCH_STORE_BGP_EVALUATOR_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../patch/triple.h"
+#include "../dictionary/dictionary_manager.h"
+
+// The cost of a lookup in a bind join, relative to producing one triple in a scan.
+// A lookup does an HDT search, and a deletion and addition cursor seek.
+#define BGP_BIND_JOIN_LOOKUP_COST 32
+
+class Controller;
+
+/**
+ * The ways a triple pattern is joined with the solutions of the patterns before it.
+ */
+enum BgpJoinType {
+    // The first pattern is scanned
+    BGP_JOIN_SCAN,
+    // Both sides are sorted on a shared variable
+    BGP_JOIN_MERGE,
+    // The pattern is scanned into a hash table on the shared variables, which is probed with the solutions
+    BGP_JOIN_HASH,
+    // The pattern is looked up for each solution, with the shared variables bound
+    BGP_JOIN_BIND,
+};
+
+/**
+ * How a triple pattern of a BGP was evaluated.
+ */
+struct BgpStep {
+    // The index of the pattern in the BGP
+    size_t pattern;
+    BgpJoinType join;
+    // The estimated number of triples matching the pattern on its own
+    size_t estimate;
+};
+
+/**
+ * The solutions of a BGP, as IDs in the dictionary of the version.
+ */
+struct BgpSolutions {
+    // The names of the variables, including the question mark
+    std::vector<std::string> variables;
+    // The role in which the IDs of each variable are encoded
+    std::vector<hdt::TripleComponentRole> roles;
+    // The IDs of all variables for each solution
+    std::vector<std::vector<size_t>> rows;
+    // The variable the solutions are sorted by, or -1
+    int sorted_by;
+};
+
+/**
+ * Evaluates basic graph patterns in a single version.
+ * Terms starting with a question mark are variables, empty terms are variables that are not projected.
+ * The patterns are joined in the order of their estimated counts, with all bindings kept in ID space.
+ */
+class BgpEvaluator {
+public:
+    // A triple pattern with its constants encoded, and the index of the variable at each position
+    struct EncodedPattern {
+        size_t ids[3];
+        int variables[3];
+    };
+private:
+    const Controller* controller;
+    int patch_id;
+    // The dictionary of the version, or null if no snapshot has been created yet
+    std::shared_ptr<DictionaryManager> dict;
+    // Subject and object IDs up to this one belong to the same terms
+    size_t shared_count;
+    std::unordered_map<size_t, size_t> translations;
+    std::vector<BgpStep> steps;
+    // The variables that are bound by the patterns that were joined so far
+    std::vector<bool> bound;
+
+    size_t translate(size_t id, hdt::TripleComponentRole from, hdt::TripleComponentRole to);
+    bool extend(const std::vector<size_t>& row, const Triple& triple, const EncodedPattern& pattern,
+                const std::vector<hdt::TripleComponentRole>& roles, std::vector<size_t>& extended);
+    static int get_sort_position(const EncodedPattern& pattern);
+    std::vector<Triple> scan(const EncodedPattern& pattern, bool sorted) const;
+    void join_merge(BgpSolutions& solutions, const EncodedPattern& pattern, int position);
+    void join_hash(BgpSolutions& solutions, const EncodedPattern& pattern);
+    void join_bind(BgpSolutions& solutions, const EncodedPattern& pattern);
+public:
+    /**
+     * @param controller The controller to query.
+     * @param patch_id The version to evaluate BGPs in.
+     *                 If no snapshot has been created yet, all BGPs have no solutions.
+     */
+    BgpEvaluator(const Controller* controller, int patch_id);
+    /**
+     * @param term A term of a triple pattern.
+     * @return If the term is a variable.
+     */
+    static bool is_variable(const std::string& term);
+    /**
+     * Encode the constants of a BGP with the dictionary of the version, and number its variables.
+     * @param bgp The triple patterns.
+     * @param patterns The encoded patterns, in the order of the BGP.
+     * @param variables The names of the variables, in the order of their numbers.
+     * @return If all constants are in the dictionary, otherwise the BGP can not have solutions.
+     */
+    bool encode(const std::vector<StringTriple>& bgp, std::vector<EncodedPattern>& patterns, std::vector<std::string>& variables) const;
+    /**
+     * Determine the order in which the patterns are joined.
+     * Starting from the pattern with the lowest count estimate,
+     * the next pattern is the one with the lowest estimate among those that share a variable with the previous ones.
+     * @param patterns The encoded triple patterns.
+     * @return The pattern indexes in join order, with the estimated counts of the patterns.
+     */
+    std::vector<std::pair<size_t, size_t>> order(const std::vector<EncodedPattern>& patterns) const;
+    /**
+     * Evaluate a BGP.
+     * @param bgp The triple patterns.
+     * @return The solutions.
+     */
+    BgpSolutions evaluate(const std::vector<StringTriple>& bgp);
+    /**
+     * @return How each pattern of the last evaluated BGP was joined, in join order.
+     */
+    const std::vector<BgpStep>& get_steps() const;
+    /**
+     * Translate solutions to strings.
+     * @param solutions The solutions of a BGP that was evaluated by this evaluator.
+     * @param variables The variables to project, including the question mark.
+     * @return The terms of the projected variables for each solution.
+     */
+    std::vector<std::vector<std::string>> project(const BgpSolutions& solutions, const std::vector<std::string>& variables) const;
+};
+
+#endif //TPFPATCH_STORE_BGP_EVALUATOR_H
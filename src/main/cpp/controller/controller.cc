@@ -1,9 +1,19 @@
 #include <util/StopWatch.hpp>
 #include "controller.h"
 #include "snapshot_patch_iterator_triple_id.h"
+#include "ingest_pipeline.h"
 #include "../snapshot/combined_triple_iterator.h"
 #include "../simpleprogresslistener.h"
+#include "../query_trace.h"
 #include <sys/stat.h>
+#include <limits>
+#include <algorithm>
+
+// The last version of the delta chain of a snapshot, later versions of its patch tree were rebased onto the next snapshot.
+static int get_delta_chain_end(const std::vector<int>& snapshots, int snapshot_id) {
+    auto it = std::upper_bound(snapshots.begin(), snapshots.end(), snapshot_id);
+    return it == snapshots.end() ? std::numeric_limits<int>::max() : *it - 1;
+}
 
 #define BASEURI "<http://example.org>"
 
@@ -14,11 +24,15 @@ Controller::Controller(const std::string& basePath, int8_t kc_opts, bool readonl
 Controller::Controller(const std::string& basePath, SnapshotCreationStrategy *strategy, int8_t kc_opts, bool readonly, size_t cache_size)
         : patchTreeManager(new PatchTreeManager(basePath, kc_opts, readonly, cache_size)),
           snapshotManager(new SnapshotManager(basePath, readonly, cache_size)),
-          strategy(strategy), metadata(nullptr), metadata_manager(nullptr) {
+          strategy(strategy), metadata(nullptr), metadata_manager(nullptr),
+          basePath(basePath), ingest_memory_budget(0), memory_budget(std::make_shared<MemoryBudget>()), ingest_metrics(),
+          async_snapshots(false), pending_snapshot_id(-1), pending_snapshot_dict(nullptr) {
     struct stat sb{};
     if (!(stat(basePath.c_str(), &sb) == 0 && S_ISDIR(sb.st_mode))) {
         throw std::invalid_argument("The provided path '" + basePath + "' is not a valid directory.");
     }
+    patchTreeManager->set_memory_budget(memory_budget);
+    snapshotManager->set_memory_budget(memory_budget);
 
     if (!readonly) {
         // Get the metadata for snapshot creation
@@ -28,6 +42,11 @@ Controller::Controller(const std::string& basePath, SnapshotCreationStrategy *st
 }
 
 Controller::~Controller() {
+    try {
+        finish_snapshot_creation();
+    } catch (std::exception& e) {
+        std::cerr << "Could not finish the creation of snapshot " << pending_snapshot_id << ": " << e.what() << std::endl;
+    }
     delete patchTreeManager;
     delete snapshotManager;
     delete metadata;
@@ -50,10 +69,19 @@ std::pair<size_t, hdt::ResultEstimationType> Controller::get_version_materialize
         return std::make_pair(0, hdt::EXACT);
     }
 
-    std::shared_ptr<hdt::HDT> snapshot = get_snapshot_manager()->get_snapshot(snapshot_id);
+    get_snapshot_manager()->get_snapshot(snapshot_id); // Force a snapshot load
+    std::shared_ptr<DictionaryManager> dict = get_snapshot_manager()->get_dictionary_manager(snapshot_id);
+    return get_version_materialized_count_ids(triple_pattern.get_as_triple(dict), patch_id, allowEstimates);
+}
+
+std::pair<size_t, hdt::ResultEstimationType> Controller::get_version_materialized_count_ids(const Triple& pattern, int patch_id, bool allowEstimates) const {
+    int snapshot_id = get_snapshot_manager()->get_latest_snapshot(patch_id);
+    if(snapshot_id < 0) {
+        return std::make_pair(0, hdt::EXACT);
+    }
 
+    std::shared_ptr<hdt::HDT> snapshot = get_snapshot_manager()->get_snapshot(snapshot_id);
     std::shared_ptr<DictionaryManager> dict = get_snapshot_manager()->get_dictionary_manager(snapshot_id);
-    Triple pattern = triple_pattern.get_as_triple(dict);
 
     hdt::IteratorTripleID* snapshot_it = SnapshotManager::search_with_offset(snapshot, pattern, 0, dict);
     size_t snapshot_count = snapshot_it->estimatedNumResults();
@@ -71,7 +99,7 @@ std::pair<size_t, hdt::ResultEstimationType> Controller::get_version_materialize
         return std::make_pair(snapshot_count, res_type);
     }
 
-    int id = get_patch_tree_manager()->get_patch_tree_id(patch_id);
+    int id = get_patch_tree_manager()->get_delta_chain_patch_tree_id(snapshot_id);
     std::shared_ptr<PatchTree> patchTree = get_patch_tree_manager()->get_patch_tree(id, dict);
     if(patchTree == nullptr) {
         return std::make_pair(snapshot_count, res_type);
@@ -89,6 +117,17 @@ TripleIterator* Controller::get_version_materialized(const Triple &triple_patter
 }
 
 TripleIterator* Controller::get_version_materialized(const StringTriple &triple_pattern, int offset, int patch_id) const {
+    int snapshot_id = get_snapshot_manager()->get_latest_snapshot(patch_id);
+    if(snapshot_id < 0) {
+        return new EmptyTripleIterator();
+    }
+    get_snapshot_manager()->get_snapshot(snapshot_id); // Force a snapshot load
+    std::shared_ptr<DictionaryManager> dict = get_snapshot_manager()->get_dictionary_manager(snapshot_id);
+    return get_version_materialized_ids(triple_pattern.get_as_triple(dict), offset, patch_id);
+}
+
+TripleIterator* Controller::get_version_materialized_ids(const Triple &pattern, int offset, int patch_id) const {
+    TRACE_SPAN("get_version_materialized");
     // Find the snapshot
     int snapshot_id = get_snapshot_manager()->get_latest_snapshot(patch_id);
     if(snapshot_id < 0) {
@@ -97,8 +136,6 @@ TripleIterator* Controller::get_version_materialized(const StringTriple &triple_
     std::shared_ptr<hdt::HDT> snapshot = get_snapshot_manager()->get_snapshot(snapshot_id);
     std::shared_ptr<DictionaryManager> dict = get_snapshot_manager()->get_dictionary_manager(snapshot_id);
 
-    Triple pattern = triple_pattern.get_as_triple(dict);
-
     // Simple case: We are requesting a snapshot, delegate lookup to that snapshot.
     hdt::IteratorTripleID* snapshot_it = SnapshotManager::search_with_offset(snapshot, pattern, offset, dict);
     if(snapshot_id == patch_id) {
@@ -106,7 +143,7 @@ TripleIterator* Controller::get_version_materialized(const StringTriple &triple_
     }
 
     // Otherwise, we have to prepare an iterator for a certain patch
-    int id = get_patch_tree_manager()->get_patch_tree_id(patch_id);
+    int id = get_patch_tree_manager()->get_delta_chain_patch_tree_id(snapshot_id);
     std::shared_ptr<PatchTree> patchTree = get_patch_tree_manager()->get_patch_tree(id, dict);
     if(patchTree == nullptr) {
         return new SnapshotTripleIterator(snapshot_it);
@@ -127,53 +164,56 @@ TripleIterator* Controller::get_version_materialized(const StringTriple &triple_
     // This loop is required to handle special cases like the one in the ControllerTest::EdgeCase1.
     // As worst-case, this loop will take O(n) (n:dataset size), as an optimization we can look
     // into storing long consecutive chains of deletions more efficiently.
-    while(check_offseted_deletions) {
-        if (snapshot_it->hasNext()) { // We have elements left in the snapshot we should apply deletions to
-            // Determine the first triple in the original snapshot and use it as offset for the deletion iterator
-            hdt::TripleID *tripleId = snapshot_it->next();
-            Triple firstTriple(tripleId->getSubject(), tripleId->getPredicate(), tripleId->getObject());
-            deletion_it = patchTree->deletion_iterator_from(firstTriple, patch_id, pattern);
-            deletion_it->getPatchTreeIterator()->set_early_break(true);
-
-            // Calculate a new offset, taking into account deletions.
-            PositionedTriple first_deletion_triple;
-            long snapshot_offset = 0;
-            if (deletion_it->next(&first_deletion_triple, true)) {
-                snapshot_offset = first_deletion_triple.position;
-            } else {
-                // The exact snapshot triple could not be found as a deletion
-                if (patchTree->get_spo_comparator()->compare(firstTriple, deletion_count_data.second) < 0) {
-                    // If the snapshot triple is smaller than the largest deletion,
-                    // set the offset to zero, as all deletions will come *after* this triple.
-
-                    // Note that it should impossible that there would exist a deletion *before* this snapshot triple,
-                    // otherwise we would already have found this triple as a snapshot triple before.
-                    // If we would run into issues because of this after all, we could do a backwards step with
-                    // deletion_it and see if we find a triple matching the pattern, and use its position.
-
-                    snapshot_offset = 0;
+    {
+        TRACE_SPAN("offset_fixup");
+        while(check_offseted_deletions) {
+            if (snapshot_it->hasNext()) { // We have elements left in the snapshot we should apply deletions to
+                // Determine the first triple in the original snapshot and use it as offset for the deletion iterator
+                hdt::TripleID *tripleId = snapshot_it->next();
+                Triple firstTriple(tripleId->getSubject(), tripleId->getPredicate(), tripleId->getObject());
+                deletion_it = patchTree->deletion_iterator_from(firstTriple, patch_id, pattern);
+                deletion_it->getPatchTreeIterator()->set_early_break(true);
+
+                // Calculate a new offset, taking into account deletions.
+                PositionedTriple first_deletion_triple;
+                long snapshot_offset = 0;
+                if (deletion_it->next(&first_deletion_triple, true)) {
+                    snapshot_offset = first_deletion_triple.position;
                 } else {
-                    // If the snapshot triple is larger than the largest deletion,
-                    // set the offset to the total number of deletions.
-                    snapshot_offset = deletion_count_data.first;
-                }
-            }
-            long previous_added_offset = added_offset;
-            added_offset = snapshot_offset;
+                    // The exact snapshot triple could not be found as a deletion
+                    if (patchTree->get_spo_comparator()->compare(firstTriple, deletion_count_data.second) < 0) {
+                        // If the snapshot triple is smaller than the largest deletion,
+                        // set the offset to zero, as all deletions will come *after* this triple.
 
-            // Make a new snapshot iterator for the new offset
-            // TODO: look into reusing the snapshot iterator and applying a relative offset (NOTE: I tried it before, it's trickier than it seems...)
-            delete snapshot_it;
-            snapshot_it = SnapshotManager::search_with_offset(snapshot, pattern, offset + added_offset, dict);
+                        // Note that it should impossible that there would exist a deletion *before* this snapshot triple,
+                        // otherwise we would already have found this triple as a snapshot triple before.
+                        // If we would run into issues because of this after all, we could do a backwards step with
+                        // deletion_it and see if we find a triple matching the pattern, and use its position.
 
-            // Check if we need to loop again
-            check_offseted_deletions = previous_added_offset < added_offset;
-            if(check_offseted_deletions) {
-                delete deletion_it;
-                deletion_it = nullptr;
+                        snapshot_offset = 0;
+                    } else {
+                        // If the snapshot triple is larger than the largest deletion,
+                        // set the offset to the total number of deletions.
+                        snapshot_offset = deletion_count_data.first;
+                    }
+                }
+                long previous_added_offset = added_offset;
+                added_offset = snapshot_offset;
+
+                // Make a new snapshot iterator for the new offset
+                // TODO: look into reusing the snapshot iterator and applying a relative offset (NOTE: I tried it before, it's trickier than it seems...)
+                delete snapshot_it;
+                snapshot_it = SnapshotManager::search_with_offset(snapshot, pattern, offset + added_offset, dict);
+
+                // Check if we need to loop again
+                check_offseted_deletions = previous_added_offset < added_offset;
+                if(check_offseted_deletions) {
+                    delete deletion_it;
+                    deletion_it = nullptr;
+                }
+            } else {
+                check_offseted_deletions = false;
             }
-        } else {
-            check_offseted_deletions = false;
         }
     }
     return new SnapshotPatchIteratorTripleID(snapshot_it, deletion_it, patchTree->get_spo_comparator(), snapshot, pattern, patchTree, patch_id, offset, deletion_count_data.first, dict);
@@ -194,7 +234,7 @@ std::pair<size_t, hdt::ResultEstimationType> Controller::get_delta_materialized_
         size_t count = 0;
         // the patch_id is a patch not a snapshot
         if (patch_id_start > snapshot_id_start) {
-            int id = patchTreeManager->get_patch_tree_id(patch_id_start);
+            int id = patchTreeManager->get_delta_chain_patch_tree_id(snapshot_id_start);
             std::shared_ptr<DictionaryManager> dict = snapshotManager->get_dictionary_manager(snapshot_id_start);
             std::shared_ptr<PatchTree> pt = patchTreeManager->get_patch_tree(id, dict);
             Triple tp = triple_pattern.get_as_triple(dict);
@@ -217,7 +257,7 @@ std::pair<size_t, hdt::ResultEstimationType> Controller::get_delta_materialized_
         }
         // the patch_id_end is a patch not a snapshot
         if (patch_id_end > snapshot_id_end) {
-            int id = patchTreeManager->get_patch_tree_id(patch_id_end);
+            int id = patchTreeManager->get_delta_chain_patch_tree_id(snapshot_id_end);
             std::shared_ptr<DictionaryManager> dict = snapshotManager->get_dictionary_manager(snapshot_id_end);
             std::shared_ptr<PatchTree> pt = patchTreeManager->get_patch_tree(id, dict);
             Triple tp = triple_pattern.get_as_triple(dict);
@@ -244,16 +284,35 @@ TripleDeltaIterator* Controller::get_delta_materialized(const Triple &triple_pat
 
 TripleDeltaIterator* Controller::get_delta_materialized(const StringTriple &triple_pattern, int offset, int patch_id_start,
                                                         int patch_id_end, bool use_plain_diff) const {
+    return get_delta_materialized(triple_pattern, offset, patch_id_start, patch_id_end,
+                                  use_plain_diff ? DELTA_PLAN_PLAIN_DIFF : DELTA_PLAN_AUTO);
+}
+
+DeltaQueryPlan Controller::plan_delta_materialized(const StringTriple &triple_pattern, int patch_id_start, int patch_id_end) const {
+    return DeltaQueryPlanner(snapshotManager, patchTreeManager).plan(triple_pattern, patch_id_start, patch_id_end);
+}
+
+std::vector<std::vector<Triple>> Controller::get_version_materialized_batch(const std::vector<StringTriple>& triple_patterns, int patch_id) const {
+    return BatchQuery(this, triple_patterns).get_version_materialized(patch_id);
+}
 
-    auto single_delta_query = [this, triple_pattern](int start_id, int end_id, std::shared_ptr<DictionaryManager> dict, bool sort = false) {
+std::vector<std::vector<BatchTripleDelta>> Controller::get_delta_materialized_batch(const std::vector<StringTriple>& triple_patterns,
+                                                                                   int patch_id_start, int patch_id_end) const {
+    return BatchQuery(this, triple_patterns).get_delta_materialized(patch_id_start, patch_id_end);
+}
+
+TripleDeltaIterator* Controller::get_delta_materialized(const StringTriple &triple_pattern, int offset, int patch_id_start,
+                                                        int patch_id_end, DeltaPlanType plan) const {
+    TRACE_SPAN("get_delta_materialized");
+
+    auto single_delta_query = [this, triple_pattern](int snapshot_id, int start_id, int end_id, std::shared_ptr<DictionaryManager> dict, bool sort = false) {
         TripleDeltaIterator* return_it;
-        int patch_tree_id = patchTreeManager->get_patch_tree_id(end_id);
+        int patch_tree_id = patchTreeManager->get_delta_chain_patch_tree_id(snapshot_id);
         std::shared_ptr<PatchTree> patch_tree = patchTreeManager->get_patch_tree(patch_tree_id, dict);
         Triple tp = triple_pattern.get_as_triple(dict);
         if(patch_tree == nullptr) {
             return_it = new EmptyTripleDeltaIterator();
         } else {
-            int snapshot_id = snapshotManager->get_latest_snapshot(start_id);
             // start_id = patch
             if (start_id != snapshot_id) {
                 if (TripleStore::is_default_tree(tp)) {
@@ -300,18 +359,30 @@ TripleDeltaIterator* Controller::get_delta_materialized(const StringTriple &trip
 
     // Both patches are in the same delta chain
     if (snapshot_id_start == snapshot_id_end) {
-        return (single_delta_query(patch_id_start, patch_id_end, dict_end, false))->offset(offset);
+        return (single_delta_query(snapshot_id_end, patch_id_start, patch_id_end, dict_end, false))->offset(offset);
     }
 
     hdt::TripleComponentOrder qr_order = TripleStore::get_query_order(triple_pattern);
 
-    if (use_plain_diff) {
+    if (plan != DELTA_PLAN_PLAIN_DIFF && plan != DELTA_PLAN_PERSISTED_DIFF
+        && plan != DELTA_PLAN_PATCH_TREE_DIFF && plan != DELTA_PLAN_SNAPSHOT_SCAN_DIFF) {
+        plan = plan_delta_materialized(triple_pattern, patch_id_start, patch_id_end).chosen;
+    }
+
+    if (plan == DELTA_PLAN_PLAIN_DIFF) {
+        // Materialized patch versions emit the additions after the snapshot triples, so they must be sorted first
         TripleIterator* it1 = get_version_materialized(triple_pattern, 0, patch_id_start);
         TripleIterator* it2 = get_version_materialized(triple_pattern, 0, patch_id_end);
+        if (patch_id_start != snapshot_id_start) {
+            it1 = new SortedMaterializedTripleIterator(it1, hdt::SPO, dict_start);
+        }
+        if (patch_id_end != snapshot_id_end) {
+            it2 = new SortedMaterializedTripleIterator(it2, hdt::SPO, dict_end);
+        }
         return (new PlainDiffDeltaIterator(it1, it2, dict_start, dict_end))->offset(offset);
     }
 
-    TripleDeltaIterator* snapshot_diff_it = new AutoSnapshotDiffIterator(triple_pattern, snapshotManager, patchTreeManager, snapshot_id_start, snapshot_id_end);
+    TripleDeltaIterator* snapshot_diff_it = new AutoSnapshotDiffIterator(triple_pattern, snapshotManager, patchTreeManager, snapshot_id_start, snapshot_id_end, plan);
     TripleDeltaIterator* delta_it_end = nullptr;
     TripleDeltaIterator* intermediate_it = nullptr;
 
@@ -322,12 +393,12 @@ TripleDeltaIterator* Controller::get_delta_materialized(const StringTriple &trip
 
     // start = patch
     if (patch_id_start != snapshot_id_start) {
-        TripleDeltaIterator* delta_it_start = single_delta_query(snapshot_id_start, patch_id_start, dict_start, false);
+        TripleDeltaIterator* delta_it_start = single_delta_query(snapshot_id_start, snapshot_id_start, patch_id_start, dict_start, false);
         intermediate_it = new MergeDiffIteratorCase2(delta_it_start, snapshot_diff_it, qr_order);
     }
     // end = patch
     if (patch_id_end != snapshot_id_end) {
-        delta_it_end = single_delta_query(snapshot_id_end, patch_id_end, dict_end, false);
+        delta_it_end = single_delta_query(snapshot_id_end, snapshot_id_end, patch_id_end, dict_end, false);
     }
 
     if (intermediate_it) {
@@ -353,9 +424,19 @@ std::pair<size_t, hdt::ResultEstimationType> Controller::get_version_count(const
     size_t count = 0;
     std::vector<int> snapshots = snapshotManager->get_snapshots_ids();
     if (!allowEstimates && snapshots.size() > 1) {
-        TripleVersionsIterator* it = get_version(triple_pattern, 0);
-        count = it->get_count();
-        delete it;
+        // Stream over the sorted triples of every delta chain, so that duplicates across chains
+        // can be filtered out without materializing the full get_version result.
+        hdt::TripleComponentOrder qr_order = TripleStore::get_query_order(triple_pattern);
+        TripleVersionsDistinctCounter counter(qr_order);
+        for (int snapshot: snapshots) {
+            std::shared_ptr<DictionaryManager> dict = snapshotManager->get_dictionary_manager(snapshot);
+            Triple pattern = triple_pattern.get_as_triple(dict);
+            std::shared_ptr<hdt::HDT> hdt = snapshotManager->get_snapshot(snapshot);
+            hdt::IteratorTripleID* snapshot_it = SnapshotManager::search_with_offset(hdt, pattern, 0, dict, true);
+            std::shared_ptr<PatchTree> patchTree = patchTreeManager->get_patch_tree(patchTreeManager->get_delta_chain_patch_tree_id(snapshot), dict);
+            counter.add_iterator(new DeltaChainTripleIterator(pattern, snapshot_it, patchTree, dict, get_delta_chain_end(snapshots, snapshot)));
+        }
+        count = counter.count();
     } else {
         for (int snapshot: snapshots) {
             std::shared_ptr<DictionaryManager> dict = snapshotManager->get_dictionary_manager(snapshot);
@@ -378,7 +459,7 @@ std::pair<size_t, hdt::ResultEstimationType> Controller::get_version_count(const
 
             // Count the additions for all versions
             // We get the ID of the next patch_tree (after the current snapshot)
-            int patch_tree_id = patchTreeManager->get_patch_tree_id(snapshot+1);;
+            int patch_tree_id = patchTreeManager->get_delta_chain_patch_tree_id(snapshot);
             if (patch_tree_id > -1) {
                 std::shared_ptr<PatchTree> patchTree = patchTreeManager->get_patch_tree(patch_tree_id, dict);
                 if (patchTree != nullptr) {
@@ -415,6 +496,7 @@ TripleVersionsIterator* Controller::get_version(const Triple &triple_pattern, in
 }
 
 TripleVersionsIterator *Controller::get_version(const StringTriple &triple_pattern, int offset) const {
+    TRACE_SPAN("get_version");
     hdt::TripleComponentOrder qr_order = TripleStore::get_query_order(triple_pattern);
     std::vector<int> snapshots_id = snapshotManager->get_snapshots_ids();
 
@@ -425,17 +507,77 @@ TripleVersionsIterator *Controller::get_version(const StringTriple &triple_patte
         Triple pattern = triple_pattern.get_as_triple(dict);
         std::shared_ptr<hdt::HDT> snapshot = snapshotManager->get_snapshot(id);
         hdt::IteratorTripleID* snapshot_it = SnapshotManager::search_with_offset(snapshot, pattern, 0, dict, true);
-        int patch_tree_id = patchTreeManager->get_patch_tree_id(id+1);
+        int patch_tree_id = patchTreeManager->get_delta_chain_patch_tree_id(id);
         std::shared_ptr<PatchTree> patchTree = patchTreeManager->get_patch_tree(patch_tree_id, dict);
 //        auto it = new PatchTreeTripleVersionsIterator(pattern, snapshot_it, patchTree, id, dict);
-        auto it = new PatchTreeTripleVersionsIteratorV2(pattern, snapshot_it, patchTree, id, dict);
+        TripleVersionsIterator* it = new PatchTreeTripleVersionsIteratorV2(pattern, snapshot_it, patchTree, id, dict);
+        int chain_end = get_delta_chain_end(snapshots_id, id);
+        if (chain_end != std::numeric_limits<int>::max()) {
+            it = new VersionRangeTripleVersionsIterator(it, id, chain_end);
+        }
         it_version->add_iterator(it);
         delete it;
     }
     return it_version->offset(offset);
 }
 
+TripleVersionsIterator* Controller::get_version_range(const StringTriple &triple_pattern, int offset, int patch_id_start, int patch_id_end) const {
+    int snapshot_id = snapshotManager->get_latest_snapshot(patch_id_start);
+    if (snapshot_id < 0) {
+        // Without a snapshot, there are no triples
+        return new TripleVersionsIteratorCombinedV2(TripleStore::get_query_order(triple_pattern));
+    }
+    snapshotManager->get_snapshot(snapshot_id); // Force a snapshot load
+    std::shared_ptr<DictionaryManager> dict = snapshotManager->get_dictionary_manager(snapshot_id);
+    return get_version_range_ids(triple_pattern.get_as_triple(dict), offset, patch_id_start, patch_id_end);
+}
+
+TripleVersionsIterator* Controller::get_version_range_ids(const Triple &pattern, int offset, int patch_id_start, int patch_id_end) const {
+    TRACE_SPAN("get_version_range");
+    if (patch_id_end < patch_id_start) {
+        throw std::invalid_argument("The end of the version range must not be before its start.");
+    }
+    int snapshot_id = snapshotManager->get_latest_snapshot(patch_id_start);
+    if (snapshot_id < 0) {
+        // Without a snapshot, there are no triples
+        return new TripleVersionsIteratorCombinedV2(TripleStore::get_query_order(pattern));
+    }
+    if (snapshotManager->get_latest_snapshot(patch_id_end) != snapshot_id) {
+        throw std::invalid_argument("The version range must be contained in a single delta chain.");
+    }
+
+    std::shared_ptr<hdt::HDT> snapshot = snapshotManager->get_snapshot(snapshot_id);
+    std::shared_ptr<DictionaryManager> dict = snapshotManager->get_dictionary_manager(snapshot_id);
+    hdt::IteratorTripleID* snapshot_it = SnapshotManager::search_with_offset(snapshot, pattern, 0, dict, true);
+
+    // If only the snapshot is requested, its triples don't have to be looked up in the deletion tree
+    std::shared_ptr<PatchTree> patchTree = nullptr;
+    int patch_tree_id = patchTreeManager->get_delta_chain_patch_tree_id(snapshot_id);
+    if (patch_id_end > snapshot_id && patch_tree_id >= 0) {
+        patchTree = patchTreeManager->get_patch_tree(patch_tree_id, dict);
+    }
+    auto it = new PatchTreeTripleVersionsIteratorV2(pattern, snapshot_it, patchTree, snapshot_id, dict);
+    return (new VersionRangeTripleVersionsIterator(it, patch_id_start, patch_id_end))->offset(offset);
+}
+
 bool Controller::append(PatchElementIterator* patch_it, int patch_id, std::shared_ptr<DictionaryManager> dict, bool check_uniqueness, hdt::ProgressListener* progressListener) {
+    // Register a background snapshot if it is ready, so that this patch is appended to its delta chain.
+    if (is_snapshot_creation_pending() && finish_snapshot_creation(false, progressListener)) {
+        std::shared_ptr<DictionaryManager> snapshot_dict = snapshotManager->get_dictionary_manager(snapshotManager->get_latest_snapshot(patch_id));
+        if (snapshot_dict != dict) {
+            // The patch was encoded with the dictionary of the previous snapshot
+            PatchSorted patch(snapshot_dict);
+            PatchElement element(Triple(0, 0, 0), false);
+            while (patch_it->next(&element)) {
+                const Triple& triple = element.get_triple();
+                patch.add_unsorted(PatchElement(Triple(triple.get_subject(*dict), triple.get_predicate(*dict), triple.get_object(*dict), snapshot_dict), element.is_addition()));
+            }
+            patch.sort();
+            PatchElementIteratorVector it(&patch.get_vector());
+            return append(&it, patch_id, snapshot_dict, check_uniqueness, progressListener);
+        }
+    }
+
     // Detect if we need to construct a new patchTree (when last patch triggered a new snapshot)
     int snapshot_id = snapshotManager->get_latest_snapshot(patch_id);
     int patch_tree_id = patchTreeManager->get_patch_tree_id(patch_id);
@@ -450,14 +592,38 @@ bool Controller::append(PatchElementIterator* patch_it, int patch_id, std::share
     auto istop = std::chrono::high_resolution_clock::now();
     auto iduration = std::chrono::duration_cast<std::chrono::milliseconds>(istop - istart);
     metadata->ingestion_times = metadata_manager->store_uint64("ingest-time", snapshot_id, iduration.count());
+    {
+        std::lock_guard<std::mutex> lock(ingest_metrics_mutex);
+        ingest_metrics.appends++;
+        ingest_metrics.failed_appends += status ? 0 : 1;
+        ingest_metrics.elements += patch_it->getPassed();
+        ingest_metrics.seconds += std::chrono::duration<double>(istop - istart).count();
+    }
 
+    // While a snapshot is being created in the background, this patch is only provisional.
+    // Its metadata is stored once it is rebased onto the new snapshot, and no other snapshot is started.
+    if (is_snapshot_creation_pending()) {
+        return status;
+    }
     std::shared_ptr<PatchTree> pt = patchTreeManager->get_patch_tree(patch_tree_id, dict);
+    store_strategy_metadata(patch_id, snapshot_id, patch_it->getPassed(), pt, dict);
 
+    // If we need to create a new snapshot:
+    // - We do a VM query on the current patch_id
+    // - We use the result of the query to make a new snapshot
+    // - (optional) we delete the current patch_id in the patch_tree ?
+    if (strategy != nullptr && strategy->doCreate(*metadata)) {
+        create_snapshot(patch_id, dict, progressListener);
+    }
+    return status;
+}
+
+void Controller::store_strategy_metadata(int patch_id, int snapshot_id, size_t patch_size, std::shared_ptr<PatchTree> pt,
+                                         std::shared_ptr<DictionaryManager> dict) {
     // Fill the metadata struct for strategy
-    // Maybe move it to its own separate function later ?
     Triple tp("", "", "", dict);
     metadata->patch_id = patch_id;
-    metadata->delta_sizes = metadata_manager->store_uint64("delta-size", snapshot_id, patch_it->getPassed());
+    metadata->delta_sizes = metadata_manager->store_uint64("delta-size", snapshot_id, patch_size);
     size_t add_count = pt->addition_count(patch_id, tp);
     size_t del_count = pt->deletion_count(tp, patch_id).first;
     metadata->agg_delta_sizes = metadata_manager->store_uint64("agg-delta-size", snapshot_id, add_count + del_count);
@@ -469,35 +635,146 @@ bool Controller::append(PatchElementIterator* patch_it, int patch_id, std::share
     metadata->change_ratios = metadata_manager->store_double("change-ratio", snapshot_id, change_ratio);
     if (metadata->agg_delta_sizes.size() > 1) {
         uint64_t prev_ver_size = metadata->version_sizes[metadata->version_sizes.size()-2];
-        double loc_cr = (double) patch_it->getPassed() / (prev_ver_size + patch_it->getPassed());
+        double loc_cr = (double) patch_size / (prev_ver_size + patch_size);
         metadata->loc_change_ratios = metadata_manager->store_double("local-change-ratio", snapshot_id, loc_cr);
     } else {
         metadata->loc_change_ratios = metadata_manager->store_double("local-change-ratio", snapshot_id, 0.0);
     }
+}
 
-    // If we need to create a new snapshot:
-    // - We do a VM query on the current patch_id
-    // - We use the result of the query to make a new snapshot
-    // - (optional) we delete the current patch_id in the patch_tree ?
-    bool create_snapshot = strategy != nullptr && strategy->doCreate(*metadata);
-    if (create_snapshot) {
-        NOTIFYMSG(progressListener, "\nCreating snapshot from patch...\n");
-        NOTIFYMSG(progressListener, "\nMaterializing version ...\n");
-        TripleIterator* triples_vm = get_version_materialized(Triple("", "", "", dict), 0, patch_id);
-        //TODO: custom IteratorTripleString to not have to buffer triples
-        std::vector<hdt::TripleString> triples;
-        Triple t;
-        while (triples_vm->next(&t)) {
-            triples.emplace_back(t.get_subject(*dict), t.get_predicate(*dict), t.get_object(*dict));
-        }
-        delete triples_vm;
-        IteratorTripleStringVector vec_it(&triples);
+void Controller::create_snapshot(int patch_id, std::shared_ptr<DictionaryManager> dict, hdt::ProgressListener* progressListener) {
+    // Materializing the version is not part of the query workload
+    BufferPool::IngestScope ingest_scope;
+    {
+        std::lock_guard<std::mutex> lock(ingest_metrics_mutex);
+        ingest_metrics.snapshots++;
+    }
+    NOTIFYMSG(progressListener, "\nCreating snapshot from patch...\n");
+    NOTIFYMSG(progressListener, "\nMaterializing version ...\n");
+    // The version is streamed twice in ID space (once for the dictionary, once for the triples) instead of buffered
+    TripleIteratorFactory vm_factory = [this, dict, patch_id]() {
+        return get_version_materialized(Triple("", "", "", dict), 0, patch_id);
+    };
+    if (async_snapshots) {
+        // Later patches don't change the materialization of this version, so this is a consistent view.
+        NOTIFYMSG(progressListener, "\nCreating new snapshot in the background ...\n");
+        pending_snapshot_id = patch_id;
+        pending_snapshot_dict = dict;
+        pending_snapshot = std::async(std::launch::async, [this, vm_factory, dict, patch_id]() {
+            BufferPool::IngestScope ingest_scope;
+            snapshotManager->build_snapshot(patch_id, vm_factory, dict, BASEURI);
+            build_snapshot_diff(patch_id, dict);
+            // The index is generated here, so that loading the snapshot afterwards does not block queries
+            snapshotManager->build_index(patch_id);
+        });
+    } else {
         NOTIFYMSG(progressListener, "\nCreating new snapshot ...\n");
-        std::cout.setstate(std::ios_base::failbit); // Disable cout info from HDT
-        snapshotManager->create_snapshot(patch_id, &vec_it, BASEURI, progressListener);
-        std::cout.clear();
+        // HDT reports to the listener of each call. std::cout is not silenced,
+        // as toggling the shared stream races with snapshots that are loaded on other threads.
+        snapshotManager->build_snapshot(patch_id, vm_factory, dict, BASEURI, progressListener);
+        NOTIFYMSG(progressListener, "\nStoring diff from the previous snapshot ...\n");
+        build_snapshot_diff(patch_id, dict);
+        // The append only returns once the new snapshot has been loaded and indexed
+        snapshotManager->preload_snapshots({patch_id}, true);
     }
-    return status;
+}
+
+void Controller::build_snapshot_diff(int snapshot_id, std::shared_ptr<DictionaryManager> dict) {
+    int previous_id = snapshotManager->get_latest_snapshot(snapshot_id - 1);
+    if (previous_id < 0) {
+        return;
+    }
+    try {
+        std::shared_ptr<PatchTree> patch_tree = patchTreeManager->get_patch_tree(patchTreeManager->get_delta_chain_patch_tree_id(previous_id), dict);
+        if (patch_tree == nullptr) {
+            return;
+        }
+        std::vector<std::pair<Triple, bool>> elements;
+        ForwardPatchTripleDeltaIterator<PatchTreeDeletionValue> delta_it(patch_tree, Triple(0, 0, 0), snapshot_id, dict);
+        TripleDelta td;
+        while (delta_it.next(&td)) {
+            elements.emplace_back(*td.get_triple(), td.is_addition());
+        }
+        SnapshotDiff::write(basePath + SNAPSHOT_DIFF_FILENAME(previous_id, snapshot_id), previous_id, snapshot_id, elements, dict);
+    } catch (const std::exception& e) {
+        // Queries across both snapshots can still diff them on the fly
+        std::cerr << "Could not store the diff of snapshot " << snapshot_id << ": " << e.what() << std::endl;
+    }
+}
+
+void Controller::set_async_snapshot_creation(bool async) {
+    async_snapshots = async;
+}
+
+bool Controller::is_snapshot_creation_pending() const {
+    return pending_snapshot.valid();
+}
+
+bool Controller::finish_snapshot_creation(bool wait, hdt::ProgressListener* progressListener) {
+    if (!pending_snapshot.valid()) {
+        return true;
+    }
+    if (!wait && pending_snapshot.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        return false;
+    }
+    int snapshot_id = pending_snapshot_id;
+    std::shared_ptr<DictionaryManager> old_dict = pending_snapshot_dict;
+    pending_snapshot_id = -1;
+    pending_snapshot_dict = nullptr;
+    pending_snapshot.get(); // Rethrows any exception from the background thread
+    BufferPool::IngestScope ingest_scope;
+
+    // Decode the provisional patches from the previous delta chain.
+    // They are kept in the old patch tree, where queries ignore them once the new snapshot is registered.
+    NOTIFYMSG(progressListener, "\nRebasing provisional patches...\n");
+    int previous_id = snapshotManager->get_latest_snapshot(snapshot_id - 1);
+    std::shared_ptr<PatchTree> old_patch_tree = patchTreeManager->get_patch_tree(patchTreeManager->get_delta_chain_patch_tree_id(previous_id), old_dict);
+    int max_patch_id = old_patch_tree->get_max_patch_id();
+    std::vector<std::vector<std::pair<StringTriple, bool>>> provisional_patches;
+    for (int patch_id = snapshot_id + 1; patch_id <= max_patch_id; patch_id++) {
+        std::vector<std::pair<StringTriple, bool>> elements;
+        ForwardDiffPatchTripleDeltaIterator<PatchTreeDeletionValue> delta_it(old_patch_tree, Triple(0, 0, 0), patch_id - 1, patch_id, old_dict);
+        TripleDelta td;
+        while (delta_it.next(&td)) {
+            Triple* t = td.get_triple();
+            elements.emplace_back(StringTriple(t->get_subject(*old_dict), t->get_predicate(*old_dict), t->get_object(*old_dict)), td.is_addition());
+        }
+        provisional_patches.push_back(std::move(elements));
+    }
+
+    // Append the provisional patches again, relative to the new snapshot.
+    // The new patch tree is complete before the snapshot is registered, and queries resolve patch trees from their snapshot,
+    // so they either see the previous delta chain with the provisional patches, or the new one with the rebased patches.
+    std::shared_ptr<hdt::HDT> snapshot;
+    std::shared_ptr<DictionaryManager> dict;
+    auto open_start = std::chrono::steady_clock::now();
+    std::tie(snapshot, dict) = snapshotManager->open_snapshot(snapshot_id);
+    std::chrono::duration<double> open_duration = std::chrono::steady_clock::now() - open_start;
+    if (!provisional_patches.empty()) {
+        patchTreeManager->construct_next_patch_tree(snapshot_id + 1, dict);
+    }
+    int patch_id = snapshot_id + 1;
+    for (auto& elements : provisional_patches) {
+        PatchSorted patch(dict);
+        for (auto& element : elements) {
+            patch.add_unsorted(PatchElement(element.first.get_as_triple(dict), element.second));
+        }
+        patch.sort();
+        patchTreeManager->append(patch, patch_id++, dict, false, progressListener);
+    }
+
+    // Register the new snapshot
+    snapshotManager->register_snapshot(snapshot_id, snapshot, dict, open_duration.count());
+
+    // The metadata of the rebased patches can only be computed against the registered snapshot.
+    // Whether they trigger the next snapshot is decided by the next append.
+    if (!provisional_patches.empty()) {
+        std::shared_ptr<PatchTree> patch_tree = patchTreeManager->get_patch_tree(patchTreeManager->get_delta_chain_patch_tree_id(snapshot_id), dict);
+        for (size_t i = 0; i < provisional_patches.size(); i++) {
+            store_strategy_metadata(snapshot_id + 1 + i, snapshot_id, provisional_patches[i].size(), patch_tree, dict);
+        }
+    }
+    return true;
 }
 
 bool Controller::append(const PatchSorted& patch, int patch_id, std::shared_ptr<DictionaryManager> dict, bool check_uniqueness,
@@ -566,6 +843,10 @@ void Controller::cleanup(std::string basePath, Controller* controller) {
         int id = *itS;
         std::remove((basePath + SNAPSHOT_FILENAME_BASE(id)).c_str());
         std::remove((basePath + SNAPSHOT_FILENAME_BASE(id) + ".index.v1-1").c_str());
+        if (itS != snapshots.begin()) {
+            std::remove((basePath + SNAPSHOT_ID_MAP_FILENAME(*std::prev(itS), id)).c_str());
+            std::remove((basePath + SNAPSHOT_DIFF_FILENAME(*std::prev(itS), id)).c_str());
+        }
 
         patchDictsToDelete.push_back(id);
         itS++;
@@ -587,19 +868,52 @@ void Controller::cleanup(std::string basePath, Controller* controller) {
 
     // Delete strategy metadata database
     std::remove((basePath + "ingestion_metadata.kch").c_str());
+
+    // Delete the page cache access counts, which are stored when the controller is deleted
+    std::remove((basePath + BUFFER_POOL_ACCESSES_FILENAME).c_str());
 }
 
 PatchBuilder* Controller::new_patch_bulk() {
+    finish_snapshot_creation(false);
     return new PatchBuilder(this);
 }
 
 PatchBuilderStreaming *Controller::new_patch_stream() {
+    finish_snapshot_creation(false);
     return new PatchBuilderStreaming(this);
 }
 
+void Controller::set_ingest_memory_budget(size_t bytes) {
+    ingest_memory_budget = bytes;
+}
+
+void Controller::set_memory_budget(size_t bytes) {
+    memory_budget->set_limit(bytes);
+}
+
+size_t Controller::get_memory_usage() const {
+    return patchTreeManager->get_memory_usage() + snapshotManager->get_memory_usage();
+}
+
+StoreMetrics Controller::get_metrics() const {
+    StoreMetrics metrics;
+    metrics.snapshots = snapshotManager->get_cache_metrics();
+    metrics.patch_trees = patchTreeManager->get_cache_metrics();
+    metrics.trees = patchTreeManager->get_tree_metrics();
+    metrics.dictionaries = snapshotManager->get_dictionary_lookups();
+    {
+        std::lock_guard<std::mutex> lock(ingest_metrics_mutex);
+        metrics.ingest = ingest_metrics;
+    }
+    metrics.memory_usage = get_memory_usage();
+    metrics.memory_limit = memory_budget->get_limit();
+    return metrics;
+}
+
 bool Controller::ingest(const std::vector<std::pair<hdt::IteratorTripleString *, bool>> &files, int patch_id, bool sort,
                         hdt::ProgressListener *progressListener) {
-
+    // Register a background snapshot if it is ready, before determining the dictionary to encode the patch with.
+    finish_snapshot_creation(false, progressListener);
 
     std::shared_ptr<DictionaryManager> dict;
 
@@ -607,14 +921,15 @@ bool Controller::ingest(const std::vector<std::pair<hdt::IteratorTripleString *,
 
     // Initialize iterators
     CombinedTripleIterator *it_snapshot = nullptr;
-    PatchElementIteratorCombined *it_patch = nullptr;
+    IngestPipeline *pipeline = nullptr;
     if (first) {
         it_snapshot = new CombinedTripleIterator();
     } else {
         int snapshot_id = snapshotManager->get_latest_snapshot(patch_id);
         snapshotManager->load_snapshot(snapshot_id);
         dict = snapshotManager->get_dictionary_manager(snapshot_id);
-        it_patch = new PatchElementIteratorCombined(PatchTreeKeyComparator(comp_s, comp_p, comp_o, dict));
+        pipeline = new IngestPipeline(dict, sort, progressListener, 0, INGEST_CHUNK_SIZE, INGEST_QUEUE_CAPACITY,
+                                      ingest_memory_budget, basePath);
     }
 
     for (auto &file: files) {
@@ -625,42 +940,35 @@ bool Controller::ingest(const std::vector<std::pair<hdt::IteratorTripleString *,
             }
             it_snapshot->appendIterator(file.first);
         } else {
-            it_patch->appendIterator(new PatchElementIteratorTripleStrings(dict, file.first, file.second));
+            pipeline->add_file(file.first, file.second);
         }
     }
 
     size_t added;
     if (first) {
         NOTIFYMSG(progressListener, "\nCreating snapshot...\n");
-        std::cout.setstate(std::ios_base::failbit); // Disable cout info from HDT
         auto istart = std::chrono::high_resolution_clock::now();
         std::shared_ptr<hdt::HDT> hdt = snapshotManager->create_snapshot(patch_id, it_snapshot, BASEURI, progressListener);
         auto istop = std::chrono::high_resolution_clock::now();
         auto iduration = std::chrono::duration_cast<std::chrono::milliseconds>(istop - istart);
         metadata_manager->store_uint64("ingest-time", patch_id, iduration.count());
-        std::cout.clear();
         added = hdt->getTriples()->getNumberOfElements();
         delete it_snapshot;
     } else {
-        if (sort) {
-            NOTIFYMSG(progressListener, "\nSorting patch...\n");
-            auto* comparator = new PatchElementComparator(new PatchTreeKeyComparator(comp_s, comp_p, comp_o, dict));
-            PatchSorted patch_sorted(comparator);
-            PatchElement patch_element;
-            while (it_patch->next(&patch_element)) {
-                patch_sorted.add_unsorted(patch_element);
-            }
-            patch_sorted.sort();
-            NOTIFYMSG(progressListener, "\nAppending patch...\n");
-            append(patch_sorted, patch_id, dict, false, progressListener);
-            added = patch_sorted.get_size();
-            delete comparator;
-        } else {
-            NOTIFYMSG(progressListener, "\nAppending patch...\n");
+        // Files are parsed, encoded and sorted in parallel, while the result is appended on this thread.
+        NOTIFYMSG(progressListener, sort ? "\nSorting and appending patch...\n" : "\nAppending patch...\n");
+        try {
+            PatchElementIterator* it_patch = pipeline->start();
+            // A file that fails to parse aborts the ingest before anything is appended
+            pipeline->wait_until_sorted();
             append(it_patch, patch_id, dict, false, progressListener);
-            added = it_patch->getPassed();
+            added = pipeline->finish();
+        } catch (const std::exception& e) {
+            cerr << "Failed to ingest patch " << patch_id << ": " << e.what() << endl;
+            delete pipeline;
+            return false;
         }
-        delete it_patch;
+        delete pipeline;
     }
 
     NOTIFYMSG(progressListener, ("\nInserted " + to_string(added) + " for version " + to_string(patch_id) + ".\n").c_str());
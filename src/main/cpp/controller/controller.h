@@ -7,9 +7,13 @@
 #include "patch_builder.h"
 #include "patch_builder_streaming.h"
 #include "triple_delta_iterator.h"
+#include "batch_query.h"
 #include "triple_versions_iterator.h"
 #include "snapshot_creation_strategy.h"
 #include "metadata_manager.h"
+#include "metrics.h"
+#include <future>
+#include <mutex>
 
 
 class Controller {
@@ -21,6 +25,46 @@ private:
 
     MetadataManager* metadata_manager;
 
+    std::string basePath;
+    // The number of bytes that may be used for sorting a patch during ingestion, 0 for unbounded
+    size_t ingest_memory_budget;
+    // The number of bytes that the loaded snapshots and patch trees may use together
+    std::shared_ptr<MemoryBudget> memory_budget;
+    // Counters of the appended patches
+    IngestMetrics ingest_metrics;
+    mutable std::mutex ingest_metrics_mutex;
+
+    // State of the snapshot that is being created in the background
+    bool async_snapshots;
+    std::future<void> pending_snapshot;
+    int pending_snapshot_id;
+    std::shared_ptr<DictionaryManager> pending_snapshot_dict;
+
+    /**
+     * Store the diff between the previous snapshot and a new snapshot,
+     * which is the delta of the last patch of the previous delta chain.
+     * @param snapshot_id The id of the new snapshot
+     * @param dict The dictionary of the previous snapshot
+     */
+    void build_snapshot_diff(int snapshot_id, std::shared_ptr<DictionaryManager> dict);
+    /**
+     * Store the metadata of an appended patch, on which the snapshot creation strategy decides.
+     * @param patch_id The id of the appended patch
+     * @param snapshot_id The id of the snapshot of its delta chain
+     * @param patch_size The number of elements in the patch
+     * @param pt The patch tree of the delta chain
+     * @param dict The dictionary of the snapshot
+     */
+    void store_strategy_metadata(int patch_id, int snapshot_id, size_t patch_size, std::shared_ptr<PatchTree> pt,
+                                 std::shared_ptr<DictionaryManager> dict);
+    /**
+     * Create a snapshot from the materialization of a patch, in the background if enabled.
+     * @param patch_id The id of the patch that becomes a snapshot
+     * @param dict The dictionary of the delta chain of the patch
+     * @param progressListener an optional progress listener.
+     */
+    void create_snapshot(int patch_id, std::shared_ptr<DictionaryManager> dict, hdt::ProgressListener* progressListener);
+
 public:
     explicit Controller(const string& basePath, int8_t kc_opts = 0, bool readonly = false, size_t cache_size = 4);
     Controller(const string& basePath, SnapshotCreationStrategy* strategy, int8_t kc_opts = 0, bool readonly = false, size_t cache_size = 4);
@@ -34,8 +78,26 @@ public:
      */
     TripleIterator* get_version_materialized(const Triple &triple_pattern, int offset, int patch_id) const;
     TripleIterator* get_version_materialized(const StringTriple &triple_pattern, int offset, int patch_id) const;
+    /**
+     * Get an iterator for all triples matching the given triple pattern with a certain offset
+     * in the list of all triples for the given patch id, without translating the pattern.
+     * @param triple_pattern Only triples matching this pattern will be returned,
+     *                       encoded with the dictionary of get_dictionary_manager(patch_id).
+     * @param offset A certain offset the iterator should start with.
+     * @param patch_id The patch id for which triples should be returned.
+     */
+    TripleIterator* get_version_materialized_ids(const Triple &triple_pattern, int offset, int patch_id) const;
     std::pair<size_t, hdt::ResultEstimationType> get_version_materialized_count(const Triple& triple_pattern, int patch_id, bool allowEstimates = false) const;
     std::pair<size_t, hdt::ResultEstimationType> get_version_materialized_count(const StringTriple& triple_pattern, int patch_id, bool allowEstimates = false) const;
+    /**
+     * Count the triples matching the given triple pattern for the given patch id, without translating the pattern.
+     * @param triple_pattern Only triples matching this pattern will be counted,
+     *                       encoded with the dictionary of get_dictionary_manager(patch_id).
+     * @param patch_id The patch id for which triples should be counted.
+     * @param allowEstimates If the snapshot count may be an estimate.
+     * @return The count, and if it is exact.
+     */
+    std::pair<size_t, hdt::ResultEstimationType> get_version_materialized_count_ids(const Triple& triple_pattern, int patch_id, bool allowEstimates = false) const;
     size_t get_version_materialized_count_estimated(const Triple& triple_pattern, int patch_id) const;
     /**
      * Get an addition/deletion iterator for all triples matching the given triple pattern with a certain offset
@@ -47,6 +109,41 @@ public:
      */
     TripleDeltaIterator* get_delta_materialized(const Triple &triple_pattern, int offset, int patch_id_start, int patch_id_end) const;
     TripleDeltaIterator* get_delta_materialized(const StringTriple &triple_pattern, int offset, int patch_id_start, int patch_id_end, bool use_plain_diff = false) const;
+    /**
+     * Get an addition/deletion iterator, computed with the given plan.
+     * @param triple_pattern Only triples matching this pattern will be returned.
+     * @param offset A certain offset the iterator should start with.
+     * @param patch_id_start The start version.
+     * @param patch_id_end The end version.
+     * @param plan The plan to compute the delta with, DELTA_PLAN_AUTO picks the cheapest one.
+     *             Plans that can not be used for versions in different delta chains are ignored.
+     */
+    TripleDeltaIterator* get_delta_materialized(const StringTriple &triple_pattern, int offset, int patch_id_start, int patch_id_end, DeltaPlanType plan) const;
+    /**
+     * Estimate the costs of the plans to compute the delta between two versions.
+     * @param triple_pattern The triple pattern.
+     * @param patch_id_start The start version.
+     * @param patch_id_end The end version.
+     * @return The plan that would be chosen by get_delta_materialized, with the estimates of all plans.
+     */
+    DeltaQueryPlan plan_delta_materialized(const StringTriple &triple_pattern, int patch_id_start, int patch_id_end) const;
+    /**
+     * Get the triples matching each of the given triple patterns in a version.
+     * Patterns that share an index prefix are answered with a single scan.
+     * @param triple_patterns The triple patterns.
+     * @param patch_id The version.
+     * @return For each pattern, the matching triples, encoded with the dictionary of the version.
+     */
+    std::vector<std::vector<Triple>> get_version_materialized_batch(const std::vector<StringTriple>& triple_patterns, int patch_id) const;
+    /**
+     * Get the additions and deletions matching each of the given triple patterns between two versions.
+     * Patterns that share an index prefix are answered with a single scan.
+     * @param triple_patterns The triple patterns.
+     * @param patch_id_start The start version.
+     * @param patch_id_end The end version.
+     * @return For each pattern, the matching elements of the delta.
+     */
+    std::vector<std::vector<BatchTripleDelta>> get_delta_materialized_batch(const std::vector<StringTriple>& triple_patterns, int patch_id_start, int patch_id_end) const;
     std::pair<size_t, hdt::ResultEstimationType> get_delta_materialized_count(const Triple& triple_pattern, int patch_id_start, int patch_id_end, bool allowEstimates = false) const;
     std::pair<size_t, hdt::ResultEstimationType> get_delta_materialized_count(const StringTriple& triple_pattern, int patch_id_start, int patch_id_end, bool allowEstimates = false) const;
     size_t get_delta_materialized_count_estimated(const Triple& triple_pattern, int patch_id_start, int patch_id_end) const;
@@ -63,6 +160,26 @@ public:
     std::pair<size_t, hdt::ResultEstimationType> get_version_count(const Triple& triple_pattern, bool allowEstimates = false) const;
     std::pair<size_t, hdt::ResultEstimationType> get_version_count(const StringTriple& triple_pattern, bool allowEstimates = false) const;
     size_t get_version_count_estimated(const Triple& triple_pattern) const;
+    /**
+     * Get an iterator for all triples matching the given triple pattern in a range of versions of a single delta chain.
+     * The snapshot and the patch tree are only scanned once for all versions.
+     * Triples are annotated with the versions in the range in which they are valid.
+     * @param triple_pattern Only triples matching this pattern will be returned.
+     * @param offset A certain offset the iterator should start with.
+     * @param patch_id_start The first version of the range.
+     * @param patch_id_end The last version of the range, which must be in the same delta chain as patch_id_start.
+     */
+    TripleVersionsIterator* get_version_range(const StringTriple &triple_pattern, int offset, int patch_id_start, int patch_id_end) const;
+    /**
+     * Get an iterator for all triples matching the given triple pattern in a range of versions of a single delta chain,
+     * in the query order of the pattern, without translating the pattern.
+     * @param triple_pattern Only triples matching this pattern will be returned,
+     *                       encoded with the dictionary of get_dictionary_manager(patch_id_start).
+     * @param offset A certain offset the iterator should start with.
+     * @param patch_id_start The first version of the range.
+     * @param patch_id_end The last version of the range, which must be in the same delta chain as patch_id_start.
+     */
+    TripleVersionsIterator* get_version_range_ids(const Triple &triple_pattern, int offset, int patch_id_start, int patch_id_end) const;
 
     /**
      * Add the given patch to a patch tree.
@@ -72,6 +189,8 @@ public:
      * @param progressListener an optional progress listener.
      * @return If the append succeeded.
      * @note The patch iterator MUST provide triples sorted by SPO.
+     * @note A snapshot that was created in the background is registered first if it is ready,
+     *       in which case a patch that was encoded with the previous dictionary is encoded again.
      */
     bool append(PatchElementIterator* patch_it, int patch_id, std::shared_ptr<DictionaryManager> dict, bool check_uniqueness = true, hdt::ProgressListener* progressListener = NULL);
     /**
@@ -128,12 +247,61 @@ public:
 
     CreationStrategyMetadata* get_strategy_metadata();
 
+    /**
+     * Enable or disable the creation of snapshots in the background.
+     * When enabled, the snapshot for version n is built on a separate thread,
+     * while the following patches are provisionally appended to the delta chain of the previous snapshot.
+     * Once the snapshot is ready, it is registered and the provisional patches are rebased onto it
+     * by finish_snapshot_creation.
+     * @param async If snapshots should be created in the background.
+     */
+    void set_async_snapshot_creation(bool async);
+    /**
+     * @return If a snapshot is currently being created in the background.
+     */
+    bool is_snapshot_creation_pending() const;
+    /**
+     * Register the snapshot that is being created in the background, if any,
+     * and rebase the patches that were appended in the meantime onto it.
+     * @param wait If we should block until the snapshot is ready,
+     *             otherwise nothing happens if the snapshot is still being built.
+     * @param progressListener an optional progress listener.
+     * @return If no snapshot is pending anymore.
+     */
+    bool finish_snapshot_creation(bool wait = true, hdt::ProgressListener* progressListener = nullptr);
+
+    /**
+     * Limit the memory that is used for sorting and merging patches in ingest.
+     * Sorted runs that exceed this budget are spilled to temporary files in the store's directory.
+     * @param bytes The memory budget in bytes, 0 for unbounded.
+     */
+    void set_ingest_memory_budget(size_t bytes);
+    /**
+     * Limit the memory that the loaded snapshots, their dictionaries and the patch trees use together.
+     * Objects that are not in use are unloaded when their kind exceeds its share of the budget, next to the limit on their number.
+     * The patch trees get the part of the budget for their page caches, the snapshots and dictionaries get the rest.
+     * The page caches of the patch trees that are loaded afterwards are sized after this budget.
+     * @param bytes The memory budget in bytes, 0 for unbounded.
+     */
+    void set_memory_budget(size_t bytes);
+    /**
+     * @return The number of bytes that the loaded snapshots, their dictionaries and the patch trees use.
+     */
+    size_t get_memory_usage() const;
+    /**
+     * @return The current cache, KC tree, dictionary, ingest and memory metrics of this store.
+     */
+    StoreMetrics get_metrics() const;
+
     /**
     * Add the content from the given files to the patch tree
     * Create new snapshots when relevant, according to the given strategy.
+    * Patch files are parsed and encoded in parallel, with one thread per file, and sorted by a pool of threads.
     * @param files The list of files to ingest as a pair of filenames and boolean indicating if it's additions.
     * @param patch_id The id of the patch.
-    * @param sort if the triples needs to be sorted before insertion
+    * @param sort if the triples needs to be sorted before insertion,
+    *             if so, nothing is appended when one of the files can not be parsed
+    * @param progressListener an optional listener, which also receives the throughput of each ingestion stage
     * @return if ingestion has succeeded
     */
     bool ingest(const std::vector<std::pair<hdt::IteratorTripleString*, bool>>& files, int patch_id, bool sort = false, hdt::ProgressListener* progressListener = nullptr);
@@ -0,0 +1,135 @@
+#include <algorithm>
+#include <sstream>
+#include "delta_query_planner.h"
+#include "../patch/triple_store.h"
+
+std::string DeltaQueryPlan::get_name(DeltaPlanType type) {
+    switch (type) {
+        case DELTA_PLAN_AUTO: return "auto";
+        case DELTA_PLAN_EMPTY: return "empty";
+        case DELTA_PLAN_SINGLE_CHAIN: return "single-chain";
+        case DELTA_PLAN_PLAIN_DIFF: return "plain-diff";
+        case DELTA_PLAN_PERSISTED_DIFF: return "persisted-diff";
+        case DELTA_PLAN_PATCH_TREE_DIFF: return "patch-tree-diff";
+        case DELTA_PLAN_SNAPSHOT_SCAN_DIFF: return "snapshot-scan-diff";
+    }
+    return "unknown";
+}
+
+std::string DeltaQueryPlan::to_string() const {
+    std::stringstream ss;
+    ss << get_name(chosen);
+    for (const DeltaPlanEstimate& estimate : estimates) {
+        ss << " " << get_name(estimate.type) << "=";
+        if (estimate.feasible) {
+            ss << estimate.cost;
+        } else {
+            ss << "n/a";
+        }
+    }
+    return ss.str();
+}
+
+DeltaQueryPlanner::DeltaQueryPlanner(SnapshotManager* snapshot_manager, PatchTreeManager* patch_tree_manager)
+        : snapshot_manager(snapshot_manager), patch_tree_manager(patch_tree_manager) {}
+
+size_t DeltaQueryPlanner::estimate_snapshot(const StringTriple& triple_pattern, int snapshot_id) const {
+    std::shared_ptr<hdt::HDT> hdt = snapshot_manager->get_snapshot(snapshot_id);
+    std::shared_ptr<DictionaryManager> dict = snapshot_manager->get_dictionary_manager(snapshot_id);
+    hdt::IteratorTripleID* it = SnapshotManager::search_with_offset(hdt, triple_pattern.get_as_triple(dict), 0, dict);
+    size_t count = it->estimatedNumResults();
+    delete it;
+    return count;
+}
+
+size_t DeltaQueryPlanner::estimate_patch(const StringTriple& triple_pattern, int patch_id, int snapshot_id) const {
+    if (patch_id == snapshot_id) {
+        return 0;
+    }
+    int patch_tree_id = patch_tree_manager->get_delta_chain_patch_tree_id(snapshot_id);
+    if (patch_tree_id < 0) {
+        return 0;
+    }
+    std::shared_ptr<DictionaryManager> dict = snapshot_manager->get_dictionary_manager(snapshot_id);
+    std::shared_ptr<PatchTree> patch_tree = patch_tree_manager->get_patch_tree(patch_tree_id, dict);
+    if (patch_tree == nullptr) {
+        return 0;
+    }
+    Triple tp = triple_pattern.get_as_triple(dict);
+    return patch_tree->deletion_count(tp, patch_id).first + patch_tree->addition_count(patch_id, tp);
+}
+
+DeltaQueryPlan DeltaQueryPlanner::plan(const StringTriple& triple_pattern, int patch_id_start, int patch_id_end) const {
+    DeltaQueryPlan plan{DELTA_PLAN_EMPTY, {}};
+    if (patch_id_end <= patch_id_start) {
+        return plan;
+    }
+    int snapshot_id_start = snapshot_manager->get_latest_snapshot(patch_id_start);
+    int snapshot_id_end = snapshot_manager->get_latest_snapshot(patch_id_end);
+    if (snapshot_id_start < 0 || snapshot_id_end < 0) {
+        return plan;
+    }
+
+    size_t delta_start = estimate_patch(triple_pattern, patch_id_start, snapshot_id_start);
+    size_t delta_end = estimate_patch(triple_pattern, patch_id_end, snapshot_id_end);
+    if (snapshot_id_start == snapshot_id_end) {
+        plan.chosen = DELTA_PLAN_SINGLE_CHAIN;
+        plan.estimates.push_back({DELTA_PLAN_SINGLE_CHAIN, true, (delta_start + delta_end) * DELTA_PLAN_COST_PATCH});
+        return plan;
+    }
+
+    // The snapshot diff plans merge the deltas of both versions relative to their snapshot into the diff,
+    // the plain diff plan compares the materialized versions, which are encoded with different dictionaries.
+    size_t merged_deltas = (delta_start + delta_end) * (DELTA_PLAN_COST_PATCH + DELTA_PLAN_COST_CROSS_DICTIONARY);
+    size_t snapshot_elements = estimate_snapshot(triple_pattern, snapshot_id_start) + estimate_snapshot(triple_pattern, snapshot_id_end);
+    size_t snapshots = snapshot_elements * (DELTA_PLAN_COST_SNAPSHOT + DELTA_PLAN_COST_CROSS_DICTIONARY);
+    hdt::TripleComponentOrder order = TripleStore::get_query_order(triple_pattern);
+
+    // Persisted diffs must exist between all consecutive snapshots in the range
+    std::vector<int> snapshot_ids = snapshot_manager->get_snapshots_ids();
+    auto it_start = std::find(snapshot_ids.begin(), snapshot_ids.end(), snapshot_id_start);
+    auto it_end = std::find(snapshot_ids.begin(), snapshot_ids.end(), snapshot_id_end);
+    size_t distance = std::distance(it_start, it_end);
+    DeltaPlanEstimate persisted{DELTA_PLAN_PERSISTED_DIFF, true, merged_deltas};
+    for (auto it = it_start; it != it_end && it != snapshot_ids.end(); it++) {
+        std::shared_ptr<SnapshotDiff> diff = snapshot_manager->get_snapshot_diff(*std::next(it));
+        if (diff == nullptr) {
+            persisted.feasible = false;
+            break;
+        }
+        std::shared_ptr<DictionaryManager> dict = snapshot_manager->get_dictionary_manager(diff->get_from_snapshot());
+        auto range = diff->find(triple_pattern.get_as_triple(dict), order, *dict);
+        persisted.cost += (range.second - range.first) * (DELTA_PLAN_COST_PERSISTED_DIFF + DELTA_PLAN_COST_CROSS_DICTIONARY);
+    }
+    plan.estimates.push_back(persisted);
+
+    // The last patch of a delta chain is the diff to the next snapshot
+    DeltaPlanEstimate patch_tree{DELTA_PLAN_PATCH_TREE_DIFF,
+                                 distance == 1 && patch_tree_manager->get_delta_chain_patch_tree_id(snapshot_id_start) >= 0, merged_deltas};
+    if (patch_tree.feasible) {
+        patch_tree.cost += estimate_patch(triple_pattern, snapshot_id_end, snapshot_id_start)
+                * (DELTA_PLAN_COST_PATCH + DELTA_PLAN_COST_CROSS_DICTIONARY);
+    }
+    plan.estimates.push_back(patch_tree);
+
+    // Plain diffs are emitted in SPO order, so they can only replace the other plans if that is the query order.
+    // Materialized patch versions are not sorted, so without buffering both versions only snapshots can be merged.
+    // Both snapshots are then compared directly, without deltas to merge or snapshots to sort,
+    // so it is listed before the snapshot scan to be preferred when the costs are equal.
+    bool snapshots_only = patch_id_start == snapshot_id_start && patch_id_end == snapshot_id_end;
+    plan.estimates.push_back({DELTA_PLAN_PLAIN_DIFF, order == hdt::SPO && snapshots_only, snapshots});
+
+    // Scanning the snapshots buffers and sorts them if the query order is not SPO
+    size_t sort = order == hdt::SPO ? 0 : snapshot_elements * DELTA_PLAN_COST_SORT;
+    plan.estimates.push_back({DELTA_PLAN_SNAPSHOT_SCAN_DIFF, true, snapshots + sort + merged_deltas});
+
+    // On equal costs, the first plan is preferred
+    const DeltaPlanEstimate* cheapest = nullptr;
+    for (const DeltaPlanEstimate& estimate : plan.estimates) {
+        if (estimate.feasible && (cheapest == nullptr || estimate.cost < cheapest->cost)) {
+            cheapest = &estimate;
+        }
+    }
+    plan.chosen = cheapest->type;
+    return plan;
+}
@@ -0,0 +1,94 @@
+#ifndef TPFPATCH_STORE_DELTA_QUERY_PLANNER_H
+#define TPFPATCH_STORE_DELTA_QUERY_PLANNER_H
+
+#include <string>
+#include <vector>
+#include "../patch/triple.h"
+#include "../snapshot/snapshot_manager.h"
+#include "../patch/patch_tree_manager.h"
+
+// Relative cost of producing one element by iterating over an HDT snapshot
+#define DELTA_PLAN_COST_SNAPSHOT 1
+// Relative cost of producing one element by iterating over a patch tree, which steps a KC cursor and decodes a value
+#define DELTA_PLAN_COST_PATCH 4
+// Relative cost of producing one element from a persisted snapshot diff
+#define DELTA_PLAN_COST_PERSISTED_DIFF 1
+// Relative cost of comparing two triples that are encoded with different dictionaries
+#define DELTA_PLAN_COST_CROSS_DICTIONARY 2
+// Relative cost of buffering and sorting one snapshot element in a query order other than SPO
+#define DELTA_PLAN_COST_SORT 2
+
+/**
+ * The ways to compute the delta between two versions.
+ */
+enum DeltaPlanType {
+    // Pick the cheapest plan
+    DELTA_PLAN_AUTO,
+    // Nothing has to be computed, the delta is empty
+    DELTA_PLAN_EMPTY,
+    // Both versions are in the same delta chain, the delta is read from its patch tree
+    DELTA_PLAN_SINGLE_CHAIN,
+    // Materialize both versions and compare them
+    DELTA_PLAN_PLAIN_DIFF,
+    // Merge the diffs that were stored when the snapshots in between were created
+    DELTA_PLAN_PERSISTED_DIFF,
+    // Read the diff between two consecutive snapshots from the last patch of the first delta chain
+    DELTA_PLAN_PATCH_TREE_DIFF,
+    // Scan both snapshots and compare them
+    DELTA_PLAN_SNAPSHOT_SCAN_DIFF,
+};
+
+/**
+ * The estimated cost of a plan.
+ */
+struct DeltaPlanEstimate {
+    DeltaPlanType type;
+    // If the plan can be executed for the query
+    bool feasible;
+    // The estimated number of elements that are iterated over, weighted by their relative cost
+    size_t cost;
+};
+
+/**
+ * The plan that is chosen for a delta materialization query, with the estimates of all considered plans.
+ */
+struct DeltaQueryPlan {
+    DeltaPlanType chosen;
+    std::vector<DeltaPlanEstimate> estimates;
+
+    /**
+     * @param type A plan type
+     * @return The name of the plan type.
+     */
+    static std::string get_name(DeltaPlanType type);
+    /**
+     * @return A readable description of the chosen plan and the estimates.
+     */
+    std::string to_string() const;
+};
+
+/**
+ * Chooses how to compute the delta between two versions, based on the counts that are available without iterating:
+ * the HDT estimates of the snapshots, the addition and deletion counts of the patch trees,
+ * the sizes of the persisted snapshot diffs, and the number of delta chains in between.
+ */
+class DeltaQueryPlanner {
+private:
+    SnapshotManager* snapshot_manager;
+    PatchTreeManager* patch_tree_manager;
+
+    size_t estimate_snapshot(const StringTriple& triple_pattern, int snapshot_id) const;
+    size_t estimate_patch(const StringTriple& triple_pattern, int patch_id, int snapshot_id) const;
+public:
+    DeltaQueryPlanner(SnapshotManager* snapshot_manager, PatchTreeManager* patch_tree_manager);
+    /**
+     * Estimate all plans for a delta materialization query and pick the cheapest one.
+     * @param triple_pattern The triple pattern
+     * @param patch_id_start The start version
+     * @param patch_id_end The end version
+     * @return The plan.
+     */
+    DeltaQueryPlan plan(const StringTriple& triple_pattern, int patch_id_start, int patch_id_end) const;
+};
+
+#endif //TPFPATCH_STORE_DELTA_QUERY_PLANNER_H
@@ -0,0 +1,430 @@
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <stdexcept>
+#include "ingest_pipeline.h"
+
+// Subject, predicate and object ID, followed by the addition flag
+#define RUN_ELEMENT_SIZE (3 * sizeof(size_t) + 1)
+// The maximum number of run files that are merged at once, to stay below the limit of open files
+#define MAX_MERGE_RUN_FILES 256
+
+std::atomic<int> pipeline_count(0);
+
+PatchElementIteratorQueue::PatchElementIteratorQueue(PatchElementChunkQueue* queue)
+        : queue(queue), chunk(), chunk_pos(0), passed(0) {}
+
+bool PatchElementIteratorQueue::next(PatchElement* element) {
+    while (chunk_pos >= chunk.size()) {
+        if (!queue->pop(chunk)) {
+            return false;
+        }
+        chunk_pos = 0;
+    }
+    const PatchElement& queued = chunk[chunk_pos++];
+    element->set_triple(queued.get_triple());
+    element->set_addition(queued.is_addition());
+    passed++;
+    return true;
+}
+
+void PatchElementIteratorQueue::goToStart() {
+    throw std::runtime_error("A queued patch element iterator can not be restarted");
+}
+
+size_t PatchElementIteratorQueue::getPassed() {
+    return passed;
+}
+
+PatchElementIteratorRunFile::PatchElementIteratorRunFile(const std::string& file_name)
+        : file(file_name, std::ios::binary), buffer(INGEST_RUN_READ_BUFFER * RUN_ELEMENT_SIZE),
+          buffer_size(0), buffer_pos(0), passed(0) {
+    if (!file.good()) {
+        throw std::runtime_error("Could not open the sorted run " + file_name);
+    }
+}
+
+bool PatchElementIteratorRunFile::next(PatchElement* element) {
+    if (buffer_pos >= buffer_size) {
+        // The buffer holds a whole number of elements, so an element never crosses two reads.
+        file.read(buffer.data(), buffer.size());
+        buffer_size = (size_t) file.gcount();
+        buffer_pos = 0;
+        if (buffer_size < RUN_ELEMENT_SIZE) {
+            return false;
+        }
+    }
+    const char* data = buffer.data() + buffer_pos;
+    size_t ids[3];
+    std::memcpy(ids, data, 3 * sizeof(size_t));
+    element->set_triple(Triple(ids[0], ids[1], ids[2]));
+    element->set_addition(data[3 * sizeof(size_t)] != 0);
+    buffer_pos += RUN_ELEMENT_SIZE;
+    passed++;
+    return true;
+}
+
+void PatchElementIteratorRunFile::goToStart() {
+    file.clear();
+    file.seekg(0);
+    buffer_size = 0;
+    buffer_pos = 0;
+}
+
+size_t PatchElementIteratorRunFile::getPassed() {
+    return passed;
+}
+
+void PatchElementIteratorRunFile::write(const std::string& file_name, const std::vector<PatchElement>& elements, bool append) {
+    std::ofstream file(file_name, append ? std::ios::binary | std::ios::app : std::ios::binary | std::ios::trunc);
+    std::vector<char> buffer(INGEST_RUN_READ_BUFFER * RUN_ELEMENT_SIZE);
+    size_t buffer_pos = 0;
+    for (auto& element : elements) {
+        const Triple& triple = element.get_triple();
+        size_t ids[3] = {triple.get_subject(), triple.get_predicate(), triple.get_object()};
+        std::memcpy(buffer.data() + buffer_pos, ids, 3 * sizeof(size_t));
+        buffer[buffer_pos + 3 * sizeof(size_t)] = (char) element.is_addition();
+        buffer_pos += RUN_ELEMENT_SIZE;
+        if (buffer_pos == buffer.size()) {
+            file.write(buffer.data(), buffer_pos);
+            buffer_pos = 0;
+        }
+    }
+    file.write(buffer.data(), buffer_pos);
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error("Could not write the sorted run " + file_name);
+    }
+}
+
+IngestPipeline::IngestPipeline(std::shared_ptr<DictionaryManager> dict, bool sort, hdt::ProgressListener* listener,
+                               unsigned int sort_workers, size_t chunk_size, size_t queue_capacity,
+                               size_t memory_budget, std::string temp_path)
+        : dict(dict), sort(sort), listener(listener),
+          sort_workers(sort_workers > 0 ? sort_workers : std::max(1u, std::thread::hardware_concurrency())),
+          chunk_size(std::max((size_t) 1, chunk_size)), queue_capacity(std::max((size_t) 1, queue_capacity)),
+          memory_budget(memory_budget), temp_path(temp_path), pipeline_id(pipeline_count++),
+          comparator(new PatchElementComparator(new PatchTreeKeyComparator(comp_s, comp_p, comp_o, dict))),
+          merged_queue(nullptr), runs_size(0), spilled_runs(0), output(nullptr), started(false), error(nullptr), sorted(false),
+          encoded_count(0), sorted_count(0), active_encoders(0),
+          encode_duration(0), sort_duration(0), merge_duration(0) {
+    dict->prepareInsertions();
+}
+
+IngestPipeline::~IngestPipeline() {
+    // Make sure that no stage is still waiting, in case the output was not fully consumed.
+    close_queues();
+    for (auto& thread : encode_threads) {
+        if (thread.joinable()) thread.join();
+    }
+    if (merge_thread.joinable()) merge_thread.join();
+    delete output;
+    for (auto& queue : encoded_queues) {
+        delete queue;
+    }
+    delete merged_queue;
+    for (auto& file : files) {
+        delete file;
+    }
+    remove_run_files();
+    delete comparator;
+}
+
+void IngestPipeline::add_file(hdt::IteratorTripleString* it, bool additions) {
+    if (started) {
+        throw std::logic_error("Files can not be added to an ingest pipeline that has already started");
+    }
+    files.push_back(new PatchElementIteratorTripleStrings(dict, it, additions));
+}
+
+PatchElementIterator* IngestPipeline::start() {
+    if (started) {
+        throw std::logic_error("An ingest pipeline can only be started once");
+    }
+    started = true;
+    start_time = std::chrono::high_resolution_clock::now();
+    active_encoders = files.size();
+
+    if (sort) {
+        if (memory_budget > 0) {
+            // Half of the budget is for the chunks in flight between the stages, the other half for sorted runs.
+            size_t chunks_in_flight = files.size() + 2 * queue_capacity + sort_workers + 2;
+            size_t max_chunk_size = memory_budget / 2 / sizeof(PatchElement) / chunks_in_flight;
+            chunk_size = std::max((size_t) 1, std::min(chunk_size, max_chunk_size));
+        }
+        // All encoders feed into the same queue, from which the sort workers take chunks.
+        auto* encoded_queue = new PatchElementChunkQueue(queue_capacity);
+        encoded_queues.push_back(encoded_queue);
+        merged_queue = new PatchElementChunkQueue(queue_capacity);
+        if (files.empty()) {
+            encoded_queue->close();
+        }
+        for (size_t i = 0; i < files.size(); i++) {
+            encode_threads.emplace_back(&IngestPipeline::encode, this, i, encoded_queue);
+        }
+        for (unsigned int i = 0; i < sort_workers; i++) {
+            sort_threads.emplace_back(&IngestPipeline::sort_runs, this);
+        }
+        merge_thread = std::thread(&IngestPipeline::merge, this);
+        output = new PatchElementIteratorQueue(merged_queue);
+    } else {
+        // Each file is already sorted, so the caller can merge the encoded streams directly.
+        auto* combined = new PatchElementIteratorCombined(PatchTreeKeyComparator(comp_s, comp_p, comp_o, dict));
+        for (size_t i = 0; i < files.size(); i++) {
+            auto* encoded_queue = new PatchElementChunkQueue(queue_capacity);
+            encoded_queues.push_back(encoded_queue);
+            combined->appendIterator(new PatchElementIteratorQueue(encoded_queue));
+        }
+        for (size_t i = 0; i < files.size(); i++) {
+            encode_threads.emplace_back(&IngestPipeline::encode, this, i, encoded_queues[i]);
+        }
+        output = combined;
+    }
+    return output;
+}
+
+void IngestPipeline::wait_until_sorted() {
+    if (!started) {
+        throw std::logic_error("An ingest pipeline must be started before it can be waited for");
+    }
+    if (!sort) {
+        return;
+    }
+    std::unique_lock<std::mutex> l(error_mutex);
+    trigger_sorted.wait(l, [this]() { return sorted; });
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+size_t IngestPipeline::finish() {
+    for (auto& thread : encode_threads) {
+        if (thread.joinable()) thread.join();
+    }
+    if (merge_thread.joinable()) merge_thread.join();
+    {
+        std::lock_guard<std::mutex> l(error_mutex);
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+
+    // All encoded elements pass through the remaining stages
+    size_t produced = encoded_count;
+    long total_duration = elapsed_ms();
+    auto report = [this](const std::string& stage, size_t count, long duration) {
+        double throughput = duration > 0 ? count * 1000.0 / duration : count;
+        NOTIFYMSG(listener, ("\n" + stage + ": " + std::to_string(count) + " triples in " + std::to_string(duration)
+                             + "ms (" + std::to_string((size_t) throughput) + " triples/s)\n").c_str());
+    };
+    report("Parsed and encoded", encoded_count, encode_duration);
+    if (sort) {
+        report("Sorted (" + std::to_string(sort_workers) + " workers, " + std::to_string(spilled_runs) + " runs spilled to disk)",
+               sorted_count, sort_duration);
+        report("Merged", produced, merge_duration);
+    }
+    report("Appended (total)", produced, total_duration);
+    return produced;
+}
+
+void IngestPipeline::encode(size_t file_id, PatchElementChunkQueue* queue) {
+    try {
+        PatchElementIteratorTripleStrings* it = files[file_id];
+        std::vector<PatchElement> chunk;
+        chunk.reserve(chunk_size);
+        PatchElement element;
+        bool open = true;
+        while (open && it->next(&element)) {
+            chunk.push_back(element);
+            if (chunk.size() >= chunk_size) {
+                encoded_count += chunk.size();
+                // Blocks while the next stage is lagging behind
+                open = queue->push(std::move(chunk));
+                chunk = std::vector<PatchElement>();
+                chunk.reserve(chunk_size);
+            }
+        }
+        if (open && !chunk.empty()) {
+            encoded_count += chunk.size();
+            queue->push(std::move(chunk));
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+    bool last = --active_encoders == 0;
+    if (last) {
+        encode_duration = elapsed_ms();
+    }
+    // With sorting, the shared queue may only be closed by the last encoder.
+    if (!sort || last) {
+        queue->close();
+    }
+}
+
+void IngestPipeline::sort_runs() {
+    try {
+        auto compare = comparator->get();
+        std::vector<PatchElement> chunk;
+        while (encoded_queues[0]->pop(chunk)) {
+            std::sort(chunk.begin(), chunk.end(), compare);
+            sorted_count += chunk.size();
+            size_t chunk_bytes = chunk.size() * sizeof(PatchElement);
+            std::string run_file;
+            {
+                std::lock_guard<std::mutex> l(runs_mutex);
+                if (memory_budget == 0 || runs_size + chunk_bytes <= memory_budget / 2) {
+                    runs_size += chunk_bytes;
+                    runs.push_back(std::move(chunk));
+                    continue;
+                }
+                run_file = temp_path + INGEST_RUN_FILENAME(pipeline_id, run_files.size());
+                run_files.push_back(run_file);
+                spilled_runs++;
+            }
+            // The run doesn't fit in memory anymore, so spill it to disk.
+            PatchElementIteratorRunFile::write(run_file, chunk);
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+    long duration = elapsed_ms();
+    long previous = sort_duration;
+    while (previous < duration && !sort_duration.compare_exchange_weak(previous, duration));
+}
+
+bool IngestPipeline::merge_runs(std::vector<std::unique_ptr<PatchElementIterator>>& sources,
+                                const std::function<bool(std::vector<PatchElement>&&)>& emit) {
+    auto compare = comparator->get();
+    std::vector<PatchElement> heads(sources.size());
+    // A min-heap of the sources, ordered by their current element
+    auto heap_compare = [&heads, &compare](size_t source1, size_t source2) {
+        return compare(heads[source2], heads[source1]);
+    };
+    std::vector<size_t> heap;
+    for (size_t i = 0; i < sources.size(); i++) {
+        if (sources[i]->next(&heads[i])) {
+            heap.push_back(i);
+        }
+    }
+    std::make_heap(heap.begin(), heap.end(), heap_compare);
+
+    std::vector<PatchElement> chunk;
+    chunk.reserve(chunk_size);
+    while (!heap.empty()) {
+        std::pop_heap(heap.begin(), heap.end(), heap_compare);
+        size_t source = heap.back();
+        chunk.push_back(heads[source]);
+        if (sources[source]->next(&heads[source])) {
+            std::push_heap(heap.begin(), heap.end(), heap_compare);
+        } else {
+            heap.pop_back();
+        }
+        if (chunk.size() >= chunk_size) {
+            if (!emit(std::move(chunk))) {
+                return false;
+            }
+            chunk = std::vector<PatchElement>();
+            chunk.reserve(chunk_size);
+        }
+    }
+    return chunk.empty() || emit(std::move(chunk));
+}
+
+void IngestPipeline::merge() {
+    // The runs can only be merged once all of them have been sorted.
+    for (auto& thread : sort_threads) {
+        thread.join();
+    }
+    bool failed;
+    {
+        std::lock_guard<std::mutex> l(error_mutex);
+        failed = error != nullptr;
+        sorted = true;
+    }
+    trigger_sorted.notify_all();
+    try {
+        if (!failed) {
+            // Merge the spilled runs in several passes if there are too many to open at once.
+            size_t fan_in = get_merge_fan_in();
+            size_t merged_files = 0;
+            while (run_files.size() - merged_files > fan_in) {
+                std::vector<std::unique_ptr<PatchElementIterator>> sources;
+                for (size_t i = 0; i < fan_in; i++) {
+                    sources.emplace_back(new PatchElementIteratorRunFile(run_files[merged_files + i]));
+                }
+                std::string run_file = temp_path + INGEST_RUN_FILENAME(pipeline_id, run_files.size());
+                PatchElementIteratorRunFile::write(run_file, std::vector<PatchElement>());
+                merge_runs(sources, [&run_file](std::vector<PatchElement>&& chunk) {
+                    PatchElementIteratorRunFile::write(run_file, chunk, true);
+                    return true;
+                });
+                sources.clear();
+                for (size_t i = 0; i < fan_in; i++) {
+                    std::remove(run_files[merged_files + i].c_str());
+                }
+                merged_files += fan_in;
+                run_files.push_back(run_file);
+            }
+
+            std::vector<std::unique_ptr<PatchElementIterator>> sources;
+            for (auto& run : runs) {
+                sources.emplace_back(new PatchElementIteratorVector(&run));
+            }
+            for (size_t i = merged_files; i < run_files.size(); i++) {
+                sources.emplace_back(new PatchElementIteratorRunFile(run_files[i]));
+            }
+            merge_runs(sources, [this](std::vector<PatchElement>&& chunk) {
+                return merged_queue->push(std::move(chunk));
+            });
+        }
+    } catch (...) {
+        fail(std::current_exception());
+    }
+    runs.clear();
+    remove_run_files();
+    merge_duration = elapsed_ms();
+    merged_queue->close();
+}
+
+size_t IngestPipeline::get_merge_fan_in() const {
+    if (memory_budget == 0) {
+        return MAX_MERGE_RUN_FILES;
+    }
+    // The runs in memory take the other half of the budget. This half holds the merged chunks and the read buffers.
+    size_t merged_chunks = (queue_capacity + 2) * chunk_size * sizeof(PatchElement);
+    size_t available = memory_budget / 2 > merged_chunks ? memory_budget / 2 - merged_chunks : 0;
+    size_t fan_in = available / (INGEST_RUN_READ_BUFFER * RUN_ELEMENT_SIZE);
+    return std::max((size_t) 2, std::min((size_t) MAX_MERGE_RUN_FILES, fan_in));
+}
+
+void IngestPipeline::fail(std::exception_ptr exception) {
+    {
+        std::lock_guard<std::mutex> l(error_mutex);
+        if (!error) {
+            error = exception;
+        }
+    }
+    // Unblock all other stages
+    close_queues();
+}
+
+void IngestPipeline::close_queues() {
+    for (auto& queue : encoded_queues) {
+        queue->close();
+    }
+    if (merged_queue != nullptr) {
+        merged_queue->close();
+    }
+}
+
+void IngestPipeline::remove_run_files() {
+    for (auto& run_file : run_files) {
+        std::remove(run_file.c_str());
+    }
+    run_files.clear();
+}
+
+long IngestPipeline::elapsed_ms() const {
+    auto now = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration_cast<std::chrono::milliseconds>(now - start_time).count();
+}
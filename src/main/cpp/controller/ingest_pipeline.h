@@ -0,0 +1,243 @@
+#ifndef TPFPATCH_STORE_INGEST_PIPELINE_H
+#define TPFPATCH_STORE_INGEST_PIPELINE_H
+
+#include <list>
+#include <string>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <HDTListener.hpp>
+#include "../patch/patch_element_iterator.h"
+#include "../patch/patch_element_comparator.h"
+
+// The number of patch elements that are passed from one stage to the next at once
+#define INGEST_CHUNK_SIZE 100000
+// The number of chunks that may be waiting between two stages before the producing stage blocks
+#define INGEST_QUEUE_CAPACITY 4
+// The number of patch elements that are read from a run file at once
+#define INGEST_RUN_READ_BUFFER 8192
+#define INGEST_RUN_FILENAME(pipeline_id, run_id) ("ingest_" + std::to_string(pipeline_id) + "_run_" + std::to_string(run_id) + ".tmp")
+
+/**
+ * A FIFO queue with a fixed capacity that is shared between threads.
+ * Producers block while the queue is full, consumers block while it is empty.
+ */
+template <typename T>
+class BoundedQueue {
+protected:
+    std::queue<T> items;
+    size_t capacity;
+    bool closed;
+    std::mutex mutex;
+    std::condition_variable trigger_not_full;
+    std::condition_variable trigger_not_empty;
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity), closed(false) {}
+    /**
+     * Add an item, waiting until there is room for it.
+     * @param item The item to add
+     * @return If the item was added, false if the queue was closed.
+     */
+    bool push(T&& item) {
+        std::unique_lock<std::mutex> l(mutex);
+        while (!closed && items.size() >= capacity) {
+            trigger_not_full.wait(l);
+        }
+        if (closed) {
+            return false;
+        }
+        items.push(std::move(item));
+        trigger_not_empty.notify_one();
+        return true;
+    }
+    /**
+     * Take the first item, waiting until one is available.
+     * @param item The item to overwrite
+     * @return If an item was taken, false if the queue was closed and is empty.
+     */
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> l(mutex);
+        while (!closed && items.empty()) {
+            trigger_not_empty.wait(l);
+        }
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop();
+        trigger_not_full.notify_one();
+        return true;
+    }
+    /**
+     * Indicate that no more items will be pushed, and wake up all waiting threads.
+     */
+    void close() {
+        std::lock_guard<std::mutex> l(mutex);
+        closed = true;
+        trigger_not_full.notify_all();
+        trigger_not_empty.notify_all();
+    }
+};
+
+typedef BoundedQueue<std::vector<PatchElement>> PatchElementChunkQueue;
+
+/**
+ * A patch element iterator that emits the elements of the chunks in a queue, as they become available.
+ */
+class PatchElementIteratorQueue : public PatchElementIterator {
+protected:
+    PatchElementChunkQueue* queue;
+    std::vector<PatchElement> chunk;
+    size_t chunk_pos;
+    size_t passed;
+public:
+    explicit PatchElementIteratorQueue(PatchElementChunkQueue* queue);
+    bool next(PatchElement* element) override;
+    void goToStart() override;
+    size_t getPassed() override;
+};
+
+/**
+ * A patch element iterator over a sorted run that was spilled to a file.
+ * Each element is stored as its subject, predicate and object ID, followed by its addition flag.
+ */
+class PatchElementIteratorRunFile : public PatchElementIterator {
+protected:
+    std::ifstream file;
+    std::vector<char> buffer;
+    size_t buffer_size;
+    size_t buffer_pos;
+    size_t passed;
+public:
+    explicit PatchElementIteratorRunFile(const std::string& file_name);
+    bool next(PatchElement* element) override;
+    void goToStart() override;
+    size_t getPassed() override;
+    /**
+     * Write a sorted run to a file.
+     * @param file_name The file to write to.
+     * @param elements The sorted elements.
+     * @param append If the elements must be appended to the file, instead of overwriting it.
+     */
+    static void write(const std::string& file_name, const std::vector<PatchElement>& elements, bool append = false);
+};
+
+/**
+ * Encodes and sorts the triples of a number of files into a single patch stream, using multiple threads.
+ *
+ * The stages are:
+ * 1. Parse/encode: one thread per file that parses triples and encodes them with the dictionary.
+ * 2. Sort: a pool of threads that sort chunks of encoded elements into runs.
+ * 3. Merge: one thread that merges the sorted runs.
+ * The resulting stream is consumed by the caller, typically to append it to a patch tree.
+ * Stages are connected by bounded queues, so that a fast stage waits for a slower one.
+ * Without sorting, the files are assumed to be sorted already, and are merged directly by the caller.
+ * When a memory budget is set, sorted runs that don't fit in it are spilled to temporary files,
+ * which are merged from disk, so that patches larger than the available memory can be ingested.
+ */
+class IngestPipeline {
+protected:
+    std::shared_ptr<DictionaryManager> dict;
+    bool sort;
+    hdt::ProgressListener* listener;
+    unsigned int sort_workers;
+    size_t chunk_size;
+    size_t queue_capacity;
+    size_t memory_budget;
+    std::string temp_path;
+    int pipeline_id;
+    PatchElementComparator* comparator;
+
+    std::vector<PatchElementIteratorTripleStrings*> files;
+    std::vector<PatchElementChunkQueue*> encoded_queues;
+    PatchElementChunkQueue* merged_queue;
+    std::list<std::vector<PatchElement>> runs;
+    size_t runs_size;
+    std::vector<std::string> run_files;
+    size_t spilled_runs;
+    std::mutex runs_mutex;
+    PatchElementIterator* output;
+
+    std::vector<std::thread> encode_threads;
+    std::vector<std::thread> sort_threads;
+    std::thread merge_thread;
+    bool started;
+
+    std::mutex error_mutex;
+    std::exception_ptr error;
+    // If all elements have been encoded and sorted, before any of them is merged
+    bool sorted;
+    std::condition_variable trigger_sorted;
+
+    std::chrono::high_resolution_clock::time_point start_time;
+    std::atomic<size_t> encoded_count;
+    std::atomic<size_t> sorted_count;
+    std::atomic<size_t> active_encoders;
+    std::atomic<long> encode_duration;
+    std::atomic<long> sort_duration;
+    std::atomic<long> merge_duration;
+protected:
+    void encode(size_t file_id, PatchElementChunkQueue* queue);
+    void sort_runs();
+    bool merge_runs(std::vector<std::unique_ptr<PatchElementIterator>>& sources,
+                    const std::function<bool(std::vector<PatchElement>&&)>& emit);
+    void merge();
+    void fail(std::exception_ptr exception);
+    void close_queues();
+    void remove_run_files();
+    long elapsed_ms() const;
+    /**
+     * @return The number of run files that are merged at once, so that their read buffers fit in the memory budget.
+     */
+    size_t get_merge_fan_in() const;
+public:
+    /**
+     * @param dict The dictionary to encode triples with.
+     * @param sort If the elements must be sorted, otherwise each file must already be sorted.
+     * @param listener An optional listener that receives the throughput of each stage.
+     * @param sort_workers The number of sort threads, 0 to use the number of hardware threads.
+     * @param chunk_size The number of elements in a chunk that is passed between stages.
+     * @param queue_capacity The maximum number of chunks waiting between two stages.
+     * @param memory_budget The maximum number of bytes for buffering elements while sorting and merging, 0 for unbounded.
+     * @param temp_path The directory in which sorted runs are spilled when they exceed the memory budget.
+     */
+    IngestPipeline(std::shared_ptr<DictionaryManager> dict, bool sort, hdt::ProgressListener* listener = nullptr,
+                   unsigned int sort_workers = 0, size_t chunk_size = INGEST_CHUNK_SIZE,
+                   size_t queue_capacity = INGEST_QUEUE_CAPACITY, size_t memory_budget = 0,
+                   std::string temp_path = "./");
+    ~IngestPipeline();
+    /**
+     * Add a file to ingest, this must be called before start.
+     * @param it The triples of the file, this pipeline takes ownership.
+     * @param additions If the triples are additions, otherwise deletions.
+     */
+    void add_file(hdt::IteratorTripleString* it, bool additions);
+    /**
+     * Start all stages in the background.
+     * @return The resulting patch elements, owned by this pipeline.
+     */
+    PatchElementIterator* start();
+    /**
+     * Wait until all elements have been encoded and sorted, which is before the first one is emitted.
+     * Any error that occurred while parsing, encoding or sorting is rethrown here,
+     * so that nothing of a failed patch has to be appended.
+     * Without sorting, the elements are emitted while the files are encoded, so this returns right away.
+     */
+    void wait_until_sorted();
+    /**
+     * Wait for all stages to end, and report their throughput.
+     * Any error that occurred in one of the stages is rethrown here.
+     * @return The number of patch elements that were produced.
+     */
+    size_t finish();
+};
+
+#endif //TPFPATCH_STORE_INGEST_PIPELINE_H
@@ -0,0 +1,81 @@
+#include <iomanip>
+#include "metrics.h"
+
+namespace {
+    void write_cache_json(std::ostream& out, const CacheMetrics& cache) {
+        out << "{\"hits\":" << cache.hits << ",\"misses\":" << cache.misses << ",\"evictions\":" << cache.evictions
+            << ",\"loaded\":" << cache.loaded << ",\"load_seconds\":" << cache.load_seconds
+            << ",\"max_load_seconds\":" << cache.max_load_seconds << "}";
+    }
+
+    void write_cache_prometheus(std::ostream& out, const std::string& cache_name, const CacheMetrics& cache) {
+        std::string label = "{cache=\"" + cache_name + "\"}";
+        out << "ostrich_cache_hits_total" << label << " " << cache.hits << "\n";
+        out << "ostrich_cache_misses_total" << label << " " << cache.misses << "\n";
+        out << "ostrich_cache_evictions_total" << label << " " << cache.evictions << "\n";
+        out << "ostrich_cache_loaded" << label << " " << cache.loaded << "\n";
+        out << "ostrich_cache_load_seconds_total" << label << " " << cache.load_seconds << "\n";
+        out << "ostrich_cache_load_seconds_max" << label << " " << cache.max_load_seconds << "\n";
+    }
+
+    double residency(const TreeMetrics& tree) {
+        return tree.leaves == 0 ? 0 : (double) tree.cached_leaves / tree.leaves;
+    }
+}
+
+void StoreMetrics::write_json(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(6);
+    out << "{\"snapshots\":";
+    write_cache_json(out, snapshots);
+    out << ",\"patch_trees\":";
+    write_cache_json(out, patch_trees);
+    out << ",\"trees\":[";
+    for (size_t i = 0; i < trees.size(); i++) {
+        const TreeMetrics& tree = trees[i];
+        out << (i > 0 ? "," : "") << "{\"name\":\"" << tree.name << "\",\"records\":" << tree.records
+            << ",\"file_size\":" << tree.file_size << ",\"page_cache_usage\":" << tree.page_cache_usage
+            << ",\"page_cache_capacity\":" << tree.page_cache_capacity << ",\"leaves\":" << tree.leaves
+            << ",\"cached_leaves\":" << tree.cached_leaves << ",\"page_cache_residency\":" << residency(tree) << "}";
+    }
+    out << "],\"dictionaries\":{";
+    bool first = true;
+    for (const auto& dict : dictionaries) {
+        out << (first ? "" : ",") << "\"" << dict.first << "\":{\"hdt\":" << dict.second.hdt
+            << ",\"patch\":" << dict.second.patch << ",\"misses\":" << dict.second.misses << "}";
+        first = false;
+    }
+    out << "},\"ingest\":{\"appends\":" << ingest.appends << ",\"failed_appends\":" << ingest.failed_appends
+        << ",\"elements\":" << ingest.elements << ",\"snapshots\":" << ingest.snapshots << ",\"seconds\":" << ingest.seconds
+        << "},\"memory\":{\"usage\":" << memory_usage << ",\"limit\":" << memory_limit << "}}";
+    out.flags(flags);
+}
+
+void StoreMetrics::write_prometheus(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(6);
+    write_cache_prometheus(out, "snapshots", snapshots);
+    write_cache_prometheus(out, "patch_trees", patch_trees);
+    for (const TreeMetrics& tree : trees) {
+        std::string label = "{tree=\"" + tree.name + "\"}";
+        out << "ostrich_tree_records" << label << " " << tree.records << "\n";
+        out << "ostrich_tree_file_bytes" << label << " " << tree.file_size << "\n";
+        out << "ostrich_tree_page_cache_bytes" << label << " " << tree.page_cache_usage << "\n";
+        out << "ostrich_tree_page_cache_capacity_bytes" << label << " " << tree.page_cache_capacity << "\n";
+        out << "ostrich_tree_page_cache_residency" << label << " " << residency(tree) << "\n";
+    }
+    for (const auto& dict : dictionaries) {
+        std::string snapshot = "snapshot=\"" + std::to_string(dict.first) + "\"";
+        out << "ostrich_dictionary_lookups_total{" << snapshot << ",path=\"hdt\"} " << dict.second.hdt << "\n";
+        out << "ostrich_dictionary_lookups_total{" << snapshot << ",path=\"patch\"} " << dict.second.patch << "\n";
+        out << "ostrich_dictionary_lookups_total{" << snapshot << ",path=\"miss\"} " << dict.second.misses << "\n";
+    }
+    out << "ostrich_ingest_appends_total " << ingest.appends << "\n";
+    out << "ostrich_ingest_failed_appends_total " << ingest.failed_appends << "\n";
+    out << "ostrich_ingest_elements_total " << ingest.elements << "\n";
+    out << "ostrich_ingest_snapshots_total " << ingest.snapshots << "\n";
+    out << "ostrich_ingest_seconds_total " << ingest.seconds << "\n";
+    out << "ostrich_memory_usage_bytes " << memory_usage << "\n";
+    out << "ostrich_memory_limit_bytes " << memory_limit << "\n";
+    out.flags(flags);
+}
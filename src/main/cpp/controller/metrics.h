@@ -0,0 +1,49 @@
+#ifndef TPFPATCH_STORE_METRICS_H
+#define TPFPATCH_STORE_METRICS_H
+
+#include <map>
+#include <ostream>
+#include <vector>
+#include "../patch/cache_metrics.h"
+#include "../patch/triple_store.h"
+#include "../dictionary/dictionary_manager.h"
+
+/**
+ * The counters of the patches that were appended to a store.
+ */
+struct IngestMetrics {
+    size_t appends;
+    size_t failed_appends;
+    // The number of patch elements that were appended
+    size_t elements;
+    size_t snapshots;
+    double seconds;
+};
+
+/**
+ * A snapshot of the runtime metrics of a store.
+ */
+struct StoreMetrics {
+    CacheMetrics snapshots;
+    CacheMetrics patch_trees;
+    // The KC trees of the loaded patch trees
+    std::vector<TreeMetrics> trees;
+    // The term lookups of the loaded dictionaries, by snapshot id
+    std::map<int, DictionaryLookups> dictionaries;
+    IngestMetrics ingest;
+    size_t memory_usage;
+    size_t memory_limit;
+
+    /**
+     * Write the metrics as a JSON document.
+     * @param out The stream to write to
+     */
+    void write_json(std::ostream& out) const;
+    /**
+     * Write the metrics in the Prometheus text exposition format.
+     * @param out The stream to write to
+     */
+    void write_prometheus(std::ostream& out) const;
+};
+
+#endif //TPFPATCH_STORE_METRICS_H
@@ -8,6 +8,7 @@ PatchBuilder::PatchBuilder(Controller* controller) : controller(controller), pat
     int snapshot_id = controller->get_snapshot_manager()->get_latest_snapshot(max_patch_id);
     dict = controller->get_snapshot_manager()->get_dictionary_manager(snapshot_id);
     if (dict != nullptr) {
+        dict->prepareInsertions();
         patch = new PatchSorted(dict);
     } else {
         patch = nullptr;
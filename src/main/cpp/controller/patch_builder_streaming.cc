@@ -7,6 +7,9 @@ PatchBuilderStreaming::PatchBuilderStreaming(Controller* controller, int patch_i
     int max_patch_id = controller->get_max_patch_id();
     int snapshot_id = controller->get_snapshot_manager()->get_latest_snapshot(max_patch_id);
     dict = controller->get_snapshot_manager()->get_dictionary_manager(snapshot_id);
+    if (dict != nullptr) {
+        dict->prepareInsertions();
+    }
     this->patch_id = patch_id < 0 ? max_patch_id + 1 : patch_id;
     thread = std::thread(std::bind(&PatchBuilderStreaming::threaded_insert, this));
 }
@@ -1,6 +1,7 @@
 #include <Triples.hpp>
 #include "snapshot_patch_iterator_triple_id.h"
 #include "../snapshot/snapshot_manager.h"
+#include "../query_trace.h"
 
 SnapshotPatchIteratorTripleID::SnapshotPatchIteratorTripleID(hdt::IteratorTripleID* snapshot_it,
                                                              PositionedTripleIterator* deletion_it,
@@ -28,6 +29,7 @@ SnapshotPatchIteratorTripleID::~SnapshotPatchIteratorTripleID() {
 bool SnapshotPatchIteratorTripleID::next(Triple* triple) {
     while(snapshot_it != nullptr || addition_it != nullptr) {
         if (snapshot_it != nullptr && snapshot_it->hasNext()) { // Emit triples from snapshot - deletions
+            TRACE_COUNT(TRACE_SNAPSHOT_TRIPLES, 1);
             // Find snapshot triple
             hdt::TripleID* snapshot_triple = snapshot_it->next();
             triple->set_subject(snapshot_triple->getSubject());
@@ -78,6 +80,7 @@ bool SnapshotPatchIteratorTripleID::next(Triple* triple) {
                 // Calculate the offset for our addition iterator.
                 long snapshot_count = snapshot_it->numResultEstimation() == hdt::EXACT ? snapshot_it->estimatedNumResults() : -1;
                 if (snapshot_count == -1) {
+                    TRACE_SPAN("snapshot_count");
                     snapshot_count = 0;
                     hdt::IteratorTripleID *tmp_it = SnapshotManager::search_with_offset(snapshot, triple_pattern, 0, dict);
                     while (tmp_it->hasNext()) {
@@ -95,6 +98,7 @@ bool SnapshotPatchIteratorTripleID::next(Triple* triple) {
                 long addition_offset = offset - snapshot_count + deletion_count;
                 addition_it = patchTree->addition_iterator_from(addition_offset, patch_id, triple_pattern);
             }
+            TRACE_COUNT(TRACE_ADDITIONS_ITERATED, 1);
             if(addition_it->next(triple)) {
                 return true;
             } else {
@@ -1,4 +1,7 @@
 #include "triple_delta_iterator.h"
+#include "../query_trace.h"
+#include <algorithm>
+#include <tuple>
 
 
 
@@ -43,6 +46,7 @@ ForwardPatchTripleDeltaIterator<DV>::~ForwardPatchTripleDeltaIterator() {
 
 template <class DV>
 bool ForwardPatchTripleDeltaIterator<DV>::next(TripleDelta* triple) {
+    TRACE_COUNT(TRACE_DELTAS_ITERATED, 1);
     bool valid, addition;
     // This loop makes sure that if the triple is a deletion,
     // and it was not present in the snapshot, that it will be skipped.
@@ -64,6 +68,7 @@ ForwardDiffPatchTripleDeltaIterator<DV>::ForwardDiffPatchTripleDeltaIterator(std
 
 template <class DV>
 bool ForwardDiffPatchTripleDeltaIterator<DV>::next(TripleDelta *triple) {
+    TRACE_COUNT(TRACE_DELTAS_ITERATED, 1);
     bool valid;
     while ((valid = this->it->next(triple->get_triple(), this->value))  // we have a triple (it valid)
                     && this->value->is_delta_type_equal(patch_id_start, patch_id_end)) {}  // the triple exist in both version (so not a delta)
@@ -174,6 +179,7 @@ MergeDiffIterator::MergeDiffIterator(TripleDeltaIterator *iterator_1, TripleDelt
 }
 
 bool MergeDiffIterator::next(TripleDelta *triple) {
+    TRACE_COUNT(TRACE_DELTAS_ITERATED, 1);
     auto emit_triple = [](TripleDelta* source, TripleDelta* target, bool is_addition) {
         target->get_triple()->set_subject(source->get_triple()->get_subject());
         target->get_triple()->set_predicate(source->get_triple()->get_predicate());
@@ -334,6 +340,23 @@ bool MergeDiffIteratorCase2::next(TripleDelta *triple) {
 }
 
 
+PersistedSnapshotDiffIterator::PersistedSnapshotDiffIterator(std::shared_ptr<SnapshotDiff> diff, const Triple &triple_pattern,
+                                                             hdt::TripleComponentOrder order, std::shared_ptr<DictionaryManager> dict)
+        : diff(diff), dict(dict), order(order) {
+    std::tie(position, end) = diff->find(triple_pattern, order, *dict);
+}
+
+bool PersistedSnapshotDiffIterator::next(TripleDelta *triple) {
+    TRACE_COUNT(TRACE_DELTAS_ITERATED, 1);
+    if (position >= end) {
+        return false;
+    }
+    triple->set_addition(diff->get(position++, order, triple->get_triple()));
+    triple->set_dictionary(dict);
+    return true;
+}
+
+
 IterativeSnapshotDiffIterator::IterativeSnapshotDiffIterator(const StringTriple& triple_pattern, SnapshotManager *snapshot_manager,
                                                              PatchTreeManager *patch_tree_manager, int snapshot_id_1,
                                                              int snapshot_id_2): internal_it(nullptr) {
@@ -356,7 +379,7 @@ IterativeSnapshotDiffIterator::IterativeSnapshotDiffIterator(const StringTriple&
     TripleDeltaIterator* start_it = nullptr;
     MergeDiffIterator* it = nullptr;
     for (int i = 1; i < snapshots_ids.size(); i++) {
-        int id = patch_tree_manager->get_patch_tree_id(snapshots_ids[i]);
+        int id = patch_tree_manager->get_delta_chain_patch_tree_id(snapshots_ids[i-1]);
         std::shared_ptr<DictionaryManager> dict = snapshot_manager->get_dictionary_manager(snapshots_ids[i-1]);
         std::shared_ptr<PatchTree> pt = patch_tree_manager->get_patch_tree(id, dict);
         TripleDeltaIterator* tmp;
@@ -396,7 +419,7 @@ IterativeSnapshotDiffIterator::~IterativeSnapshotDiffIterator() {
 AutoSnapshotDiffIterator::AutoSnapshotDiffIterator(const StringTriple &triple_pattern,
                                                    SnapshotManager *snapshot_manager,
                                                    PatchTreeManager *patch_tree_manager, int snapshot_id_1,
-                                                   int snapshot_id_2) {
+                                                   int snapshot_id_2, DeltaPlanType plan) : internal_it(nullptr) {
     int min_id = std::min(snapshot_id_1, snapshot_id_2);
     int max_id = std::max(snapshot_id_1, snapshot_id_2);
     std::vector<int> snapshots = snapshot_manager->get_snapshots_ids();
@@ -406,11 +429,38 @@ AutoSnapshotDiffIterator::AutoSnapshotDiffIterator(const StringTriple &triple_pa
         throw std::runtime_error("could not find the snapshots to compute diff");
     }
     size_t distance = std::distance(it1, it2);
-    hdt::TripleString tp(triple_pattern.get_subject(), triple_pattern.get_predicate(), triple_pattern.get_object());
-    if (distance <= 1) {
+
+    // Merge the diffs between consecutive snapshots that were stored when the snapshots were created
+    std::vector<std::shared_ptr<SnapshotDiff>> diffs;
+    for (auto it = it1; it != it2 && (plan == DELTA_PLAN_AUTO || plan == DELTA_PLAN_PERSISTED_DIFF); it++) {
+        std::shared_ptr<SnapshotDiff> diff = snapshot_manager->get_snapshot_diff(*std::next(it));
+        if (diff == nullptr) {
+            diffs.clear();
+            break;
+        }
+        diffs.push_back(diff);
+    }
+    if (!diffs.empty()) {
+        hdt::TripleComponentOrder order = TripleStore::get_query_order(triple_pattern);
+        internal_it = nullptr;
+        for (auto& diff : diffs) {
+            std::shared_ptr<DictionaryManager> dict = snapshot_manager->get_dictionary_manager(diff->get_from_snapshot());
+            TripleDeltaIterator* diff_it = new PersistedSnapshotDiffIterator(diff, triple_pattern.get_as_triple(dict), order, dict);
+            internal_it = internal_it == nullptr ? diff_it : new MergeDiffIterator(internal_it, diff_it, order);
+        }
+        return;
+    }
+    if (plan == DELTA_PLAN_PERSISTED_DIFF) {
+        throw std::runtime_error("the diffs between the snapshots are not stored");
+    }
+    if (plan == DELTA_PLAN_PATCH_TREE_DIFF && distance > 1) {
+        throw std::runtime_error("only consecutive snapshots can be diffed with a patch tree");
+    }
+
+    if ((plan == DELTA_PLAN_AUTO && distance <= 1) || plan == DELTA_PLAN_PATCH_TREE_DIFF) {
         std::shared_ptr<DictionaryManager> dict = snapshot_manager->get_dictionary_manager(min_id);
         Triple ttp = triple_pattern.get_as_triple(dict);
-        std::shared_ptr<PatchTree> patch_tree = patch_tree_manager->get_patch_tree(patch_tree_manager->get_patch_tree_id(max_id), dict);
+        std::shared_ptr<PatchTree> patch_tree = patch_tree_manager->get_patch_tree(patch_tree_manager->get_delta_chain_patch_tree_id(min_id), dict);
         if (TripleStore::is_default_tree(ttp)) {
             internal_it = new ForwardPatchTripleDeltaIterator<PatchTreeDeletionValue>(patch_tree, ttp, max_id, dict);
         } else {
@@ -430,6 +480,27 @@ bool AutoSnapshotDiffIterator::next(TripleDelta *triple) {
 }
 
 
+SortedMaterializedTripleIterator::SortedMaterializedTripleIterator(TripleIterator* iterator, hdt::TripleComponentOrder order,
+                                                                   std::shared_ptr<DictionaryManager> dict): index(0) {
+    Triple triple;
+    while (iterator->next(&triple)) {
+        triples.push_back(triple);
+    }
+    delete iterator;
+    TripleComparator* comparator = TripleComparator::get_triple_comparator(order, dict, dict);
+    if (!std::is_sorted(triples.begin(), triples.end(), *comparator))
+        std::sort(triples.begin(), triples.end(), *comparator);
+    delete comparator;
+}
+
+bool SortedMaterializedTripleIterator::next(Triple* triple) {
+    if (index >= triples.size()) {
+        return false;
+    }
+    *triple = triples[index++];
+    return true;
+}
+
 PlainDiffDeltaIterator::PlainDiffDeltaIterator(TripleIterator *it1, TripleIterator *it2,
                                                std::shared_ptr<DictionaryManager> dict1,
                                                std::shared_ptr<DictionaryManager> dict2) : it_v1(it1), it_v2(it2),
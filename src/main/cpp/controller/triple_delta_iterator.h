@@ -7,6 +7,7 @@
 #include "../snapshot/snapshot_manager.h"
 #include "../patch/patch_tree_manager.h"
 #include "../patch/triple_comparator.h"
+#include "delta_query_planner.h"
 
 
 // Iterator for triples annotated with addition/deletion.
@@ -71,6 +72,22 @@ public:
 };
 
 
+// Iterator over the stored diff between two consecutive snapshots, sorted in the given order.
+class PersistedSnapshotDiffIterator: public TripleDeltaIterator {
+private:
+    std::shared_ptr<SnapshotDiff> diff;
+    std::shared_ptr<DictionaryManager> dict;
+    hdt::TripleComponentOrder order;
+    size_t position;
+    size_t end;
+
+public:
+    PersistedSnapshotDiffIterator(std::shared_ptr<SnapshotDiff> diff, const Triple& triple_pattern, hdt::TripleComponentOrder order,
+                                  std::shared_ptr<DictionaryManager> dict);
+    bool next(TripleDelta* triple) override;
+};
+
+
 class IterativeSnapshotDiffIterator: public TripleDeltaIterator {
 private:
     TripleDeltaIterator *internal_it;
@@ -83,13 +100,16 @@ public:
 };
 
 
+// Diff between two snapshots, using the persisted diffs, the patch tree or scanning both snapshots.
+// With DELTA_PLAN_AUTO, the persisted diffs are used when available, otherwise the patch tree for consecutive snapshots.
 class AutoSnapshotDiffIterator: public TripleDeltaIterator {
 private:
     TripleDeltaIterator *internal_it;
 
 public:
     AutoSnapshotDiffIterator(const StringTriple &triple_pattern, SnapshotManager *snapshot_manager,
-                             PatchTreeManager *patch_tree_manager, int snapshot_id_1, int snapshot_id_2);
+                             PatchTreeManager *patch_tree_manager, int snapshot_id_1, int snapshot_id_2,
+                             DeltaPlanType plan = DELTA_PLAN_AUTO);
     ~AutoSnapshotDiffIterator() override;
     bool next(TripleDelta* triple) override;
 };
@@ -148,6 +168,19 @@ public:
 
 
 
+// Buffers the triples of an iterator and emits them in the given order
+class SortedMaterializedTripleIterator: public TripleIterator {
+private:
+    size_t index;
+    std::vector<Triple> triples;
+
+public:
+    SortedMaterializedTripleIterator(TripleIterator* iterator, hdt::TripleComponentOrder order, std::shared_ptr<DictionaryManager> dict);
+    bool next(Triple* triple) override;
+};
+
+
+// Assume that the input iterators are sorted in SPO order
 class PlainDiffDeltaIterator: public TripleDeltaIterator {
 private:
     TripleIterator* it_v1;
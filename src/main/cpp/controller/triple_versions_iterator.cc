@@ -1,4 +1,5 @@
 #include "triple_versions_iterator.h"
+#include "../query_trace.h"
 #include "../snapshot/sorted_triple_iterator.h"
 #include <algorithm>
 #include <numeric>
@@ -37,6 +38,7 @@ inline void PatchTreeTripleVersionsIterator::eraseDeletedVersions(std::vector<in
 }
 
 bool PatchTreeTripleVersionsIterator::next(TripleVersions* triple_versions) {
+    TRACE_COUNT(TRACE_VERSIONS_ITERATED, 1);
     // Loop over snapshot elements, and emit all versions minus the versions that have been deleted.
 
     triple_versions->set_dictionary(dict);
@@ -353,6 +355,7 @@ PatchTreeTripleVersionsIteratorV2::PatchTreeTripleVersionsIteratorV2(Triple trip
 }
 
 bool PatchTreeTripleVersionsIteratorV2::next(TripleVersions *triple_versions) {
+    TRACE_COUNT(TRACE_VERSIONS_ITERATED, 1);
     auto emit_triple = [] (const Triple& source, Triple& target) {
         target.set_subject(source.get_subject());
         target.set_predicate(source.get_predicate());
@@ -427,6 +430,38 @@ hdt::TripleComponentOrder PatchTreeTripleVersionsIteratorV2::get_order() {
 }
 
 
+VersionRangeTripleVersionsIterator::VersionRangeTripleVersionsIterator(TripleVersionsIterator* it, int patch_id_start, int patch_id_end)
+        : it(it), patch_id_start(patch_id_start), patch_id_end(patch_id_end) {}
+
+bool VersionRangeTripleVersionsIterator::next(TripleVersions* triple_versions) {
+    while (it->next(triple_versions)) {
+        // The versions are sorted
+        std::vector<int>* versions = triple_versions->get_versions();
+        versions->erase(std::upper_bound(versions->begin(), versions->end(), patch_id_end), versions->end());
+        versions->erase(versions->begin(), std::lower_bound(versions->begin(), versions->end(), patch_id_start));
+        if (!versions->empty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t VersionRangeTripleVersionsIterator::get_count() {
+    size_t count = 0;
+    TripleVersions tv;
+    while (next(&tv)) {
+        count++;
+    }
+    return count;
+}
+
+VersionRangeTripleVersionsIterator* VersionRangeTripleVersionsIterator::offset(int offset) {
+    TripleVersions tv;
+    while(offset-- > 0 && next(&tv));
+    return this;
+}
+
+
 TripleVersionsIteratorCombinedV2::TripleVersionsIteratorCombinedV2(hdt::TripleComponentOrder order) : comparator(TripleComparator::get_triple_comparator(order)) {}
 
 void TripleVersionsIteratorCombinedV2::add_iterator(TripleVersionsIterator *it) {
@@ -545,3 +580,133 @@ bool SortedPatchTreeIteratorAdditionProxy::next(Triple *triple, int *first_versi
     }
     return false;
 }
+
+
+DeltaChainTripleIterator::DeltaChainTripleIterator(const Triple& triple_pattern, hdt::IteratorTripleID* snapshot_it,
+                                                   std::shared_ptr<PatchTree> patchTree,
+                                                   std::shared_ptr<DictionaryManager> dictionary, int max_patch_id) :
+                                                   snapshot_it(snapshot_it),
+                                                   patchTree(patchTree),
+                                                   addition_it(nullptr),
+                                                   dict(dictionary),
+                                                   max_patch_id(max_patch_id) {
+    hdt::TripleComponentOrder qr_order = TripleStore::get_query_order(triple_pattern);
+    comparator = std::unique_ptr<TripleComparator>(TripleComparator::get_triple_comparator(qr_order, dict, dict));
+    step_snapshot_it();
+
+    if (patchTree != nullptr) {
+        addition_it = std::unique_ptr<PatchTreeIterator>(patchTree->addition_iterator(triple_pattern));
+#ifdef COMPRESSED_ADD_VALUES
+        value = std::unique_ptr<PatchTreeAdditionValue>(new PatchTreeAdditionValue(patchTree->get_max_patch_id()));
+#else
+        value = std::unique_ptr<PatchTreeAdditionValue>(new PatchTreeAdditionValue);
+#endif
+        step_addition_it();
+    } else {
+        status2 = false;
+    }
+}
+
+void DeltaChainTripleIterator::step_snapshot_it() {
+    if (snapshot_it->hasNext()) {
+        hdt::TripleID *tripleId = snapshot_it->next();
+        t1.set_subject(tripleId->getSubject());
+        t1.set_predicate(tripleId->getPredicate());
+        t1.set_object(tripleId->getObject());
+        status1 = true;
+    } else {
+        status1 = false;
+    }
+}
+
+void DeltaChainTripleIterator::step_addition_it() {
+    // The patch ids of an addition are sorted, so its first one is the first version that contains it
+    do {
+        status2 = addition_it->next_addition(&t2, value.get());
+    } while (status2 && value->get_size() > 0 && value->get_patch_id_at(0) > max_patch_id);
+}
+
+bool DeltaChainTripleIterator::next(Triple* triple) {
+    if (status1 && status2) {
+        int comp = comparator->compare(t1, t2);
+        if (comp <= 0) {
+            *triple = t1;
+            step_snapshot_it();
+            // Additions that are equal to a snapshot triple are local changes, they only have to be emitted once.
+            if (comp == 0) {
+                step_addition_it();
+            }
+        } else {
+            *triple = t2;
+            step_addition_it();
+        }
+        return true;
+    }
+    if (status1) {
+        *triple = t1;
+        step_snapshot_it();
+        return true;
+    }
+    if (status2) {
+        *triple = t2;
+        step_addition_it();
+        return true;
+    }
+    return false;
+}
+
+std::shared_ptr<DictionaryManager> DeltaChainTripleIterator::get_dictionary() const {
+    return dict;
+}
+
+
+TripleVersionsDistinctCounter::TripleVersionsDistinctCounter(hdt::TripleComponentOrder order) : comparator(TripleComparator::get_triple_comparator(order)) {}
+
+TripleVersionsDistinctCounter::~TripleVersionsDistinctCounter() {
+    for (auto it: iterators) {
+        delete it;
+    }
+}
+
+void TripleVersionsDistinctCounter::add_iterator(DeltaChainTripleIterator* it) {
+    iterators.push_back(it);
+}
+
+size_t TripleVersionsDistinctCounter::count() {
+    // A triple can re-appear in any later delta chain (e.g., deleted in chain i and re-added in chain i+2),
+    // so the heads of all chains are merged instead of only comparing adjacent chains.
+    size_t n = iterators.size();
+    std::vector<Triple> heads(n);
+    std::vector<bool> valid(n);
+    for (size_t i = 0; i < n; i++) {
+        valid[i] = iterators[i]->next(&heads[i]);
+    }
+
+    size_t count = 0;
+    std::vector<size_t> equal;
+    while (true) {
+        long min = -1;
+        equal.clear();
+        for (size_t i = 0; i < n; i++) {
+            if (valid[i]) {
+                int comp = min < 0 ? -1 : comparator->compare(heads[i], heads[min],
+                                                              iterators[i]->get_dictionary(), iterators[min]->get_dictionary());
+                if (comp < 0) {
+                    min = i;
+                    equal.clear();
+                    equal.push_back(i);
+                } else if (comp == 0) {
+                    equal.push_back(i);
+                }
+            }
+        }
+        if (min < 0) {
+            break;
+        }
+        count++;
+        for (size_t i: equal) {
+            valid[i] = iterators[i]->next(&heads[i]);
+        }
+    }
+    return count;
+}
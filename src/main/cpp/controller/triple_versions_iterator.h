@@ -3,9 +3,11 @@
 
 #include <vector>
 #include <set>
+#include <limits>
 #include "../patch/triple.h"
 #include "../patch/patch_tree.h"
 #include "../patch/triple_comparator.h"
+#include "../patch/triple_iterator.h"
 
 
 class TripleVersionsIterator {
@@ -167,5 +169,74 @@ public:
     TripleVersionsIteratorCombinedV2* offset(int offset) override;
 };
 
+// Restricts the version annotations of the triples of a single delta chain to a range of versions.
+// Triples that do not exist in any version of the range are skipped.
+class VersionRangeTripleVersionsIterator: public TripleVersionsIterator {
+private:
+    std::unique_ptr<TripleVersionsIterator> it;
+    int patch_id_start;
+    int patch_id_end;
+public:
+    VersionRangeTripleVersionsIterator(TripleVersionsIterator* it, int patch_id_start, int patch_id_end);
+    bool next(TripleVersions* triple_versions) override;
+    size_t get_count() override;
+    VersionRangeTripleVersionsIterator* offset(int offset) override;
+};
+
+// Iterator over the distinct triples of a single delta chain (its snapshot merged with the additions of its patch tree),
+// in the query order of the triple pattern.
+// Contrary to PatchTreeTripleVersionsIteratorV2, version annotations are not resolved,
+// so no deletion lookup has to be done for every triple.
+class DeltaChainTripleIterator: public TripleIterator {
+protected:
+    std::unique_ptr<hdt::IteratorTripleID> snapshot_it;
+    std::shared_ptr<PatchTree> patchTree;
+    std::unique_ptr<PatchTreeIterator> addition_it;
+    std::shared_ptr<DictionaryManager> dict;
+    std::unique_ptr<TripleComparator> comparator;
+
+    Triple t1;
+    bool status1;
+
+    std::unique_ptr<PatchTreeAdditionValue> value;
+    Triple t2;
+    bool status2;
+    int max_patch_id;
+
+    void step_snapshot_it();
+    void step_addition_it();
+public:
+    /**
+     * @param max_patch_id Additions that only appear after this patch are skipped,
+     *                     they belong to the next delta chain.
+     */
+    DeltaChainTripleIterator(const Triple& triple_pattern, hdt::IteratorTripleID* snapshot_it, std::shared_ptr<PatchTree> patchTree,
+                             std::shared_ptr<DictionaryManager> dictionary, int max_patch_id = std::numeric_limits<int>::max());
+    bool next(Triple* triple) override;
+    std::shared_ptr<DictionaryManager> get_dictionary() const;
+};
+
+// Counts the distinct triples over multiple delta chains by merging their sorted streams.
+// Only the current head of each chain is kept in memory.
+class TripleVersionsDistinctCounter {
+private:
+    std::unique_ptr<TripleComparator> comparator;
+    std::vector<DeltaChainTripleIterator*> iterators;
+public:
+    explicit TripleVersionsDistinctCounter(hdt::TripleComponentOrder order);
+    ~TripleVersionsDistinctCounter();
+    /**
+     * Add the iterator of a delta chain, the counter takes ownership of it.
+     * All iterators must produce triples in the order this counter was created with.
+     * @param it The iterator to add
+     */
+    void add_iterator(DeltaChainTripleIterator* it);
+    /**
+     * Consume all iterators.
+     * @return The number of distinct triples over all delta chains.
+     */
+    size_t count();
+};
+
 
 #endif //TPFPATCH_STORE_TRIPLEVERSIONITERATOR_H
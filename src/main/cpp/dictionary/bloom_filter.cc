@@ -0,0 +1,48 @@
+#include <algorithm>
+#include <cmath>
+#include "bloom_filter.h"
+
+BloomFilter::BloomFilter(size_t expected_elements, double false_positive_rate) {
+    double n = std::max((size_t) 1, expected_elements);
+    double p = std::min(std::max(false_positive_rate, 1e-9), 0.5);
+    // Optimal number of bits and hash functions for the given size and rate
+    bit_count = std::max((size_t) 64, (size_t) std::ceil(-n * std::log(p) / (std::log(2) * std::log(2))));
+    hash_count = std::max(1u, (unsigned int) std::round(bit_count / n * std::log(2)));
+    bits.resize((bit_count + 63) / 64, 0);
+}
+
+uint64_t BloomFilter::hash(const std::string& key, size_t tag) {
+    // FNV-1a, seeded with the tag
+    uint64_t h = 14695981039346656037ULL ^ (tag * 0x9E3779B97F4A7C15ULL);
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+void BloomFilter::add(const std::string& key, size_t tag) {
+    uint64_t h1 = hash(key, tag);
+    // Derive the other hash functions from two base hashes (Kirsch-Mitzenmacher)
+    uint64_t h2 = (h1 >> 33 | h1 << 31) * 0xC2B2AE3D27D4EB4FULL | 1;
+    for (unsigned int i = 0; i < hash_count; i++) {
+        size_t bit = (h1 + i * h2) % bit_count;
+        bits[bit / 64] |= 1ULL << (bit % 64);
+    }
+}
+
+bool BloomFilter::might_contain(const std::string& key, size_t tag) const {
+    uint64_t h1 = hash(key, tag);
+    uint64_t h2 = (h1 >> 33 | h1 << 31) * 0xC2B2AE3D27D4EB4FULL | 1;
+    for (unsigned int i = 0; i < hash_count; i++) {
+        size_t bit = (h1 + i * h2) % bit_count;
+        if (!(bits[bit / 64] & (1ULL << (bit % 64)))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t BloomFilter::get_size() const {
+    return bits.size() * sizeof(uint64_t);
+}
@@ -0,0 +1,44 @@
+#ifndef TPFPATCH_STORE_BLOOM_FILTER_H
+#define TPFPATCH_STORE_BLOOM_FILTER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * A fixed-size set of strings that can have false positives, but no false negatives.
+ * Each string can be tagged, so that the same string can be a separate member for different tags.
+ */
+class BloomFilter {
+protected:
+    std::vector<uint64_t> bits;
+    size_t bit_count;
+    unsigned int hash_count;
+
+    static uint64_t hash(const std::string& key, size_t tag);
+public:
+    /**
+     * @param expected_elements The number of elements that will be added.
+     * @param false_positive_rate The targeted probability of might_contain returning true for an element that was not added.
+     */
+    BloomFilter(size_t expected_elements, double false_positive_rate);
+    /**
+     * Add a string to this set.
+     * @param key The string to add
+     * @param tag The tag of the string
+     */
+    void add(const std::string& key, size_t tag = 0);
+    /**
+     * Check if a string can be part of this set.
+     * @param key The string to check
+     * @param tag The tag of the string
+     * @return False if the string has definitely not been added, true if it probably has been added.
+     */
+    bool might_contain(const std::string& key, size_t tag = 0) const;
+    /**
+     * @return The number of bytes that are used for the bits of this filter.
+     */
+    size_t get_size() const;
+};
+
+#endif //TPFPATCH_STORE_BLOOM_FILTER_H
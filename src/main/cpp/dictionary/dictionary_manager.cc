@@ -1,5 +1,10 @@
 #include <iostream>
 #include <string>
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include <Dictionary.hpp>
 #include <HDTVocabulary.hpp>
@@ -10,16 +15,17 @@
 #include <boost/iostreams/filter/zlib.hpp>
 
 #include "dictionary_manager.h"
+#include "../query_trace.h"
 
 
 DictionaryManager::DictionaryManager(string basePath, int snapshotId, Dictionary *hdtDict, hdt::PlainDictionary *patchDict, bool readonly)
-        : basePath(std::move(basePath)), snapshotId(snapshotId), hdtDict(hdtDict), patchDict(patchDict), maxHdtId(0), readonly(readonly) {
+        : basePath(std::move(basePath)), snapshotId(snapshotId), hdtDict(hdtDict), patchDict(patchDict), maxHdtId(0), readonly(readonly), mappedDict(nullptr), legacyBase(false), hdtTermFilter(nullptr), baseTerms(0), logTerms(0) {
     updateMaxHdtId();
     load();
 };
 
 DictionaryManager::DictionaryManager(string basePath, int snapshotId, Dictionary *hdtDict, bool readonly)
-        : basePath(std::move(basePath)), snapshotId(snapshotId), hdtDict(hdtDict), maxHdtId(0), readonly(readonly) {
+        : basePath(std::move(basePath)), snapshotId(snapshotId), hdtDict(hdtDict), maxHdtId(0), readonly(readonly), mappedDict(nullptr), legacyBase(false), hdtTermFilter(nullptr), baseTerms(0), logTerms(0) {
     updateMaxHdtId();
     // Create additional dictionary
     patchDict = new hdt::PlainDictionary();
@@ -27,7 +33,7 @@ DictionaryManager::DictionaryManager(string basePath, int snapshotId, Dictionary
 };
 
 DictionaryManager::DictionaryManager(string basePath, int snapshotId, bool readonly)
-        : basePath(std::move(basePath)), snapshotId(snapshotId), maxHdtId(0), readonly(readonly) {
+        : basePath(std::move(basePath)), snapshotId(snapshotId), maxHdtId(0), readonly(readonly), mappedDict(nullptr), legacyBase(false), hdtTermFilter(nullptr), baseTerms(0), logTerms(0) {
     // Create two empty default dictionaries dictionary,
     hdtDict = new hdt::PlainDictionary();
     patchDict = new hdt::PlainDictionary();
@@ -39,11 +45,18 @@ DictionaryManager::~DictionaryManager() {
         save();
     }
     delete patchDict;
+    delete mappedDict;
+    delete hdtTermFilter.load();
 }
 
 void DictionaryManager::load() {
+    std::string mappedFileName = basePath + PATCHDICT_MAPPED_FILENAME_BASE(snapshotId);
     ifstream dictFile(basePath + PATCHDICT_FILENAME_BASE(snapshotId), ios_base::in | ios_base::binary);
-    if (dictFile.is_open()) {
+    if (std::filesystem::exists(mappedFileName)) {
+        // Terms are looked up in place, so nothing has to be decoded here
+        mappedDict = new MappedPatchDictionary(mappedFileName);
+        baseTerms = mappedDict->get_total_count();
+    } else if (dictFile.is_open()) {
         boost::iostreams::filtering_streambuf<boost::iostreams::input> in;
 #ifdef COMPRESS_DICT
         in.push(boost::iostreams::zlib_decompressor());
@@ -54,34 +67,170 @@ void DictionaryManager::load() {
         hdt::ControlInformation ci = hdt::ControlInformation();
         ci.load(decompressed);
         patchDict->load(decompressed, ci);
+        baseTerms = patchDict->getNumberOfElements();
+        legacyBase = true;
     }
+    std::unique_lock<std::shared_mutex> lock(patch_dict_mutex);
+    replayLog();
+}
+
+// Flush a file or directory to disk, so that later renames and removals can not overtake its contents.
+static bool syncFile(const std::string& fileName) {
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    bool synced = ::fsync(fd) == 0;
+    ::close(fd);
+    return synced;
 }
 
 void DictionaryManager::save() {
-    std::ofstream dictFile;
-    dictFile.open(basePath + PATCHDICT_FILENAME_BASE(snapshotId), ios_base::out | ios_base::binary);
-    boost::iostreams::filtering_streambuf<boost::iostreams::output> out;
-#ifdef COMPRESS_DICT
-    out.push(boost::iostreams::zlib_compressor());
-#endif
-    out.push(dictFile);
+    std::unique_lock<std::shared_mutex> lock(patch_dict_mutex);
+    if ((legacyBase && !readonly) || logTerms + logBuffer.size() > std::max(baseTerms, (size_t) PATCHDICT_LOG_MIN_COMPACT_TERMS)) {
+        saveBase();
+    } else {
+        appendLog();
+    }
+}
+
+void DictionaryManager::compact() {
+    std::unique_lock<std::shared_mutex> lock(patch_dict_mutex);
+    saveBase();
+}
+
+void DictionaryManager::appendLog() {
+    if (logBuffer.empty()) {
+        return;
+    }
+    // Each record is the position, the length and the term
+    std::ofstream logFile(basePath + PATCHDICT_LOG_FILENAME_BASE(snapshotId), ios_base::out | ios_base::app | ios_base::binary);
+    for (auto& term : logBuffer) {
+        auto position = (uint8_t) term.second;
+        auto length = (uint32_t) term.first.size();
+        logFile.write((const char*) &position, sizeof(position));
+        logFile.write((const char*) &length, sizeof(length));
+        logFile.write(term.first.data(), length);
+    }
+    logFile.close();
+    if (logFile.fail() || !syncFile(basePath + PATCHDICT_LOG_FILENAME_BASE(snapshotId))) {
+        cerr << "Could not append to the dictionary log of snapshot " << snapshotId << endl;
+        return;
+    }
+    logTerms += logBuffer.size();
+    logBuffer.clear();
+}
+
+void DictionaryManager::replayLog() {
+    std::string logFileName = basePath + PATCHDICT_LOG_FILENAME_BASE(snapshotId);
+    ifstream logFile(logFileName, ios_base::in | ios_base::binary);
+    if (!logFile.is_open()) {
+        return;
+    }
+    std::streamoff valid_size = 0;
+    uint8_t position;
+    uint32_t length;
+    std::string term;
+    while (logFile.read((char*) &position, sizeof(position)) && logFile.read((char*) &length, sizeof(length))) {
+        term.resize(length);
+        if (!logFile.read(&term[0], length)) {
+            break;
+        }
+        auto role = (hdt::TripleComponentRole) position;
+        // Terms may already be in the base file if compaction was interrupted before the log was removed
+        if (findPatchId(term, role) == 0) {
+            patchDict->insert(term, role == hdt::SUBJECT ? hdt::NOT_SHARED_SUBJECT : (role == hdt::PREDICATE ? hdt::NOT_SHARED_PREDICATE
+                                                                                                   : hdt::NOT_SHARED_OBJECT));
+        }
+        logTerms++;
+        valid_size = logFile.tellg();
+    }
+    logFile.close();
 
-    out.set_auto_close(false);
-    std::ostream compressed(&out);
-    hdt::ControlInformation ci = hdt::ControlInformation();
-    patchDict->save(compressed, ci);
+    // Drop an incomplete record from an interrupted append, so that new records can follow the valid ones
+    std::error_code error;
+    if (!readonly && std::filesystem::file_size(logFileName, error) != (uintmax_t) valid_size && !error) {
+        std::filesystem::resize_file(logFileName, valid_size, error);
+    }
+}
+
+void DictionaryManager::saveBase() {
+    std::string fileName = basePath + PATCHDICT_MAPPED_FILENAME_BASE(snapshotId);
+    // The compacted terms keep their IDs, the terms in patchDict follow them
+    hdt::TripleComponentRole roles[3] = {hdt::SUBJECT, hdt::PREDICATE, hdt::OBJECT};
+    size_t patchCounts[3] = {patchDict->getMaxSubjectID(), patchDict->getMaxPredicateID(), patchDict->getMaxObjectID()};
+    std::array<std::vector<std::string>, 3> terms;
+    try {
+        for (size_t i = 0; i < 3; i++) {
+            size_t count = mappedCount(roles[i]);
+            terms[i].reserve(count + patchCounts[i]);
+            for (size_t id = 1; id <= count; id++) {
+                terms[i].push_back(mappedDict->id_to_string(id, roles[i]));
+            }
+            for (size_t id = 1; id <= patchCounts[i]; id++) {
+                terms[i].push_back(patchDict->idToString(id, roles[i]));
+            }
+        }
+        MappedPatchDictionary::write(fileName + ".tmp", terms);
+        if (!syncFile(fileName + ".tmp")) {
+            throw std::runtime_error("could not sync " + fileName + ".tmp");
+        }
+    } catch (const std::exception& e) {
+        cerr << "Could not write the dictionary of snapshot " << snapshotId << ": " << e.what() << endl;
+        std::remove((fileName + ".tmp").c_str());
+        return;
+    }
+    // Replace the base file atomically, the log and the old format only become redundant afterwards.
+    if (std::rename((fileName + ".tmp").c_str(), fileName.c_str()) != 0) {
+        cerr << "Could not replace the dictionary of snapshot " << snapshotId << endl;
+        return;
+    }
+    // The rename must be durable before the log is removed
+    syncFile(basePath.empty() ? "." : basePath);
+    std::remove((basePath + PATCHDICT_LOG_FILENAME_BASE(snapshotId)).c_str());
+    std::remove((basePath + PATCHDICT_FILENAME_BASE(snapshotId)).c_str());
+    legacyBase = false;
+    logTerms = 0;
+    logBuffer.clear();
+
+    // Continue from the new file, so that the terms no longer have to be kept in memory
+    try {
+        auto* newMappedDict = new MappedPatchDictionary(fileName);
+        delete mappedDict;
+        mappedDict = newMappedDict;
+        delete patchDict;
+        patchDict = new hdt::PlainDictionary();
+    } catch (const std::exception& e) {
+        // The current terms are still valid
+    }
+    baseTerms = terms[0].size() + terms[1].size() + terms[2].size();
 }
 
 std::string DictionaryManager::idToString(size_t id, hdt::TripleComponentRole position) {
     if (id == 0) return "";
 
+    // IDs never change meaning, so decoded terms can be cached without invalidation
+    size_t key = id * 3 + position;
+    std::string str;
+    if (termCache.get(key, str)) {
+        return str;
+    }
+
+    TRACE_COUNT(TRACE_TERMS_DECODED, 1);
     // Check whether id is from HDT or not (MSB is not set)
     if (id <= maxHdtId) {
-        return hdtDict->idToString(id, position);
+        str = hdtDict->idToString(id, position);
+    } else {
+        std::shared_lock<std::shared_mutex> lock(patch_dict_mutex);
+        size_t patchId = id - maxHdtId;
+        size_t count = mappedCount(position);
+        str = patchId <= count ? mappedDict->id_to_string(patchId, position) : patchDict->idToString(patchId - count, position);
     }
-
-    std::shared_lock<std::shared_mutex> lock(patch_dict_mutex);
-    return patchDict->idToString(id - maxHdtId, position);
+    // Unknown IDs may still be assigned later on
+    if (!str.empty()) {
+        termCache.put(key, str);
+    }
+    return str;
 }
 
 size_t DictionaryManager::stringToId(const std::string &str, hdt::TripleComponentRole position) {
@@ -89,49 +238,107 @@ size_t DictionaryManager::stringToId(const std::string &str, hdt::TripleComponen
     if (str.empty()) return 0;
 
     // First ask HDT
-    size_t id;
-    try {
-        id = hdtDict->stringToId(str, position);
-        if (id > 0) {
-            return id;
-        }
-    } catch (std::exception e) {
-    } // String is not in there
+    size_t id = findHdtId(str, position);
+    if (id > 0) {
+        hdtLookups.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
 
     std::shared_lock<std::shared_mutex> lock(patch_dict_mutex);
-    id = patchDict->stringToId(str, position);
+    id = findPatchId(str, position);
     if (id == 0) {  // the string is not in PatchTree dictionary either
+        missedLookups.fetch_add(1, std::memory_order_relaxed);
         std::string err = "Unknown string: " + str;
         throw std::runtime_error(err);
     }
+    patchLookups.fetch_add(1, std::memory_order_relaxed);
     return id + maxHdtId;
 }
 
 size_t DictionaryManager::insert(const std::string &str, hdt::TripleComponentRole position) {
     if (str.empty()) return 0;
 
-    // First ask HDT
-    size_t id;
-    try {
-        id = hdtDict->stringToId(str, position);
-        if (id > 0) {
-            return id;
-        }
-    } catch (std::exception e) {
-    } // ID is not in there
+    // First ask HDT, new terms are mostly filtered out before searching it if the ingest path prepared for insertions
+    size_t id = findHdtId(str, position);
+    if (id > 0) {
+        hdtLookups.fetch_add(1, std::memory_order_relaxed);
+        return id;
+    }
 
     std::unique_lock<std::shared_mutex> lock(patch_dict_mutex);
-    size_t originalId = patchDict->stringToId(str, position);
+    size_t originalId = findPatchId(str, position);
+    (originalId == 0 ? missedLookups : patchLookups).fetch_add(1, std::memory_order_relaxed);
     if (originalId == 0) {
         patchDict->insert(str, position == hdt::SUBJECT ? hdt::NOT_SHARED_SUBJECT : (position == hdt::PREDICATE ? hdt::NOT_SHARED_PREDICATE
                                                                                                  : hdt::NOT_SHARED_OBJECT));
-        originalId = patchDict->stringToId(str, position);
+        originalId = findPatchId(str, position);
+        if (!readonly) {
+            logBuffer.emplace_back(str, position);
+            if (logBuffer.size() >= PATCHDICT_LOG_FLUSH_TERMS) {
+                appendLog();
+            }
+        }
     }
     id  = originalId + maxHdtId;
 
     return id;
 }
 
+void DictionaryManager::prepareInsertions() {
+    std::call_once(hdtTermFilterBuilt, &DictionaryManager::buildHdtTermFilter, this);
+}
+
+size_t DictionaryManager::findHdtId(const std::string &str, hdt::TripleComponentRole position) {
+    BloomFilter* filter = hdtTermFilter.load(std::memory_order_acquire);
+    if (filter != nullptr && !filter->might_contain(str, position)) {
+        return 0;
+    }
+    try {
+        return hdtDict->stringToId(str, position);
+    } catch (const std::exception& e) {
+        return 0; // String is not in there
+    }
+}
+
+size_t DictionaryManager::mappedCount(hdt::TripleComponentRole position) const {
+    return mappedDict != nullptr ? mappedDict->get_count(position) : 0;
+}
+
+size_t DictionaryManager::findPatchId(const std::string &str, hdt::TripleComponentRole position) {
+    if (mappedDict != nullptr) {
+        size_t id = mappedDict->string_to_id(str, position);
+        if (id > 0) {
+            return id;
+        }
+    }
+    size_t id = patchDict->stringToId(str, position);
+    return id > 0 ? id + mappedCount(position) : 0;
+}
+
+void DictionaryManager::buildHdtTermFilter() {
+    size_t max_s = hdtDict->getMaxSubjectID();
+    size_t max_p = hdtDict->getMaxPredicateID();
+    size_t max_o = hdtDict->getMaxObjectID();
+    // Shared terms are added for both the subject and object position, just like HDT looks them up.
+    auto* filter = new BloomFilter(max_s + max_p + max_o, HDT_TERM_FILTER_FALSE_POSITIVE_RATE);
+    try {
+        for (size_t id = 1; id <= max_s; id++) {
+            filter->add(hdtDict->idToString(id, hdt::SUBJECT), hdt::SUBJECT);
+        }
+        for (size_t id = 1; id <= max_p; id++) {
+            filter->add(hdtDict->idToString(id, hdt::PREDICATE), hdt::PREDICATE);
+        }
+        for (size_t id = 1; id <= max_o; id++) {
+            filter->add(hdtDict->idToString(id, hdt::OBJECT), hdt::OBJECT);
+        }
+    } catch (const std::exception& e) {
+        // Without a complete filter, all lookups simply go to HDT
+        delete filter;
+        return;
+    }
+    hdtTermFilter.store(filter, std::memory_order_release);
+}
+
 hdt::Dictionary* DictionaryManager::getHdtDict() const {
     return hdtDict;
 }
@@ -141,55 +348,62 @@ hdt::ModifiableDictionary* DictionaryManager::getPatchDict() const {
 }
 
 void DictionaryManager::cleanup(string basePath, int snapshotId) {
-    std::remove((PATCHDICT_FILENAME_BASE(snapshotId)).c_str());
+    std::remove((basePath + PATCHDICT_FILENAME_BASE(snapshotId)).c_str());
+    std::remove((basePath + PATCHDICT_LOG_FILENAME_BASE(snapshotId)).c_str());
+    std::remove((basePath + PATCHDICT_MAPPED_FILENAME_BASE(snapshotId)).c_str());
 }
 
 size_t DictionaryManager::getNumberOfElements() {
-    return hdtDict->getNumberOfElements() + patchDict->getNumberOfElements();
+    size_t mapped = mappedDict != nullptr ? mappedDict->get_total_count() : 0;
+    return hdtDict->getNumberOfElements() + patchDict->getNumberOfElements() + mapped;
 }
 
 uint64_t DictionaryManager::size() {
-    return hdtDict->size() + patchDict->size();
+    size_t mapped = mappedDict != nullptr ? mappedDict->get_data_size() : 0;
+    return hdtDict->size() + patchDict->size() + mapped;
 }
 
 size_t DictionaryManager::getNsubjects() {
-    return hdtDict->getNsubjects() + patchDict->getNsubjects();
+    return hdtDict->getNsubjects() + patchDict->getNsubjects() + mappedCount(hdt::SUBJECT);
 }
 
 size_t DictionaryManager::getNpredicates() {
-    return hdtDict->getNpredicates() + patchDict->getNpredicates();
+    return hdtDict->getNpredicates() + patchDict->getNpredicates() + mappedCount(hdt::PREDICATE);
 }
 
 size_t DictionaryManager::getNobjects() {
-    return hdtDict->getNobjects() + patchDict->getNobjects();
+    return hdtDict->getNobjects() + patchDict->getNobjects() + mappedCount(hdt::OBJECT);
 }
 
 size_t DictionaryManager::getNobjectsLiterals() {
-    return hdtDict->getNobjectsLiterals() + patchDict->getNobjectsLiterals();
+    size_t mapped = mappedDict != nullptr ? mappedDict->get_literal_count() : 0;
+    return hdtDict->getNobjectsLiterals() + patchDict->getNobjectsLiterals() + mapped;
 }
 
 size_t DictionaryManager::getNobjectsNotLiterals() {
-    return hdtDict->getNobjectsNotLiterals() + patchDict->getNobjectsNotLiterals();
+    size_t mapped = mappedDict != nullptr ? mappedDict->get_count(hdt::OBJECT) - mappedDict->get_literal_count() : 0;
+    return hdtDict->getNobjectsNotLiterals() + patchDict->getNobjectsNotLiterals() + mapped;
 }
 
 size_t DictionaryManager::getNshared() {
-    return hdtDict->getNshared() + patchDict->getNshared();
+    size_t mapped = mappedDict != nullptr ? mappedDict->get_shared_count() : 0;
+    return hdtDict->getNshared() + patchDict->getNshared() + mapped;
 }
 
 size_t DictionaryManager::getMaxID() {
-    return patchDict->getMaxID();
+    return std::max({getMaxSubjectID(), getMaxPredicateID(), getMaxObjectID()});
 }
 
 size_t DictionaryManager::getMaxSubjectID() {
-    return patchDict->getMaxSubjectID();
+    return patchDict->getMaxSubjectID() + mappedCount(hdt::SUBJECT);
 }
 
 size_t DictionaryManager::getMaxPredicateID() {
-    return patchDict->getMaxPredicateID();
+    return patchDict->getMaxPredicateID() + mappedCount(hdt::PREDICATE);
 }
 
 size_t DictionaryManager::getMaxObjectID() {
-    return patchDict->getMaxObjectID();
+    return patchDict->getMaxObjectID() + mappedCount(hdt::OBJECT);
 }
 
 void DictionaryManager::populateHeader(hdt::Header &header, string rootNode) {}
@@ -261,6 +475,37 @@ size_t DictionaryManager::getMaxHdtId() const {
     return maxHdtId;
 }
 
+int DictionaryManager::getSnapshotId() const {
+    return snapshotId;
+}
+
+void DictionaryManager::setTranslationMap(std::shared_ptr<IdTranslationMap> map) {
+    translationMap = std::move(map);
+}
+
+const IdTranslationMap* DictionaryManager::getTranslationMap() const {
+    return translationMap.get();
+}
+
+TermCache& DictionaryManager::getTermCache() {
+    return termCache;
+}
+
+size_t DictionaryManager::getMemoryFootprint() {
+    size_t footprint = termCache.get_size();
+    std::shared_lock<std::shared_mutex> lock(patch_dict_mutex);
+    footprint += patchDict->size();
+    if (mappedDict != nullptr) {
+        footprint += mappedDict->get_mapping_size();
+    }
+    return footprint;
+}
+
+DictionaryLookups DictionaryManager::getLookups() const {
+    return {hdtLookups.load(std::memory_order_relaxed), patchLookups.load(std::memory_order_relaxed),
+            missedLookups.load(std::memory_order_relaxed)};
+}
+
 void DictionaryManager::updateMaxHdtId() {
     size_t max_s = hdtDict->getMaxSubjectID();
     size_t max_p = hdtDict->getMaxPredicateID();
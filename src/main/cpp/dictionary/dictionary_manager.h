@@ -2,6 +2,11 @@
 #define TPFPATCH_STORE_DICTIONARY_MANAGER_H
 
 #define PATCHDICT_FILENAME_BASE(id) ("snapshotpatch_" + std::to_string(id) + ".dic")
+#define PATCHDICT_LOG_FILENAME_BASE(id) (PATCHDICT_FILENAME_BASE(id) + ".log")
+// The number of new terms that are buffered before they are appended to the log
+#define PATCHDICT_LOG_FLUSH_TERMS 10000
+// The minimum number of terms in the log before it is compacted into the base file
+#define PATCHDICT_LOG_MIN_COMPACT_TERMS 100000
 #define COMPRESS_DICT
 
 #include <Dictionary.hpp>
@@ -10,13 +15,37 @@
 #include <Triples.hpp>
 #include <shared_mutex>
 #include <mutex>
+#include <atomic>
+#include <memory>
+#include "bloom_filter.h"
+#include "term_cache.h"
+#include "mapped_patch_dictionary.h"
+#include "id_translation_map.h"
 
+// The targeted false positive rate of the filter over HDT terms
+#define HDT_TERM_FILTER_FALSE_POSITIVE_RATE 0.01
+
+
+/**
+ * The number of string lookups in a dictionary, by where the string was found.
+ */
+struct DictionaryLookups {
+    size_t hdt;
+    size_t patch;
+    // Strings that were in neither dictionary
+    size_t misses;
+};
 
 class DictionaryManager : public hdt::ModifiableDictionary {
 
     std::string basePath;
     Dictionary *hdtDict;             // Dictionary from HDT file
     hdt::PlainDictionary *patchDict; // Additional dictionary
+    // Compacted terms of the additional dictionary, the terms in patchDict follow them per role.
+    // This is null if the dictionary was never compacted.
+    MappedPatchDictionary *mappedDict;
+    // If the compacted terms were loaded from the old compressed format into patchDict, to be migrated on save.
+    bool legacyBase;
 
     size_t maxHdtId;
     int snapshotId;
@@ -26,7 +55,47 @@ class DictionaryManager : public hdt::ModifiableDictionary {
     // we only need to synchronise around the PatchTree dictionary
     std::shared_mutex patch_dict_mutex;
 
+    // Filter over the terms in the HDT dictionary, so that lookups of new terms can skip HDT.
+    // It is only built once the ingest path prepares for insertions, queries insert their terms as well but should not pay for it.
+    std::atomic<BloomFilter*> hdtTermFilter;
+    std::once_flag hdtTermFilterBuilt;
+
+    // Recently decoded terms, by ID and position
+    TermCache termCache;
+
+    // Translation from the HDT IDs of the previous snapshot, may be null.
+    std::shared_ptr<IdTranslationMap> translationMap;
+
+    // New terms are appended to a log, which is compacted into the base file once it becomes larger than it.
+    std::vector<std::pair<std::string, hdt::TripleComponentRole>> logBuffer;
+    size_t baseTerms;
+    size_t logTerms;
+
+    std::atomic<size_t> hdtLookups{0};
+    std::atomic<size_t> patchLookups{0};
+    std::atomic<size_t> missedLookups{0};
+
     void updateMaxHdtId();
+    void buildHdtTermFilter();
+    /**
+     * @param position The position in the triple
+     * @return The number of compacted terms for the given position.
+     */
+    size_t mappedCount(hdt::TripleComponentRole position) const;
+    /**
+     * Find a patch term, patch_dict_mutex must be held.
+     * @param str The string to look up
+     * @param position The position of the string in the triple
+     * @return The ID relative to maxHdtId, or 0 if the string is not a patch term.
+     */
+    size_t findPatchId(const std::string &str, hdt::TripleComponentRole position);
+    /**
+     * Find the ID of a string in the HDT dictionary, without throwing exceptions for unknown strings.
+     * @param str The string to look up
+     * @param position The position of the string in the triple
+     * @return The ID, or 0 if the string is not in HDT.
+     */
+    size_t findHdtId(const std::string &str, hdt::TripleComponentRole position);
 public:
     DictionaryManager(std::string basePath, int snapshotId, Dictionary *hdtDict, hdt::PlainDictionary *patchDict, bool readonly = false);
     DictionaryManager(std::string basePath, int snapshotId, Dictionary *hdtDict, bool readonly = false);
@@ -58,6 +127,13 @@ public:
     **/
     size_t insert(const std::string &str, hdt::TripleComponentRole position) override;
 
+    /**
+     * Prepare for inserting many new terms, as done when ingesting a patch.
+     * The first call builds a filter over the HDT terms by scanning the HDT dictionary,
+     * after which inserts of new terms mostly skip searching HDT.
+     */
+    void prepareInsertions();
+
     Dictionary* getHdtDict() const;
     ModifiableDictionary* getPatchDict() const;
     /**
@@ -74,6 +150,31 @@ public:
     int compareComponent(size_t componentId1, size_t componentId2, hdt::TripleComponentRole role);
 
     size_t getMaxHdtId() const;
+    int getSnapshotId() const;
+
+    /**
+     * @param map The translation from the HDT IDs of the previous snapshot to the ones of this snapshot.
+     *            This must be set before this dictionary is shared with other threads.
+     */
+    void setTranslationMap(std::shared_ptr<IdTranslationMap> map);
+    /**
+     * @return The translation from the HDT IDs of the previous snapshot, or null if there is none.
+     */
+    const IdTranslationMap* getTranslationMap() const;
+
+    /**
+     * @return The cache of decoded terms, which can be resized and exposes its hit rate.
+     */
+    TermCache& getTermCache();
+    /**
+     * @return The number of bytes that the patch dictionary and the term cache use in memory,
+     *         the HDT dictionary is not included.
+     */
+    size_t getMemoryFootprint();
+    /**
+     * @return The number of string lookups so far, by where the string was found.
+     */
+    DictionaryLookups getLookups() const;
 
     /**
     * Proxied methods
@@ -118,9 +219,31 @@ public:
     hdt::IteratorUCharString *getSuggestions(const char *prefix, hdt::TripleComponentRole role) override;
     hdt::IteratorUInt *getIDSuggestions(const char *prefix, hdt::TripleComponentRole role) override;
 
+    /**
+     * Persist the terms that were inserted since the last save.
+     * New terms are appended to the log, unless the log has grown larger than the base file,
+     * in which case the whole dictionary is compacted into a new base file.
+     */
     void save();
+    /**
+     * Write the whole dictionary to the memory-mappable base file, and clear the log.
+     */
+    void compact();
 protected:
     void load();
+    /**
+     * Append the buffered new terms to the log, patch_dict_mutex must be held exclusively.
+     */
+    void appendLog();
+    /**
+     * Insert the terms from the log, ignoring an incomplete record at the end, patch_dict_mutex must be held exclusively.
+     */
+    void replayLog();
+    /**
+     * Write the whole dictionary to the memory-mappable base file, and remove the log and the old compressed file,
+     * patch_dict_mutex must be held exclusively.
+     */
+    void saveBase();
 };
 
 class DictManagerIterator : public hdt::IteratorUCharString {
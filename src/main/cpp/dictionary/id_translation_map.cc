@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "id_translation_map.h"
+
+#define ID_MAP_MAGIC "OSTIDM01"
+#define ID_MAP_HEADER_SIZE (8 + 2 * 8 + 3 * 5 * 8)
+
+namespace {
+    // A sorted run of IDs in an HDT dictionary section
+    struct RunCursor {
+        hdt::Dictionary* dict;
+        int side;
+        size_t id;
+        size_t last;
+        std::string term;
+    };
+
+    void write_uint64(std::ofstream& out, uint64_t value) {
+        out.write((const char*) &value, sizeof(value));
+    }
+
+    void write_array(std::ofstream& out, const std::vector<uint64_t>& values) {
+        out.write((const char*) values.data(), values.size() * sizeof(uint64_t));
+    }
+}
+
+IdTranslationMap::IdTranslationMap(const std::string& file_name)
+        : file_name(file_name), mapping(nullptr), mapping_size(0), from_snapshot(-1), to_snapshot(-1), sections() {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the translation map " + file_name);
+    }
+    struct stat sb{};
+    if (fstat(fd, &sb) != 0 || (size_t) sb.st_size < ID_MAP_HEADER_SIZE) {
+        close(fd);
+        throw std::runtime_error("Invalid translation map " + file_name);
+    }
+    mapping_size = (size_t) sb.st_size;
+    void* ptr = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        throw std::runtime_error("Could not map the translation map " + file_name);
+    }
+    mapping = (unsigned char*) ptr;
+
+    auto fail = [this](const std::string& reason) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        throw std::runtime_error("Invalid translation map " + this->file_name + ": " + reason);
+    };
+    if (std::memcmp(mapping, ID_MAP_MAGIC, 8) != 0) {
+        fail("unknown format");
+    }
+    const auto* header = (const uint64_t*) (mapping + 8);
+    from_snapshot = (int) header[0];
+    to_snapshot = (int) header[1];
+    for (size_t i = 0; i < 3; i++) {
+        const uint64_t* fields = header + 2 + i * 5;
+        Section& section = sections[i];
+        section.count_from = fields[0];
+        section.count_to = fields[1];
+        if (fields[2] + section.count_from * 8 > mapping_size || fields[3] + section.count_to * 8 > mapping_size
+            || fields[4] + section.count_from * 8 > mapping_size) {
+            fail("section out of bounds");
+        }
+        section.ranks_from = (const uint64_t*) (mapping + fields[2]);
+        section.ranks_to = (const uint64_t*) (mapping + fields[3]);
+        section.translation = (const uint64_t*) (mapping + fields[4]);
+    }
+}
+
+IdTranslationMap::~IdTranslationMap() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+size_t IdTranslationMap::role_index(hdt::TripleComponentRole role) {
+    switch (role) {
+        case hdt::SUBJECT: return 0;
+        case hdt::PREDICATE: return 1;
+        default: return 2;
+    }
+}
+
+int IdTranslationMap::get_from_snapshot() const {
+    return from_snapshot;
+}
+
+int IdTranslationMap::get_to_snapshot() const {
+    return to_snapshot;
+}
+
+size_t IdTranslationMap::translate(size_t id, hdt::TripleComponentRole role) const {
+    const Section& section = sections[role_index(role)];
+    if (id == 0 || id > section.count_from) {
+        return 0;
+    }
+    return section.translation[id - 1];
+}
+
+bool IdTranslationMap::compare(size_t from_id, size_t to_id, hdt::TripleComponentRole role, int32_t& result) const {
+    const Section& section = sections[role_index(role)];
+    if (from_id == 0 || to_id == 0 || from_id > section.count_from || to_id > section.count_to) {
+        return false;
+    }
+    uint64_t rank1 = section.ranks_from[from_id - 1];
+    uint64_t rank2 = section.ranks_to[to_id - 1];
+    result = rank1 < rank2 ? -1 : (rank1 > rank2 ? 1 : 0);
+    return true;
+}
+
+void IdTranslationMap::build(hdt::Dictionary* from, hdt::Dictionary* to, int from_snapshot, int to_snapshot, const std::string& file_name) {
+    hdt::TripleComponentRole roles[3] = {hdt::SUBJECT, hdt::PREDICATE, hdt::OBJECT};
+    hdt::Dictionary* dicts[2] = {from, to};
+    std::array<std::array<std::vector<uint64_t>, 2>, 3> ranks;
+    std::array<std::vector<uint64_t>, 3> translations;
+    for (size_t i = 0; i < 3; i++) {
+        hdt::TripleComponentRole role = roles[i];
+        // Subjects and objects are sorted within the shared section and within their own section,
+        // so the terms of both snapshots are ranked by merging these sorted runs.
+        std::vector<RunCursor> cursors;
+        for (int side = 0; side < 2; side++) {
+            hdt::Dictionary* dict = dicts[side];
+            size_t max_id = role == hdt::SUBJECT ? dict->getMaxSubjectID()
+                    : (role == hdt::PREDICATE ? dict->getMaxPredicateID() : dict->getMaxObjectID());
+            ranks[i][side].resize(max_id, 0);
+            size_t shared = role == hdt::PREDICATE ? 0 : std::min(dict->getNshared(), max_id);
+            if (shared > 0) {
+                cursors.push_back({dict, side, 1, shared, ""});
+            }
+            if (max_id > shared) {
+                cursors.push_back({dict, side, shared + 1, max_id, ""});
+            }
+        }
+        translations[i].resize(ranks[i][0].size(), 0);
+        for (auto& cursor : cursors) {
+            cursor.term = cursor.dict->idToString(cursor.id, role);
+        }
+
+        uint64_t rank = 0;
+        std::string previous;
+        size_t rank_ids[2] = {0, 0};
+        while (!cursors.empty()) {
+            size_t min = 0;
+            for (size_t c = 1; c < cursors.size(); c++) {
+                if (cursors[c].term.compare(cursors[min].term) < 0) {
+                    min = c;
+                }
+            }
+            RunCursor& cursor = cursors[min];
+            if (rank == 0 || cursor.term != previous) {
+                rank++;
+                previous = cursor.term;
+                rank_ids[0] = rank_ids[1] = 0;
+            }
+            ranks[i][cursor.side][cursor.id - 1] = rank;
+            rank_ids[cursor.side] = cursor.id;
+            if (rank_ids[0] > 0 && rank_ids[1] > 0) {
+                translations[i][rank_ids[0] - 1] = rank_ids[1];
+            }
+            if (cursor.id < cursor.last) {
+                cursor.id++;
+                cursor.term = cursor.dict->idToString(cursor.id, role);
+            } else {
+                cursors.erase(cursors.begin() + min);
+            }
+        }
+    }
+
+    std::string tmp_file_name = file_name + ".tmp";
+    std::ofstream out(tmp_file_name, std::ios::binary | std::ios::trunc);
+    out.write(ID_MAP_MAGIC, 8);
+    write_uint64(out, (uint64_t) from_snapshot);
+    write_uint64(out, (uint64_t) to_snapshot);
+    uint64_t offset = ID_MAP_HEADER_SIZE;
+    for (size_t i = 0; i < 3; i++) {
+        write_uint64(out, ranks[i][0].size());
+        write_uint64(out, ranks[i][1].size());
+        write_uint64(out, offset);
+        offset += ranks[i][0].size() * 8;
+        write_uint64(out, offset);
+        offset += ranks[i][1].size() * 8;
+        write_uint64(out, offset);
+        offset += translations[i].size() * 8;
+    }
+    for (size_t i = 0; i < 3; i++) {
+        write_array(out, ranks[i][0]);
+        write_array(out, ranks[i][1]);
+        write_array(out, translations[i]);
+    }
+    out.close();
+    if (out.fail() || std::rename(tmp_file_name.c_str(), file_name.c_str()) != 0) {
+        std::remove(tmp_file_name.c_str());
+        throw std::runtime_error("Could not write the translation map " + file_name);
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef TPFPATCH_STORE_ID_TRANSLATION_MAP_H
+#define TPFPATCH_STORE_ID_TRANSLATION_MAP_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <Dictionary.hpp>
+
+#define SNAPSHOT_ID_MAP_FILENAME(from, to) ("snapshotmap_" + std::to_string(from) + "_" + std::to_string(to) + ".idm")
+
+/**
+ * A memory-mapped translation between the HDT ID spaces of two consecutive snapshots,
+ * so that components of both snapshots can be compared without decoding them.
+ *
+ * For each triple component role, the file contains:
+ * - The rank of every term of both snapshots in their combined sorted order, where equal terms have equal ranks.
+ * - The ID in the second snapshot of every term of the first snapshot, or 0 if it does not exist there.
+ *
+ * Only the terms in the HDT files are covered, patch terms must still be compared as strings.
+ */
+class IdTranslationMap {
+protected:
+    struct Section {
+        uint64_t count_from;
+        uint64_t count_to;
+        const uint64_t* ranks_from;
+        const uint64_t* ranks_to;
+        const uint64_t* translation;
+    };
+    std::string file_name;
+    unsigned char* mapping;
+    size_t mapping_size;
+    int from_snapshot;
+    int to_snapshot;
+    std::array<Section, 3> sections;
+
+    static size_t role_index(hdt::TripleComponentRole role);
+public:
+    /**
+     * Map the given file into memory.
+     * @param file_name The file to map
+     * @throws std::runtime_error If the file can not be mapped or is invalid.
+     */
+    explicit IdTranslationMap(const std::string& file_name);
+    ~IdTranslationMap();
+    /**
+     * @return The id of the snapshot that is translated from.
+     */
+    int get_from_snapshot() const;
+    /**
+     * @return The id of the snapshot that is translated to.
+     */
+    int get_to_snapshot() const;
+    /**
+     * @param id An ID from the first snapshot
+     * @param role SUBJECT, PREDICATE or OBJECT
+     * @return The ID of the same term in the second snapshot, or 0 if it is not in there.
+     */
+    size_t translate(size_t id, hdt::TripleComponentRole role) const;
+    /**
+     * Compare the terms of a component of both snapshots.
+     * @param from_id An ID from the first snapshot
+     * @param to_id An ID from the second snapshot
+     * @param role SUBJECT, PREDICATE or OBJECT
+     * @param result Set to a negative number, zero or a positive number
+     *        if the first term is smaller than, equal to or larger than the second one.
+     * @return If both IDs are covered by this map, otherwise result is not set.
+     */
+    bool compare(size_t from_id, size_t to_id, hdt::TripleComponentRole role, int32_t& result) const;
+    /**
+     * Write a translation map file.
+     * @param from The HDT dictionary of the first snapshot
+     * @param to The HDT dictionary of the second snapshot
+     * @param from_snapshot The id of the first snapshot
+     * @param to_snapshot The id of the second snapshot
+     * @param file_name The file to write to
+     * @throws std::runtime_error If the file could not be written.
+     */
+    static void build(hdt::Dictionary* from, hdt::Dictionary* to, int from_snapshot, int to_snapshot, const std::string& file_name);
+};
+
+#endif //TPFPATCH_STORE_ID_TRANSLATION_MAP_H
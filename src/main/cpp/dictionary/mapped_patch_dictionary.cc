@@ -0,0 +1,283 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <numeric>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mapped_patch_dictionary.h"
+
+#define MAPPED_DICT_MAGIC "OSTPDM01"
+#define MAPPED_DICT_HEADER_SIZE (8 + 8 + 3 * 5 * 8)
+
+namespace {
+    void write_varint(std::string& out, uint64_t value) {
+        while (value >= 0x80) {
+            out.push_back((char) ((value & 0x7F) | 0x80));
+            value >>= 7;
+        }
+        out.push_back((char) value);
+    }
+
+    uint64_t read_varint(const unsigned char*& pos, const unsigned char* end) {
+        uint64_t value = 0;
+        int shift = 0;
+        while (pos < end && shift < 64) {
+            unsigned char byte = *pos++;
+            value |= (uint64_t) (byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return value;
+            }
+            shift += 7;
+        }
+        throw std::runtime_error("Corrupt term in memory-mapped patch dictionary");
+    }
+
+    void write_uint64(std::ofstream& out, uint64_t value) {
+        out.write((const char*) &value, sizeof(value));
+    }
+
+    void pad(std::ofstream& out, uint64_t& offset) {
+        static const char zeros[8] = {0};
+        uint64_t padding = (8 - offset % 8) % 8;
+        out.write(zeros, padding);
+        offset += padding;
+    }
+}
+
+MappedPatchDictionary::MappedPatchDictionary(const std::string& file_name)
+        : file_name(file_name), mapping(nullptr), mapping_size(0), block_size(0), sections(), shared_count(0) {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the patch dictionary " + file_name);
+    }
+    struct stat sb{};
+    if (fstat(fd, &sb) != 0 || (size_t) sb.st_size < MAPPED_DICT_HEADER_SIZE) {
+        close(fd);
+        throw std::runtime_error("Invalid patch dictionary " + file_name);
+    }
+    mapping_size = (size_t) sb.st_size;
+    void* ptr = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        throw std::runtime_error("Could not map the patch dictionary " + file_name);
+    }
+    mapping = (unsigned char*) ptr;
+
+    auto fail = [this](const std::string& reason) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        throw std::runtime_error("Invalid patch dictionary " + this->file_name + ": " + reason);
+    };
+    if (std::memcmp(mapping, MAPPED_DICT_MAGIC, 8) != 0) {
+        fail("unknown format");
+    }
+    const auto* header = (const uint64_t*) (mapping + 8);
+    block_size = header[0];
+    if (block_size == 0) {
+        fail("invalid block size");
+    }
+    for (size_t i = 0; i < 3; i++) {
+        const uint64_t* fields = header + 1 + i * 5;
+        Section& section = sections[i];
+        section.count = fields[0];
+        uint64_t block_count = (section.count + block_size - 1) / block_size;
+        uint64_t blocks_offset = fields[1];
+        uint64_t data_offset = fields[2];
+        section.data_size = fields[3];
+        uint64_t sorted_ids_offset = fields[4];
+        if (blocks_offset + block_count * 8 > mapping_size || data_offset + section.data_size > mapping_size
+            || sorted_ids_offset + section.count * 8 > mapping_size || blocks_offset % 8 != 0 || sorted_ids_offset % 8 != 0) {
+            fail("section out of bounds");
+        }
+        section.block_offsets = (const uint64_t*) (mapping + blocks_offset);
+        section.data = mapping + data_offset;
+        section.sorted_ids = (const uint64_t*) (mapping + sorted_ids_offset);
+    }
+}
+
+MappedPatchDictionary::~MappedPatchDictionary() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+size_t MappedPatchDictionary::role_index(hdt::TripleComponentRole role) {
+    switch (role) {
+        case hdt::SUBJECT: return 0;
+        case hdt::PREDICATE: return 1;
+        default: return 2;
+    }
+}
+
+std::string MappedPatchDictionary::decode(const Section& section, uint64_t id) const {
+    uint64_t index = id - 1;
+    uint64_t block_offset = section.block_offsets[index / block_size];
+    if (block_offset > section.data_size) {
+        throw std::runtime_error("Corrupt block in memory-mapped patch dictionary");
+    }
+    const unsigned char* pos = section.data + block_offset;
+    const unsigned char* end = section.data + section.data_size;
+    uint64_t length = read_varint(pos, end);
+    if (length > (uint64_t) (end - pos)) {
+        throw std::runtime_error("Corrupt term in memory-mapped patch dictionary");
+    }
+    std::string str((const char*) pos, length);
+    pos += length;
+    for (uint64_t i = 0; i < index % block_size; i++) {
+        uint64_t prefix = read_varint(pos, end);
+        uint64_t suffix = read_varint(pos, end);
+        if (prefix > str.size() || suffix > (uint64_t) (end - pos)) {
+            throw std::runtime_error("Corrupt term in memory-mapped patch dictionary");
+        }
+        str.resize(prefix);
+        str.append((const char*) pos, suffix);
+        pos += suffix;
+    }
+    return str;
+}
+
+int MappedPatchDictionary::compare(const Section& section, uint64_t id, const std::string& str) const {
+    return decode(section, id).compare(str);
+}
+
+size_t MappedPatchDictionary::get_count(hdt::TripleComponentRole role) const {
+    return sections[role_index(role)].count;
+}
+
+size_t MappedPatchDictionary::get_total_count() const {
+    return sections[0].count + sections[1].count + sections[2].count;
+}
+
+size_t MappedPatchDictionary::get_mapping_size() const {
+    return mapping_size;
+}
+
+size_t MappedPatchDictionary::get_data_size() const {
+    return sections[0].data_size + sections[1].data_size + sections[2].data_size;
+}
+
+size_t MappedPatchDictionary::get_literal_count() const {
+    // Literals start with a quote, so they are a contiguous range of the sorted objects
+    const Section& section = sections[role_index(hdt::OBJECT)];
+    const uint64_t* begin = section.sorted_ids;
+    const uint64_t* end = section.sorted_ids + section.count;
+    const uint64_t* first = std::partition_point(begin, end, [&](uint64_t id) { return compare(section, id, "\"") < 0; });
+    const uint64_t* last = std::partition_point(first, end, [&](uint64_t id) { return compare(section, id, "#") < 0; });
+    return last - first;
+}
+
+size_t MappedPatchDictionary::get_shared_count() const {
+    std::call_once(shared_counted, [this]() {
+        const Section& subjects = sections[role_index(hdt::SUBJECT)];
+        const Section& objects = sections[role_index(hdt::OBJECT)];
+        uint64_t i = 0;
+        uint64_t j = 0;
+        while (i < subjects.count && j < objects.count) {
+            int comparison = decode(subjects, subjects.sorted_ids[i]).compare(decode(objects, objects.sorted_ids[j]));
+            if (comparison == 0) {
+                shared_count++;
+            }
+            i += comparison <= 0 ? 1 : 0;
+            j += comparison >= 0 ? 1 : 0;
+        }
+    });
+    return shared_count;
+}
+
+std::string MappedPatchDictionary::id_to_string(size_t id, hdt::TripleComponentRole role) const {
+    const Section& section = sections[role_index(role)];
+    if (id == 0 || id > section.count) {
+        return "";
+    }
+    return decode(section, id);
+}
+
+size_t MappedPatchDictionary::string_to_id(const std::string& str, hdt::TripleComponentRole role) const {
+    const Section& section = sections[role_index(role)];
+    uint64_t low = 0;
+    uint64_t high = section.count;
+    while (low < high) {
+        uint64_t middle = low + (high - low) / 2;
+        int comparison = compare(section, section.sorted_ids[middle], str);
+        if (comparison == 0) {
+            return section.sorted_ids[middle];
+        } else if (comparison < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return 0;
+}
+
+void MappedPatchDictionary::write(const std::string& file_name, const std::array<std::vector<std::string>, 3>& terms) {
+    std::array<std::string, 3> data;
+    std::array<std::vector<uint64_t>, 3> block_offsets;
+    std::array<std::vector<uint64_t>, 3> sorted_ids;
+    for (size_t i = 0; i < 3; i++) {
+        const std::vector<std::string>& section_terms = terms[i];
+        for (size_t j = 0; j < section_terms.size(); j++) {
+            const std::string& term = section_terms[j];
+            if (j % PATCHDICT_MAPPED_BLOCK_SIZE == 0) {
+                block_offsets[i].push_back(data[i].size());
+                write_varint(data[i], term.size());
+                data[i].append(term);
+            } else {
+                const std::string& previous = section_terms[j - 1];
+                size_t max_prefix = std::min(previous.size(), term.size());
+                size_t prefix = 0;
+                while (prefix < max_prefix && previous[prefix] == term[prefix]) {
+                    prefix++;
+                }
+                write_varint(data[i], prefix);
+                write_varint(data[i], term.size() - prefix);
+                data[i].append(term, prefix, std::string::npos);
+            }
+        }
+        sorted_ids[i].resize(section_terms.size());
+        std::iota(sorted_ids[i].begin(), sorted_ids[i].end(), 1);
+        std::sort(sorted_ids[i].begin(), sorted_ids[i].end(), [&section_terms](uint64_t id1, uint64_t id2) {
+            return section_terms[id1 - 1] < section_terms[id2 - 1];
+        });
+    }
+
+    // Determine the layout after the header
+    std::array<uint64_t[5], 3> fields{};
+    uint64_t offset = MAPPED_DICT_HEADER_SIZE;
+    for (size_t i = 0; i < 3; i++) {
+        fields[i][0] = terms[i].size();
+        fields[i][1] = offset;
+        offset += block_offsets[i].size() * 8;
+        fields[i][2] = offset;
+        fields[i][3] = data[i].size();
+        offset += data[i].size();
+        offset += (8 - offset % 8) % 8;
+        fields[i][4] = offset;
+        offset += sorted_ids[i].size() * 8;
+    }
+
+    std::ofstream out(file_name, std::ios::binary | std::ios::trunc);
+    out.write(MAPPED_DICT_MAGIC, 8);
+    write_uint64(out, PATCHDICT_MAPPED_BLOCK_SIZE);
+    for (size_t i = 0; i < 3; i++) {
+        for (uint64_t field : fields[i]) {
+            write_uint64(out, field);
+        }
+    }
+    offset = MAPPED_DICT_HEADER_SIZE;
+    for (size_t i = 0; i < 3; i++) {
+        out.write((const char*) block_offsets[i].data(), block_offsets[i].size() * 8);
+        out.write(data[i].data(), data[i].size());
+        offset += block_offsets[i].size() * 8 + data[i].size();
+        pad(out, offset);
+        out.write((const char*) sorted_ids[i].data(), sorted_ids[i].size() * 8);
+        offset += sorted_ids[i].size() * 8;
+    }
+    out.close();
+    if (out.fail()) {
+        throw std::runtime_error("Could not write the patch dictionary " + file_name);
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef TPFPATCH_STORE_MAPPED_PATCH_DICTIONARY_H
+#define TPFPATCH_STORE_MAPPED_PATCH_DICTIONARY_H
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <HDTEnums.hpp>
+
+#define PATCHDICT_MAPPED_FILENAME_BASE(id) ("snapshotpatch_" + std::to_string(id) + ".dicm")
+// The number of terms per front-coded block
+#define PATCHDICT_MAPPED_BLOCK_SIZE 16
+
+/**
+ * A read-only patch dictionary that is queried in place from a memory-mapped file, so that opening it is instant.
+ *
+ * The file has a section per triple component role, each containing:
+ * - The terms in ID order, front-coded in blocks of a fixed number of terms, for ID to string lookups.
+ *   The first term of a block is stored in full, the others as the length of the prefix they share with their
+ *   predecessor, followed by the remaining suffix.
+ * - The offset of each block.
+ * - The IDs sorted by their term, for binary searching string to ID lookups.
+ */
+class MappedPatchDictionary {
+protected:
+    struct Section {
+        uint64_t count;
+        const uint64_t* block_offsets;
+        const unsigned char* data;
+        uint64_t data_size;
+        const uint64_t* sorted_ids;
+    };
+    std::string file_name;
+    unsigned char* mapping;
+    size_t mapping_size;
+    uint64_t block_size;
+    std::array<Section, 3> sections;
+    mutable std::once_flag shared_counted;
+    mutable size_t shared_count;
+
+    static size_t role_index(hdt::TripleComponentRole role);
+    int compare(const Section& section, uint64_t id, const std::string& str) const;
+    std::string decode(const Section& section, uint64_t id) const;
+public:
+    /**
+     * Map the given file into memory.
+     * @param file_name The file to map
+     * @throws std::runtime_error If the file can not be mapped or is invalid.
+     */
+    explicit MappedPatchDictionary(const std::string& file_name);
+    ~MappedPatchDictionary();
+    /**
+     * @param role SUBJECT, PREDICATE or OBJECT
+     * @return The number of terms for the given role, their IDs are 1 up to and including this count.
+     */
+    size_t get_count(hdt::TripleComponentRole role) const;
+    /**
+     * @return The total number of terms.
+     */
+    size_t get_total_count() const;
+    /**
+     * @return The number of mapped bytes.
+     */
+    size_t get_mapping_size() const;
+    /**
+     * @return The number of bytes of the front-coded terms.
+     */
+    size_t get_data_size() const;
+    /**
+     * @return The number of objects that are literals.
+     */
+    size_t get_literal_count() const;
+    /**
+     * Count the terms that are both a subject and an object.
+     * This decodes all subjects and objects once, after which the count is kept.
+     * @return The number of shared terms.
+     */
+    size_t get_shared_count() const;
+    /**
+     * @param id The ID to translate, starting from 1
+     * @param role SUBJECT, PREDICATE or OBJECT
+     * @return The term, or an empty string if the ID is unknown.
+     */
+    std::string id_to_string(size_t id, hdt::TripleComponentRole role) const;
+    /**
+     * @param str The term to translate
+     * @param role SUBJECT, PREDICATE or OBJECT
+     * @return The ID, or 0 if the term is unknown.
+     */
+    size_t string_to_id(const std::string& str, hdt::TripleComponentRole role) const;
+    /**
+     * Write a dictionary file.
+     * @param file_name The file to write to
+     * @param terms The terms in ID order for the SUBJECT, PREDICATE and OBJECT role.
+     * @throws std::runtime_error If the file could not be written.
+     */
+    static void write(const std::string& file_name, const std::array<std::vector<std::string>, 3>& terms);
+};
+
+#endif //TPFPATCH_STORE_MAPPED_PATCH_DICTIONARY_H
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <mutex>
+#include "term_cache.h"
+
+TermCache::TermCache(size_t capacity, size_t shard_count) : shards(std::max((size_t) 1, shard_count)) {
+    for (auto& shard : shards) {
+        shard.capacity = capacity / shards.size();
+    }
+}
+
+TermCache::Shard& TermCache::get_shard(size_t key) {
+    // Mix the bits, as keys are mostly consecutive IDs
+    size_t h = key * 0x9E3779B97F4A7C15ULL;
+    return shards[(h >> 32) % shards.size()];
+}
+
+size_t TermCache::entry_size(const std::string& value) {
+    return value.size() + TERM_CACHE_ENTRY_OVERHEAD;
+}
+
+bool TermCache::get(size_t key, std::string& value) {
+    Shard& shard = get_shard(key);
+    {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            Entry& entry = shard.entries[it->second];
+            entry.referenced.store(true, std::memory_order_relaxed);
+            value = entry.value;
+            shard.hits.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    shard.misses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+void TermCache::put(size_t key, const std::string& value) {
+    Shard& shard = get_shard(key);
+    size_t size = entry_size(value);
+    std::unique_lock<std::shared_mutex> lock(shard.mutex);
+    if (shard.index.find(key) != shard.index.end() || !make_room(shard, size)) {
+        return;
+    }
+    size_t position;
+    if (shard.free_entries.empty()) {
+        position = shard.entries.size();
+        shard.entries.emplace_back();
+    } else {
+        position = shard.free_entries.back();
+        shard.free_entries.pop_back();
+    }
+    Entry& entry = shard.entries[position];
+    entry.key = key;
+    entry.value = value;
+    entry.occupied = true;
+    entry.referenced.store(false, std::memory_order_relaxed);
+    shard.index[key] = position;
+    shard.size += size;
+}
+
+bool TermCache::make_room(Shard& shard, size_t size) {
+    if (size > shard.capacity) {
+        return false;
+    }
+    // Every entry is passed at most twice: once to clear its reference bit, and once to evict it.
+    while (shard.size + size > shard.capacity) {
+        if (shard.hand >= shard.entries.size()) {
+            shard.hand = 0;
+        }
+        Entry& entry = shard.entries[shard.hand++];
+        if (!entry.occupied) {
+            continue;
+        }
+        if (entry.referenced.load(std::memory_order_relaxed)) {
+            entry.referenced.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        shard.size -= entry_size(entry.value);
+        shard.index.erase(entry.key);
+        std::string().swap(entry.value);
+        entry.occupied = false;
+        shard.free_entries.push_back(shard.hand - 1);
+    }
+    return true;
+}
+
+void TermCache::set_capacity(size_t capacity) {
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.capacity = capacity / shards.size();
+        make_room(shard, 0);
+    }
+}
+
+void TermCache::clear() {
+    for (auto& shard : shards) {
+        std::unique_lock<std::shared_mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.entries.clear();
+        shard.free_entries.clear();
+        shard.hand = 0;
+        shard.size = 0;
+    }
+}
+
+size_t TermCache::get_capacity() const {
+    return shards[0].capacity * shards.size();
+}
+
+size_t TermCache::get_size() {
+    size_t size = 0;
+    for (auto& shard : shards) {
+        std::shared_lock<std::shared_mutex> lock(shard.mutex);
+        size += shard.size;
+    }
+    return size;
+}
+
+size_t TermCache::get_hits() const {
+    size_t hits = 0;
+    for (auto& shard : shards) {
+        hits += shard.hits.load(std::memory_order_relaxed);
+    }
+    return hits;
+}
+
+size_t TermCache::get_misses() const {
+    size_t misses = 0;
+    for (auto& shard : shards) {
+        misses += shard.misses.load(std::memory_order_relaxed);
+    }
+    return misses;
+}
+
+double TermCache::get_hit_rate() const {
+    size_t hits = get_hits();
+    size_t total = hits + get_misses();
+    return total > 0 ? (double) hits / total : 0;
+}
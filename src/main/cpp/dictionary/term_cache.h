@@ -0,0 +1,107 @@
+#ifndef TPFPATCH_STORE_TERM_CACHE_H
+#define TPFPATCH_STORE_TERM_CACHE_H
+
+#include <atomic>
+#include <deque>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The default number of bytes of decoded terms that are cached per dictionary
+#define TERM_CACHE_SIZE (16 * 1024 * 1024)
+// The number of independently locked parts of a term cache
+#define TERM_CACHE_SHARDS 16
+// The estimated number of bytes that is used per cached term, next to the term itself
+#define TERM_CACHE_ENTRY_OVERHEAD 64
+
+/**
+ * A cache of decoded dictionary terms by key, bounded by the number of bytes of the terms.
+ *
+ * The cache is split into shards that are locked separately.
+ * Lookups only take a shared lock, so concurrent lookups never block each other.
+ * Entries are evicted with the CLOCK algorithm, which marks an entry as used on a lookup with a single atomic store,
+ * instead of reordering a list like LRU would.
+ */
+class TermCache {
+protected:
+    struct Entry {
+        size_t key;
+        std::string value;
+        bool occupied;
+        std::atomic<bool> referenced;
+        Entry() : key(0), value(), occupied(false), referenced(false) {}
+    };
+    struct Shard {
+        std::shared_mutex mutex;
+        std::unordered_map<size_t, size_t> index;
+        std::deque<Entry> entries;
+        std::vector<size_t> free_entries;
+        size_t hand;
+        size_t size;
+        size_t capacity;
+        std::atomic<size_t> hits;
+        std::atomic<size_t> misses;
+        Shard() : hand(0), size(0), capacity(0), hits(0), misses(0) {}
+    };
+    std::vector<Shard> shards;
+
+    Shard& get_shard(size_t key);
+    static size_t entry_size(const std::string& value);
+    /**
+     * Evict entries from the given shard until the given number of bytes fits in it.
+     * The shard must be exclusively locked.
+     */
+    static bool make_room(Shard& shard, size_t size);
+public:
+    /**
+     * @param capacity The maximum number of bytes of cached terms.
+     * @param shard_count The number of independently locked parts.
+     */
+    explicit TermCache(size_t capacity = TERM_CACHE_SIZE, size_t shard_count = TERM_CACHE_SHARDS);
+    /**
+     * Look up a term.
+     * @param key The key of the term
+     * @param value The string to overwrite with the term if it is cached
+     * @return If the term was cached
+     */
+    bool get(size_t key, std::string& value);
+    /**
+     * Add a term, possibly evicting other terms.
+     * Terms that are larger than a shard are not cached.
+     * @param key The key of the term
+     * @param value The term
+     */
+    void put(size_t key, const std::string& value);
+    /**
+     * Change the maximum size, evicting terms if needed.
+     * @param capacity The maximum number of bytes of cached terms.
+     */
+    void set_capacity(size_t capacity);
+    /**
+     * Remove all terms.
+     */
+    void clear();
+    /**
+     * @return The maximum number of bytes of cached terms.
+     */
+    size_t get_capacity() const;
+    /**
+     * @return The estimated number of bytes of the cached terms.
+     */
+    size_t get_size();
+    /**
+     * @return The number of lookups that were cached.
+     */
+    size_t get_hits() const;
+    /**
+     * @return The number of lookups that were not cached.
+     */
+    size_t get_misses() const;
+    /**
+     * @return The fraction of lookups that were cached, 0 if there were no lookups.
+     */
+    double get_hit_rate() const;
+};
+
+#endif //TPFPATCH_STORE_TERM_CACHE_H
@@ -0,0 +1,35 @@
+#include <iostream>
+#include <cstring>
+
+#include "../../main/cpp/controller/controller.h"
+
+
+int main(int argc, char** argv) {
+    if (argc > 2 || (argc == 2 && std::strcmp(argv[1], "json") != 0 && std::strcmp(argv[1], "prometheus") != 0)) {
+        std::cerr << "ERROR: Metrics command must be invoked as '[json|prometheus]' " << std::endl;
+        return 1;
+    }
+    bool prometheus = argc == 2 && std::strcmp(argv[1], "prometheus") == 0;
+
+    // Load the store
+    Controller controller("./", kyotocabinet::TreeDB::TCOMPRESS, true);
+
+    // Open the patch trees, so that the state of their KC trees can be reported
+    for (int patch_tree_id : controller.get_patch_tree_manager()->get_patch_trees_ids()) {
+        try {
+            controller.get_patch_tree_manager()->get_patch_tree(patch_tree_id, controller.get_dictionary_manager(patch_tree_id));
+        } catch (const std::exception& e) {
+            std::cerr << "Could not open patch tree " << patch_tree_id << ": " << e.what() << std::endl;
+        }
+    }
+
+    StoreMetrics metrics = controller.get_metrics();
+    if (prometheus) {
+        metrics.write_prometheus(std::cout);
+    } else {
+        metrics.write_json(std::cout);
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cmath>
+#include "benchmark_comparison.h"
+#include "latency_summary.h"
+
+BenchmarkComparison::BenchmarkComparison(const BenchmarkReport& baseline, const BenchmarkReport& candidate,
+                                         double alpha, double threshold) : comparisons() {
+    for (const auto& query : baseline.get_queries()) {
+        auto candidate_query = candidate.get_queries().find(query.first);
+        if (candidate_query == candidate.get_queries().end()) {
+            continue;
+        }
+        LatencySummary baseline_summary = LatencySummary::summarize(query.second);
+        LatencySummary candidate_summary = LatencySummary::summarize(candidate_query->second);
+        QueryComparison comparison{};
+        comparison.query_type = query.first;
+        comparison.baseline_p50 = baseline_summary.p50;
+        comparison.candidate_p50 = candidate_summary.p50;
+        comparison.baseline_p99 = baseline_summary.p99;
+        comparison.candidate_p99 = candidate_summary.p99;
+        comparison.ratio = (double) std::max((uint64_t) 1, candidate_summary.p50) / std::max((uint64_t) 1, baseline_summary.p50);
+        comparison.p_value = mann_whitney_p_value(query.second, candidate_query->second);
+        comparison.regression = comparison.ratio > 1 + threshold && comparison.p_value < alpha;
+        comparisons.push_back(comparison);
+    }
+}
+
+const std::vector<QueryComparison>& BenchmarkComparison::get_comparisons() const {
+    return comparisons;
+}
+
+bool BenchmarkComparison::has_regression() const {
+    return std::any_of(comparisons.begin(), comparisons.end(), [](const QueryComparison& comparison) {
+        return comparison.regression;
+    });
+}
+
+void BenchmarkComparison::write(std::ostream& out) const {
+    out << "type,baseline-p50-mus,candidate-p50-mus,baseline-p99-mus,candidate-p99-mus,ratio,p-value,regression" << std::endl;
+    for (const QueryComparison& comparison : comparisons) {
+        out << comparison.query_type << "," << comparison.baseline_p50 << "," << comparison.candidate_p50 << ","
+            << comparison.baseline_p99 << "," << comparison.candidate_p99 << "," << comparison.ratio << ","
+            << comparison.p_value << "," << (comparison.regression ? "yes" : "no") << std::endl;
+    }
+}
+
+double BenchmarkComparison::mann_whitney_p_value(const std::vector<uint64_t>& baseline, const std::vector<uint64_t>& candidate) {
+    if (baseline.empty() || candidate.empty()) {
+        return 1;
+    }
+    // Rank all samples together, ties get the average of their ranks
+    std::vector<std::pair<uint64_t, bool>> samples;
+    for (uint64_t value : baseline) {
+        samples.emplace_back(value, false);
+    }
+    for (uint64_t value : candidate) {
+        samples.emplace_back(value, true);
+    }
+    std::sort(samples.begin(), samples.end());
+    double n = samples.size();
+    double candidate_rank_sum = 0;
+    double tie_correction = 0;
+    for (size_t start = 0; start < samples.size();) {
+        size_t end = start;
+        while (end < samples.size() && samples[end].first == samples[start].first) {
+            end++;
+        }
+        double ties = end - start;
+        double rank = (start + 1 + end) / 2.0;
+        for (size_t i = start; i < end; i++) {
+            if (samples[i].second) {
+                candidate_rank_sum += rank;
+            }
+        }
+        tie_correction += ties * ties * ties - ties;
+        start = end;
+    }
+
+    double n_baseline = baseline.size();
+    double n_candidate = candidate.size();
+    double u = candidate_rank_sum - n_candidate * (n_candidate + 1) / 2;
+    double mean = n_baseline * n_candidate / 2;
+    double variance = n_baseline * n_candidate / 12 * ((n + 1) - tie_correction / (n * (n - 1)));
+    if (variance <= 0) {
+        return 1;
+    }
+    // Continuity correction towards the mean
+    double z = (u - mean - 0.5) / std::sqrt(variance);
+    return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
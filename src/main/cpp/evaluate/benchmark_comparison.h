@@ -0,0 +1,74 @@
+#ifndef TPFPATCH_STORE_BENCHMARK_COMPARISON_H
+#define TPFPATCH_STORE_BENCHMARK_COMPARISON_H
+
+#include <ostream>
+#include <string>
+#include <vector>
+#include "benchmark_report.h"
+
+// The significance level below which a difference is considered real
+#define BENCHMARK_COMPARISON_DEFAULT_ALPHA 0.01
+// The relative increase of the median latency below which a difference is ignored
+#define BENCHMARK_COMPARISON_DEFAULT_THRESHOLD 0.05
+
+/**
+ * The comparison of one query type between a baseline and a candidate report.
+ */
+struct QueryComparison {
+    std::string query_type;
+    uint64_t baseline_p50;
+    uint64_t candidate_p50;
+    uint64_t baseline_p99;
+    uint64_t candidate_p99;
+    // The candidate median divided by the baseline median
+    double ratio;
+    // The one-sided probability of latencies at least this much larger if the candidate were not slower
+    double p_value;
+    bool regression;
+};
+
+/**
+ * Compares the query latencies of two benchmark reports.
+ *
+ * A query type is flagged as a regression when its median latency increased by more than a threshold,
+ * and a one-sided Mann-Whitney U test finds the candidate latencies significantly larger than the baseline latencies.
+ * The test makes no assumption on the distribution of the latencies, which are typically skewed.
+ */
+class BenchmarkComparison {
+private:
+    std::vector<QueryComparison> comparisons;
+public:
+    /**
+     * Compare the query types that occur in both reports.
+     * @param baseline The report of the reference build
+     * @param candidate The report of the build under test
+     * @param alpha The significance level
+     * @param threshold The relative increase of the median below which slowdowns are ignored
+     */
+    BenchmarkComparison(const BenchmarkReport& baseline, const BenchmarkReport& candidate,
+                        double alpha = BENCHMARK_COMPARISON_DEFAULT_ALPHA,
+                        double threshold = BENCHMARK_COMPARISON_DEFAULT_THRESHOLD);
+    /**
+     * @return The comparison of each query type, ordered by query type.
+     */
+    const std::vector<QueryComparison>& get_comparisons() const;
+    /**
+     * @return If any query type regressed.
+     */
+    bool has_regression() const;
+    /**
+     * Write the comparison as CSV.
+     * @param out The stream to write to
+     */
+    void write(std::ostream& out) const;
+    /**
+     * Compute the one-sided p-value of the Mann-Whitney U test, using the normal approximation with tie correction.
+     * @param baseline The baseline samples
+     * @param candidate The candidate samples
+     * @return The probability of candidate samples at least this large relative to the baseline samples
+     *         if both come from the same distribution, 1 if either set is empty.
+     */
+    static double mann_whitney_p_value(const std::vector<uint64_t>& baseline, const std::vector<uint64_t>& candidate);
+};
+
+#endif //TPFPATCH_STORE_BENCHMARK_COMPARISON_H
@@ -0,0 +1,336 @@
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+#include <iomanip>
+#include <stdexcept>
+#include <thread>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include "benchmark_report.h"
+#include "latency_summary.h"
+
+namespace {
+    void write_string(std::ostream& out, const std::string& value) {
+        out << '"';
+        for (char c : value) {
+            switch (c) {
+                case '"': out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\t': out << "\\t"; break;
+                default:
+                    if ((unsigned char) c < 0x20) {
+                        out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec << std::setfill(' ');
+                    } else {
+                        out << c;
+                    }
+            }
+        }
+        out << '"';
+    }
+
+    void write_string_map(std::ostream& out, const std::map<std::string, std::string>& values) {
+        out << "{";
+        bool first = true;
+        for (const auto& entry : values) {
+            out << (first ? "" : ",");
+            write_string(out, entry.first);
+            out << ":";
+            write_string(out, entry.second);
+            first = false;
+        }
+        out << "}";
+    }
+
+    /**
+     * A reader for the subset of JSON that write_json produces.
+     */
+    class JsonReader {
+    private:
+        std::istream& in;
+
+        [[noreturn]] void fail(const std::string& message) {
+            throw std::runtime_error("Invalid benchmark report: " + message);
+        }
+    public:
+        explicit JsonReader(std::istream& in) : in(in) {}
+
+        char peek() {
+            in >> std::ws;
+            int c = in.peek();
+            if (c == EOF) {
+                fail("unexpected end");
+            }
+            return (char) c;
+        }
+
+        void expect(char expected) {
+            if (peek() != expected) {
+                fail(std::string("expected '") + expected + "'");
+            }
+            in.get();
+        }
+
+        // Consume the given character if it is next
+        bool consume(char c) {
+            if (peek() == c) {
+                in.get();
+                return true;
+            }
+            return false;
+        }
+
+        std::string read_string() {
+            expect('"');
+            std::string value;
+            int c;
+            while ((c = in.get()) != '"') {
+                if (c == EOF) {
+                    fail("unterminated string");
+                }
+                if (c == '\\') {
+                    c = in.get();
+                    switch (c) {
+                        case 'n': value += '\n'; break;
+                        case 't': value += '\t'; break;
+                        case 'r': value += '\r'; break;
+                        case 'b': value += '\b'; break;
+                        case 'f': value += '\f'; break;
+                        case 'u': {
+                            char hex[5] = {0};
+                            in.read(hex, 4);
+                            unsigned long code = std::strtoul(hex, nullptr, 16);
+                            value += code < 0x80 ? (char) code : '?';
+                            break;
+                        }
+                        case EOF: fail("unterminated string");
+                        default: value += (char) c;
+                    }
+                } else {
+                    value += (char) c;
+                }
+            }
+            return value;
+        }
+
+        // Read a number or literal as its textual representation
+        std::string read_token() {
+            peek();
+            std::string token;
+            while (in.peek() != EOF && (std::isalnum(in.peek()) || in.peek() == '-' || in.peek() == '+' || in.peek() == '.')) {
+                token += (char) in.get();
+            }
+            if (token.empty()) {
+                fail("expected a value");
+            }
+            return token;
+        }
+
+        uint64_t read_uint64() {
+            std::string token = read_token();
+            try {
+                return std::stoull(token);
+            } catch (const std::exception&) {
+                fail("expected a number instead of " + token);
+            }
+        }
+
+        std::string read_scalar() {
+            return peek() == '"' ? read_string() : read_token();
+        }
+
+        void skip_value() {
+            char c = peek();
+            if (c == '{') {
+                in.get();
+                if (!consume('}')) {
+                    do {
+                        read_string();
+                        expect(':');
+                        skip_value();
+                    } while (consume(','));
+                    expect('}');
+                }
+            } else if (c == '[') {
+                in.get();
+                if (!consume(']')) {
+                    do {
+                        skip_value();
+                    } while (consume(','));
+                    expect(']');
+                }
+            } else {
+                read_scalar();
+            }
+        }
+
+        // Call the given function for each key of an object, which must read the value
+        template<typename F>
+        void read_object(F read_member) {
+            expect('{');
+            if (consume('}')) {
+                return;
+            }
+            do {
+                std::string key = read_string();
+                expect(':');
+                read_member(key);
+            } while (consume(','));
+            expect('}');
+        }
+
+        // Call the given function for each element of an array, which must read the element
+        template<typename F>
+        void read_array(F read_element) {
+            expect('[');
+            if (consume(']')) {
+                return;
+            }
+            do {
+                read_element();
+            } while (consume(','));
+            expect(']');
+        }
+    };
+}
+
+BenchmarkReport::BenchmarkReport() : environment(), parameters(), ingests(), queries(), store_size(0) {
+    char hostname[256] = {0};
+    if (gethostname(hostname, sizeof(hostname) - 1) == 0) {
+        environment["hostname"] = hostname;
+    }
+    struct utsname system{};
+    if (uname(&system) == 0) {
+        environment["os"] = std::string(system.sysname) + " " + system.release;
+        environment["machine"] = system.machine;
+    }
+    environment["cpus"] = std::to_string(std::thread::hardware_concurrency());
+#ifdef __VERSION__
+    environment["compiler"] = __VERSION__;
+#endif
+#ifdef NDEBUG
+    environment["assertions"] = "off";
+#else
+    environment["assertions"] = "on";
+#endif
+#ifdef OSTRICH_TRACE
+    environment["trace"] = "on";
+#else
+    environment["trace"] = "off";
+#endif
+    std::time_t now = std::time(nullptr);
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    environment["timestamp"] = timestamp;
+}
+
+void BenchmarkReport::set_parameter(const std::string& key, const std::string& value) {
+    parameters[key] = value;
+}
+
+void BenchmarkReport::add_ingest(const IngestRecord& record) {
+    ingests.push_back(record);
+    store_size = record.store_size;
+}
+
+void BenchmarkReport::add_query_time(const std::string& query_type, uint64_t micros) {
+    queries[query_type].push_back(micros);
+}
+
+void BenchmarkReport::set_store_size(uint64_t bytes) {
+    store_size = bytes;
+}
+
+const std::map<std::string, std::string>& BenchmarkReport::get_environment() const {
+    return environment;
+}
+
+const std::map<std::string, std::string>& BenchmarkReport::get_parameters() const {
+    return parameters;
+}
+
+const std::vector<IngestRecord>& BenchmarkReport::get_ingests() const {
+    return ingests;
+}
+
+const std::map<std::string, std::vector<uint64_t>>& BenchmarkReport::get_queries() const {
+    return queries;
+}
+
+uint64_t BenchmarkReport::get_store_size() const {
+    return store_size;
+}
+
+void BenchmarkReport::write_json(std::ostream& out) const {
+    out << "{\"environment\":";
+    write_string_map(out, environment);
+    out << ",\"parameters\":";
+    write_string_map(out, parameters);
+    out << ",\"ingest\":[";
+    for (size_t i = 0; i < ingests.size(); i++) {
+        const IngestRecord& record = ingests[i];
+        out << (i > 0 ? "," : "") << "{\"version\":" << record.version << ",\"added\":" << record.added
+            << ",\"duration_ms\":" << record.duration_ms << ",\"rate\":" << record.rate
+            << ",\"store_size\":" << record.store_size << "}";
+    }
+    out << "],\"queries\":{";
+    bool first = true;
+    for (const auto& query : queries) {
+        LatencySummary summary = LatencySummary::summarize(query.second);
+        out << (first ? "" : ",");
+        write_string(out, query.first);
+        out << ":{\"count\":" << summary.count << ",\"mean\":" << summary.mean << ",\"p50\":" << summary.p50
+            << ",\"p90\":" << summary.p90 << ",\"p99\":" << summary.p99 << ",\"max\":" << summary.max << ",\"samples\":[";
+        for (size_t i = 0; i < query.second.size(); i++) {
+            out << (i > 0 ? "," : "") << query.second[i];
+        }
+        out << "]}";
+        first = false;
+    }
+    out << "},\"store_size\":" << store_size << "}";
+}
+
+BenchmarkReport BenchmarkReport::read_json(std::istream& in) {
+    BenchmarkReport report;
+    report.environment.clear();
+    JsonReader reader(in);
+    reader.read_object([&](const std::string& key) {
+        if (key == "environment" || key == "parameters") {
+            std::map<std::string, std::string>& values = key == "environment" ? report.environment : report.parameters;
+            reader.read_object([&](const std::string& name) {
+                values[name] = reader.read_scalar();
+            });
+        } else if (key == "ingest") {
+            reader.read_array([&]() {
+                IngestRecord record{};
+                reader.read_object([&](const std::string& field) {
+                    if (field == "version") record.version = (int) reader.read_uint64();
+                    else if (field == "added") record.added = reader.read_uint64();
+                    else if (field == "duration_ms") record.duration_ms = reader.read_uint64();
+                    else if (field == "rate") record.rate = reader.read_uint64();
+                    else if (field == "store_size") record.store_size = reader.read_uint64();
+                    else reader.skip_value();
+                });
+                report.ingests.push_back(record);
+            });
+        } else if (key == "queries") {
+            reader.read_object([&](const std::string& query_type) {
+                std::vector<uint64_t>& samples = report.queries[query_type];
+                reader.read_object([&](const std::string& field) {
+                    if (field == "samples") {
+                        reader.read_array([&]() {
+                            samples.push_back(reader.read_uint64());
+                        });
+                    } else {
+                        reader.skip_value();
+                    }
+                });
+            });
+        } else if (key == "store_size") {
+            report.store_size = reader.read_uint64();
+        } else {
+            reader.skip_value();
+        }
+    });
+    return report;
+}
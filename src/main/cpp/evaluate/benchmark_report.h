@@ -0,0 +1,83 @@
+#ifndef TPFPATCH_STORE_BENCHMARK_REPORT_H
+#define TPFPATCH_STORE_BENCHMARK_REPORT_H
+
+#include <cstdint>
+#include <istream>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * The ingestion of one version.
+ */
+struct IngestRecord {
+    int version;
+    size_t added;
+    uint64_t duration_ms;
+    // The number of added elements per second
+    uint64_t rate;
+    // The size of the store after ingesting the version, in bytes
+    uint64_t store_size;
+};
+
+/**
+ * The machine-readable results of an evaluation run,
+ * with the environment it ran in, the parameters of the store, the ingestion of each version,
+ * and the latencies of all query executions by query type.
+ *
+ * The raw latencies are kept next to their percentiles, so that two reports can be compared statistically.
+ */
+class BenchmarkReport {
+private:
+    std::map<std::string, std::string> environment;
+    std::map<std::string, std::string> parameters;
+    std::vector<IngestRecord> ingests;
+    // The latencies in microseconds, by query type
+    std::map<std::string, std::vector<uint64_t>> queries;
+    uint64_t store_size;
+public:
+    /**
+     * Create an empty report for the current environment.
+     */
+    BenchmarkReport();
+    /**
+     * @param key The name of a store or evaluation parameter
+     * @param value Its value
+     */
+    void set_parameter(const std::string& key, const std::string& value);
+    /**
+     * @param record The ingestion of a version, the store size of the report is updated to its store size.
+     */
+    void add_ingest(const IngestRecord& record);
+    /**
+     * @param query_type The type of query, such as "vm" or "dm_count"
+     * @param micros The latency of one execution in microseconds
+     */
+    void add_query_time(const std::string& query_type, uint64_t micros);
+    /**
+     * @param bytes The size of the store in bytes
+     */
+    void set_store_size(uint64_t bytes);
+
+    const std::map<std::string, std::string>& get_environment() const;
+    const std::map<std::string, std::string>& get_parameters() const;
+    const std::vector<IngestRecord>& get_ingests() const;
+    const std::map<std::string, std::vector<uint64_t>>& get_queries() const;
+    uint64_t get_store_size() const;
+
+    /**
+     * Write the report as a JSON document.
+     * @param out The stream to write to
+     */
+    void write_json(std::ostream& out) const;
+    /**
+     * Read a report that was written by write_json.
+     * @param in The stream to read from
+     * @return The report, with the environment it was written in.
+     * @throws std::runtime_error If the stream does not contain a valid report.
+     */
+    static BenchmarkReport read_json(std::istream& in);
+};
+
+#endif //TPFPATCH_STORE_BENCHMARK_REPORT_H
@@ -0,0 +1,175 @@
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include "dataset_generator.h"
+
+DatasetGenerator::DatasetGenerator(const DatasetGeneratorOptions& options)
+        : options(options), state(0), entities(std::max((size_t) 16, options.triples / 4)),
+          current(), current_positions(), deleted(), version_changes() {
+    validate(options);
+    // Spread the seed over the state with splitmix64, as xorshift requires a non-zero state
+    uint64_t z = options.seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    state = (z ^ (z >> 31)) | 1;
+}
+
+void DatasetGenerator::validate(const DatasetGeneratorOptions& options) {
+    if (options.versions < 1 || options.triples == 0 || options.predicates == 0) {
+        throw std::invalid_argument("At least one version with one triple and one predicate must be generated");
+    }
+    if (!(options.change_ratio >= 0 && options.change_ratio <= 1) || !(options.churn >= 0 && options.churn <= 1)
+        || !(options.new_term_rate >= 0 && options.new_term_rate <= 1)) {
+        throw std::invalid_argument("The change ratio, churn and new term rate must be between 0 and 1");
+    }
+    if (!(options.skew > 0)) {
+        throw std::invalid_argument("The skew must be positive");
+    }
+}
+
+uint64_t DatasetGenerator::next_random() {
+    // xorshift64*
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return state * 0x2545F4914F6CDD1DULL;
+}
+
+double DatasetGenerator::next_double() {
+    return (next_random() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+size_t DatasetGenerator::next_skewed(size_t count) {
+    return std::min(count - 1, (size_t) (count * std::pow(next_double(), options.skew)));
+}
+
+std::string DatasetGenerator::next_triple() {
+    bool new_term = next_double() < options.new_term_rate;
+    bool new_subject = new_term && (next_random() & 1) == 0;
+    size_t subject = new_subject ? entities++ : next_skewed(entities);
+    size_t predicate = next_skewed(options.predicates);
+    size_t object = new_term && !new_subject ? entities++ : next_skewed(entities);
+    std::string object_term = (next_random() & 1) == 0
+            ? "<" + entity(object) + ">"
+            : "\"l" + std::to_string(object) + "\"";
+    return "<" + entity(subject) + "> <" + DatasetGenerator::predicate(predicate) + "> " + object_term + " .";
+}
+
+void DatasetGenerator::add(const std::string& triple) {
+    current_positions[triple] = current.size();
+    current.push_back(triple);
+}
+
+void DatasetGenerator::remove(size_t position) {
+    current_positions.erase(current[position]);
+    if (position != current.size() - 1) {
+        current[position] = std::move(current.back());
+        current_positions[current[position]] = position;
+    }
+    current.pop_back();
+}
+
+void DatasetGenerator::write_file(const std::string& file_name, std::vector<std::string> triples) {
+    std::sort(triples.begin(), triples.end());
+    std::ofstream out(file_name, std::ios::trunc);
+    for (const std::string& triple : triples) {
+        out << triple << '\n';
+    }
+    out.close();
+    if (out.fail()) {
+        throw std::runtime_error("Could not write the dataset file " + file_name);
+    }
+}
+
+void DatasetGenerator::generate(const std::string& path) {
+    std::filesystem::create_directories(std::filesystem::path(path) / "alldata.IC.nt");
+    std::filesystem::create_directories(std::filesystem::path(path) / "alldata.CB.nt");
+
+    size_t attempts = 0;
+    while (current.size() < options.triples) {
+        if (attempts++ >= options.triples * DATASET_GENERATOR_ATTEMPTS_PER_TRIPLE) {
+            throw std::runtime_error("Could only generate " + std::to_string(current.size())
+                                     + " distinct triples for the first version, increase the new term rate or lower the skew");
+        }
+        std::string triple = next_triple();
+        if (current_positions.find(triple) == current_positions.end()) {
+            add(triple);
+        }
+    }
+    write_file(snapshot_file(path), current);
+    version_changes.push_back(current.size());
+
+    for (int version = 1; version < options.versions; version++) {
+        size_t changes = (size_t) std::llround(options.change_ratio * current.size());
+        size_t deletion_count = std::min(changes / 2, current.size());
+        size_t addition_count = changes - deletion_count;
+
+        std::vector<std::string> deletions;
+        for (size_t i = 0; i < deletion_count; i++) {
+            size_t position = next_random() % current.size();
+            deletions.push_back(current[position]);
+            remove(position);
+        }
+        std::unordered_set<std::string> deleted_now(deletions.begin(), deletions.end());
+
+        std::vector<std::string> additions;
+        attempts = 0;
+        while (additions.size() < addition_count) {
+            if (attempts++ >= addition_count * DATASET_GENERATOR_ATTEMPTS_PER_TRIPLE) {
+                throw std::runtime_error("Could only generate " + std::to_string(additions.size()) + " of the "
+                                         + std::to_string(addition_count) + " additions of version " + std::to_string(version)
+                                         + ", increase the new term rate or lower the skew");
+            }
+            std::string triple;
+            if (!deleted.empty() && next_double() < options.churn) {
+                size_t position = next_random() % deleted.size();
+                triple = std::move(deleted[position]);
+                deleted[position] = std::move(deleted.back());
+                deleted.pop_back();
+            } else {
+                triple = next_triple();
+            }
+            if (current_positions.find(triple) == current_positions.end() && deleted_now.find(triple) == deleted_now.end()) {
+                add(triple);
+                additions.push_back(triple);
+            }
+        }
+        deleted.insert(deleted.end(), deletions.begin(), deletions.end());
+
+        write_file(changeset_file(path, version, true), additions);
+        write_file(changeset_file(path, version, false), deletions);
+        version_changes.push_back(additions.size() + deletions.size());
+    }
+}
+
+size_t DatasetGenerator::get_entity_count() const {
+    return entities;
+}
+
+size_t DatasetGenerator::get_triple_count() const {
+    return current.size();
+}
+
+const std::vector<size_t>& DatasetGenerator::get_version_changes() const {
+    return version_changes;
+}
+
+std::string DatasetGenerator::entity(size_t id) {
+    return DATASET_GENERATOR_BASE_IRI "e" + std::to_string(id);
+}
+
+std::string DatasetGenerator::predicate(size_t id) {
+    return DATASET_GENERATOR_BASE_IRI "p" + std::to_string(id);
+}
+
+std::string DatasetGenerator::snapshot_file(const std::string& path) {
+    return (std::filesystem::path(path) / "alldata.IC.nt" / "1.nt").string();
+}
+
+std::string DatasetGenerator::changeset_file(const std::string& path, int version, bool additions) {
+    std::string name = (additions ? "data-added_" : "data-deleted_")
+            + std::to_string(version) + "-" + std::to_string(version + 1) + ".nt";
+    return (std::filesystem::path(path) / "alldata.CB.nt" / name).string();
+}
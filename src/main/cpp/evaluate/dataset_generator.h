@@ -0,0 +1,121 @@
+#ifndef TPFPATCH_STORE_DATASET_GENERATOR_H
+#define TPFPATCH_STORE_DATASET_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#define DATASET_GENERATOR_BASE_IRI "http://example.org/"
+// The number of random triples that are tried per triple that must be generated, before giving up
+#define DATASET_GENERATOR_ATTEMPTS_PER_TRIPLE 100
+
+/**
+ * The parameters of a synthetic versioned dataset.
+ */
+struct DatasetGeneratorOptions {
+    // The number of triples in the first version
+    size_t triples = 10000;
+    // The number of versions, including the first one
+    int versions = 10;
+    // The number of changed triples per version, relative to the size of the previous version
+    double change_ratio = 0.05;
+    // The fraction of the additions that re-add a previously deleted triple
+    double churn = 0.2;
+    // The exponent with which terms are picked, 1 picks them uniformly, higher values favour a few popular terms
+    double skew = 2.0;
+    // The fraction of the new triples that introduce a new subject or object term
+    double new_term_rate = 0.1;
+    // The number of distinct predicates
+    size_t predicates = 32;
+    // The seed of the random generator, the same options always produce the same dataset
+    uint64_t seed = 42;
+};
+
+/**
+ * Generates a versioned dataset in the layout that BearEvaluatorMS expects:
+ * the first version as "alldata.IC.nt/1.nt", and the changeset from version i-1 to version i
+ * as "alldata.CB.nt/data-added_i-(i+1).nt" and "alldata.CB.nt/data-deleted_i-(i+1).nt", for i >= 1.
+ *
+ * Subjects and objects are drawn from a growing pool of entities, objects are literals in half of the cases.
+ * The random generator is a self-contained xorshift, so the output does not depend on the standard library.
+ * Each file is written sorted, with one triple per line.
+ */
+class DatasetGenerator {
+private:
+    DatasetGeneratorOptions options;
+    uint64_t state;
+    size_t entities;
+    // The triples of the current version, with their position in the vector for constant-time removal
+    std::vector<std::string> current;
+    std::unordered_map<std::string, size_t> current_positions;
+    // The triples that were deleted at some point and are not present anymore
+    std::vector<std::string> deleted;
+    // The number of triples in the first version, followed by the number of changes of each changeset
+    std::vector<size_t> version_changes;
+
+    uint64_t next_random();
+    double next_double();
+    size_t next_skewed(size_t count);
+    std::string next_triple();
+    void add(const std::string& triple);
+    void remove(size_t position);
+    static void write_file(const std::string& file_name, std::vector<std::string> triples);
+public:
+    /**
+     * @param options The parameters of the dataset.
+     * @throws std::invalid_argument If the options are invalid.
+     */
+    explicit DatasetGenerator(const DatasetGeneratorOptions& options);
+    /**
+     * Check if a dataset can be generated with the given options.
+     * @param options The parameters of the dataset.
+     * @throws std::invalid_argument If there must be no versions, triples or predicates,
+     *                               or if a ratio or rate is not between 0 and 1.
+     */
+    static void validate(const DatasetGeneratorOptions& options);
+    /**
+     * Generate all versions.
+     * @param path The directory to write the dataset to, it is created if it does not exist.
+     * @throws std::runtime_error If a file could not be written,
+     *                            or if not enough distinct triples could be generated because the terms are exhausted.
+     */
+    void generate(const std::string& path);
+    /**
+     * @return The number of distinct entities that were generated so far.
+     */
+    size_t get_entity_count() const;
+    /**
+     * @return The number of triples in the last generated version.
+     */
+    size_t get_triple_count() const;
+    /**
+     * @return The number of triples in the first version, followed by the number of additions and deletions of each changeset.
+     */
+    const std::vector<size_t>& get_version_changes() const;
+    /**
+     * @param id An entity id, smaller than the entity count
+     * @return The IRI of the entity, without angle brackets.
+     */
+    static std::string entity(size_t id);
+    /**
+     * @param id A predicate id, smaller than the number of predicates
+     * @return The IRI of the predicate, without angle brackets.
+     */
+    static std::string predicate(size_t id);
+    /**
+     * @param path The dataset directory
+     * @return The file of the first version.
+     */
+    static std::string snapshot_file(const std::string& path);
+    /**
+     * @param path The dataset directory
+     * @param version The version the changeset leads to, at least 1
+     * @param additions If the file of the additions or of the deletions must be returned
+     * @return The changeset file.
+     */
+    static std::string changeset_file(const std::string& path, int version, bool additions);
+};
+
+#endif //TPFPATCH_STORE_DATASET_GENERATOR_H
@@ -8,6 +8,8 @@
 #include "evaluator.h"
 #include "../simpleprogresslistener.h"
 #include "../controller/statistics.h"
+#include "../snapshot/snapshot_diff.h"
+#include "../dictionary/id_translation_map.h"
 
 void Evaluator::init(string basePath, string patchesBasePatch, int startIndex, int endIndex, hdt::ProgressListener* progressListener) {
     controller = new Controller(basePath, kyotocabinet::TreeDB::TCOMPRESS);
@@ -25,6 +27,9 @@ void Evaluator::init(string basePath, string patchesBasePatch, int startIndex, i
         closedir(dir);
     }
     cout << "---INSERTION END---" << endl;
+    if (report != nullptr) {
+        report->set_store_size(patchstore_size(controller));
+    }
 }
 
 void Evaluator::populate_controller_with_version(int patch_id, string path, hdt::ProgressListener* progressListener) {
@@ -94,11 +99,39 @@ void Evaluator::populate_controller_with_version(int patch_id, string path, hdt:
     long long rate = added / duration;
     std::ifstream::pos_type accsize = patchstore_size(controller);
     cout << patch_id << "," << added << "," << duration << "," << rate << "," << accsize << endl;
+    if (report != nullptr) {
+        report->add_ingest({patch_id, (size_t) added, (uint64_t) duration, (uint64_t) (added * 1000 / duration), (uint64_t) accsize});
+    }
 
     delete it_snapshot;
     delete it_patch;
 }
 
+// Missing files count as empty, not every artifact exists for every snapshot
+static long existing_filesize(const std::string& file) {
+    std::ifstream::pos_type size = std::ifstream(file.c_str(), std::ifstream::ate | std::ifstream::binary).tellg();
+    return size == std::ifstream::pos_type(-1) ? 0 : (long) size;
+}
+
+// The files of the given snapshots, with their dictionaries, and the diffs and translation maps from their previous snapshot
+static long snapshots_size(const std::vector<int>& snapshots) {
+    long size = 0;
+    int previous_id = -1;
+    for (int id : snapshots) {
+        size += existing_filesize(SNAPSHOT_FILENAME_BASE(id));
+        size += existing_filesize(SNAPSHOT_FILENAME_BASE(id) + ".index.v1.1");
+        size += existing_filesize(PATCHDICT_MAPPED_FILENAME_BASE(id));
+        size += existing_filesize(PATCHDICT_LOG_FILENAME_BASE(id));
+        size += existing_filesize(PATCHDICT_FILENAME_BASE(id)); // Compacted dictionary in the legacy format
+        if (previous_id >= 0) {
+            size += existing_filesize(SNAPSHOT_DIFF_FILENAME(previous_id, id));
+            size += existing_filesize(SNAPSHOT_ID_MAP_FILENAME(previous_id, id));
+        }
+        previous_id = id;
+    }
+    return size;
+}
+
 std::ifstream::pos_type Evaluator::patchstore_size(Controller* controller) {
     long size = 0;
 
@@ -119,23 +152,17 @@ std::ifstream::pos_type Evaluator::patchstore_size(Controller* controller) {
         size += filesize(PATCHTREE_FILENAME(id, "count_additions"));
         itP++;
     }
+    size += filesize(BUFFER_POOL_ACCESSES_FILENAME);
 
     std::vector<int> snapshots = controller->get_snapshot_manager()->get_snapshots_ids();
     controller->get_snapshot_manager()->get_dictionary_manager(0)->save();
-    auto itS = snapshots.begin();
-    while(itS != snapshots.end()) {
-        int id = *itS;
-        size += filesize(SNAPSHOT_FILENAME_BASE(id));
-        size += filesize((SNAPSHOT_FILENAME_BASE(id) + ".index.v1.1"));
-        size += filesize((PATCHDICT_FILENAME_BASE(id)));
-        itS++;
-    }
+    size += snapshots_size(snapshots);
 
     return size;
 }
 
 std::ifstream::pos_type Evaluator::filesize(string file) {
-    return std::ifstream(file.c_str(), std::ifstream::ate | std::ifstream::binary).tellg();
+    return existing_filesize(file);
 }
 
 hdt::IteratorTripleString* Evaluator::get_from_file(string file) {
@@ -157,7 +184,9 @@ long long Evaluator::measure_lookup_version_materialized(hdt::Dictionary& dict,
             result_count++;
         };
         delete ti;
-        total += st.stopReal();
+        long long time = st.stopReal();
+        record_time("vm", time);
+        total += time;
     }
     result_count /= replications;
     return total / replications;
@@ -168,7 +197,9 @@ long long Evaluator::measure_count_version_materialized(Triple triple_pattern, i
     for (int i = 0; i < replications; i++) {
         StopWatch st;
         std::pair<size_t, hdt::ResultEstimationType> count = controller->get_version_materialized_count(triple_pattern, patch_id, true);
-        total += st.stopReal();
+        long long time = st.stopReal();
+        record_time("vm_count", time);
+        total += time;
     }
     return total / replications;
 }
@@ -188,7 +219,9 @@ long long Evaluator::measure_lookup_delta_materialized(hdt::Dictionary& dict, Tr
             result_count++;
         };
         delete ti;
-        total += st.stopReal();
+        long long time = st.stopReal();
+        record_time("dm", time);
+        total += time;
     }
     result_count /= replications;
     return total / replications;
@@ -199,7 +232,9 @@ long long Evaluator::measure_count_delta_materialized(Triple triple_pattern, int
     for (int i = 0; i < replications; i++) {
         StopWatch st;
         std::pair<size_t, hdt::ResultEstimationType> count = controller->get_delta_materialized_count(triple_pattern, patch_id_start, patch_id_end, true);
-        total += st.stopReal();
+        long long time = st.stopReal();
+        record_time("dm_count", time);
+        total += time;
     }
     return total / replications;
 }
@@ -218,7 +253,9 @@ long long Evaluator::measure_lookup_version(hdt::Dictionary& dict, Triple triple
             result_count++;
         };
         delete ti;
-        total += st.stopReal();
+        long long time = st.stopReal();
+        record_time("vq", time);
+        total += time;
     }
     result_count /= replications;
     return total / replications;
@@ -229,7 +266,9 @@ long long Evaluator::measure_count_version(Triple triple_pattern, int replicatio
     for (int i = 0; i < replications; i++) {
         StopWatch st;
         std::pair<size_t, hdt::ResultEstimationType> count = controller->get_version_count(triple_pattern, true);
-        total += st.stopReal();
+        long long time = st.stopReal();
+        record_time("vq_count", time);
+        total += time;
     }
     return total / replications;
 }
@@ -268,6 +307,16 @@ void Evaluator::test_lookup(string s, string p, string o, int replications, int
     cout << "" << offset << "," << limit << "," << dcount << "," << d1 << "," << result_count1 << endl;
 }
 
+void Evaluator::set_report(BenchmarkReport* report) {
+    this->report = report;
+}
+
+void Evaluator::record_time(const std::string& query_type, uint64_t micros) {
+    if (report != nullptr) {
+        report->add_query_time(query_type, micros);
+    }
+}
+
 void Evaluator::cleanup_controller() {
     //Controller::cleanup(controller);
     delete controller;
@@ -298,6 +347,9 @@ void BearEvaluatorMS::init(string basePath, string patchesBasePatch, SnapshotCre
 void BearEvaluatorMS::init_readonly(string basePath, bool warmup) {
     controller = new Controller(basePath, kyotocabinet::TreeDB::TCOMPRESS, true, 32);
     patch_count = controller->get_number_versions();
+    if (report != nullptr) {
+        report->set_store_size(patchstore_size(controller));
+    }
 
     if (warmup) {
         StringTriple pattern("", "", "");
@@ -371,6 +423,10 @@ void BearEvaluatorMS::compute_statistics() {
     }
 }
 
+void BearEvaluatorMS::set_report(BenchmarkReport* report) {
+    this->report = report;
+}
+
 void BearEvaluatorMS::cleanup_controller() {
     delete controller;
 }
@@ -443,6 +499,9 @@ void BearEvaluatorMS::populate_controller_with_version(int patch_id, std::string
     uint64_t rate = added / duration;
     std::ifstream::pos_type accsize = patchstore_size(controller);
     cout << patch_id << "," << added << "," << duration << "," << rate << "," << accsize << endl;
+    if (report != nullptr) {
+        report->add_ingest({patch_id, added, duration, added * 1000 / duration, (uint64_t) accsize});
+    }
 
     delete it_snapshot;
     delete it_patch;
@@ -468,23 +527,19 @@ std::ifstream::pos_type BearEvaluatorMS::patchstore_size(Controller *controller)
         size += filesize(PATCHTREE_FILENAME(id, "count_additions"));
         itP++;
     }
+    size += filesize(BUFFER_POOL_ACCESSES_FILENAME);
 
     std::vector<int> snapshots = controller->get_snapshot_manager()->get_snapshots_ids();
-    auto itS = snapshots.begin();
-    while(itS != snapshots.end()) {
-        controller->get_snapshot_manager()->get_dictionary_manager(*itS)->save();
-        int id = *itS;
-        size += filesize(SNAPSHOT_FILENAME_BASE(id));
-        size += filesize((SNAPSHOT_FILENAME_BASE(id) + ".index.v1.1"));
-        size += filesize((PATCHDICT_FILENAME_BASE(id)));
-        itS++;
+    for (int id : snapshots) {
+        controller->get_snapshot_manager()->get_dictionary_manager(id)->save();
     }
+    size += snapshots_size(snapshots);
 
     return size;
 }
 
 std::ifstream::pos_type BearEvaluatorMS::filesize(const string& file) {
-    return std::ifstream(file.c_str(), std::ifstream::ate | std::ifstream::binary).tellg();
+    return existing_filesize(file);
 }
 
 hdt::IteratorTripleString *BearEvaluatorMS::get_from_file(const string& file) {
@@ -530,6 +585,7 @@ BearEvaluatorMS::measure_lookup_version_materialized(const StringTriple& triple_
         times.push_back(time);
         total += time;
     }
+    record_times("vm", times);
     median_t = compute_median(times);
     result_count /= replications;
     return total / replications;
@@ -541,7 +597,7 @@ BearEvaluatorMS::measure_count_version_materialized(const StringTriple& triple_p
     int snapshot_id = controller->get_snapshot_manager()->get_latest_snapshot(patch_id);
     controller->get_snapshot_manager()->load_snapshot(snapshot_id);
     if (snapshot_id != patch_id) {
-        int patchtree_id = controller->get_patch_tree_manager()->get_patch_tree_id(patch_id);
+        int patchtree_id = controller->get_patch_tree_manager()->get_delta_chain_patch_tree_id(snapshot_id);
         controller->get_patch_tree_manager()->load_patch_tree(patchtree_id, controller->get_dictionary_manager(patch_id));
     }
 
@@ -554,6 +610,7 @@ BearEvaluatorMS::measure_count_version_materialized(const StringTriple& triple_p
         times.push_back(time);
         total += time;
     }
+    record_times("vm_count", times);
     median_t = compute_median(times);
     return total / replications;
 }
@@ -592,6 +649,8 @@ uint64_t BearEvaluatorMS::measure_lookup_version(const StringTriple& triple_patt
         total += time;
     }
     result_count /= replications;
+    record_times("vq", times);
+    median_t = compute_median(times);
     return total / replications;
 }
 
@@ -605,6 +664,7 @@ uint64_t BearEvaluatorMS::measure_count_version(const StringTriple& triple_patte
         times.push_back(time);
         total += time;
     }
+    record_times("vq_count", times);
     median_t = compute_median(times);
     return total / replications;
 }
@@ -646,6 +706,7 @@ BearEvaluatorMS::measure_lookup_delta_materialized(const StringTriple &triple_pa
         total += time;
     }
 
+    record_times("dm", times);
     median_t = compute_median(times);
     result_count /= replications;
     return total / replications;
@@ -662,10 +723,19 @@ uint64_t BearEvaluatorMS::measure_count_delta_materialized(const StringTriple &t
         times.push_back(time);
         total += time;
     }
+    record_times("dm_count", times);
     median_t = compute_median(times);
     return total / replications;
 }
 
+void BearEvaluatorMS::record_times(const std::string& query_type, const std::vector<uint64_t>& times) {
+    if (report != nullptr) {
+        for (uint64_t time : times) {
+            report->add_query_time(query_type, time);
+        }
+    }
+}
+
 uint64_t BearEvaluatorMS::compute_median(std::vector<uint64_t> values) {
     if (values.size() == 1) {
         return values[0];
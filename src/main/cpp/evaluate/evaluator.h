@@ -3,6 +3,7 @@
 
 
 #include "../controller/controller.h"
+#include "benchmark_report.h"
 
 #define BASEURI "<http://example.org>"
 
@@ -17,9 +18,17 @@ class Evaluator {
 private:
     int patch_count = 0;
     Controller* controller;
+    BenchmarkReport* report = nullptr;
+
+    void record_time(const std::string& query_type, uint64_t micros);
 public:
     void init(std::string basePath, std::string patchesBasePatch, int startIndex, int endIndex, hdt::ProgressListener* progressListener = nullptr);
     void test_lookup(std::string s, std::string p, std::string o, int replications, int offset, int limit);
+    /**
+     * Record the ingestion, query latencies and store size in the given report, next to the CSV output.
+     * @param report The report to fill in, or nullptr to stop recording.
+     */
+    void set_report(BenchmarkReport* report);
     void cleanup_controller();
 protected:
     void populate_controller_with_version(int patch_id, std::string path, hdt::ProgressListener* progressListener = nullptr);
@@ -47,13 +56,20 @@ private:
     Controller* controller;
     std::string ic_path;
     std::string file_prefix;
+    BenchmarkReport* report = nullptr;
 
     static uint64_t compute_median(std::vector<uint64_t> values) ;
+    void record_times(const std::string& query_type, const std::vector<uint64_t>& times);
 public:
     void init(std::string basePath, std::string patchesBasePatch, SnapshotCreationStrategy* strategy, int startIndex, int endIndex, hdt::ProgressListener* progressListener = nullptr);
     void init_readonly(string basePath, bool warmup = false);
     void test_lookup(std::string s, std::string p, std::string o, int replications, int offset, int limit);
     void compute_statistics();
+    /**
+     * Record the environment, ingestion, query latencies and store size in the given report, next to the CSV output.
+     * @param report The report to fill in, or nullptr to stop recording.
+     */
+    void set_report(BenchmarkReport* report);
     void cleanup_controller();
 protected:
     void populate_controller_with_version(int patch_id, std::string path, hdt::ProgressListener* progressListener = nullptr);
@@ -0,0 +1,29 @@
+#include <algorithm>
+#include <cmath>
+#include "latency_summary.h"
+
+LatencySummary LatencySummary::summarize(std::vector<uint64_t> values) {
+    LatencySummary summary;
+    if (values.empty()) {
+        return summary;
+    }
+    std::sort(values.begin(), values.end());
+    summary.count = values.size();
+    for (uint64_t value : values) {
+        summary.total += value;
+    }
+    summary.mean = summary.total / summary.count;
+    summary.p50 = percentile(values, 50);
+    summary.p90 = percentile(values, 90);
+    summary.p99 = percentile(values, 99);
+    summary.max = values.back();
+    return summary;
+}
+
+uint64_t LatencySummary::percentile(const std::vector<uint64_t>& values, double percentile) {
+    if (values.empty()) {
+        return 0;
+    }
+    auto rank = (size_t) std::ceil(percentile * values.size() / 100);
+    return values[std::min(values.size(), std::max((size_t) 1, rank)) - 1];
+}
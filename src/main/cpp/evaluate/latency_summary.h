@@ -0,0 +1,34 @@
+#ifndef TPFPATCH_STORE_LATENCY_SUMMARY_H
+#define TPFPATCH_STORE_LATENCY_SUMMARY_H
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * The distribution of a set of latency measurements, in the unit of the measurements.
+ */
+struct LatencySummary {
+    size_t count = 0;
+    uint64_t total = 0;
+    uint64_t mean = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t max = 0;
+
+    /**
+     * Summarize the given measurements.
+     * Percentiles use the nearest-rank method, so they are always one of the measurements.
+     * @param values The measurements, in any order
+     * @return The summary, all zero if there are no measurements.
+     */
+    static LatencySummary summarize(std::vector<uint64_t> values);
+    /**
+     * @param values The measurements, sorted ascending
+     * @param percentile The percentile, between 0 and 100
+     * @return The smallest measurement such that at least the given percentage of measurements is not larger.
+     */
+    static uint64_t percentile(const std::vector<uint64_t>& values, double percentile);
+};
+
+#endif //TPFPATCH_STORE_LATENCY_SUMMARY_H
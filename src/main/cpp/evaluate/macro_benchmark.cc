@@ -0,0 +1,163 @@
+#include <chrono>
+#include <rdf/RDFParserNtriples.hpp>
+#include "macro_benchmark.h"
+
+namespace {
+    uint64_t elapsed_micros(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    QueryMixResult summarize(const std::string& query_type, size_t results, const std::vector<uint64_t>& times) {
+        QueryMixResult result;
+        result.query_type = query_type;
+        result.results = results;
+        result.latency = LatencySummary::summarize(times);
+        result.throughput = result.latency.total == 0 ? 0 : result.latency.count * 1000000.0 / result.latency.total;
+        return result;
+    }
+}
+
+MacroBenchmark::MacroBenchmark(Controller* controller, const DatasetGenerator& generator, const DatasetGeneratorOptions& options, uint64_t seed)
+        : controller(controller), generator(generator), options(options), random(seed) {}
+
+size_t MacroBenchmark::next_index(size_t count) {
+    return random() % count;
+}
+
+StringTriple MacroBenchmark::next_pattern() {
+    std::string subject = DatasetGenerator::entity(next_index(generator.get_entity_count()));
+    std::string predicate = DatasetGenerator::predicate(next_index(options.predicates));
+    std::string object = DatasetGenerator::entity(next_index(generator.get_entity_count()));
+    switch (next_index(4)) {
+        case 0: return StringTriple(subject, "", "");
+        case 1: return StringTriple("", predicate, "");
+        case 2: return StringTriple("", "", object);
+        default: return StringTriple(subject, predicate, "");
+    }
+}
+
+size_t MacroBenchmark::run_version_materialized(const StringTriple& triple_pattern, int patch_id) {
+    int snapshot_id = controller->get_snapshot_manager()->get_latest_snapshot(patch_id);
+    controller->get_snapshot_manager()->load_snapshot(snapshot_id);
+    std::shared_ptr<DictionaryManager> dict = controller->get_snapshot_manager()->get_dictionary_manager(snapshot_id);
+
+    size_t results = 0;
+    Triple t;
+    TripleIterator* ti = controller->get_version_materialized(triple_pattern, 0, patch_id);
+    while (ti->next(&t)) {
+        t.get_subject(*dict);
+        t.get_predicate(*dict);
+        t.get_object(*dict);
+        results++;
+    }
+    delete ti;
+    return results;
+}
+
+size_t MacroBenchmark::run_delta_materialized(const StringTriple& triple_pattern, int patch_id_start, int patch_id_end) {
+    size_t results = 0;
+    TripleDelta t;
+    TripleDeltaIterator* ti = controller->get_delta_materialized(triple_pattern, 0, patch_id_start, patch_id_end);
+    while (ti->next(&t)) {
+        t.get_triple()->get_subject(*(t.get_dictionary()));
+        t.get_triple()->get_predicate(*(t.get_dictionary()));
+        t.get_triple()->get_object(*(t.get_dictionary()));
+        results++;
+    }
+    delete ti;
+    return results;
+}
+
+size_t MacroBenchmark::run_version(const StringTriple& triple_pattern) {
+    size_t results = 0;
+    TripleVersions t;
+    TripleVersionsIterator* ti = controller->get_version(triple_pattern, 0);
+    while (ti->next(&t)) {
+        t.get_triple()->get_subject(*(t.get_dictionary()));
+        t.get_triple()->get_predicate(*(t.get_dictionary()));
+        t.get_triple()->get_object(*(t.get_dictionary()));
+        results++;
+    }
+    delete ti;
+    return results;
+}
+
+std::vector<IngestResult> MacroBenchmark::ingest(const std::string& path, hdt::ProgressListener* progressListener) {
+    std::vector<IngestResult> results;
+    for (int version = 0; version < options.versions; version++) {
+        std::vector<std::pair<hdt::IteratorTripleString*, bool>> files;
+        if (version == 0) {
+            files.emplace_back(new hdt::RDFParserNtriples(DatasetGenerator::snapshot_file(path).c_str(), hdt::NTRIPLES), true);
+        } else {
+            files.emplace_back(new hdt::RDFParserNtriples(DatasetGenerator::changeset_file(path, version, true).c_str(), hdt::NTRIPLES), true);
+            files.emplace_back(new hdt::RDFParserNtriples(DatasetGenerator::changeset_file(path, version, false).c_str(), hdt::NTRIPLES), false);
+        }
+        auto start = std::chrono::high_resolution_clock::now();
+        if (!controller->ingest(files, version, true, progressListener)) {
+            return {};
+        }
+        results.push_back({version, generator.get_version_changes()[version], elapsed_micros(start) / 1000});
+    }
+    // Include the creation of a snapshot in the background in the ingestion time of the last version
+    auto start = std::chrono::high_resolution_clock::now();
+    controller->finish_snapshot_creation();
+    results.back().duration_ms += elapsed_micros(start) / 1000;
+    return results;
+}
+
+std::vector<QueryMixResult> MacroBenchmark::run(size_t queries) {
+    std::vector<QueryMixResult> results;
+    int versions = controller->get_max_patch_id() + 1;
+
+    std::vector<uint64_t> times;
+    size_t result_count = 0;
+    for (size_t i = 0; i < queries; i++) {
+        StringTriple triple_pattern = next_pattern();
+        int patch_id = (int) next_index(versions);
+        auto start = std::chrono::high_resolution_clock::now();
+        result_count += run_version_materialized(triple_pattern, patch_id);
+        times.push_back(elapsed_micros(start));
+    }
+    results.push_back(summarize("VM", result_count, times));
+
+    times.clear();
+    result_count = 0;
+    for (size_t i = 0; i < queries && versions > 1; i++) {
+        StringTriple triple_pattern = next_pattern();
+        int patch_id_start = (int) next_index(versions - 1);
+        int patch_id_end = patch_id_start + 1 + (int) next_index(versions - 1 - patch_id_start);
+        auto start = std::chrono::high_resolution_clock::now();
+        result_count += run_delta_materialized(triple_pattern, patch_id_start, patch_id_end);
+        times.push_back(elapsed_micros(start));
+    }
+    results.push_back(summarize("DM", result_count, times));
+
+    times.clear();
+    result_count = 0;
+    for (size_t i = 0; i < queries; i++) {
+        StringTriple triple_pattern = next_pattern();
+        auto start = std::chrono::high_resolution_clock::now();
+        result_count += run_version(triple_pattern);
+        times.push_back(elapsed_micros(start));
+    }
+    results.push_back(summarize("VQ", result_count, times));
+
+    return results;
+}
+
+void MacroBenchmark::write_ingest_results(std::ostream& out, const std::vector<IngestResult>& results) {
+    out << "version,changes,durationms,rate" << std::endl;
+    for (const IngestResult& result : results) {
+        uint64_t duration = result.duration_ms == 0 ? 1 : result.duration_ms; // Avoid division by 0
+        out << result.version << "," << result.changes << "," << result.duration_ms << "," << result.changes * 1000 / duration << std::endl;
+    }
+}
+
+void MacroBenchmark::write_query_results(std::ostream& out, const std::vector<QueryMixResult>& results) {
+    out << "type,queries,results,throughput-qps,mean-mus,p50-mus,p90-mus,p99-mus,max-mus" << std::endl;
+    for (const QueryMixResult& result : results) {
+        out << result.query_type << "," << result.latency.count << "," << result.results << "," << result.throughput << ","
+            << result.latency.mean << "," << result.latency.p50 << "," << result.latency.p90 << ","
+            << result.latency.p99 << "," << result.latency.max << std::endl;
+    }
+}
@@ -0,0 +1,83 @@
+#ifndef TPFPATCH_STORE_MACRO_BENCHMARK_H
+#define TPFPATCH_STORE_MACRO_BENCHMARK_H
+
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "../controller/controller.h"
+#include "dataset_generator.h"
+#include "latency_summary.h"
+
+/**
+ * The ingestion of one version.
+ */
+struct IngestResult {
+    int version;
+    size_t changes;
+    uint64_t duration_ms;
+};
+
+/**
+ * The measurements of one query type.
+ */
+struct QueryMixResult {
+    std::string query_type;
+    size_t results;
+    double throughput;
+    // The latencies in microseconds
+    LatencySummary latency;
+};
+
+/**
+ * An end-to-end benchmark over a synthetic dataset.
+ * It ingests the dataset of a DatasetGenerator into a store,
+ * and runs a mix of version materialization (VM), delta materialization (DM) and version (VQ) queries.
+ *
+ * The query patterns are S??, ?P?, ??O and SP?, with terms that are picked uniformly from the generated terms,
+ * so that the same seed always runs the same queries.
+ */
+class MacroBenchmark {
+private:
+    Controller* controller;
+    const DatasetGenerator& generator;
+    DatasetGeneratorOptions options;
+    std::mt19937_64 random;
+
+    size_t next_index(size_t count);
+    StringTriple next_pattern();
+    size_t run_version_materialized(const StringTriple& triple_pattern, int patch_id);
+    size_t run_delta_materialized(const StringTriple& triple_pattern, int patch_id_start, int patch_id_end);
+    size_t run_version(const StringTriple& triple_pattern);
+public:
+    /**
+     * @param controller The store to ingest into and to query
+     * @param generator The generator that has generated the dataset
+     * @param options The options the dataset was generated with
+     * @param seed The seed of the query patterns
+     */
+    MacroBenchmark(Controller* controller, const DatasetGenerator& generator, const DatasetGeneratorOptions& options, uint64_t seed);
+    /**
+     * Ingest all versions of the dataset, in order.
+     * @param path The directory the dataset was generated in
+     * @param progressListener an optional progress listener.
+     * @return The ingestion of each version, or an empty vector if ingestion failed.
+     */
+    std::vector<IngestResult> ingest(const std::string& path, hdt::ProgressListener* progressListener = nullptr);
+    /**
+     * Run the query mixes, each one on its own random patterns and versions.
+     * @param queries The number of queries per query type
+     * @return The measurements of VM, DM and VQ queries, in that order.
+     */
+    std::vector<QueryMixResult> run(size_t queries);
+    /**
+     * Write the ingestion results as CSV.
+     */
+    static void write_ingest_results(std::ostream& out, const std::vector<IngestResult>& results);
+    /**
+     * Write the query results as CSV.
+     */
+    static void write_query_results(std::ostream& out, const std::vector<QueryMixResult>& results);
+};
+
+#endif //TPFPATCH_STORE_MACRO_BENCHMARK_H
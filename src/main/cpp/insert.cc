@@ -14,7 +14,7 @@
 
 int main(int argc, char** argv) {
     if (argc < 2) {
-        std::cerr << "ERROR: Insert command must be invoked as '[-v] [-s string int|float] patch_id [+|- file_1.nt [file_2.nt [...]]]*' " << std::endl;
+        std::cerr << "ERROR: Insert command must be invoked as '[-v] [-s string int|float] [-m megabytes] patch_id [+|- file_1.nt [file_2.nt [...]]]*' " << std::endl;
         return 1;
     }
 
@@ -37,9 +37,27 @@ int main(int argc, char** argv) {
         strategy = SnapshotCreationStrategy::get_composite_strategy(strat_name, strat_param);
     }
 
+    size_t memory_budget = 0;
+    bool has_memory_budget = argc > 1 + param_offset && std::string(argv[1 + param_offset]) == "-m";
+    if (has_memory_budget) {
+        param_offset += 1;
+        if (argc <= 2 + param_offset) {
+            std::cerr << "ERROR: -m must be followed by a number of megabytes and a patch_id" << std::endl;
+            return 1;
+        }
+        memory_budget = std::stoul(argv[1 + param_offset]) * 1024 * 1024;
+        param_offset += 1;
+    }
+
+    if (argc <= 1 + param_offset) {
+        std::cerr << "ERROR: A patch_id is required" << std::endl;
+        return 1;
+    }
+
     // Load the store
 
     Controller controller("./", strategy, kyotocabinet::TreeDB::TCOMPRESS);
+    controller.set_ingest_memory_budget(memory_budget);
 
     // Get parameters
     int patch_id = std::stoi(argv[1 + param_offset]);
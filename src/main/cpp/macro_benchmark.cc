@@ -0,0 +1,68 @@
+#include <iostream>
+#include <string>
+
+#include "evaluate/macro_benchmark.h"
+
+#define DATASET_PATH "./macro-dataset"
+
+int main(int argc, char** argv) {
+    if (argc < 3 || argc > 11) {
+        std::cerr << "Usage: " << argv[0] << " strategy strategy_parameter [triples [versions [change_ratio [churn [skew [new_term_rate [queries [seed]]]]]]]]" << std::endl;
+        std::cerr << "\tGenerates a dataset in " << DATASET_PATH << ", ingests it into a store in ./ and queries it." << std::endl;
+        return 1;
+    }
+
+    DatasetGeneratorOptions options;
+    size_t queries = 100;
+    try {
+        if (argc > 3) options.triples = std::stoul(argv[3]);
+        if (argc > 4) options.versions = std::stoi(argv[4]);
+        if (argc > 5) options.change_ratio = std::stod(argv[5]);
+        if (argc > 6) options.churn = std::stod(argv[6]);
+        if (argc > 7) options.skew = std::stod(argv[7]);
+        if (argc > 8) options.new_term_rate = std::stod(argv[8]);
+        if (argc > 9) queries = std::stoul(argv[9]);
+        if (argc > 10) options.seed = std::stoull(argv[10]);
+        DatasetGenerator::validate(options);
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: Invalid benchmark parameter: " << e.what() << std::endl;
+        return 1;
+    }
+
+    SnapshotCreationStrategy* strategy = SnapshotCreationStrategy::get_composite_strategy(argv[1], argv[2]);
+    if (strategy == nullptr) {
+        std::cerr << "ERROR: Unknown snapshot creation strategy " << argv[1] << std::endl;
+        return 1;
+    }
+
+    DatasetGenerator generator(options);
+    try {
+        generator.generate(DATASET_PATH);
+    } catch (const std::exception& e) {
+        std::cerr << "ERROR: " << e.what() << std::endl;
+        delete strategy;
+        return 1;
+    }
+
+    Controller* controller = new Controller("./", strategy, kyotocabinet::TreeDB::TCOMPRESS);
+    MacroBenchmark benchmark(controller, generator, options, options.seed);
+
+    std::cout << "---INSERTION START---" << std::endl;
+    std::vector<IngestResult> ingest_results = benchmark.ingest(DATASET_PATH);
+    MacroBenchmark::write_ingest_results(std::cout, ingest_results);
+    std::cout << "---INSERTION END---" << std::endl;
+    if (ingest_results.empty()) {
+        std::cerr << "ERROR: Could not ingest the dataset" << std::endl;
+        delete controller;
+        delete strategy;
+        return 1;
+    }
+
+    std::cout << "---QUERIES START---" << std::endl;
+    MacroBenchmark::write_query_results(std::cout, benchmark.run(queries));
+    std::cout << "---QUERIES END---" << std::endl;
+
+    delete controller;
+    delete strategy;
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include <algorithm>
+#include <fstream>
+#include "buffer_pool.h"
+
+thread_local bool BufferPool::ingesting = false;
+
+BufferPool::IngestScope::IngestScope() : previous(BufferPool::ingesting) {
+    BufferPool::ingesting = true;
+}
+
+BufferPool::IngestScope::~IngestScope() {
+    BufferPool::ingesting = previous;
+}
+
+BufferPool::BufferPool(size_t capacity, size_t stores) : capacity(capacity), stores(std::max((size_t) 1, stores)), accesses(),
+                                                         total_accesses(0) {
+    for (auto& count : accesses) {
+        count.store(0);
+    }
+}
+
+void BufferPool::set_capacity(size_t capacity, size_t stores) {
+    this->capacity.store(capacity);
+    this->stores.store(std::max((size_t) 1, stores));
+}
+
+size_t BufferPool::get_capacity() const {
+    return capacity.load();
+}
+
+size_t BufferPool::get_accesses(TreeKind kind) const {
+    return accesses[kind].load(std::memory_order_relaxed);
+}
+
+size_t BufferPool::get_page_cache_size(TreeKind kind) const {
+    // Every kind counts one extra access, so that all kinds get an equal part before anything is queried
+    double total = BUFFER_POOL_TREE_KINDS;
+    for (auto& count : accesses) {
+        total += count.load(std::memory_order_relaxed);
+    }
+    double share = (get_accesses(kind) + 1) / total;
+    size_t size = (size_t) (share * capacity.load() / stores.load());
+    return std::max((size_t) BUFFER_POOL_MIN_PAGE_CACHE_SIZE, size);
+}
+
+void BufferPool::decay() {
+    size_t removed = 0;
+    for (auto& count : accesses) {
+        // Accesses that are counted concurrently may be lost, which is fine for shares
+        size_t value = count.load(std::memory_order_relaxed);
+        count.store(value / 2, std::memory_order_relaxed);
+        removed += value - value / 2;
+    }
+    total_accesses.fetch_sub(std::min(removed, total_accesses.load(std::memory_order_relaxed)), std::memory_order_relaxed);
+}
+
+void BufferPool::load(const std::string& file_name) {
+    std::ifstream file(file_name);
+    size_t loaded[BUFFER_POOL_TREE_KINDS];
+    for (size_t& count : loaded) {
+        if (!(file >> count)) {
+            return;
+        }
+    }
+    size_t total = 0;
+    for (int kind = 0; kind < BUFFER_POOL_TREE_KINDS; kind++) {
+        accesses[kind].store(loaded[kind] / 2);
+        total += loaded[kind] / 2;
+    }
+    total_accesses.store(std::min(total, (size_t) BUFFER_POOL_ACCESS_WINDOW - 1));
+}
+
+void BufferPool::save(const std::string& file_name) const {
+    std::ofstream file(file_name, std::ios::trunc);
+    for (int kind = 0; kind < BUFFER_POOL_TREE_KINDS; kind++) {
+        file << (kind > 0 ? " " : "") << get_accesses((TreeKind) kind);
+    }
+    file << std::endl;
+}
@@ -0,0 +1,115 @@
+#ifndef TPFPATCH_STORE_BUFFER_POOL_H
+#define TPFPATCH_STORE_BUFFER_POOL_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+// The number of kinds of KC trees in a triple store: SPO, POS and OSP for deletions and additions
+#define BUFFER_POOL_TREE_KINDS 6
+// The smallest page cache that a tree is given from a buffer pool (1MB)
+#define BUFFER_POOL_MIN_PAGE_CACHE_SIZE (1LL << 20)
+// The number of accesses after which all counts are halved, so that the shares follow the recent workload
+#define BUFFER_POOL_ACCESS_WINDOW (1LL << 20)
+// The file in which the access counts are kept across sessions
+#define BUFFER_POOL_ACCESSES_FILENAME "buffer_pool_accesses.dat"
+
+/**
+ * The page cache memory that is shared by the KC trees of all patch trees of a store.
+ *
+ * KC trees can only have a private page cache, with a size that is fixed when the tree is opened.
+ * Instead of giving each tree the same size, the pool divides its capacity among the kinds of trees
+ * after the number of accesses to each kind in the whole store,
+ * so that frequently queried trees get more pages than trees that are rarely used.
+ * The counts decay over a window of BUFFER_POOL_ACCESS_WINDOW accesses, and can be kept across sessions,
+ * as page cache sizes only take effect when trees are opened.
+ */
+class BufferPool {
+public:
+    enum TreeKind {
+        SPO_DELETIONS = 0,
+        POS_DELETIONS = 1,
+        OSP_DELETIONS = 2,
+        SPO_ADDITIONS = 3,
+        POS_ADDITIONS = 4,
+        OSP_ADDITIONS = 5,
+    };
+protected:
+    std::atomic<size_t> capacity;
+    std::atomic<size_t> stores;
+    std::array<std::atomic<size_t>, BUFFER_POOL_TREE_KINDS> accesses;
+    std::atomic<size_t> total_accesses;
+    static thread_local bool ingesting;
+
+    /**
+     * Halve all access counts.
+     */
+    void decay();
+public:
+    /**
+     * Stops counting accesses on the current thread while it is in scope,
+     * so that ingestion does not take page cache away from the trees that are queried.
+     */
+    class IngestScope {
+    protected:
+        bool previous;
+    public:
+        IngestScope();
+        ~IngestScope();
+    };
+
+    /**
+     * @param capacity The number of bytes of all page caches together.
+     * @param stores The maximum number of triple stores that are open at the same time.
+     */
+    BufferPool(size_t capacity, size_t stores);
+    /**
+     * @param capacity The number of bytes of all page caches together.
+     * @param stores The maximum number of triple stores that are open at the same time.
+     */
+    void set_capacity(size_t capacity, size_t stores);
+    /**
+     * @return The number of bytes of all page caches together.
+     */
+    size_t get_capacity() const;
+    /**
+     * Count an access to a tree of the given kind.
+     * @param kind The kind of tree
+     */
+    inline void record_access(TreeKind kind) {
+        if (ingesting) {
+            return;
+        }
+        accesses[kind].fetch_add(1, std::memory_order_relaxed);
+        // Exactly one thread reaches the window
+        if (total_accesses.fetch_add(1, std::memory_order_relaxed) + 1 == BUFFER_POOL_ACCESS_WINDOW) {
+            decay();
+        }
+    }
+    /**
+     * @param kind The kind of tree
+     * @return The number of accesses to trees of the given kind.
+     */
+    size_t get_accesses(TreeKind kind) const;
+    /**
+     * Determine the page cache size for a tree that is opened.
+     * Each kind of tree gets a part of the capacity of one store that is proportional to its number of accesses.
+     * @param kind The kind of tree
+     * @return The page cache size in bytes.
+     */
+    size_t get_page_cache_size(TreeKind kind) const;
+    /**
+     * Load the access counts of a previous session, which count for half.
+     * Nothing is loaded if the file does not exist.
+     * @param file_name The file to load from
+     */
+    void load(const std::string& file_name);
+    /**
+     * Store the access counts for a later session.
+     * @param file_name The file to store to
+     */
+    void save(const std::string& file_name) const;
+};
+
+#endif //TPFPATCH_STORE_BUFFER_POOL_H
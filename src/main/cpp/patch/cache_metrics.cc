@@ -0,0 +1,22 @@
+#include "cache_metrics.h"
+
+CacheCounters::CacheCounters() : hits(0), misses(0), evictions(0), load_nanos(0), max_load_nanos(0) {}
+
+void CacheCounters::loaded(double seconds) {
+    uint64_t nanos = (uint64_t) (seconds * 1e9);
+    misses.fetch_add(1, std::memory_order_relaxed);
+    load_nanos.fetch_add(nanos, std::memory_order_relaxed);
+    uint64_t current = max_load_nanos.load(std::memory_order_relaxed);
+    while (current < nanos && !max_load_nanos.compare_exchange_weak(current, nanos, std::memory_order_relaxed));
+}
+
+CacheMetrics CacheCounters::get_metrics(size_t loaded) const {
+    return {
+            hits.load(std::memory_order_relaxed),
+            misses.load(std::memory_order_relaxed),
+            evictions.load(std::memory_order_relaxed),
+            loaded,
+            load_nanos.load(std::memory_order_relaxed) / 1e9,
+            max_load_nanos.load(std::memory_order_relaxed) / 1e9,
+    };
+}
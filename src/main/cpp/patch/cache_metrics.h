@@ -0,0 +1,53 @@
+#ifndef TPFPATCH_STORE_CACHE_METRICS_H
+#define TPFPATCH_STORE_CACHE_METRICS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * A snapshot of the counters of a cache of loaded objects.
+ */
+struct CacheMetrics {
+    size_t hits;
+    size_t misses;
+    size_t evictions;
+    // The number of objects that are currently loaded
+    size_t loaded;
+    // The total and largest number of seconds it took to load an object after a miss
+    double load_seconds;
+    double max_load_seconds;
+};
+
+/**
+ * Counts the hits, misses, evictions and load latencies of a cache.
+ * The counters can be updated concurrently, also while only holding a shared lock on the cache.
+ */
+class CacheCounters {
+protected:
+    std::atomic<size_t> hits;
+    std::atomic<size_t> misses;
+    std::atomic<size_t> evictions;
+    std::atomic<uint64_t> load_nanos;
+    std::atomic<uint64_t> max_load_nanos;
+public:
+    CacheCounters();
+    inline void hit() {
+        hits.fetch_add(1, std::memory_order_relaxed);
+    }
+    inline void evicted() {
+        evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+    /**
+     * Count a miss, after which an object was loaded.
+     * @param seconds The number of seconds it took to load the object
+     */
+    void loaded(double seconds);
+    /**
+     * @param loaded The number of objects that are currently loaded
+     * @return The current values of the counters.
+     */
+    CacheMetrics get_metrics(size_t loaded) const;
+};
+
+#endif //TPFPATCH_STORE_CACHE_METRICS_H
@@ -0,0 +1,106 @@
+#include "clock_eviction_policy.h"
+
+ClockEvictionPolicy::ClockEvictionPolicy() : index(), slots(), free_slots(), hand(0) {}
+
+bool ClockEvictionPolicy::touch(int id) {
+    auto it = index.find(id);
+    if (it == index.end()) {
+        return false;
+    }
+    Slot& slot = slots[it->second];
+    // Avoid writing the shared cache line when the bit is already set
+    if (!slot.referenced.load(std::memory_order_relaxed)) {
+        slot.referenced.store(true, std::memory_order_relaxed);
+    }
+    return true;
+}
+
+void ClockEvictionPolicy::insert(int id) {
+    if (touch(id)) {
+        return;
+    }
+    size_t position;
+    if (free_slots.empty()) {
+        position = slots.size();
+        slots.emplace_back();
+    } else {
+        position = free_slots.back();
+        free_slots.pop_back();
+    }
+    Slot& slot = slots[position];
+    slot.id = id;
+    slot.occupied = true;
+    slot.referenced.store(true, std::memory_order_relaxed);
+    index[id] = position;
+}
+
+void ClockEvictionPolicy::erase(int id) {
+    auto it = index.find(id);
+    if (it == index.end()) {
+        return;
+    }
+    slots[it->second].occupied = false;
+    free_slots.push_back(it->second);
+    index.erase(it);
+}
+
+int ClockEvictionPolicy::evict(const std::function<bool(int)>& can_evict) {
+    // Every slot is passed at most twice: once to clear its reference bit, and once to evict it.
+    for (size_t steps = 0; steps < 2 * slots.size(); steps++) {
+        if (hand >= slots.size()) {
+            hand = 0;
+        }
+        Slot& slot = slots[hand++];
+        if (!slot.occupied) {
+            continue;
+        }
+        if (slot.referenced.load(std::memory_order_relaxed)) {
+            slot.referenced.store(false, std::memory_order_relaxed);
+            continue;
+        }
+        if (can_evict(slot.id)) {
+            int id = slot.id;
+            erase(id);
+            return id;
+        }
+    }
+    return -1;
+}
+
+int ClockEvictionPolicy::evict(const std::function<bool(int)>& can_evict, const std::function<double(int)>& priority) {
+    // The first full pass clears the reference bits it passes,
+    // so the second pass only happens if all unreferenced elements were in use.
+    for (int pass = 0; pass < 2; pass++) {
+        int selected = -1;
+        double selected_priority = 0;
+        for (size_t steps = 0; steps < slots.size(); steps++) {
+            if (hand >= slots.size()) {
+                hand = 0;
+            }
+            Slot& slot = slots[hand++];
+            if (!slot.occupied) {
+                continue;
+            }
+            if (slot.referenced.load(std::memory_order_relaxed)) {
+                slot.referenced.store(false, std::memory_order_relaxed);
+                continue;
+            }
+            if (can_evict(slot.id)) {
+                double slot_priority = priority(slot.id);
+                if (selected < 0 || slot_priority > selected_priority) {
+                    selected = slot.id;
+                    selected_priority = slot_priority;
+                }
+            }
+        }
+        if (selected >= 0) {
+            erase(selected);
+            return selected;
+        }
+    }
+    return -1;
+}
+
+size_t ClockEvictionPolicy::size() const {
+    return index.size();
+}
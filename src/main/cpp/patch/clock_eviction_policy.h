@@ -0,0 +1,71 @@
+#ifndef TPFPATCH_STORE_CLOCK_EVICTION_POLICY_H
+#define TPFPATCH_STORE_CLOCK_EVICTION_POLICY_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Decides which loaded snapshots or patch trees are unloaded, with the CLOCK algorithm.
+ *
+ * This class is not locked itself, it relies on the lock of its owner:
+ * touch() only requires a shared lock, so cache hits never block each other,
+ * while insert(), erase() and evict() require an exclusive lock.
+ * A hit marks an id as used with a single atomic store instead of reordering a list like LRU would.
+ */
+class ClockEvictionPolicy {
+protected:
+    struct Slot {
+        int id;
+        bool occupied;
+        std::atomic<bool> referenced;
+        Slot() : id(0), occupied(false), referenced(false) {}
+    };
+    std::unordered_map<int, size_t> index;
+    std::deque<Slot> slots;
+    std::vector<size_t> free_slots;
+    size_t hand;
+public:
+    ClockEvictionPolicy();
+    /**
+     * Mark the given id as used.
+     * This only requires a shared lock.
+     * @param id The id of a loaded element
+     * @return If the id is tracked.
+     */
+    bool touch(int id);
+    /**
+     * Start tracking the given id, it is marked as used.
+     * @param id The id of a loaded element
+     */
+    void insert(int id);
+    /**
+     * Stop tracking the given id.
+     * @param id The id of an unloaded element
+     */
+    void erase(int id);
+    /**
+     * Select an id to unload and stop tracking it.
+     * Ids that were used since the last pass of the clock hand get a second chance.
+     * @param can_evict If the element with the given id can be unloaded, elements that are still in use can not.
+     * @return The id to unload, or -1 if none of the elements can be unloaded.
+     */
+    int evict(const std::function<bool(int)>& can_evict);
+    /**
+     * Select an id to unload and stop tracking it, taking into account what unloading it gains.
+     * Ids that were used since the last pass of the clock hand get a second chance,
+     * among the other ids, the one with the highest priority is selected.
+     * @param can_evict If the element with the given id can be unloaded, elements that are still in use can not.
+     * @param priority How much unloading the element with the given id gains, such as its size divided by its reload cost.
+     * @return The id to unload, or -1 if none of the elements can be unloaded.
+     */
+    int evict(const std::function<bool(int)>& can_evict, const std::function<double(int)>& priority);
+    /**
+     * @return The number of tracked ids.
+     */
+    size_t size() const;
+};
+
+#endif //TPFPATCH_STORE_CLOCK_EVICTION_POLICY_H
@@ -0,0 +1,72 @@
+#include <algorithm>
+#include "memory_budget.h"
+
+MemoryBudget::MemoryBudget(size_t limit) : limit(limit), used(0), used_by() {
+    for (auto& count : used_by) {
+        count.store(0);
+    }
+}
+
+void MemoryBudget::set_limit(size_t limit) {
+    this->limit.store(limit);
+}
+
+size_t MemoryBudget::get_limit() const {
+    return limit.load();
+}
+
+void MemoryBudget::add(size_t bytes) {
+    used.fetch_add(bytes);
+}
+
+// Never wrap around, even if a footprint grew between adding and releasing it
+static void release_bytes(std::atomic<size_t>& used, size_t bytes) {
+    size_t current = used.load();
+    while (!used.compare_exchange_weak(current, current - std::min(current, bytes)));
+}
+
+void MemoryBudget::release(size_t bytes) {
+    release_bytes(used, bytes);
+}
+
+size_t MemoryBudget::get_used() const {
+    return used.load();
+}
+
+bool MemoryBudget::is_exceeded() const {
+    size_t max = limit.load();
+    return max > 0 && used.load() > max;
+}
+
+void MemoryBudget::add(size_t bytes, Consumer consumer) {
+    add(bytes);
+    used_by[consumer].fetch_add(bytes);
+}
+
+void MemoryBudget::release(size_t bytes, Consumer consumer) {
+    release(bytes);
+    release_bytes(used_by[consumer], bytes);
+}
+
+size_t MemoryBudget::get_used(Consumer consumer) const {
+    return used_by[consumer].load();
+}
+
+size_t MemoryBudget::get_share(Consumer consumer) const {
+    size_t max = limit.load();
+    size_t page_caches = max / MEMORY_BUDGET_PAGE_CACHE_FRACTION;
+    return consumer == PATCH_TREES ? page_caches : max - page_caches;
+}
+
+bool MemoryBudget::is_exceeded(Consumer consumer) const {
+    return limit.load() > 0 && get_used(consumer) > get_share(consumer);
+}
+
+size_t MemoryBudget::get_page_cache_size(size_t trees, size_t max_size) const {
+    size_t max = limit.load();
+    if (max == 0 || trees == 0) {
+        return max_size;
+    }
+    size_t size = max / MEMORY_BUDGET_PAGE_CACHE_FRACTION / trees;
+    return std::max((size_t) MEMORY_BUDGET_MIN_PAGE_CACHE_SIZE, std::min(max_size, size));
+}
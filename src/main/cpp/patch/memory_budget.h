@@ -0,0 +1,101 @@
+#ifndef TPFPATCH_STORE_MEMORY_BUDGET_H
+#define TPFPATCH_STORE_MEMORY_BUDGET_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// The smallest page cache per KC tree when the page caches are sized after a memory budget (1MB)
+#define MEMORY_BUDGET_MIN_PAGE_CACHE_SIZE (1LL << 20)
+// The part of a memory budget that is divided among the page caches of the KC trees
+#define MEMORY_BUDGET_PAGE_CACHE_FRACTION 4
+// The number of kinds of objects that share a memory budget: snapshots and patch trees
+#define MEMORY_BUDGET_CONSUMERS 2
+
+/**
+ * The number of bytes that the loaded snapshots and patch trees of a store may use together.
+ *
+ * Each manager reports the footprint of the objects it loads,
+ * and unloads its own objects when they exceed the share of the budget of that manager.
+ * Patch trees get the part of the budget for page caches, snapshots get the rest,
+ * so that loading many objects of one kind never unloads the objects of the other kind.
+ */
+class MemoryBudget {
+public:
+    enum Consumer {
+        SNAPSHOTS = 0,
+        PATCH_TREES = 1,
+    };
+protected:
+    std::atomic<size_t> limit;
+    std::atomic<size_t> used;
+    std::array<std::atomic<size_t>, MEMORY_BUDGET_CONSUMERS> used_by;
+public:
+    /**
+     * @param limit The maximum number of bytes, 0 for unbounded.
+     */
+    explicit MemoryBudget(size_t limit = 0);
+    /**
+     * @param limit The maximum number of bytes, 0 for unbounded.
+     */
+    void set_limit(size_t limit);
+    /**
+     * @return The maximum number of bytes, 0 for unbounded.
+     */
+    size_t get_limit() const;
+    /**
+     * Account for memory that was taken.
+     * @param bytes The number of bytes
+     */
+    void add(size_t bytes);
+    /**
+     * Account for memory that was freed.
+     * @param bytes The number of bytes
+     */
+    void release(size_t bytes);
+    /**
+     * @return The number of bytes that are currently used.
+     */
+    size_t get_used() const;
+    /**
+     * @return If more bytes are used than allowed.
+     */
+    bool is_exceeded() const;
+    /**
+     * Account for memory that was taken by the given kind of objects.
+     * @param bytes The number of bytes
+     * @param consumer The kind of objects
+     */
+    void add(size_t bytes, Consumer consumer);
+    /**
+     * Account for memory that was freed by the given kind of objects.
+     * @param bytes The number of bytes
+     * @param consumer The kind of objects
+     */
+    void release(size_t bytes, Consumer consumer);
+    /**
+     * @param consumer The kind of objects
+     * @return The number of bytes that are currently used by the given kind of objects.
+     */
+    size_t get_used(Consumer consumer) const;
+    /**
+     * @param consumer The kind of objects
+     * @return The maximum number of bytes for the given kind of objects, 0 for unbounded.
+     */
+    size_t get_share(Consumer consumer) const;
+    /**
+     * @param consumer The kind of objects
+     * @return If the given kind of objects use more bytes than their share.
+     */
+    bool is_exceeded(Consumer consumer) const;
+    /**
+     * Determine the page cache size of KC trees, so that the page caches of the given number of trees
+     * together use a fixed part of the budget.
+     * @param trees The maximum number of trees that are open at the same time
+     * @param max_size The page cache size when the budget is unbounded, which is never exceeded
+     * @return The page cache size per tree in bytes.
+     */
+    size_t get_page_cache_size(size_t trees, size_t max_size) const;
+};
+
+#endif //TPFPATCH_STORE_MEMORY_BUDGET_H
@@ -2,11 +2,13 @@
 
 #include "patch_tree.h"
 #include "../simpleprogresslistener.h"
+#include "../query_trace.h"
 
 
-PatchTree::PatchTree(string basePath, int min_patch_id, std::shared_ptr<DictionaryManager> dict, int8_t kc_opts, bool readonly)
+PatchTree::PatchTree(string basePath, int min_patch_id, std::shared_ptr<DictionaryManager> dict, int8_t kc_opts, bool readonly,
+                     std::shared_ptr<BufferPool> buffer_pool)
         : metadata_filename(basePath + METADATA_FILENAME_BASE(min_patch_id)), min_patch_id(min_patch_id), max_patch_id(min_patch_id), readonly(readonly) {
-    tripleStore = new TripleStore(basePath + PATCHTREE_FILENAME_BASE(min_patch_id), dict, kc_opts, readonly);
+    tripleStore = new TripleStore(basePath + PATCHTREE_FILENAME_BASE(min_patch_id), dict, kc_opts, readonly, buffer_pool);
     read_metadata();
 
     if (!readonly) {
@@ -673,6 +675,7 @@ std::pair<DV*, Triple> PatchTree::last_deletion_value(const Triple &triple_patte
 }
 
 std::pair<PatchPosition, Triple> PatchTree::deletion_count(const Triple &triple_pattern, int patch_id) const {
+    TRACE_SPAN("deletion_count");
     PatchPosition patch_position;
     Triple triple;
     if (TripleStore::is_default_tree(triple_pattern)) {
@@ -702,6 +705,7 @@ std::pair<PatchPosition, Triple> PatchTree::deletion_count(const Triple &triple_
 }
 
 PositionedTripleIterator* PatchTree::deletion_iterator_from(const Triple& offset, int patch_id, const Triple& triple_pattern) const {
+    TRACE_SPAN("deletion_iterator_from");
     kyotocabinet::DB::Cursor* cursor_deletions = tripleStore->getDefaultDeletionsTree()->cursor();
     size_t size;
     const char* data = offset.serialize(&size);
@@ -789,6 +793,7 @@ PatchPositions PatchTree::get_deletion_patch_positions(const Triple& triple, int
 }
 
 PatchTreeTripleIterator* PatchTree::addition_iterator_from(long offset, int patch_id, const Triple& triple_pattern) const {
+    TRACE_SPAN("addition_iterator_from");
     kyotocabinet::DB::Cursor* cursor = tripleStore->getAdditionsTree(triple_pattern)->cursor();
     size_t size;
     const char* data = triple_pattern.serialize(&size);
@@ -886,6 +891,14 @@ int PatchTree::get_min_patch_id() const {
     return min_patch_id;
 }
 
+size_t PatchTree::get_memory_footprint() const {
+    return tripleStore->get_memory_footprint();
+}
+
+std::vector<TreeMetrics> PatchTree::get_tree_metrics() const {
+    return tripleStore->get_tree_metrics();
+}
+
 void PatchTree::write_metadata() {
     ofstream metadata_file;
     metadata_file.open(metadata_filename);
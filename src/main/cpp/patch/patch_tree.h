@@ -48,7 +48,8 @@ protected:
     template <class DV>
     std::pair<DV*, Triple> last_deletion_value(const Triple &triple_pattern, int patch_id) const;
 public:
-    PatchTree(string basePath, int min_patch_id, std::shared_ptr<DictionaryManager> dict, int8_t kc_opts = 0, bool readonly = false);
+    PatchTree(string basePath, int min_patch_id, std::shared_ptr<DictionaryManager> dict, int8_t kc_opts = 0, bool readonly = false,
+              std::shared_ptr<BufferPool> buffer_pool = nullptr);
     ~PatchTree();
     /**
      * Append the given patch elements to the tree with given patch id.
@@ -230,6 +231,14 @@ public:
      * @return The smallest patch id that is currently available.
      */
     int get_min_patch_id() const;
+    /**
+     * @return The number of bytes that the KC trees of this patch tree use in memory.
+     */
+    size_t get_memory_footprint() const;
+    /**
+     * @return The state of each of the KC trees of this patch tree.
+     */
+    std::vector<TreeMetrics> get_tree_metrics() const;
 protected:
     void write_metadata();
     void read_metadata();
@@ -2,6 +2,7 @@
 #include <string>
 #include <limits>
 #include "patch_tree_addition_value.h"
+#include "../query_trace.h"
 
 
 #ifndef COMPRESSED_ADD_VALUES
@@ -119,6 +120,7 @@ const char *PatchTreeAdditionValue::serialize(size_t *size) const {
 }
 
 void PatchTreeAdditionValue::deserialize(const char *data, size_t size) {
+    TRACE_COUNT(TRACE_VALUES_DESERIALIZED, 1);
 #ifdef USE_VSI
     size_t patches_size, decode_size, offset;
     patches_size = decode_ULEB128((const uint8_t*)data, &decode_size);
@@ -268,6 +270,7 @@ const char *PatchTreeAdditionValue::serialize(size_t *size) const {
 }
 
 void PatchTreeAdditionValue::deserialize(const char *data, size_t size) {
+    TRACE_COUNT(TRACE_VALUES_DESERIALIZED, 1);
     size_t patches_size, decode_size, offset;
 #ifdef USE_VSI
     patches_size = decode_ULEB128((const uint8_t*)data, &decode_size);
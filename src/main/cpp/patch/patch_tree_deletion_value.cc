@@ -2,6 +2,7 @@
 #include <string>
 
 #include "patch_tree_deletion_value.h"
+#include "../query_trace.h"
 
 
 int PatchTreeDeletionValueElementBase::get_patch_id() const {
@@ -176,6 +177,7 @@ const char* PatchTreeDeletionValueBase<T>::serialize(size_t* size) const {
 
 template <class T>
 void PatchTreeDeletionValueBase<T>::deserialize(const char* data, size_t size) {
+    TRACE_COUNT(TRACE_VALUES_DESERIALIZED, 1);
     elements.clear();
     size_t offset = 0;
     while (offset < size) {
@@ -254,6 +256,7 @@ const char* PatchTreeDeletionValueBase<T>::serialize(size_t* size) const {
 
 template <class T>
 void PatchTreeDeletionValueBase<T>::deserialize(const char* data, size_t size) {
+    TRACE_COUNT(TRACE_VALUES_DESERIALIZED, 1);
     elements.deserialize(data, size);
 }
 #endif
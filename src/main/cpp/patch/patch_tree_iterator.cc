@@ -3,6 +3,7 @@
 #include <kchashdb.h>
 
 #include "patch_tree_iterator.h"
+#include "../query_trace.h"
 
 template <class DV>
 PatchTreeIteratorBase<DV>::PatchTreeIteratorBase(kyotocabinet::DB::Cursor* cursor_deletions, kyotocabinet::DB::Cursor* cursor_additions, PatchTreeKeyComparator* comparator)
@@ -134,6 +135,7 @@ bool PatchTreeIteratorBase<DV>::next_deletion(PatchTreeKey* key, DV* value, bool
 
         if(!silent_step || !filter_valid) {
             reverse ? cursor_deletions->step_back() : cursor_deletions->step();
+            TRACE_COUNT(TRACE_KC_CURSOR_STEPS, 1);
         }
     }
     return true;
@@ -158,6 +160,7 @@ bool PatchTreeIteratorBase<DV>::next_addition(PatchTreeKey* key, PatchTreeAdditi
             return false;
         }
         reverse ? cursor_additions->step_back() : cursor_additions->step();
+        TRACE_COUNT(TRACE_KC_CURSOR_STEPS, 1);
         value->deserialize(vbp, vsp);
 
         key->deserialize(kbp, ksp);
@@ -1,15 +1,25 @@
+#include <chrono>
 #include <dirent.h>
 #include <iostream>
 #include <memory>
 #include "patch_tree_manager.h"
 
-PatchTreeManager::PatchTreeManager(string basePath, int8_t kc_opts, bool readonly, size_t cache_size) : basePath(basePath), max_loaded_patches(std::max((size_t)2,cache_size)), kc_opts(kc_opts), readonly(readonly) {
+PatchTreeManager::PatchTreeManager(string basePath, int8_t kc_opts, bool readonly, size_t cache_size) : basePath(basePath), max_loaded_patches(std::max((size_t)2,cache_size)), kc_opts(kc_opts), readonly(readonly),
+        buffer_pool(std::make_shared<BufferPool>(KC_PAGE_CACHE_SIZE * KC_TREE_COUNT * max_loaded_patches, max_loaded_patches)) {
+    // Trees that are opened in this session are sized after the workload of the previous ones
+    buffer_pool->load(basePath + BUFFER_POOL_ACCESSES_FILENAME);
     detect_patch_trees();
 }
 
-PatchTreeManager::~PatchTreeManager() = default;
+PatchTreeManager::~PatchTreeManager() {
+    set_memory_budget(nullptr);
+    if (!readonly) {
+        buffer_pool->save(basePath + BUFFER_POOL_ACCESSES_FILENAME);
+    }
+}
 
 bool PatchTreeManager::append(PatchElementIterator* patch_it, int patch_id, std::shared_ptr<DictionaryManager> dict, bool check_uniqueness, hdt::ProgressListener* progressListener) {
+    BufferPool::IngestScope ingest_scope;
     int patchtree_id = get_patch_tree_id(patch_id);
     std::shared_ptr<PatchTree> patchtree;
     if(patchtree_id < 0) {
@@ -77,10 +87,24 @@ std::shared_ptr<PatchTree> PatchTreeManager::load_patch_tree(int patch_id_start,
     update_cache(patch_id_start);
     auto it = loaded_patchtrees.find(patch_id_start);
     if (it != loaded_patchtrees.end() && it->second) {
+        cache_counters.hit();
         return it->second;
     }
-    loaded_patchtrees[patch_id_start] = std::make_shared<PatchTree>(basePath, patch_id_start, dict, kc_opts, readonly);
-    return loaded_patchtrees[patch_id_start];
+    // The page caches of all trees that may be loaded together take a fixed part of the memory budget
+    size_t trees = max_loaded_patches * KC_TREE_COUNT;
+    size_t page_cache_size = memory_budget == nullptr ? KC_PAGE_CACHE_SIZE
+            : memory_budget->get_page_cache_size(trees, KC_PAGE_CACHE_SIZE);
+    buffer_pool->set_capacity(page_cache_size * trees, max_loaded_patches);
+    auto start = std::chrono::steady_clock::now();
+    std::shared_ptr<PatchTree> patchtree = std::make_shared<PatchTree>(basePath, patch_id_start, dict, kc_opts, readonly, buffer_pool);
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+    loaded_patchtrees[patch_id_start] = patchtree;
+    reload_costs[patch_id_start] = duration.count();
+    cache_counters.loaded(duration.count());
+    update_footprint(patch_id_start);
+    // Other patch trees are unloaded if this one exceeds the memory budget
+    update_cache(patch_id_start);
+    return patchtree;
 }
 
 std::shared_ptr<PatchTree> PatchTreeManager::get_patch_tree(int patch_id_start, std::shared_ptr<DictionaryManager> dict) {
@@ -100,7 +124,9 @@ std::shared_ptr<PatchTree> PatchTreeManager::get_patch_tree(int patch_id_start,
         lock.unlock();
         return load_patch_tree(it->first, dict);
     }
-    return it->second;
+    cache_policy.touch(it->first);
+    cache_counters.hit();
+    return patchtree;
 }
 
 std::shared_ptr<PatchTree> PatchTreeManager::construct_next_patch_tree(int patch_id_start, std::shared_ptr<DictionaryManager> dict) {
@@ -121,6 +147,11 @@ int PatchTreeManager::get_patch_tree_id(int patch_id) {
     return it->first;
 }
 
+int PatchTreeManager::get_delta_chain_patch_tree_id(int snapshot_id) {
+    int patchtree_id = get_patch_tree_id(snapshot_id + 1);
+    return patchtree_id > snapshot_id ? patchtree_id : -1;
+}
+
 Patch* PatchTreeManager::get_patch(int patch_id, std::shared_ptr<DictionaryManager> dict) {
     int patchtree_id = get_patch_tree_id(patch_id);
     if(patchtree_id < 0) {
@@ -145,31 +176,81 @@ int PatchTreeManager::get_max_patch_id(std::shared_ptr<DictionaryManager> dict)
 }
 
 void PatchTreeManager::update_cache(int accessed_patch_id) {
-    update_cache_internal(accessed_patch_id, lru_map.size());
-}
-
-void PatchTreeManager::update_cache_internal(int accessed_id, int iterations) {
-    if (lru_map.size() >= max_loaded_patches) {
-        if (iterations > 0) {
-            int lru_patchtree = lru_list.back();
-            lru_list.pop_back();
-            lru_map.erase(lru_patchtree);
-            if (!loaded_patchtrees[lru_patchtree].unique() || lru_patchtree == accessed_id) {
-                // the patchtree we want to unload is still used somewhere
-                // so we push it to the front of the list
-                lru_list.push_front(lru_patchtree);
-                lru_map[lru_patchtree] = lru_list.begin();
-                update_cache_internal(accessed_id, --iterations);
-            } else {
-                loaded_patchtrees[lru_patchtree] = nullptr;
-            }
+    cache_policy.insert(accessed_patch_id);
+    while (cache_policy.size() > max_loaded_patches || (memory_budget != nullptr && memory_budget->is_exceeded(MemoryBudget::PATCH_TREES))) {
+        int evicted = cache_policy.evict([this, accessed_patch_id](int id) {
+            // the patchtree we want to unload may still be used somewhere
+            return id != accessed_patch_id && loaded_patchtrees[id].use_count() <= 1;
+        }, [this](int id) {
+            // Prefer to unload patch trees that free a lot of memory and are quickly reopened
+            return footprints[id] / std::max(reload_costs[id], 0.001);
+        });
+        if (evicted < 0) {
+            break;
+        }
+        loaded_patchtrees[evicted] = nullptr;
+        update_footprint(evicted);
+        cache_counters.evicted();
+    }
+}
+
+void PatchTreeManager::update_footprint(int patch_id_start) {
+    std::shared_ptr<PatchTree> patchtree = loaded_patchtrees[patch_id_start];
+    size_t footprint = patchtree == nullptr ? 0 : patchtree->get_memory_footprint();
+    if (memory_budget != nullptr) {
+        memory_budget->release(footprints[patch_id_start], MemoryBudget::PATCH_TREES);
+        memory_budget->add(footprint, MemoryBudget::PATCH_TREES);
+    }
+    footprints[patch_id_start] = footprint;
+}
+
+void PatchTreeManager::set_memory_budget(std::shared_ptr<MemoryBudget> budget) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (auto& footprint : footprints) {
+        if (memory_budget != nullptr) {
+            memory_budget->release(footprint.second, MemoryBudget::PATCH_TREES);
+        }
+        if (budget != nullptr) {
+            budget->add(footprint.second, MemoryBudget::PATCH_TREES);
         }
     }
-    if (lru_map.find(accessed_id) != lru_map.end()) {
-        lru_list.erase(lru_map[accessed_id]);
+    memory_budget = budget;
+}
+
+size_t PatchTreeManager::get_memory_usage() {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    size_t usage = 0;
+    for (auto& footprint : footprints) {
+        usage += footprint.second;
+    }
+    return usage;
+}
+
+std::shared_ptr<BufferPool> PatchTreeManager::get_buffer_pool() const {
+    return buffer_pool;
+}
+
+CacheMetrics PatchTreeManager::get_cache_metrics() {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    size_t loaded = 0;
+    for (auto& patchtree : loaded_patchtrees) {
+        if (patchtree.second != nullptr) {
+            loaded++;
+        }
+    }
+    return cache_counters.get_metrics(loaded);
+}
+
+std::vector<TreeMetrics> PatchTreeManager::get_tree_metrics() {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::vector<TreeMetrics> metrics;
+    for (auto& patchtree : loaded_patchtrees) {
+        if (patchtree.second != nullptr) {
+            std::vector<TreeMetrics> tree_metrics = patchtree.second->get_tree_metrics();
+            metrics.insert(metrics.end(), tree_metrics.begin(), tree_metrics.end());
+        }
     }
-    lru_list.push_front(accessed_id);
-    lru_map[accessed_id] = lru_list.begin();
+    return metrics;
 }
 
 size_t PatchTreeManager::get_cache_max_size() const {
@@ -7,24 +7,38 @@
 #include <memory>
 #include <shared_mutex>
 #include "patch_tree.h"
+#include "clock_eviction_policy.h"
+#include "memory_budget.h"
+#include "cache_metrics.h"
 
 class PatchTreeManager {
 private:
     string basePath;
 
     size_t max_loaded_patches;
-    std::list<int> lru_list;
-    std::map<int, std::list<int>::iterator> lru_map;
+    ClockEvictionPolicy cache_policy;
+    std::shared_ptr<MemoryBudget> memory_budget;
+    // The number of bytes that each loaded patch tree uses
+    std::map<int, size_t> footprints;
+    // The number of seconds it took to load each patch tree
+    std::map<int, double> reload_costs;
+    CacheCounters cache_counters;
     // Mapping from patchtree_id -> patchTree
     std::map<int, std::shared_ptr<PatchTree>> loaded_patchtrees;
     // Options for KC trees
     int8_t kc_opts;
     bool readonly;
+    // The page cache memory that is divided among the KC trees of all patch trees
+    std::shared_ptr<BufferPool> buffer_pool;
 
     std::shared_mutex mutex;
     std::mutex append_mutex;
 
-    void update_cache_internal(int accessed_id, int iterations);
+    /**
+     * Recalculate the memory footprint of the given patch tree.
+     * The manager must be exclusively locked.
+     */
+    void update_footprint(int patch_id_start);
 
 public:
     PatchTreeManager(string basePath, int8_t kc_opts = 0, bool readonly = false, size_t cache_size = 4);
@@ -89,6 +103,14 @@ public:
      * @return The id of the patch tree, can be -1 if the patch_id is not present in any tree.
      */
     int get_patch_tree_id(int patch_id);
+    /**
+     * Get the id of the patch tree of the delta chain that starts at the given snapshot.
+     * The patch tree of a next delta chain can already exist before its snapshot is registered,
+     * so queries must resolve their patch tree from their snapshot, not from their patch id.
+     * @param snapshot_id The id of a snapshot.
+     * @return The id of the patch tree, can be -1 if no patches were appended to this snapshot.
+     */
+    int get_delta_chain_patch_tree_id(int snapshot_id);
     /**
      * Get the patch with the given id.
      * @param patch_id The id of a patch.
@@ -103,10 +125,35 @@ public:
     int get_max_patch_id(std::shared_ptr<DictionaryManager> dict);
 
     /**
-     * Update the state of the patch cache
+     * Update the state of the patch cache after loading a patch tree, unloading unused patch trees if it is full.
+     * The manager must be exclusively locked, cache hits only mark the patch tree as used.
      */
     void update_cache(int accessed_patch_id);
 
+    /**
+     * Share a memory budget with other managers, patch trees are unloaded when they exceed their share of it.
+     * Unused patch trees that are large and quick to reload are unloaded first.
+     * The page caches of patch trees that are loaded afterwards are sized after this budget.
+     * @param budget The memory budget, or null to only limit the number of loaded patch trees.
+     */
+    void set_memory_budget(std::shared_ptr<MemoryBudget> budget);
+    /**
+     * @return The number of bytes that the loaded patch trees use.
+     */
+    size_t get_memory_usage();
+    /**
+     * @return The pool that sizes the page caches of the patch trees after how often each kind of tree is accessed.
+     */
+    std::shared_ptr<BufferPool> get_buffer_pool() const;
+    /**
+     * @return The hits, misses, evictions and load latencies of the patch tree cache.
+     */
+    CacheMetrics get_cache_metrics();
+    /**
+     * @return The state of the KC trees of the loaded patch trees.
+     */
+    std::vector<TreeMetrics> get_tree_metrics();
+
     size_t get_cache_max_size() const;
 
     void set_cache_max_size(size_t new_size);
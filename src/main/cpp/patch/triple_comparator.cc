@@ -1,5 +1,21 @@
 #include "triple_comparator.h"
 
+namespace {
+    // Components of consecutive snapshots are compared on their ranks in the translation map between them.
+    // Other components are translated to strings and compared.
+    int32_t compare_across_dictionaries(size_t id1, size_t id2, hdt::TripleComponentRole role, DictionaryManager& dict1, DictionaryManager& dict2) {
+        int32_t comp;
+        const IdTranslationMap* map = dict2.getTranslationMap();
+        if (map != nullptr && map->get_from_snapshot() == dict1.getSnapshotId() && map->compare(id1, id2, role, comp)) {
+            return comp;
+        }
+        map = dict1.getTranslationMap();
+        if (map != nullptr && map->get_from_snapshot() == dict2.getSnapshotId() && map->compare(id2, id1, role, comp)) {
+            return -comp;
+        }
+        return dict1.idToString(id1, role).compare(dict2.idToString(id2, role));
+    }
+}
 
 triplecomp subject_comparator = [] (const Triple& t1, const Triple& t2, std::shared_ptr<DictionaryManager> dict1, std::shared_ptr<DictionaryManager> dict2) {
     size_t max_id = std::numeric_limits<size_t>::max();
@@ -10,8 +26,7 @@ triplecomp subject_comparator = [] (const Triple& t1, const Triple& t2, std::sha
     if (dict1 == dict2) {
         return dict1->compareComponent(t1.get_subject(), t2.get_subject(), hdt::SUBJECT);
     }
-    //Else, translate to string and compare
-    return t1.get_subject(*dict1).compare(t2.get_subject(*dict2));
+    return compare_across_dictionaries(t1.get_subject(), t2.get_subject(), hdt::SUBJECT, *dict1, *dict2);
 };
 
 triplecomp predicate_comparator = [] (const Triple& t1, const Triple& t2, std::shared_ptr<DictionaryManager> dict1, std::shared_ptr<DictionaryManager> dict2) {
@@ -23,8 +38,7 @@ triplecomp predicate_comparator = [] (const Triple& t1, const Triple& t2, std::s
     if (dict1 == dict2) {
         return dict1->compareComponent(t1.get_predicate(), t2.get_predicate(), hdt::PREDICATE);
     }
-    //Else, translate to string and compare
-    return t1.get_predicate(*dict1).compare(t2.get_predicate(*dict2));
+    return compare_across_dictionaries(t1.get_predicate(), t2.get_predicate(), hdt::PREDICATE, *dict1, *dict2);
 };
 
 triplecomp object_comparator = [] (const Triple& t1, const Triple& t2, std::shared_ptr<DictionaryManager> dict1, std::shared_ptr<DictionaryManager> dict2) {
@@ -36,8 +50,7 @@ triplecomp object_comparator = [] (const Triple& t1, const Triple& t2, std::shar
     if (dict1 == dict2) {
         return dict1->compareComponent(t1.get_object(), t2.get_object(), hdt::OBJECT);
     }
-    //Else, translate to string and compare
-    return t1.get_object(*dict1).compare(t2.get_object(*dict2));
+    return compare_across_dictionaries(t1.get_object(), t2.get_object(), hdt::OBJECT, *dict1, *dict2);
 };
 
 
@@ -1,10 +1,15 @@
+#include <algorithm>
+#include <cstdlib>
+#include <map>
 #include "triple_store.h"
 #include "patch_tree_addition_value.h"
 #include "patch_tree_key_comparator.h"
 #include "../simpleprogresslistener.h"
 
 
-TripleStore::TripleStore(string base_file_name, std::shared_ptr<DictionaryManager> dict, int8_t kc_opts, bool readonly) : dict(dict) {
+TripleStore::TripleStore(string base_file_name, std::shared_ptr<DictionaryManager> dict, int8_t kc_opts, bool readonly,
+                         std::shared_ptr<BufferPool> buffer_pool)
+        : dict(dict), buffer_pool(buffer_pool), page_cache_capacity(0) {
     // Construct trees
     index_spo_deletions = new kyotocabinet::TreeDB();
     index_pos_deletions = new kyotocabinet::TreeDB();
@@ -32,12 +37,12 @@ TripleStore::TripleStore(string base_file_name, std::shared_ptr<DictionaryManage
     index_osp_additions->tune_options(kc_opts);
 
     // Open the databases
-    open(index_spo_deletions, base_file_name + "_spo_deletions", readonly);
-    open(index_pos_deletions, base_file_name + "_pos_deletions", readonly);
-    open(index_osp_deletions, base_file_name + "_osp_deletions", readonly);
-    open(index_spo_additions, base_file_name + "_spo_additions", readonly);
-    open(index_pos_additions, base_file_name + "_pos_additions", readonly);
-    open(index_osp_additions, base_file_name + "_osp_additions", readonly);
+    open(index_spo_deletions, base_file_name + "_spo_deletions", readonly, BufferPool::SPO_DELETIONS);
+    open(index_pos_deletions, base_file_name + "_pos_deletions", readonly, BufferPool::POS_DELETIONS);
+    open(index_osp_deletions, base_file_name + "_osp_deletions", readonly, BufferPool::OSP_DELETIONS);
+    open(index_spo_additions, base_file_name + "_spo_additions", readonly, BufferPool::SPO_ADDITIONS);
+    open(index_pos_additions, base_file_name + "_pos_additions", readonly, BufferPool::POS_ADDITIONS);
+    open(index_osp_additions, base_file_name + "_osp_additions", readonly, BufferPool::OSP_ADDITIONS);
     if (!count_additions->open(base_file_name + "_count_additions", (readonly ? kyotocabinet::HashDB::OREADER : (kyotocabinet::HashDB::OWRITER | kyotocabinet::HashDB::OCREATE)) | kyotocabinet::HashDB::ONOREPAIR)) {
         cerr << "Open addition count tree error: " << count_additions->error().name() << endl;
     }
@@ -78,10 +83,12 @@ TripleStore::~TripleStore() {
     delete element_comparator;
 }
 
-void TripleStore::open(kyotocabinet::TreeDB* db, string name, bool readonly) {
+void TripleStore::open(kyotocabinet::TreeDB* db, string name, bool readonly, BufferPool::TreeKind kind) {
     db->tune_map(KC_MEMORY_MAP_SIZE);
     //db->tune_buckets(1LL * 1000 * 1000);
-    db->tune_page_cache(KC_PAGE_CACHE_SIZE);
+    size_t page_cache_size = buffer_pool == nullptr ? KC_PAGE_CACHE_SIZE : buffer_pool->get_page_cache_size(kind);
+    db->tune_page_cache(page_cache_size);
+    page_cache_capacity += page_cache_size;
     db->tune_defrag(8);
     if (!db->open(name, (readonly ? kyotocabinet::TreeDB::OREADER : (kyotocabinet::TreeDB::OWRITER | kyotocabinet::TreeDB::OCREATE)) | kyotocabinet::TreeDB::ONOREPAIR)) {
         cerr << "open " << name << " error: " << db->error().name() << endl;
@@ -95,28 +102,57 @@ void TripleStore::close(kyotocabinet::TreeDB* db, string name) {
     delete db;
 }
 
+size_t TripleStore::get_memory_footprint() {
+    return page_cache_capacity;
+}
+
+std::vector<TreeMetrics> TripleStore::get_tree_metrics() {
+    std::vector<TreeMetrics> metrics;
+    for (kyotocabinet::TreeDB* db : {index_spo_deletions, index_pos_deletions, index_osp_deletions,
+                                     index_spo_additions, index_pos_additions, index_osp_additions}) {
+        // The cache usage is only calculated when it is requested
+        std::map<std::string, std::string> status;
+        status["cusage"] = "";
+        status["cusage_lcnt"] = "";
+        if (!db->status(&status)) {
+            continue;
+        }
+        TreeMetrics tree;
+        std::string path = db->path();
+        tree.name = path.substr(path.find_last_of('/') + 1);
+        tree.records = db->count();
+        tree.file_size = db->size();
+        tree.page_cache_usage = std::strtoull(status["cusage"].c_str(), nullptr, 10);
+        tree.page_cache_capacity = std::strtoull(status["pccap"].c_str(), nullptr, 10);
+        tree.leaves = std::strtoull(status["lcnt"].c_str(), nullptr, 10);
+        tree.cached_leaves = std::strtoull(status["cusage_lcnt"].c_str(), nullptr, 10);
+        metrics.push_back(tree);
+    }
+    return metrics;
+}
+
 kyotocabinet::TreeDB* TripleStore::getAdditionsTree(Triple triple_pattern) {
     hdt::TripleComponentOrder order = get_query_order(triple_pattern);
 
-    if(order == hdt::OSP) return index_osp_additions;
-    if(order == hdt::POS) return index_pos_additions;
-    return index_spo_additions;
+    if(order == hdt::OSP) return accessed(index_osp_additions, BufferPool::OSP_ADDITIONS);
+    if(order == hdt::POS) return accessed(index_pos_additions, BufferPool::POS_ADDITIONS);
+    return accessed(index_spo_additions, BufferPool::SPO_ADDITIONS);
 }
 
 kyotocabinet::TreeDB* TripleStore::getDefaultAdditionsTree() {
-    return index_spo_additions;
+    return accessed(index_spo_additions, BufferPool::SPO_ADDITIONS);
 }
 
 kyotocabinet::TreeDB* TripleStore::getDeletionsTree(Triple triple_pattern) {
     hdt::TripleComponentOrder order = get_query_order(triple_pattern);
 
-    if(order == hdt::OSP) return index_osp_deletions;
-    if(order == hdt::POS) return index_pos_deletions;
-    return index_spo_deletions;
+    if(order == hdt::OSP) return accessed(index_osp_deletions, BufferPool::OSP_DELETIONS);
+    if(order == hdt::POS) return accessed(index_pos_deletions, BufferPool::POS_DELETIONS);
+    return accessed(index_spo_deletions, BufferPool::SPO_DELETIONS);
 }
 
 kyotocabinet::TreeDB* TripleStore::getDefaultDeletionsTree() {
-    return index_spo_deletions;
+    return accessed(index_spo_deletions, BufferPool::SPO_DELETIONS);
 }
 
 void TripleStore::insertAdditionSingle(const PatchTreeKey* key, const PatchTreeAdditionValue* value, kyotocabinet::DB::Cursor* cursor) {
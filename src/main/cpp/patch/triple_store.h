@@ -8,6 +8,7 @@
 #include "../dictionary/dictionary_manager.h"
 #include "patch_tree_key_comparator.h"
 #include "patch_tree_addition_value.h"
+#include "buffer_pool.h"
 
 
 // The amount of triples after which the store should be flushed to disk, to avoid memory issues
@@ -22,11 +23,29 @@
 #ifndef KC_PAGE_CACHE_SIZE
 #define KC_PAGE_CACHE_SIZE (1LL << 25)
 #endif
+// The number of KC trees that are opened per triple store
+#define KC_TREE_COUNT 6
 // The minimum addition triple count so that it will be stored in the db
 #ifndef MIN_ADDITION_COUNT
 #define MIN_ADDITION_COUNT 100
 #endif
 
+/**
+ * The state of a KC tree, as reported by KC.
+ */
+struct TreeMetrics {
+    // The file of the tree
+    std::string name;
+    int64_t records;
+    int64_t file_size;
+    // The number of bytes in the page cache, and its capacity
+    size_t page_cache_usage;
+    size_t page_cache_capacity;
+    // The number of leaf pages, and how many of them are in the page cache
+    size_t leaves;
+    size_t cached_leaves;
+};
+
 class TripleStore {
 private:
     kyotocabinet::TreeDB* index_spo_deletions;
@@ -45,12 +64,32 @@ private:
     PatchElementComparator* element_comparator;
     int flush_counter_additions = 0;
     int flush_counter_deletions = 0;
+    std::shared_ptr<BufferPool> buffer_pool;
+    size_t page_cache_capacity;
 protected:
-    void open(kyotocabinet::TreeDB* db, string name, bool readonly);
+    void open(kyotocabinet::TreeDB* db, string name, bool readonly, BufferPool::TreeKind kind);
     void close(kyotocabinet::TreeDB* db, string name);
     void increment_addition_count(const TripleVersion& triple_version);
+    /**
+     * Count an access to the given tree in the buffer pool, which sizes the page caches of trees that are opened later on.
+     */
+    inline kyotocabinet::TreeDB* accessed(kyotocabinet::TreeDB* db, BufferPool::TreeKind kind) {
+        if (buffer_pool != nullptr) {
+            buffer_pool->record_access(kind);
+        }
+        return db;
+    }
 public:
-    TripleStore(string base_file_name, std::shared_ptr<DictionaryManager> dict, int8_t kc_opts = 0, bool readonly = false);
+    /**
+     * @param base_file_name The prefix of the KC files
+     * @param dict The dictionary
+     * @param kc_opts KC tree options
+     * @param readonly If the trees should be opened in read-only mode
+     * @param buffer_pool The pool that determines the page cache size of each of the KC trees,
+     *                    if null, each tree gets KC_PAGE_CACHE_SIZE.
+     */
+    TripleStore(string base_file_name, std::shared_ptr<DictionaryManager> dict, int8_t kc_opts = 0, bool readonly = false,
+                std::shared_ptr<BufferPool> buffer_pool = nullptr);
     ~TripleStore();
     kyotocabinet::TreeDB* getAdditionsTree(Triple triple_pattern);
     kyotocabinet::TreeDB* getDefaultAdditionsTree();
@@ -63,6 +102,16 @@ public:
     long flush_addition_counts();
     void insertDeletionSingle(const PatchTreeKey* key, const PatchTreeDeletionValue* value, const PatchTreeDeletionValueReduced* value_reduced, kyotocabinet::DB::Cursor* cursor = nullptr);
     void insertDeletionSingle(const PatchTreeKey* key, const PatchPositions& patch_positions, int patch_id, bool local_change, bool ignore_existing, kyotocabinet::DB::Cursor* cursor = nullptr);
+    /**
+     * The page caches are charged at the capacity they were opened with, as they grow up to it while the trees are used.
+     * The memory maps are left out, their pages belong to the OS page cache.
+     * @return The number of bytes that the page caches of the KC trees can use.
+     */
+    size_t get_memory_footprint();
+    /**
+     * @return The state of each of the KC trees.
+     */
+    std::vector<TreeMetrics> get_tree_metrics();
     /**
      * @return The comparator for this patch tree in SPO order.
      */
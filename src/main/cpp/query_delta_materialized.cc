@@ -7,6 +7,7 @@
 #include "../../main/cpp/snapshot/snapshot_manager.h"
 #include "../../main/cpp/snapshot/vector_triple_iterator.h"
 #include "../../main/cpp/controller/controller.h"
+#include "../../main/cpp/query_trace.h"
 
 #define BASEURI "<http://example.org>"
 
@@ -35,8 +36,13 @@ int main(int argc, char** argv) {
     // Construct query
     StringTriple triple_pattern(s, p, o);
 
+    // Collect a trace if the library is compiled with OSTRICH_TRACE
+    QueryTrace trace(s + " " + p + " " + o);
+    QueryTraceScope trace_scope(&trace);
+
     std::pair<size_t, hdt::ResultEstimationType> count = controller.get_delta_materialized_count(triple_pattern, patch_id_start, patch_id_end, true);
     std::cerr << "Count: " << count.first << (count.second == hdt::EXACT ? "" : " (estimate)") << std::endl;
+    std::cerr << "Plan: " << controller.plan_delta_materialized(triple_pattern, patch_id_start, patch_id_end).to_string() << std::endl;
 
     TripleDeltaIterator* it = controller.get_delta_materialized(triple_pattern, offset, patch_id_start, patch_id_end);
     TripleDelta triple_delta;
@@ -45,5 +51,10 @@ int main(int argc, char** argv) {
     }
     delete it;
 
+    const char* trace_file = std::getenv("OSTRICH_TRACE_FILE");
+    if (trace_file != nullptr) {
+        trace.write_chrome_trace(std::string(trace_file));
+    }
+
     return 0;
 }
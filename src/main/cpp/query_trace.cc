@@ -0,0 +1,125 @@
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+#include <sstream>
+#include "query_trace.h"
+
+namespace {
+    const char* counter_names[TRACE_COUNTER_COUNT] = {"kc_cursor_steps", "values_deserialized", "terms_decoded",
+                                                       "snapshot_triples", "additions_iterated", "deltas_iterated",
+                                                       "versions_iterated"};
+
+    std::string escape_json(const std::string& value) {
+        std::ostringstream out;
+        for (char c : value) {
+            switch (c) {
+                case '"': out << "\\\""; break;
+                case '\\': out << "\\\\"; break;
+                case '\n': out << "\\n"; break;
+                case '\t': out << "\\t"; break;
+                default:
+                    if ((unsigned char) c < 0x20) {
+                        out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int) c << std::dec;
+                    } else {
+                        out << c;
+                    }
+            }
+        }
+        return out.str();
+    }
+}
+
+thread_local QueryTrace* QueryTrace::active = nullptr;
+
+QueryTrace::QueryTrace(std::string name) : name(std::move(name)), origin(std::chrono::steady_clock::now()), spans(),
+                                           stages(), counters(), depth(0) {
+    counters.fill(0);
+}
+
+double QueryTrace::now() const {
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count();
+}
+
+size_t QueryTrace::get_counter(QueryTraceCounter counter) const {
+    return counters[counter];
+}
+
+const std::vector<QueryTrace::Span>& QueryTrace::get_spans() const {
+    return spans;
+}
+
+std::map<std::string, QueryTrace::Stage> QueryTrace::get_stages() const {
+    // Equal names may be different literals
+    std::map<std::string, Stage> merged;
+    for (const auto& stage : stages) {
+        Stage& total = merged[stage.first];
+        total.count += stage.second.count;
+        total.duration += stage.second.duration;
+    }
+    return merged;
+}
+
+void QueryTrace::write_chrome_trace(std::ostream& out) const {
+    std::ios::fmtflags flags = out.flags();
+    out << std::fixed << std::setprecision(3);
+    out << "{\"traceEvents\":[";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"" << escape_json(name) << "\"}}";
+    for (const Span& span : spans) {
+        out << ",{\"name\":\"" << escape_json(span.name) << "\",\"cat\":\"ostrich\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+            << ",\"ts\":" << span.begin << ",\"dur\":" << span.duration << ",\"args\":{\"depth\":" << span.depth << "}}";
+    }
+    out << ",{\"name\":\"counters\",\"ph\":\"C\",\"pid\":1,\"tid\":1,\"ts\":" << now() << ",\"args\":{";
+    for (int i = 0; i < TRACE_COUNTER_COUNT; i++) {
+        out << (i > 0 ? "," : "") << "\"" << counter_names[i] << "\":" << counters[i];
+    }
+    out << "}}],\"displayTimeUnit\":\"ms\",\"otherData\":{\"query\":\"" << escape_json(name) << "\",\"stages\":{";
+    bool first = true;
+    for (const auto& stage : get_stages()) {
+        out << (first ? "" : ",") << "\"" << escape_json(stage.first) << "\":{\"count\":" << stage.second.count
+            << ",\"duration_us\":" << stage.second.duration << "}";
+        first = false;
+    }
+    out << "}}}";
+    out.flags(flags);
+}
+
+void QueryTrace::write_chrome_trace(const std::string& file_name) const {
+    std::ofstream out(file_name, std::ios::trunc);
+    write_chrome_trace(out);
+    out.close();
+    if (out.fail()) {
+        throw std::runtime_error("Could not write the query trace " + file_name);
+    }
+}
+
+QueryTraceScope::QueryTraceScope(QueryTrace* trace) : previous(QueryTrace::active) {
+    QueryTrace::active = trace;
+}
+
+QueryTraceScope::~QueryTraceScope() {
+    QueryTrace::active = previous;
+}
+
+QueryTraceSpan::QueryTraceSpan(const char* name) : trace(QueryTrace::active), name(name), begin(0), index(0) {
+    if (trace != nullptr) {
+        begin = trace->now();
+        index = trace->spans.size();
+        if (index < QUERY_TRACE_MAX_SPANS) {
+            trace->spans.push_back({name, begin, 0, trace->depth});
+        }
+        trace->depth++;
+    }
+}
+
+QueryTraceSpan::~QueryTraceSpan() {
+    if (trace != nullptr) {
+        double duration = trace->now() - begin;
+        if (index < QUERY_TRACE_MAX_SPANS) {
+            trace->spans[index].duration = duration;
+        }
+        QueryTrace::Stage& stage = trace->stages[name];
+        stage.count++;
+        stage.duration += duration;
+        trace->depth--;
+    }
+}
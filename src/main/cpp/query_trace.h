@@ -0,0 +1,152 @@
+#ifndef TPFPATCH_STORE_QUERY_TRACE_H
+#define TPFPATCH_STORE_QUERY_TRACE_H
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// The maximum number of individual spans that are kept per trace, later spans are only aggregated
+#define QUERY_TRACE_MAX_SPANS 100000
+
+/**
+ * Counters that are kept per query trace.
+ */
+enum QueryTraceCounter {
+    TRACE_KC_CURSOR_STEPS = 0,
+    TRACE_VALUES_DESERIALIZED = 1,
+    TRACE_TERMS_DECODED = 2,
+    // Per-triple steps are counted, as a span per triple would cost more than the step itself
+    TRACE_SNAPSHOT_TRIPLES = 3,
+    TRACE_ADDITIONS_ITERATED = 4,
+    TRACE_DELTAS_ITERATED = 5,
+    TRACE_VERSIONS_ITERATED = 6,
+    TRACE_COUNTER_COUNT = 7
+};
+
+/**
+ * The timings and counters of the stages of a single query.
+ *
+ * A trace is collected on the thread on which it is activated with a QueryTraceScope,
+ * which must include the iteration over the results, as iterators evaluate lazily.
+ * Spans and counters are only recorded when the library is compiled with OSTRICH_TRACE,
+ * otherwise the instrumentation is compiled out.
+ */
+class QueryTrace {
+public:
+    struct Span {
+        const char* name;
+        // Microseconds since the start of the trace
+        double begin;
+        double duration;
+        int depth;
+    };
+    struct Stage {
+        size_t count;
+        // Microseconds, including nested stages
+        double duration;
+    };
+protected:
+    static thread_local QueryTrace* active;
+
+    std::string name;
+    std::chrono::steady_clock::time_point origin;
+    std::vector<Span> spans;
+    // Keyed by the name literal of the spans, so that ending a span does not allocate
+    std::unordered_map<const char*, Stage> stages;
+    std::array<size_t, TRACE_COUNTER_COUNT> counters;
+    int depth;
+
+    friend class QueryTraceScope;
+    friend class QueryTraceSpan;
+public:
+    /**
+     * @param name The name of the query, such as the triple pattern.
+     */
+    explicit QueryTrace(std::string name);
+    /**
+     * @return The trace that is active on the current thread, or null.
+     */
+    static inline QueryTrace* get_active() {
+        return active;
+    }
+    /**
+     * @return The microseconds since the start of the trace.
+     */
+    double now() const;
+    /**
+     * Add to a counter.
+     * @param counter The counter
+     * @param value The value to add
+     */
+    inline void count(QueryTraceCounter counter, size_t value = 1) {
+        counters[counter] += value;
+    }
+    /**
+     * @param counter The counter
+     * @return The value of the counter.
+     */
+    size_t get_counter(QueryTraceCounter counter) const;
+    /**
+     * @return The individual spans, at most QUERY_TRACE_MAX_SPANS.
+     */
+    const std::vector<Span>& get_spans() const;
+    /**
+     * @return The number of times each stage was executed and its total duration.
+     */
+    std::map<std::string, Stage> get_stages() const;
+    /**
+     * Write the spans and counters in the Chrome trace event format,
+     * which can be opened in chrome://tracing or Perfetto.
+     * @param out The stream to write the JSON document to
+     */
+    void write_chrome_trace(std::ostream& out) const;
+    /**
+     * Write the spans and counters in the Chrome trace event format to a file.
+     * @param file_name The file to write to
+     * @throws std::runtime_error If the file could not be written.
+     */
+    void write_chrome_trace(const std::string& file_name) const;
+};
+
+/**
+ * Activates a trace on the current thread while it is in scope.
+ */
+class QueryTraceScope {
+protected:
+    QueryTrace* previous;
+public:
+    explicit QueryTraceScope(QueryTrace* trace);
+    ~QueryTraceScope();
+};
+
+/**
+ * Records the duration of a stage in the active trace while it is in scope, if any.
+ * The name must be a string literal, or otherwise outlive the trace.
+ */
+class QueryTraceSpan {
+protected:
+    QueryTrace* trace;
+    const char* name;
+    double begin;
+    size_t index;
+public:
+    explicit QueryTraceSpan(const char* name);
+    ~QueryTraceSpan();
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+#ifdef OSTRICH_TRACE
+#define TRACE_SPAN(name) QueryTraceSpan TRACE_CONCAT(trace_span_, __LINE__)(name)
+#define TRACE_COUNT(counter, value) \
+    do { QueryTrace* trace_active = QueryTrace::get_active(); if (trace_active != nullptr) trace_active->count((counter), (value)); } while (false)
+#else
+#define TRACE_SPAN(name) do {} while (false)
+#define TRACE_COUNT(counter, value) do {} while (false)
+#endif
+
+#endif //TPFPATCH_STORE_QUERY_TRACE_H
@@ -6,6 +6,7 @@
 #include "../../main/cpp/snapshot/snapshot_manager.h"
 #include "../../main/cpp/snapshot/vector_triple_iterator.h"
 #include "../../main/cpp/controller/controller.h"
+#include "../../main/cpp/query_trace.h"
 
 #define BASEURI "<http://example.org>"
 
@@ -32,6 +33,10 @@ int main(int argc, char** argv) {
     // Construct query
     StringTriple triple_pattern(s, p, o);
 
+    // Collect a trace if the library is compiled with OSTRICH_TRACE
+    QueryTrace trace(s + " " + p + " " + o);
+    QueryTraceScope trace_scope(&trace);
+
     std::pair<size_t, hdt::ResultEstimationType> count = controller.get_version_count(triple_pattern, true);
     cerr << "Count: " << count.first << (count.second == hdt::EXACT ? "" : " (estimate)") << endl;
 
@@ -44,5 +49,10 @@ int main(int argc, char** argv) {
     }
     delete it;
 
+    const char* trace_file = std::getenv("OSTRICH_TRACE_FILE");
+    if (trace_file != nullptr) {
+        trace.write_chrome_trace(std::string(trace_file));
+    }
+
     return 0;
 }
@@ -7,6 +7,7 @@
 #include "../../main/cpp/snapshot/snapshot_manager.h"
 #include "../../main/cpp/snapshot/vector_triple_iterator.h"
 #include "../../main/cpp/controller/controller.h"
+#include "../../main/cpp/query_trace.h"
 
 #define BASEURI "<http://example.org>"
 
@@ -35,6 +36,10 @@ int main(int argc, char** argv) {
     std::shared_ptr<DictionaryManager> dict = controller.get_dictionary_manager(patch_id);
     Triple triple_pattern(s, p, o, dict);
 
+    // Collect a trace if the library is compiled with OSTRICH_TRACE
+    QueryTrace trace(s + " " + p + " " + o);
+    QueryTraceScope trace_scope(&trace);
+
     std::pair<size_t, hdt::ResultEstimationType> count = controller.get_version_materialized_count(triple_pattern, patch_id, true);
     std::cerr << "Count: " << count.first << (count.second == hdt::EXACT ? "" : " (estimate)") << std::endl;
 
@@ -45,5 +50,10 @@ int main(int argc, char** argv) {
     }
     delete it;
 
+    const char* trace_file = std::getenv("OSTRICH_TRACE_FILE");
+    if (trace_file != nullptr) {
+        trace.write_chrome_trace(std::string(trace_file));
+    }
+
     return 0;
 }
@@ -0,0 +1,31 @@
+#include <SingleTriple.hpp>
+#include "materialized_triple_iterator.h"
+
+MaterializedTripleIterator::MaterializedTripleIterator(TripleIteratorFactory factory, std::shared_ptr<DictionaryManager> dict)
+        : factory(std::move(factory)), dict(std::move(dict)), it(nullptr), has_buffer(false) {
+    goToStart();
+}
+
+MaterializedTripleIterator::~MaterializedTripleIterator() {
+    delete it;
+}
+
+void MaterializedTripleIterator::fill_buffer() {
+    has_buffer = it->next(&buffer);
+}
+
+bool MaterializedTripleIterator::hasNext() {
+    return has_buffer;
+}
+
+hdt::TripleString* MaterializedTripleIterator::next() {
+    current.setAll(buffer.get_subject(*dict), buffer.get_predicate(*dict), buffer.get_object(*dict));
+    fill_buffer();
+    return &current;
+}
+
+void MaterializedTripleIterator::goToStart() {
+    delete it;
+    it = factory();
+    fill_buffer();
+}
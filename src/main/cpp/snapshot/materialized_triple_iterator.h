@@ -0,0 +1,36 @@
+#ifndef OSTRICH_MATERIALIZED_TRIPLE_ITERATOR_H
+#define OSTRICH_MATERIALIZED_TRIPLE_ITERATOR_H
+
+#include <functional>
+#include <Triples.hpp>
+#include "../patch/triple_iterator.h"
+
+typedef std::function<TripleIterator*()> TripleIteratorFactory;
+
+// Lazily decodes the triples of a TripleIterator to strings, without buffering them.
+// As HDT consumes the triples more than once during snapshot creation,
+// the inner iterator is recreated through the given factory when going back to the start.
+class MaterializedTripleIterator : public hdt::IteratorTripleString {
+private:
+    TripleIteratorFactory factory;
+    std::shared_ptr<DictionaryManager> dict;
+    TripleIterator* it;
+    Triple buffer;
+    bool has_buffer;
+    hdt::TripleString current;
+
+    void fill_buffer();
+public:
+    /**
+     * @param factory Function that creates a new iterator over the triples, starting from the first one.
+     * @param dict The dictionary to decode the triples with.
+     */
+    MaterializedTripleIterator(TripleIteratorFactory factory, std::shared_ptr<DictionaryManager> dict);
+    ~MaterializedTripleIterator() override;
+    bool hasNext() override;
+    hdt::TripleString *next() override;
+    void goToStart() override;
+};
+
+
+#endif //OSTRICH_MATERIALIZED_TRIPLE_ITERATOR_H
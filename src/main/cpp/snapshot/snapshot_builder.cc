@@ -0,0 +1,136 @@
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <HDTVocabulary.hpp>
+#include <dictionary/PlainDictionary.hpp>
+#include <dictionary/FourSectionDictionary.hpp>
+#include <triples/TriplesList.hpp>
+#include <triples/BitmapTriples.hpp>
+#include <header/PlainHeader.hpp>
+#include "snapshot_builder.h"
+#include "../simpleprogresslistener.h"
+
+SnapshotBuilder::SnapshotBuilder(std::shared_ptr<DictionaryManager> dict, hdt::ProgressListener* listener)
+        : dict(std::move(dict)), listener(listener) {}
+
+void SnapshotBuilder::mark(std::vector<size_t>& map, size_t id) {
+    if (id >= map.size()) {
+        map.resize(std::max(id + 1, map.size() * 2), 0);
+    }
+    map[id] = 1;
+}
+
+std::vector<size_t>& SnapshotBuilder::get_map(hdt::TripleComponentRole role) {
+    switch (role) {
+        case hdt::SUBJECT:
+            return subject_map;
+        case hdt::PREDICATE:
+            return predicate_map;
+        default:
+            return object_map;
+    }
+}
+
+size_t SnapshotBuilder::build(const TripleIteratorFactory& triples, const std::string& file, const std::string& base_uri) {
+    const hdt::TripleComponentRole roles[] = {hdt::SUBJECT, hdt::PREDICATE, hdt::OBJECT};
+
+    // Find all terms that are still in use
+    NOTIFYMSG(listener, "\nCollecting used terms...\n");
+    Triple t;
+    std::unique_ptr<TripleIterator> it(triples());
+    while (it->next(&t)) {
+        mark(subject_map, t.get_subject());
+        mark(predicate_map, t.get_predicate());
+        mark(object_map, t.get_object());
+    }
+
+    // Merge the used HDT and patch dictionary terms into a new dictionary
+    NOTIFYMSG(listener, "\nBuilding dictionary...\n");
+    std::unique_ptr<hdt::PlainDictionary> plain_dict(new hdt::PlainDictionary());
+    plain_dict->startProcessing();
+    for (hdt::TripleComponentRole role : roles) {
+        std::vector<size_t>& map = get_map(role);
+        for (size_t id = 1; id < map.size(); id++) {
+            if (map[id]) {
+                plain_dict->insert(dict->idToString(id, role), role);
+            }
+        }
+    }
+    plain_dict->stopProcessing();
+    std::unique_ptr<hdt::FourSectionDictionary> new_dict(new hdt::FourSectionDictionary());
+    new_dict->import(plain_dict.get(), listener);
+    plain_dict.reset();
+
+    // Determine the id remapping
+    for (hdt::TripleComponentRole role : roles) {
+        std::vector<size_t>& map = get_map(role);
+        for (size_t id = 1; id < map.size(); id++) {
+            if (map[id]) {
+                map[id] = new_dict->stringToId(dict->idToString(id, role), role);
+            }
+        }
+    }
+
+    // Remap the triples, and sort them in ID space
+    NOTIFYMSG(listener, "\nBuilding triples...\n");
+    std::unique_ptr<hdt::TriplesList> triples_list(new hdt::TriplesList());
+    triples_list->startProcessing(listener);
+    it.reset(triples());
+    while (it->next(&t)) {
+        hdt::TripleID triple_id(subject_map[t.get_subject()], predicate_map[t.get_predicate()], object_map[t.get_object()]);
+        triples_list->insert(triple_id);
+    }
+    it.reset();
+    triples_list->stopProcessing(listener);
+    triples_list->sort(hdt::SPO, listener);
+    triples_list->removeDuplicates(listener);
+    std::unique_ptr<hdt::BitmapTriples> bitmap_triples(new hdt::BitmapTriples());
+    bitmap_triples->load(*triples_list, listener);
+    triples_list.reset();
+    size_t count = bitmap_triples->getNumberOfElements();
+
+    // Header, following the layout of BasicHDT
+    std::string format_node = "_:format";
+    std::string dict_node = "_:dictionary";
+    std::string triples_node = "_:triples";
+    std::unique_ptr<hdt::PlainHeader> header(new hdt::PlainHeader());
+    header->insert(base_uri, hdt::HDTVocabulary::RDF_TYPE, hdt::HDTVocabulary::HDT_DATASET);
+    header->insert(base_uri, hdt::HDTVocabulary::RDF_TYPE, hdt::HDTVocabulary::VOID_DATASET);
+    header->insert(base_uri, hdt::HDTVocabulary::VOID_TRIPLES, (long long) count);
+    header->insert(base_uri, hdt::HDTVocabulary::VOID_PROPERTIES, (long long) new_dict->getNpredicates());
+    header->insert(base_uri, hdt::HDTVocabulary::VOID_DISTINCT_SUBJECTS, (long long) new_dict->getNsubjects());
+    header->insert(base_uri, hdt::HDTVocabulary::VOID_DISTINCT_OBJECTS, (long long) new_dict->getNobjects());
+    header->insert(base_uri, hdt::HDTVocabulary::HDT_FORMAT_INFORMATION, format_node);
+    header->insert(format_node, hdt::HDTVocabulary::HDT_DICTIONARY, dict_node);
+    header->insert(format_node, hdt::HDTVocabulary::HDT_TRIPLES, triples_node);
+    new_dict->populateHeader(*header, dict_node);
+    bitmap_triples->populateHeader(*header, triples_node);
+
+    // Write the HDT container
+    NOTIFYMSG(listener, "\nSaving snapshot...\n");
+    // Write to a temporary file first, so that a partially written snapshot is never detected
+    std::string tmp_file = file + ".tmp";
+    std::ofstream out(tmp_file.c_str(), std::ios::binary | std::ios::out | std::ios::trunc);
+    if (!out.good()) {
+        throw std::runtime_error("Could not open snapshot file for writing: " + tmp_file);
+    }
+    hdt::ControlInformation ci;
+    ci.setType(hdt::GLOBAL);
+    ci.setFormat(hdt::HDTVocabulary::HDT_CONTAINER);
+    ci.save(out);
+    ci.clear();
+    ci.setType(hdt::HEADER);
+    header->save(out, ci, listener);
+    ci.clear();
+    ci.setType(hdt::DICTIONARY);
+    new_dict->save(out, ci, listener);
+    ci.clear();
+    ci.setType(hdt::TRIPLES);
+    bitmap_triples->save(out, ci, listener);
+    out.close();
+    if (std::rename(tmp_file.c_str(), file.c_str()) != 0) {
+        throw std::runtime_error("Could not move snapshot file to: " + file);
+    }
+
+    return count;
+}
@@ -0,0 +1,47 @@
+#ifndef OSTRICH_SNAPSHOT_BUILDER_H
+#define OSTRICH_SNAPSHOT_BUILDER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <HDTListener.hpp>
+#include "materialized_triple_iterator.h"
+#include "../dictionary/dictionary_manager.h"
+
+/**
+ * Builds a HDT snapshot from a stream of triple IDs encoded with the DictionaryManager of the previous snapshot.
+ *
+ * Instead of decoding every triple and letting HDT parse it again, only the terms that are still in use
+ * (from the HDT dictionary and the patch dictionary) are decoded once to build the new dictionary.
+ * The triples are then remapped to the new IDs and sorted in ID space to produce the bitmap triples.
+ */
+class SnapshotBuilder {
+private:
+    std::shared_ptr<DictionaryManager> dict;
+    hdt::ProgressListener* listener;
+
+    // Maps the old ids of one triple component to the new ids, 0 means unused.
+    std::vector<size_t> subject_map;
+    std::vector<size_t> predicate_map;
+    std::vector<size_t> object_map;
+
+    static inline void mark(std::vector<size_t>& map, size_t id);
+    std::vector<size_t>& get_map(hdt::TripleComponentRole role);
+public:
+    /**
+     * @param dict The dictionary the triple IDs are encoded with.
+     * @param listener An optional progress listener.
+     */
+    explicit SnapshotBuilder(std::shared_ptr<DictionaryManager> dict, hdt::ProgressListener* listener = nullptr);
+    /**
+     * Build a HDT file.
+     * @param triples Factory for the triple stream, this will be called twice, once for the dictionary and once for the triples.
+     * @param file The HDT file to write to.
+     * @param base_uri The base uri for the triples graph.
+     * @return The number of triples in the new snapshot.
+     */
+    size_t build(const TripleIteratorFactory& triples, const std::string& file, const std::string& base_uri);
+};
+
+
+#endif //OSTRICH_SNAPSHOT_BUILDER_H
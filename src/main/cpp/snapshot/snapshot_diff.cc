@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "snapshot_diff.h"
+#include "../patch/triple_comparator.h"
+
+#define SNAPSHOT_DIFF_MAGIC "OSTSDF01"
+#define SNAPSHOT_DIFF_HEADER_SIZE (8 + 3 * 8)
+#define SNAPSHOT_DIFF_ADDITION_FLAG (1ULL << 63)
+
+namespace {
+    const hdt::TripleComponentOrder diff_orders[3] = {hdt::SPO, hdt::POS, hdt::OSP};
+
+    // The component at the given place in the order, 0 is the first component
+    size_t get_component(const Triple& triple, hdt::TripleComponentOrder order, int place, hdt::TripleComponentRole* role) {
+        static const hdt::TripleComponentRole roles[3][3] = {
+                {hdt::SUBJECT, hdt::PREDICATE, hdt::OBJECT},
+                {hdt::PREDICATE, hdt::OBJECT, hdt::SUBJECT},
+                {hdt::OBJECT, hdt::SUBJECT, hdt::PREDICATE},
+        };
+        *role = roles[order == hdt::POS ? 1 : (order == hdt::OSP ? 2 : 0)][place];
+        return *role == hdt::SUBJECT ? triple.get_subject() : (*role == hdt::PREDICATE ? triple.get_predicate() : triple.get_object());
+    }
+
+    void write_uint64(std::ofstream& out, uint64_t value) {
+        out.write((const char*) &value, sizeof(value));
+    }
+}
+
+SnapshotDiff::SnapshotDiff(const std::string& file_name)
+        : file_name(file_name), mapping(nullptr), mapping_size(0), from_snapshot(-1), to_snapshot(-1), count(0), elements() {
+    int fd = open(file_name.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open the snapshot diff " + file_name);
+    }
+    struct stat sb{};
+    if (fstat(fd, &sb) != 0 || (size_t) sb.st_size < SNAPSHOT_DIFF_HEADER_SIZE) {
+        close(fd);
+        throw std::runtime_error("Invalid snapshot diff " + file_name);
+    }
+    mapping_size = (size_t) sb.st_size;
+    void* ptr = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        throw std::runtime_error("Could not map the snapshot diff " + file_name);
+    }
+    mapping = (unsigned char*) ptr;
+
+    const auto* header = (const uint64_t*) (mapping + 8);
+    from_snapshot = (int) header[0];
+    to_snapshot = (int) header[1];
+    count = header[2];
+    if (std::memcmp(mapping, SNAPSHOT_DIFF_MAGIC, 8) != 0 || SNAPSHOT_DIFF_HEADER_SIZE + 3 * count * 3 * 8 != mapping_size) {
+        munmap(mapping, mapping_size);
+        mapping = nullptr;
+        throw std::runtime_error("Invalid snapshot diff " + file_name);
+    }
+    for (size_t i = 0; i < 3; i++) {
+        elements[i] = (const uint64_t*) (mapping + SNAPSHOT_DIFF_HEADER_SIZE) + i * count * 3;
+    }
+}
+
+SnapshotDiff::~SnapshotDiff() {
+    if (mapping != nullptr) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+size_t SnapshotDiff::order_index(hdt::TripleComponentOrder order) {
+    switch (order) {
+        case hdt::POS: return 1;
+        case hdt::OSP: return 2;
+        default: return 0;
+    }
+}
+
+int SnapshotDiff::get_from_snapshot() const {
+    return from_snapshot;
+}
+
+int SnapshotDiff::get_to_snapshot() const {
+    return to_snapshot;
+}
+
+size_t SnapshotDiff::get_count() const {
+    return count;
+}
+
+bool SnapshotDiff::get(size_t position, hdt::TripleComponentOrder order, Triple* triple) const {
+    const uint64_t* element = elements[order_index(order)] + position * 3;
+    triple->set_subject(element[0] & ~SNAPSHOT_DIFF_ADDITION_FLAG);
+    triple->set_predicate(element[1]);
+    triple->set_object(element[2]);
+    return (element[0] & SNAPSHOT_DIFF_ADDITION_FLAG) != 0;
+}
+
+std::pair<size_t, size_t> SnapshotDiff::find(const Triple& triple_pattern, hdt::TripleComponentOrder order, DictionaryManager& dict) const {
+    hdt::TripleComponentOrder diff_order = diff_orders[order_index(order)];
+    // The bound components of the pattern are a prefix of the order
+    int bound = 0;
+    hdt::TripleComponentRole role;
+    while (bound < 3 && get_component(triple_pattern, diff_order, bound, &role) > 0) {
+        bound++;
+    }
+    auto compare_prefix = [&](size_t position) {
+        Triple triple;
+        get(position, diff_order, &triple);
+        for (int place = 0; place < bound; place++) {
+            hdt::TripleComponentRole component_role;
+            size_t component = get_component(triple, diff_order, place, &component_role);
+            size_t pattern_component = get_component(triple_pattern, diff_order, place, &component_role);
+            if (component != pattern_component) {
+                return dict.compareComponent(component, pattern_component, component_role) < 0 ? -1 : 1;
+            }
+        }
+        return 0;
+    };
+
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (compare_prefix(middle) < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    size_t start = low;
+    high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (compare_prefix(middle) <= 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return std::make_pair(start, low);
+}
+
+void SnapshotDiff::write(const std::string& file_name, int from_snapshot, int to_snapshot,
+                         const std::vector<std::pair<Triple, bool>>& elements, std::shared_ptr<DictionaryManager> dict) {
+    std::string tmp_file_name = file_name + ".tmp";
+    std::ofstream out(tmp_file_name, std::ios::binary | std::ios::trunc);
+    out.write(SNAPSHOT_DIFF_MAGIC, 8);
+    write_uint64(out, (uint64_t) from_snapshot);
+    write_uint64(out, (uint64_t) to_snapshot);
+    write_uint64(out, elements.size());
+
+    std::vector<std::pair<Triple, bool>> sorted(elements);
+    for (hdt::TripleComponentOrder order : diff_orders) {
+        std::unique_ptr<TripleComparator> comparator(TripleComparator::get_triple_comparator(order, dict, dict));
+        std::sort(sorted.begin(), sorted.end(), [&comparator](const std::pair<Triple, bool>& e1, const std::pair<Triple, bool>& e2) {
+            return (*comparator)(e1.first, e2.first);
+        });
+        for (auto& element : sorted) {
+            write_uint64(out, element.first.get_subject() | (element.second ? SNAPSHOT_DIFF_ADDITION_FLAG : 0));
+            write_uint64(out, element.first.get_predicate());
+            write_uint64(out, element.first.get_object());
+        }
+    }
+    out.close();
+    if (out.fail() || std::rename(tmp_file_name.c_str(), file_name.c_str()) != 0) {
+        std::remove(tmp_file_name.c_str());
+        throw std::runtime_error("Could not write the snapshot diff " + file_name);
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef TPFPATCH_STORE_SNAPSHOT_DIFF_H
+#define TPFPATCH_STORE_SNAPSHOT_DIFF_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "../patch/triple.h"
+#include "../dictionary/dictionary_manager.h"
+
+#define SNAPSHOT_DIFF_FILENAME(from, to) ("snapshotdiff_" + std::to_string(from) + "_" + std::to_string(to) + ".dat")
+
+/**
+ * A memory-mapped diff between two consecutive snapshots, that is stored when the second snapshot is created.
+ *
+ * The additions and deletions are encoded with the dictionary of the first snapshot,
+ * and are stored sorted in SPO, POS and OSP order, so that a triple pattern can be answered with a range lookup.
+ * Each element is stored as three IDs, where the highest bit of the subject marks an addition.
+ */
+class SnapshotDiff {
+protected:
+    std::string file_name;
+    unsigned char* mapping;
+    size_t mapping_size;
+    int from_snapshot;
+    int to_snapshot;
+    uint64_t count;
+    std::array<const uint64_t*, 3> elements;
+
+    static size_t order_index(hdt::TripleComponentOrder order);
+public:
+    /**
+     * Map the given file into memory.
+     * @param file_name The file to map
+     * @throws std::runtime_error If the file can not be mapped or is invalid.
+     */
+    explicit SnapshotDiff(const std::string& file_name);
+    ~SnapshotDiff();
+    /**
+     * @return The id of the first snapshot, whose dictionary encodes the elements.
+     */
+    int get_from_snapshot() const;
+    /**
+     * @return The id of the second snapshot.
+     */
+    int get_to_snapshot() const;
+    /**
+     * @return The number of additions and deletions.
+     */
+    size_t get_count() const;
+    /**
+     * Find the elements that match a triple pattern.
+     * @param triple_pattern The triple pattern, encoded with the dictionary of the first snapshot
+     * @param order SPO, POS or OSP, the bound components of the pattern must be a prefix of it
+     * @param dict The dictionary of the first snapshot
+     * @return The range of positions in the given order, end exclusive.
+     */
+    std::pair<size_t, size_t> find(const Triple& triple_pattern, hdt::TripleComponentOrder order, DictionaryManager& dict) const;
+    /**
+     * @param position The position in the given order
+     * @param order SPO, POS or OSP
+     * @param triple The triple to fill in
+     * @return If the element is an addition.
+     */
+    bool get(size_t position, hdt::TripleComponentOrder order, Triple* triple) const;
+    /**
+     * Write a diff file.
+     * @param file_name The file to write to
+     * @param from_snapshot The id of the first snapshot
+     * @param to_snapshot The id of the second snapshot
+     * @param elements The additions and deletions, in any order
+     * @param dict The dictionary of the first snapshot
+     * @throws std::runtime_error If the file could not be written.
+     */
+    static void write(const std::string& file_name, int from_snapshot, int to_snapshot,
+                      const std::vector<std::pair<Triple, bool>>& elements, std::shared_ptr<DictionaryManager> dict);
+};
+
+#endif //TPFPATCH_STORE_SNAPSHOT_DIFF_H
@@ -1,17 +1,36 @@
 #include <HDTManager.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iostream>
 #include <regex>
+#include <thread>
+#include <tuple>
 #include <dirent.h>
 #include <hdt/BasicHDT.hpp>
 #include "snapshot_manager.h"
 #include "../patch/triple_store.h"
 #include "sorted_triple_iterator.h"
+#include "snapshot_builder.h"
+#include "../simpleprogresslistener.h"
+#include "../query_trace.h"
 
 
 SnapshotManager::SnapshotManager(std::string basePath, bool readonly, size_t cache_size) : basePath(basePath), max_loaded_snapshots(std::max((size_t)2,cache_size)), readonly(readonly) {
     detect_snapshots();
 }
 
-SnapshotManager::~SnapshotManager() = default;
+SnapshotManager::~SnapshotManager() {
+    {
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        for (auto& task : preload_tasks) {
+            task.wait();
+        }
+    }
+    set_memory_budget(nullptr);
+}
 
 int SnapshotManager::get_latest_snapshot(int patch_id) {
     std::shared_lock<std::shared_mutex> lock(mutex);
@@ -35,31 +54,144 @@ int SnapshotManager::get_latest_snapshot(int patch_id) {
 }
 
 std::shared_ptr<hdt::HDT> SnapshotManager::load_snapshot(int snapshot_id) {
+    std::promise<void> loaded;
+    std::shared_future<void> loading;
+    int previous_id = -1;
+    bool inserted = false;
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        // We check if a snapshot is already loaded for the given snapshot_id
+        auto it = loaded_snapshots.find(snapshot_id);
+        if (it != loaded_snapshots.end() && it->second) {
+            cache_counters.hit();
+            return it->second;
+        }
+        auto loading_it = loading_snapshots.find(snapshot_id);
+        if (loading_it != loading_snapshots.end()) {
+            loading = loading_it->second;
+        } else {
+            loading_snapshots[snapshot_id] = loaded.get_future().share();
+            std::tie(it, inserted) = loaded_snapshots.emplace(snapshot_id, nullptr);
+            if (it != loaded_snapshots.begin()) {
+                previous_id = std::prev(it)->first;
+            }
+        }
+    }
+    if (loading.valid()) {
+        // Another thread is loading this snapshot, rethrows its exception if it failed
+        loading.get();
+        return load_snapshot(snapshot_id);
+    }
+
+    // The file is mapped, and indexed if needed, without holding the lock, so that snapshots can be loaded in parallel
+    std::shared_ptr<hdt::HDT> snapshot;
+    std::shared_ptr<DictionaryManager> dict;
+    auto start = std::chrono::steady_clock::now();
+    try {
+        std::tie(snapshot, dict) = open_snapshot_files(snapshot_id, previous_id);
+    } catch (...) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        loading_snapshots.erase(snapshot_id);
+        if (inserted) {
+            // No snapshot file was detected for this id
+            loaded_snapshots.erase(snapshot_id);
+        }
+        loaded.set_exception(std::current_exception());
+        throw;
+    }
+
+    std::chrono::duration<double> duration = std::chrono::steady_clock::now() - start;
+
     std::unique_lock<std::shared_mutex> lock(mutex);
-    std::shared_ptr<hdt::HDT> snapshot = nullptr;
-    // We check if a snapshot is already loaded for the given snapshot_id
-    auto it = loaded_snapshots.find(snapshot_id);
-    if (it != loaded_snapshots.end() && it->second) {
-        snapshot = it->second;
+    loaded_snapshots[snapshot_id] = snapshot;
+    loaded_dictionaries[snapshot_id] = dict;
+    reload_costs[snapshot_id] = duration.count();
+    cache_counters.loaded(duration.count());
+    update_cache(snapshot_id);
+    loading_snapshots.erase(snapshot_id);
+    loaded.set_value();
+    return snapshot;
+}
+
+std::pair<std::shared_ptr<hdt::HDT>, std::shared_ptr<DictionaryManager>> SnapshotManager::open_snapshot_files(int snapshot_id, int previous_id) {
+    std::string fileName = basePath + SNAPSHOT_FILENAME_BASE(snapshot_id);
+    std::shared_ptr<hdt::HDT> snapshot = std::shared_ptr<hdt::HDT>(hdt::HDTManager::mapIndexedHDT(fileName.c_str()));
+
+    // load dictionary as well
+    std::shared_ptr<DictionaryManager> dict = std::make_shared<DictionaryManager>(basePath, snapshot_id, snapshot->getDictionary(), readonly);
+    if (previous_id >= 0) {
+        dict->setTranslationMap(load_translation_map(previous_id, snapshot_id));
     }
+    return std::make_pair(snapshot, dict);
+}
+
+std::pair<std::shared_ptr<hdt::HDT>, std::shared_ptr<DictionaryManager>> SnapshotManager::open_snapshot(int snapshot_id) {
+    return open_snapshot_files(snapshot_id, get_latest_snapshot(snapshot_id - 1));
+}
 
-    if (snapshot == nullptr) {
-        std::string fileName = basePath + SNAPSHOT_FILENAME_BASE(snapshot_id);
-        loaded_snapshots[snapshot_id] = std::shared_ptr<hdt::HDT>(hdt::HDTManager::mapIndexedHDT(fileName.c_str()));
+void SnapshotManager::register_snapshot(int snapshot_id, std::shared_ptr<hdt::HDT> snapshot, std::shared_ptr<DictionaryManager> dict,
+                                        double reload_cost) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    loaded_snapshots[snapshot_id] = snapshot;
+    loaded_dictionaries[snapshot_id] = dict;
+    reload_costs[snapshot_id] = reload_cost;
+    update_cache(snapshot_id);
+}
 
-        // load dictionary as well
-        loaded_dictionaries[snapshot_id] = std::make_shared<DictionaryManager>(basePath, snapshot_id, loaded_snapshots[snapshot_id]->getDictionary(), readonly);
+void SnapshotManager::preload_snapshots(const std::vector<int>& snapshot_ids, bool wait) {
+    auto ids = std::make_shared<std::vector<int>>();
+    {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        for (int snapshot_id : snapshot_ids) {
+            auto it = loaded_snapshots.emplace(snapshot_id, nullptr).first;
+            loaded_dictionaries.emplace(snapshot_id, nullptr);
+            if (it->second == nullptr) {
+                ids->push_back(snapshot_id);
+            }
+        }
+    }
+    if (ids->empty()) {
+        return;
+    }
 
-        update_cache(snapshot_id);
-        snapshot = loaded_snapshots[snapshot_id];
+    // A fixed number of workers take the next snapshot to load
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+    size_t workers = std::min(ids->size(), (size_t) std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<std::future<void>> tasks;
+    for (size_t i = 0; i < workers; i++) {
+        tasks.push_back(std::async(std::launch::async, [this, ids, next]() {
+            size_t index;
+            while ((index = next->fetch_add(1)) < ids->size()) {
+                try {
+                    load_snapshot((*ids)[index]);
+                } catch (const std::exception& e) {
+                    std::cerr << "Could not preload snapshot " << (*ids)[index] << ": " << e.what() << std::endl;
+                }
+            }
+        }));
+    }
+    if (wait) {
+        for (auto& task : tasks) {
+            task.wait();
+        }
+    } else {
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        preload_tasks.erase(std::remove_if(preload_tasks.begin(), preload_tasks.end(), [](const std::future<void>& task) {
+            return task.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }), preload_tasks.end());
+        for (auto& task : tasks) {
+            preload_tasks.push_back(std::move(task));
+        }
     }
+}
 
-    return snapshot;
+void SnapshotManager::build_index(int snapshot_id) {
+    // Mapping a file with an index generates and saves the index if it does not exist yet
+    delete hdt::HDTManager::mapIndexedHDT((basePath + SNAPSHOT_FILENAME_BASE(snapshot_id)).c_str());
 }
 
 std::shared_ptr<hdt::HDT> SnapshotManager::get_snapshot(int snapshot_id) {
     std::shared_ptr<hdt::HDT> snapshot = nullptr;
-    int sid = 0;
     if(snapshot_id < 0) {
         return snapshot;
     }
@@ -73,31 +205,36 @@ std::shared_ptr<hdt::HDT> SnapshotManager::get_snapshot(int snapshot_id) {
             it--;
         }
         snapshot = it->second;
-        sid = it->first;
-    }
-    if(snapshot == nullptr) {
-        return load_snapshot(snapshot_id);
+        if (snapshot != nullptr) {
+            // A cache hit only marks the snapshot as used, so concurrent queries never wait for each other
+            cache_policy.touch(it->first);
+            cache_counters.hit();
+            return snapshot;
+        }
     }
-    std::unique_lock<std::shared_mutex> x_lock(mutex);
-    update_cache(sid);
-    return snapshot;
+    return load_snapshot(snapshot_id);
 }
 
 std::shared_ptr<hdt::HDT> SnapshotManager::create_snapshot(int snapshot_id, hdt::IteratorTripleString* triples, std::string base_uri, hdt::ProgressListener* listener) {
+    bool exists;
     {
-        std::unique_lock<std::shared_mutex> lock(mutex);
-        auto it = loaded_snapshots.find(snapshot_id);
-        if (it == loaded_snapshots.end()) {
-            auto *basicHdt = new hdt::BasicHDT();
-            basicHdt->loadFromTriples(triples, base_uri, listener);
-            basicHdt->saveToHDT((basePath + SNAPSHOT_FILENAME_BASE(snapshot_id)).c_str());
-            delete basicHdt;
-        }
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        exists = loaded_snapshots.find(snapshot_id) != loaded_snapshots.end();
+    }
+    // The lock is not held while building the HDT file,
+    // because the triples may be lazily streamed from the other snapshots of this manager.
+    if (!exists) {
+        auto *basicHdt = new hdt::BasicHDT();
+        basicHdt->loadFromTriples(triples, base_uri, listener);
+        basicHdt->saveToHDT((basePath + SNAPSHOT_FILENAME_BASE(snapshot_id)).c_str());
+        delete basicHdt;
+        build_translation_map(snapshot_id);
     }
     return load_snapshot(snapshot_id);
 }
 
 std::shared_ptr<hdt::HDT> SnapshotManager::create_snapshot(int snapshot_id, std::string triples_file, std::string base_uri, hdt::RDFNotation notation) {
+    bool created = false;
     {
         std::unique_lock<std::shared_mutex> lock(mutex);
         auto it = loaded_snapshots.find(snapshot_id);
@@ -106,11 +243,62 @@ std::shared_ptr<hdt::HDT> SnapshotManager::create_snapshot(int snapshot_id, std:
             basicHdt->loadFromRDF(triples_file.c_str(), base_uri, notation);
             basicHdt->saveToHDT((basePath + SNAPSHOT_FILENAME_BASE(snapshot_id)).c_str());
             delete basicHdt;
+            created = true;
         }
     }
+    if (created) {
+        build_translation_map(snapshot_id);
+    }
     return load_snapshot(snapshot_id);
 }
 
+std::shared_ptr<hdt::HDT> SnapshotManager::create_snapshot(int snapshot_id, const TripleIteratorFactory& triples, std::shared_ptr<DictionaryManager> dict, std::string base_uri, hdt::ProgressListener* listener) {
+    bool exists;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        exists = loaded_snapshots.find(snapshot_id) != loaded_snapshots.end();
+    }
+    if (!exists) {
+        build_snapshot(snapshot_id, triples, dict, base_uri, listener);
+    }
+    return load_snapshot(snapshot_id);
+}
+
+void SnapshotManager::build_snapshot(int snapshot_id, const TripleIteratorFactory& triples, std::shared_ptr<DictionaryManager> dict, std::string base_uri, hdt::ProgressListener* listener) {
+    SnapshotBuilder builder(dict, listener);
+    builder.build(triples, basePath + SNAPSHOT_FILENAME_BASE(snapshot_id), base_uri);
+    build_translation_map(snapshot_id, listener);
+}
+
+void SnapshotManager::build_translation_map(int snapshot_id, hdt::ProgressListener* listener) {
+    int previous_id = get_latest_snapshot(snapshot_id - 1);
+    if (previous_id < 0) {
+        return;
+    }
+    try {
+        NOTIFYMSG(listener, "\nBuilding translation map from the previous snapshot...\n");
+        std::shared_ptr<hdt::HDT> previous = get_snapshot(previous_id);
+        std::unique_ptr<hdt::HDT> current(hdt::HDTManager::mapHDT((basePath + SNAPSHOT_FILENAME_BASE(snapshot_id)).c_str()));
+        IdTranslationMap::build(previous->getDictionary(), current->getDictionary(), previous_id, snapshot_id,
+                                basePath + SNAPSHOT_ID_MAP_FILENAME(previous_id, snapshot_id));
+    } catch (const std::exception& e) {
+        // Components of both snapshots can still be compared as strings
+        std::cerr << "Could not build the translation map of snapshot " << snapshot_id << ": " << e.what() << std::endl;
+    }
+}
+
+std::shared_ptr<IdTranslationMap> SnapshotManager::load_translation_map(int previous_id, int snapshot_id) {
+    std::string fileName = basePath + SNAPSHOT_ID_MAP_FILENAME(previous_id, snapshot_id);
+    if (std::ifstream(fileName).good()) {
+        try {
+            return std::make_shared<IdTranslationMap>(fileName);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    return nullptr;
+}
+
 const std::map<int, std::shared_ptr<hdt::HDT>>& SnapshotManager::detect_snapshots() {
     std::unique_lock<std::shared_mutex> lock(mutex);
     std::regex r("snapshot_([0-9]*).hdt");
@@ -147,6 +335,7 @@ std::vector<int> SnapshotManager::get_snapshots_ids() {
 }
 
 hdt::IteratorTripleID* SnapshotManager::search_with_offset(std::shared_ptr<hdt::HDT> hdt, const Triple& triple_pattern, long offset, std::shared_ptr<DictionaryManager> dict, bool sort) {
+    TRACE_SPAN("search_with_offset");
     size_t subject = triple_pattern.get_subject();
     size_t predicate = triple_pattern.get_predicate();
     size_t object = triple_pattern.get_object();
@@ -204,21 +393,59 @@ std::shared_ptr<DictionaryManager> SnapshotManager::get_dictionary_manager(int s
         it--;
     }
     dict = it->second;
+    auto snapshot_it = loaded_snapshots.find(snapshot_id);
+    if (dict != nullptr && snapshot_it != loaded_snapshots.end() && snapshot_it->second != nullptr) {
+        cache_policy.touch(it->first);
+        cache_counters.hit();
+        return dict;
+    }
     s_lock.unlock();
     std::unique_lock<std::shared_mutex> u_lock(mutex);
     if (dict == nullptr || loaded_snapshots[snapshot_id] == nullptr) {
         // we make sure both the snapshot and dictionary are unloaded
         loaded_snapshots[snapshot_id] = nullptr;
         loaded_dictionaries[snapshot_id] = nullptr;
+        update_footprint(snapshot_id);
         // we load the snapshot
         u_lock.unlock();
         auto s_ptr = load_snapshot(snapshot_id);
+        std::shared_lock<std::shared_mutex> lock(mutex);
         return loaded_dictionaries[snapshot_id];
     }
     update_cache(snapshot_id);
     return dict;
 }
 
+std::shared_ptr<SnapshotDiff> SnapshotManager::get_snapshot_diff(int snapshot_id) {
+    std::string fileName;
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        auto it = loaded_diffs.find(snapshot_id);
+        if (it != loaded_diffs.end()) {
+            return it->second;
+        }
+        auto snapshot_it = loaded_snapshots.find(snapshot_id);
+        if (snapshot_it == loaded_snapshots.begin() || snapshot_it == loaded_snapshots.end()) {
+            return nullptr;
+        }
+        fileName = basePath + SNAPSHOT_DIFF_FILENAME(std::prev(snapshot_it)->first, snapshot_id);
+    }
+
+    // The diff is written before its snapshot is registered, so a missing diff is remembered as well
+    std::shared_ptr<SnapshotDiff> diff = nullptr;
+    if (std::ifstream(fileName).good()) {
+        try {
+            // Diffs are mapped in memory, so they are kept open
+            diff = std::make_shared<SnapshotDiff>(fileName);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << std::endl;
+        }
+    }
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    // Another query may have opened the same diff in the meantime
+    return loaded_diffs.emplace(snapshot_id, diff).first->second;
+}
+
 int SnapshotManager::get_max_snapshot_id() {
     std::shared_lock<std::shared_mutex> lock(mutex);
     if (loaded_snapshots.empty())
@@ -232,32 +459,85 @@ int SnapshotManager::get_max_snapshot_id() {
 }
 
 void SnapshotManager::update_cache(int accessed_snapshot_id) {
-    update_cache_internal(accessed_snapshot_id, lru_map.size());
+    cache_policy.insert(accessed_snapshot_id);
+    update_footprint(accessed_snapshot_id);
+    while (cache_policy.size() > max_loaded_snapshots || (memory_budget != nullptr && memory_budget->is_exceeded(MemoryBudget::SNAPSHOTS))) {
+        int evicted = cache_policy.evict([this, accessed_snapshot_id](int id) {
+            // the snapshot or dictionary we want to unload may still be used somewhere
+            return id != accessed_snapshot_id && loaded_snapshots[id].use_count() <= 1 && loaded_dictionaries[id].use_count() <= 1;
+        }, [this](int id) {
+            // Prefer to unload snapshots that free a lot of memory and are quickly reloaded
+            return footprints[id] / std::max(reload_costs[id], 0.001);
+        });
+        if (evicted < 0) {
+            break;
+        }
+        loaded_snapshots[evicted] = nullptr;
+        loaded_dictionaries[evicted] = nullptr;
+        update_footprint(evicted);
+        cache_counters.evicted();
+    }
 }
 
-void SnapshotManager::update_cache_internal(int accessed_id, int iterations) {
-    if (lru_map.size() >= max_loaded_snapshots) {
-        if (iterations >= 0) {
-            int lru_snapshot_id = lru_list.back();
-            lru_list.pop_back();
-            lru_map.erase(lru_snapshot_id);
-            if (!loaded_snapshots[lru_snapshot_id].unique() || !loaded_dictionaries[lru_snapshot_id].unique() || lru_snapshot_id == accessed_id) {
-                // the snapshot or dictionary we want to unload is still used somewhere
-                // so we push it to the front of the list
-                lru_list.push_front(lru_snapshot_id);
-                lru_map[lru_snapshot_id] = lru_list.begin();
-                update_cache_internal(accessed_id, --iterations);
-            } else {
-                loaded_snapshots[lru_snapshot_id] = nullptr;
-                loaded_dictionaries[lru_snapshot_id] = nullptr;
-            }
+void SnapshotManager::update_footprint(int snapshot_id) {
+    size_t footprint = 0;
+    std::shared_ptr<hdt::HDT> snapshot = loaded_snapshots[snapshot_id];
+    std::shared_ptr<DictionaryManager> dict = loaded_dictionaries[snapshot_id];
+    if (snapshot != nullptr) {
+        footprint += snapshot->getDictionary()->size() + snapshot->getTriples()->size();
+    }
+    if (dict != nullptr) {
+        footprint += dict->getMemoryFootprint();
+    }
+    if (memory_budget != nullptr) {
+        memory_budget->release(footprints[snapshot_id], MemoryBudget::SNAPSHOTS);
+        memory_budget->add(footprint, MemoryBudget::SNAPSHOTS);
+    }
+    footprints[snapshot_id] = footprint;
+}
+
+void SnapshotManager::set_memory_budget(std::shared_ptr<MemoryBudget> budget) {
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    for (auto& footprint : footprints) {
+        if (memory_budget != nullptr) {
+            memory_budget->release(footprint.second, MemoryBudget::SNAPSHOTS);
+        }
+        if (budget != nullptr) {
+            budget->add(footprint.second, MemoryBudget::SNAPSHOTS);
+        }
+    }
+    memory_budget = budget;
+}
+
+size_t SnapshotManager::get_memory_usage() {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    size_t usage = 0;
+    for (auto& footprint : footprints) {
+        usage += footprint.second;
+    }
+    return usage;
+}
+
+CacheMetrics SnapshotManager::get_cache_metrics() {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    size_t loaded = 0;
+    for (auto& snapshot : loaded_snapshots) {
+        if (snapshot.second != nullptr) {
+            loaded++;
         }
     }
-    if (lru_map.find(accessed_id) != lru_map.end()) {
-        lru_list.erase(lru_map[accessed_id]);
+    return cache_counters.get_metrics(loaded);
+}
+
+std::map<int, DictionaryLookups> SnapshotManager::get_dictionary_lookups() {
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    std::map<int, DictionaryLookups> lookups;
+    for (auto& dict : loaded_dictionaries) {
+        if (dict.second != nullptr) {
+            lookups[dict.first] = dict.second->getLookups();
+        }
     }
-    lru_list.push_front(accessed_id);
-    lru_map[accessed_id] = lru_list.begin();
+    return lookups;
 }
 
 void SnapshotManager::set_cache_max_size(size_t new_size) {
@@ -5,10 +5,17 @@
 
 #include <memory>
 #include <shared_mutex>
+#include <future>
+#include <mutex>
 #include <HDT.hpp>
 #include "../patch/patch.h"
+#include "../patch/clock_eviction_policy.h"
+#include "../patch/memory_budget.h"
+#include "../patch/cache_metrics.h"
 #include <Dictionary.hpp>
 #include "../dictionary/dictionary_manager.h"
+#include "materialized_triple_iterator.h"
+#include "snapshot_diff.h"
 
 
 class SnapshotManager {
@@ -16,16 +23,41 @@ private:
     std::string basePath;
 
     size_t max_loaded_snapshots;
-    std::list<int> lru_list;
-    std::map<int, std::list<int>::iterator> lru_map;
+    ClockEvictionPolicy cache_policy;
+    std::shared_ptr<MemoryBudget> memory_budget;
+    // The number of bytes that each loaded snapshot and its dictionary use
+    std::map<int, size_t> footprints;
+    // The number of seconds it took to load each snapshot
+    std::map<int, double> reload_costs;
+    CacheCounters cache_counters;
 
     std::map<int, std::shared_ptr<hdt::HDT>> loaded_snapshots;
     std::map<int, std::shared_ptr<DictionaryManager>> loaded_dictionaries;
+    // The diffs that were looked up, null if a snapshot has no stored diff
+    std::map<int, std::shared_ptr<SnapshotDiff>> loaded_diffs;
     bool readonly;
 
     std::shared_mutex mutex;
+    // Snapshots that are being loaded, which is done without holding the mutex
+    std::map<int, std::shared_future<void>> loading_snapshots;
 
-    void update_cache_internal(int accessed_id, int iterations);
+    std::mutex preload_mutex;
+    std::vector<std::future<void>> preload_tasks;
+
+    /**
+     * @return The translation map from the previous snapshot to the given snapshot, or null if it does not exist.
+     */
+    std::shared_ptr<IdTranslationMap> load_translation_map(int previous_id, int snapshot_id);
+    /**
+     * Map the HDT file of the given snapshot and open its dictionary, without locking the manager.
+     * @param previous_id The id of the previous snapshot, whose translation map is attached to the dictionary, or -1.
+     */
+    std::pair<std::shared_ptr<hdt::HDT>, std::shared_ptr<DictionaryManager>> open_snapshot_files(int snapshot_id, int previous_id);
+    /**
+     * Recalculate the memory footprint of the given snapshot.
+     * The manager must be exclusively locked.
+     */
+    void update_footprint(int snapshot_id);
 
 public:
     explicit SnapshotManager(string basePath, bool readonly = false, size_t cache_size = 4);
@@ -42,8 +74,39 @@ public:
 
     /**
      * Load the HDT file for the given snapshot id.
+     * The file is mapped and indexed without locking the manager,
+     * concurrent loads of the same snapshot wait for the first one.
      */
     std::shared_ptr<hdt::HDT> load_snapshot(int snapshot_id);
+    /**
+     * Open the HDT file and dictionary of the given snapshot, without registering it in this manager,
+     * so that data that depends on the snapshot can be prepared before queries can see it.
+     * @param snapshot_id The id of the snapshot
+     * @return The snapshot and its dictionary.
+     */
+    std::pair<std::shared_ptr<hdt::HDT>, std::shared_ptr<DictionaryManager>> open_snapshot(int snapshot_id);
+    /**
+     * Make a snapshot that was opened with open_snapshot visible to queries.
+     * @param snapshot_id The id of the snapshot
+     * @param snapshot The snapshot
+     * @param dict The dictionary of the snapshot
+     * @param reload_cost The number of seconds it took to open the snapshot, which is weighed against its footprint on eviction
+     */
+    void register_snapshot(int snapshot_id, std::shared_ptr<hdt::HDT> snapshot, std::shared_ptr<DictionaryManager> dict,
+                           double reload_cost);
+    /**
+     * Load the given snapshots in parallel on background threads, generating their indexes if needed.
+     * The snapshots are registered immediately, queries for them wait until they are loaded.
+     * At most the cache size of snapshots remain loaded.
+     * @param snapshot_ids The ids of the snapshots to load
+     * @param wait If we should block until all snapshots are loaded.
+     */
+    void preload_snapshots(const std::vector<int>& snapshot_ids, bool wait = false);
+    /**
+     * Generate and save the index of the HDT file for the given snapshot id, if it does not exist yet.
+     * This does not lock the manager, so it can be called from a background thread.
+     */
+    void build_index(int snapshot_id);
     /**
      * Get the HDT file for the given snapshot id.
      */
@@ -67,6 +130,33 @@ public:
      * @return The created snapshot
      */
     std::shared_ptr<hdt::HDT> create_snapshot(int snapshot_id, string triples_file, string base_uri, hdt::RDFNotation notation);
+    /**
+     * Create a HDT file for the given snapshot id from triple IDs, without decoding and parsing every triple.
+     * It will automatically be persisted in this manager.
+     * @param snapshot_id The id for the new snapshot
+     * @param triples Factory for the stream of triples to create a snapshot from, it will be iterated twice.
+     * @param dict The dictionary the triples are encoded with.
+     * @param base_uri The base uri for the triples graph.
+     * @return The created snapshot
+     */
+    std::shared_ptr<hdt::HDT> create_snapshot(int snapshot_id, const TripleIteratorFactory& triples, std::shared_ptr<DictionaryManager> dict, string base_uri, hdt::ProgressListener* listener = NULL);
+    /**
+     * Write the HDT file for the given snapshot id from triple IDs, without registering it in this manager.
+     * This does not lock the manager, so it can be called from a background thread.
+     * The snapshot becomes available after calling load_snapshot.
+     * @param snapshot_id The id for the new snapshot
+     * @param triples Factory for the stream of triples to create a snapshot from, it will be iterated twice.
+     * @param dict The dictionary the triples are encoded with.
+     * @param base_uri The base uri for the triples graph.
+     */
+    void build_snapshot(int snapshot_id, const TripleIteratorFactory& triples, std::shared_ptr<DictionaryManager> dict, string base_uri, hdt::ProgressListener* listener = NULL);
+    /**
+     * Write the translation map between the HDT IDs of the previous snapshot and the given snapshot,
+     * so that triples of both can be compared without decoding them.
+     * The HDT file of the given snapshot must already exist.
+     * @param snapshot_id The id of the new snapshot
+     */
+    void build_translation_map(int snapshot_id, hdt::ProgressListener* listener = NULL);
     /**
      * Find all snapshots in the current directory.
      * @return The found patch trees
@@ -96,9 +186,34 @@ public:
     std::shared_ptr<DictionaryManager> get_dictionary_manager(int snapshot_id);
 
     /**
-     * Update the state of the patch cache
+     * @param snapshot_id A snapshot id
+     * @return The stored diff from the previous snapshot to the given snapshot, or null if there is none.
+     */
+    std::shared_ptr<SnapshotDiff> get_snapshot_diff(int snapshot_id);
+
+    /**
+     * Update the state of the snapshot cache after loading a snapshot, unloading unused snapshots if it is full.
+     * The manager must be exclusively locked, cache hits only mark the snapshot as used.
      */
     void update_cache(int accessed_snapshot_id);
+    /**
+     * Share a memory budget with other managers, snapshots are unloaded when they exceed their share of it.
+     * Unused snapshots that are large and quick to reload are unloaded first.
+     * @param budget The memory budget, or null to only limit the number of loaded snapshots.
+     */
+    void set_memory_budget(std::shared_ptr<MemoryBudget> budget);
+    /**
+     * @return The number of bytes that the loaded snapshots and their dictionaries use.
+     */
+    size_t get_memory_usage();
+    /**
+     * @return The hits, misses, evictions and load latencies of the snapshot cache.
+     */
+    CacheMetrics get_cache_metrics();
+    /**
+     * @return The number of term lookups of each loaded dictionary, by snapshot id.
+     */
+    std::map<int, DictionaryLookups> get_dictionary_lookups();
 
     void set_cache_max_size(size_t new_size);
 
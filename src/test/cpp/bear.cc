@@ -1,3 +1,5 @@
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <kchashdb.h>
 #include <HDT.hpp>
@@ -69,8 +71,17 @@ void test_lookups_for_queries_ms(BearEvaluatorMS &evaluator, const string& queri
 
 
 int main(int argc, char *argv[]) {
+    // Optionally write the results as JSON next to the CSV output
+    std::string json_file;
+    if (argc > 2 && std::strcmp("--json", argv[1]) == 0) {
+        json_file = argv[2];
+        argv[2] = argv[0];
+        argv += 2;
+        argc -= 2;
+    }
+
     if (argc < 4 || argc > 9) {
-        std::cerr << "Usage: " << argv[0] << " ingest|ingest-query|query|stats " << std::endl;
+        std::cerr << "Usage: " << argv[0] << " [--json results.json] ingest|ingest-query|query|stats " << std::endl;
         std::cerr << "\tcmd \"ingest\": strategy strategy_parameter path_to_patches start_index end_index" << std::endl;
         std::cerr
                 << "\tcmd \"ingest-query\": strategy strategy_parameter path_to_patches start_index end_index path_to_queries_file replications"
@@ -82,6 +93,27 @@ int main(int argc, char *argv[]) {
     BearEvaluatorMS evaluator;
     SimpleProgressListener* listener = nullptr;
 
+    BenchmarkReport report;
+    if (!json_file.empty()) {
+        report.set_parameter("command", argv[1]);
+        report.set_parameter("kc_options", "TCOMPRESS");
+        if (std::strcmp("ingest", argv[1]) == 0 || std::strcmp("ingest-query", argv[1]) == 0) {
+            report.set_parameter("strategy", argv[2]);
+            report.set_parameter("strategy_parameter", argv[3]);
+            report.set_parameter("patches", argv[4]);
+            report.set_parameter("start_index", argv[5]);
+            report.set_parameter("end_index", argv[6]);
+            if (argc > 8) {
+                report.set_parameter("queries", argv[7]);
+                report.set_parameter("replications", argv[8]);
+            }
+        } else if (std::strcmp("query", argv[1]) == 0) {
+            report.set_parameter("queries", argv[2]);
+            report.set_parameter("replications", argv[3]);
+        }
+        evaluator.set_report(&report);
+    }
+
     if (std::strcmp("ingest", argv[1]) == 0 || std::strcmp("ingest-query", argv[1]) == 0) {
         std::string strategy_type = argv[2];
         std::string strategy_param = argv[3];
@@ -102,4 +134,14 @@ int main(int argc, char *argv[]) {
     delete listener;
 
     evaluator.cleanup_controller();
+
+    if (!json_file.empty()) {
+        std::ofstream out(json_file);
+        report.write_json(out);
+        out << std::endl;
+        if (out.fail()) {
+            std::cerr << "Could not write the results to " << json_file << std::endl;
+            return 1;
+        }
+    }
 }
\ No newline at end of file
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include <map>
+#include <set>
+
+#include "../../../main/cpp/controller/controller.h"
+#include "../../../main/cpp/controller/bgp_evaluator.h"
+
+#define TESTPATH "./"
+
+// Defined in the controller tests
+void clean_meta_files();
+
+// The fixture for testing class BgpEvaluator.
+class BgpEvaluatorTest : public ::testing::Test {
+protected:
+    Controller* controller;
+
+    BgpEvaluatorTest() : controller(new Controller(TESTPATH)) {}
+
+    virtual void SetUp() {
+        clean_meta_files();
+    }
+
+    virtual void TearDown() {
+        Controller::cleanup(TESTPATH, controller);
+        clean_meta_files();
+    }
+
+    void populate() {
+        controller->new_patch_bulk()
+        ->addition(hdt::TripleString("<a>", "<knows>", "<b>"))
+        ->addition(hdt::TripleString("<a>", "<knows>", "<c>"))
+        ->addition(hdt::TripleString("<b>", "<knows>", "<c>"))
+        ->addition(hdt::TripleString("<c>", "<knows>", "<d>"))
+        ->addition(hdt::TripleString("<e>", "<knows>", "<e>"))
+        ->addition(hdt::TripleString("<a>", "<name>", "\"A\""))
+        ->addition(hdt::TripleString("<b>", "<name>", "\"B\""))
+        ->addition(hdt::TripleString("<c>", "<name>", "\"C\""))
+        ->addition(hdt::TripleString("<a>", "<type>", "<Person>"))
+        ->addition(hdt::TripleString("<b>", "<type>", "<Person>"))
+        ->commit();
+
+        controller->new_patch_bulk()
+        ->deletion(hdt::TripleString("<a>", "<knows>", "<c>"))
+        ->addition(hdt::TripleString("<d>", "<knows>", "<a>"))
+        ->addition(hdt::TripleString("<d>", "<name>", "\"D\""))
+        ->addition(hdt::TripleString("<d>", "<type>", "<Person>"))
+        ->commit();
+    }
+
+    // Evaluate a BGP with string nested loops over the version materialization of each pattern
+    void evaluate_naive(const std::vector<StringTriple>& bgp, size_t index, int patch_id,
+                        std::map<std::string, std::string> bindings, std::vector<std::string> variables,
+                        std::multiset<std::vector<std::string>>& solutions) {
+        if (index == bgp.size()) {
+            std::vector<std::string> solution;
+            for (const std::string& variable : variables) {
+                solution.push_back(bindings[variable]);
+            }
+            solutions.insert(solution);
+            return;
+        }
+        std::string terms[3] = {bgp[index].get_subject(), bgp[index].get_predicate(), bgp[index].get_object()};
+        std::string pattern[3];
+        for (int i = 0; i < 3; i++) {
+            auto it = bindings.find(terms[i]);
+            pattern[i] = it != bindings.end() ? it->second : (BgpEvaluator::is_variable(terms[i]) ? "" : terms[i]);
+        }
+        std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(patch_id);
+        TripleIterator* it = controller->get_version_materialized(StringTriple(pattern[0], pattern[1], pattern[2]), 0, patch_id);
+        Triple triple;
+        while (it->next(&triple)) {
+            std::string values[3] = {triple.get_subject(*dict), triple.get_predicate(*dict), triple.get_object(*dict)};
+            std::map<std::string, std::string> extended = bindings;
+            bool valid = true;
+            for (int i = 0; i < 3; i++) {
+                if (!terms[i].empty() && BgpEvaluator::is_variable(terms[i])) {
+                    auto inserted = extended.emplace(terms[i], values[i]);
+                    valid = valid && inserted.first->second == values[i];
+                }
+            }
+            if (valid) {
+                evaluate_naive(bgp, index + 1, patch_id, extended, variables, solutions);
+            }
+        }
+        delete it;
+    }
+
+    std::multiset<std::vector<std::string>> evaluate(const std::vector<StringTriple>& bgp, int patch_id,
+                                                     const std::vector<std::string>& variables) {
+        BgpEvaluator evaluator(controller, patch_id);
+        BgpSolutions solutions = evaluator.evaluate(bgp);
+        std::vector<std::vector<std::string>> projected = evaluator.project(solutions, variables);
+        return std::multiset<std::vector<std::string>>(projected.begin(), projected.end());
+    }
+};
+
+TEST_F(BgpEvaluatorTest, IsVariable) {
+    ASSERT_TRUE(BgpEvaluator::is_variable("?x")) << "Named variable is not a variable";
+    ASSERT_TRUE(BgpEvaluator::is_variable("")) << "Empty term is not a variable";
+    ASSERT_FALSE(BgpEvaluator::is_variable("<a>")) << "IRI is a variable";
+    ASSERT_FALSE(BgpEvaluator::is_variable("\"?x\"")) << "Literal is a variable";
+}
+
+TEST_F(BgpEvaluatorTest, EvaluateStar) {
+    populate();
+    std::vector<StringTriple> bgp = {
+            StringTriple("?x", "<type>", "<Person>"),
+            StringTriple("?x", "<name>", "?name"),
+    };
+
+    std::multiset<std::vector<std::string>> expected0 = {{"<a>", "\"A\""}, {"<b>", "\"B\""}};
+    ASSERT_EQ(expected0, evaluate(bgp, 0, {"?x", "?name"})) << "Solutions are incorrect in version 0";
+
+    std::multiset<std::vector<std::string>> expected1 = {{"<a>", "\"A\""}, {"<b>", "\"B\""}, {"<d>", "\"D\""}};
+    ASSERT_EQ(expected1, evaluate(bgp, 1, {"?x", "?name"})) << "Solutions are incorrect in version 1";
+}
+
+TEST_F(BgpEvaluatorTest, EvaluatePath) {
+    populate();
+    // The middle variable is an object in the first pattern, and a subject in the second
+    std::vector<StringTriple> bgp = {
+            StringTriple("?x", "<knows>", "?y"),
+            StringTriple("?y", "<knows>", "?z"),
+            StringTriple("?z", "<name>", "?name"),
+    };
+
+    std::multiset<std::vector<std::string>> expected0 = {{"<a>", "<b>", "\"C\""}};
+    ASSERT_EQ(expected0, evaluate(bgp, 0, {"?x", "?y", "?name"})) << "Solutions are incorrect in version 0";
+
+    std::multiset<std::vector<std::string>> expected1 = {{"<a>", "<b>", "\"C\""}, {"<b>", "<c>", "\"D\""}, {"<c>", "<d>", "\"A\""},
+                                                                  {"<d>", "<a>", "\"B\""}};
+    ASSERT_EQ(expected1, evaluate(bgp, 1, {"?x", "?y", "?name"})) << "Solutions are incorrect in version 1";
+}
+
+TEST_F(BgpEvaluatorTest, EvaluateRepeatedVariable) {
+    populate();
+    std::vector<StringTriple> bgp = {
+            StringTriple("?x", "<knows>", "?x"),
+    };
+    std::multiset<std::vector<std::string>> expected = {{"<e>"}};
+    ASSERT_EQ(expected, evaluate(bgp, 0, {"?x"})) << "Solutions are incorrect";
+}
+
+TEST_F(BgpEvaluatorTest, EvaluateUnknownConstant) {
+    populate();
+    std::vector<StringTriple> bgp = {
+            StringTriple("?x", "<type>", "<Person>"),
+            StringTriple("?x", "<unknown>", "?y"),
+    };
+    BgpEvaluator evaluator(controller, 0);
+    BgpSolutions solutions = evaluator.evaluate(bgp);
+    ASSERT_EQ(2, solutions.variables.size()) << "Variables are incorrect";
+    ASSERT_EQ(0, solutions.rows.size()) << "A pattern with an unknown constant must have no solutions";
+    ASSERT_THROW(evaluator.project(solutions, {"?z"}), std::invalid_argument) << "Projecting an unknown variable must fail";
+}
+
+TEST_F(BgpEvaluatorTest, Order) {
+    populate();
+    std::vector<StringTriple> bgp = {
+            StringTriple("?x", "<knows>", "?y"),
+            StringTriple("?z", "<name>", "?name"),
+            StringTriple("?x", "<type>", "<Person>"),
+    };
+    BgpEvaluator evaluator(controller, 0);
+    std::vector<BgpEvaluator::EncodedPattern> patterns;
+    std::vector<std::string> variables;
+    ASSERT_TRUE(evaluator.encode(bgp, patterns, variables)) << "All constants must be known";
+    ASSERT_EQ(4, variables.size()) << "Variables are incorrect";
+    std::vector<std::pair<size_t, size_t>> order = evaluator.order(patterns);
+    ASSERT_EQ(3, order.size()) << "Order size is incorrect";
+    ASSERT_EQ(2, order[0].first) << "The most selective pattern must be first";
+    ASSERT_EQ(0, order[1].first) << "A connected pattern must precede a cartesian product";
+    ASSERT_EQ(1, order[2].first) << "The disconnected pattern must be last";
+}
+
+TEST_F(BgpEvaluatorTest, EvaluateEmptyStore) {
+    BgpEvaluator evaluator(controller, 0);
+    BgpSolutions solutions = evaluator.evaluate({StringTriple("?x", "<knows>", "?y")});
+    ASSERT_EQ(2, solutions.variables.size()) << "Variables are incorrect";
+    ASSERT_EQ(0, solutions.rows.size()) << "A store without snapshots must have no solutions";
+}
+
+TEST_F(BgpEvaluatorTest, EvaluateJoinTypes) {
+    populate();
+    BgpEvaluator evaluator(controller, 0);
+
+    // Both patterns are sorted on their subject
+    evaluator.evaluate({StringTriple("?x", "<type>", "<Person>"), StringTriple("?x", "<knows>", "<c>")});
+    ASSERT_EQ(2, evaluator.get_steps().size()) << "Number of steps is incorrect";
+    ASSERT_EQ(BGP_JOIN_SCAN, evaluator.get_steps()[0].join) << "The first pattern must be scanned";
+    ASSERT_EQ(BGP_JOIN_MERGE, evaluator.get_steps()[1].join) << "Patterns sorted on the shared variable must be merged";
+    std::multiset<std::vector<std::string>> expected0 = {{"<a>"}, {"<b>"}};
+    ASSERT_EQ(expected0, evaluate({StringTriple("?x", "<type>", "<Person>"), StringTriple("?x", "<knows>", "<c>")}, 0, {"?x"}))
+                                << "Merge join solutions are incorrect";
+    std::multiset<std::vector<std::string>> expected1 = {{"<b>"}};
+    ASSERT_EQ(expected1, evaluate({StringTriple("?x", "<type>", "<Person>"), StringTriple("?x", "<knows>", "<c>")}, 1, {"?x"}))
+                                << "Merge join solutions are incorrect in a patch";
+
+    // The shared variable is in different positions
+    evaluator.evaluate({StringTriple("?x", "<knows>", "?y"), StringTriple("?y", "<knows>", "?z")});
+    ASSERT_EQ(2, evaluator.get_steps().size()) << "Number of steps is incorrect";
+    ASSERT_EQ(BGP_JOIN_HASH, evaluator.get_steps()[1].join) << "Unsorted patterns of similar size must be hash joined";
+}
+
+TEST_F(BgpEvaluatorTest, EvaluateBindJoin) {
+    PatchBuilder* builder = controller->new_patch_bulk();
+    builder->addition(hdt::TripleString("<a>", "<knows>", "<b>"));
+    for (int i = 0; i < 2 * BGP_BIND_JOIN_LOOKUP_COST; i++) {
+        builder->addition(hdt::TripleString("<c>", "<value>", "\"" + std::to_string(i) + "\""));
+    }
+    builder->addition(hdt::TripleString("<b>", "<value>", "\"b\""));
+    builder->commit();
+
+    BgpEvaluator evaluator(controller, 0);
+    std::vector<StringTriple> bgp = {StringTriple("<a>", "<knows>", "?y"), StringTriple("?y", "<value>", "?v")};
+    BgpSolutions solutions = evaluator.evaluate(bgp);
+    ASSERT_EQ(BGP_JOIN_BIND, evaluator.get_steps()[1].join) << "A small left side must be bind joined";
+    std::vector<std::vector<std::string>> expected = {{"<b>", "\"b\""}};
+    ASSERT_EQ(expected, evaluator.project(solutions, {"?y", "?v"})) << "Bind join solutions are incorrect";
+}
+
+TEST_F(BgpEvaluatorTest, EvaluateNaive) {
+    populate();
+    std::vector<std::vector<StringTriple>> bgps = {
+            {StringTriple("?x", "<knows>", "?y")},
+            {StringTriple("?x", "<knows>", "?y"), StringTriple("?y", "<knows>", "?z")},
+            {StringTriple("?x", "<knows>", "?y"), StringTriple("?y", "<type>", "<Person>")},
+            {StringTriple("?x", "<knows>", "?y"), StringTriple("?x", "<name>", "?n"), StringTriple("?y", "<name>", "?m")},
+            {StringTriple("?x", "?p", "?y"), StringTriple("?y", "?q", "?x")},
+            {StringTriple("?x", "?p", "<Person>"), StringTriple("?x", "", "?y")},
+            {StringTriple("?x", "<type>", "<Person>"), StringTriple("?y", "<type>", "<Person>")},
+            {StringTriple("?s", "?p", "?o")},
+    };
+    for (int patch_id = 0; patch_id <= 1; patch_id++) {
+        for (const std::vector<StringTriple>& bgp : bgps) {
+            BgpEvaluator evaluator(controller, patch_id);
+            BgpSolutions solutions = evaluator.evaluate(bgp);
+            std::vector<std::vector<std::string>> projected = evaluator.project(solutions, solutions.variables);
+            std::multiset<std::vector<std::string>> actual(projected.begin(), projected.end());
+            std::multiset<std::vector<std::string>> expected;
+            evaluate_naive(bgp, 0, patch_id, {}, solutions.variables, expected);
+            ASSERT_EQ(expected, actual) << "Solutions are incorrect for a BGP of " << bgp.size() << " patterns in version " << patch_id;
+        }
+    }
+}
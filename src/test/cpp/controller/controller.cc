@@ -1,8 +1,14 @@
 #include <gtest/gtest.h>
 #include <regex>
+#include <set>
+#include <map>
+#include <algorithm>
 #include <dirent.h>
+#include <thread>
+#include <chrono>
 
 #include "../../../main/cpp/controller/controller.h"
+#include "../../../main/cpp/controller/ingest_pipeline.h"
 #include "../../../main/cpp/snapshot/vector_triple_iterator.h"
 
 #define BASEURI "<http://example.org>"
@@ -173,6 +179,165 @@ TEST_F(ControllerTest, PatchBuilderStreaming) {
     ASSERT_EQ(2, controller->get_version_materialized_count(Triple("", "", "", dict), 1).first) << "Count is incorrect";
 }
 
+TEST_F(ControllerTest, IngestMultipleFiles) {
+    std::vector<hdt::TripleString> snapshot_triples;
+    snapshot_triples.push_back(hdt::TripleString("<a>", "<a>", "<a>"));
+    snapshot_triples.push_back(hdt::TripleString("<b>", "<b>", "<b>"));
+    snapshot_triples.push_back(hdt::TripleString("<c>", "<c>", "<c>"));
+    std::vector<std::pair<hdt::IteratorTripleString*, bool>> files0;
+    files0.emplace_back(new IteratorTripleStringVector(&snapshot_triples), true);
+    ASSERT_EQ(true, controller->ingest(files0, 0, true));
+
+    std::vector<hdt::TripleString> additions1;
+    additions1.push_back(hdt::TripleString("<f>", "<f>", "<f>"));
+    additions1.push_back(hdt::TripleString("<d>", "<d>", "<d>"));
+    std::vector<hdt::TripleString> additions2;
+    additions2.push_back(hdt::TripleString("<e>", "<e>", "<e>"));
+    std::vector<hdt::TripleString> deletions;
+    deletions.push_back(hdt::TripleString("<c>", "<c>", "<c>"));
+    deletions.push_back(hdt::TripleString("<a>", "<a>", "<a>"));
+    std::vector<std::pair<hdt::IteratorTripleString*, bool>> files1;
+    files1.emplace_back(new IteratorTripleStringVector(&additions1), true);
+    files1.emplace_back(new IteratorTripleStringVector(&deletions), false);
+    files1.emplace_back(new IteratorTripleStringVector(&additions2), true);
+    ASSERT_EQ(true, controller->ingest(files1, 1, true));
+
+    std::shared_ptr<DictionaryManager> dict = controller->get_snapshot_manager()->get_dictionary_manager(0);
+    ASSERT_EQ(3, controller->get_version_materialized_count(Triple("", "", "", dict), 0).first) << "Count is incorrect";
+    ASSERT_EQ(4, controller->get_version_materialized_count(Triple("", "", "", dict), 1).first) << "Count is incorrect";
+
+    Triple t;
+    TripleIterator* it = controller->get_version_materialized(Triple("", "", "", dict), 0, 1);
+    ASSERT_EQ(true, it->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<b> <b> <b>.", t.to_string(*dict)) << "Element is incorrect";
+    ASSERT_EQ(true, it->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<d> <d> <d>.", t.to_string(*dict)) << "Element is incorrect";
+    ASSERT_EQ(true, it->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<e> <e> <e>.", t.to_string(*dict)) << "Element is incorrect";
+    ASSERT_EQ(true, it->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<f> <f> <f>.", t.to_string(*dict)) << "Element is incorrect";
+    ASSERT_EQ(false, it->next(&t)) << "Iterator should be finished";
+    delete it;
+}
+
+// Triples of a file that fails to parse after the given number of triples
+class FailingIteratorTripleString : public hdt::IteratorTripleString {
+protected:
+    int remaining;
+    hdt::TripleString triple;
+public:
+    explicit FailingIteratorTripleString(int count) : remaining(count), triple("<x>", "<x>", "<x>") {}
+    bool hasNext() override {
+        return true;
+    }
+    hdt::TripleString* next() override {
+        if (remaining-- <= 0) {
+            throw std::runtime_error("Malformed triple");
+        }
+        return &triple;
+    }
+    void goToStart() override {}
+};
+
+TEST_F(ControllerTest, IngestFailedFile) {
+    std::vector<hdt::TripleString> snapshot_triples;
+    snapshot_triples.push_back(hdt::TripleString("<a>", "<a>", "<a>"));
+    std::vector<std::pair<hdt::IteratorTripleString*, bool>> files0;
+    files0.emplace_back(new IteratorTripleStringVector(&snapshot_triples), true);
+    ASSERT_EQ(true, controller->ingest(files0, 0, true));
+
+    std::vector<hdt::TripleString> additions;
+    additions.push_back(hdt::TripleString("<b>", "<b>", "<b>"));
+    std::vector<std::pair<hdt::IteratorTripleString*, bool>> files1;
+    files1.emplace_back(new IteratorTripleStringVector(&additions), true);
+    files1.emplace_back(new FailingIteratorTripleString(10), true);
+    ASSERT_EQ(false, controller->ingest(files1, 1, true)) << "A file that fails to parse must fail the ingest";
+
+    std::shared_ptr<DictionaryManager> dict = controller->get_snapshot_manager()->get_dictionary_manager(0);
+    ASSERT_EQ(1, controller->get_version_materialized_count(Triple("", "", "", dict), 1).first) << "Nothing of the failed patch must be appended";
+}
+
+TEST_F(ControllerTest, IngestPipelineSortsChunks) {
+    controller->new_patch_bulk()
+            ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+            ->commit();
+    std::shared_ptr<DictionaryManager> dict = controller->get_snapshot_manager()->get_dictionary_manager(0);
+
+    std::vector<hdt::TripleString> triples1;
+    std::vector<hdt::TripleString> triples2;
+    for (int i = 99; i >= 0; i--) {
+        std::vector<hdt::TripleString>& triples = i % 2 == 0 ? triples1 : triples2;
+        triples.push_back(hdt::TripleString("<s" + std::to_string(i) + ">", "<p>", "<o" + std::to_string(i % 7) + ">"));
+    }
+
+    // Tiny chunks and queues, so that all stages have to wait for each other
+    IngestPipeline pipeline(dict, true, nullptr, 3, 4, 1);
+    pipeline.add_file(new IteratorTripleStringVector(&triples1), true);
+    pipeline.add_file(new IteratorTripleStringVector(&triples2), false);
+    PatchElementIterator* it = pipeline.start();
+
+    PatchSorted expected(dict);
+    for (auto& triple : triples1) {
+        expected.add_unsorted(PatchElement(Triple(triple.getSubject(), triple.getPredicate(), triple.getObject(), dict), true));
+    }
+    for (auto& triple : triples2) {
+        expected.add_unsorted(PatchElement(Triple(triple.getSubject(), triple.getPredicate(), triple.getObject(), dict), false));
+    }
+    expected.sort();
+
+    PatchElement element;
+    for (unsigned long i = 0; i < expected.get_size(); i++) {
+        ASSERT_EQ(true, it->next(&element)) << "Iterator has a no next value";
+        ASSERT_EQ(expected.get(i).get_triple(), element.get_triple()) << "Element " << i << " is incorrect";
+        ASSERT_EQ(expected.get(i).is_addition(), element.is_addition()) << "Element " << i << " is incorrect";
+    }
+    ASSERT_EQ(false, it->next(&element)) << "Iterator should be finished";
+    ASSERT_EQ(100, pipeline.finish()) << "Count is incorrect";
+}
+
+TEST_F(ControllerTest, IngestPipelineSpillsRuns) {
+    controller->new_patch_bulk()
+            ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+            ->commit();
+    std::shared_ptr<DictionaryManager> dict = controller->get_snapshot_manager()->get_dictionary_manager(0);
+
+    std::vector<hdt::TripleString> triples;
+    for (int i = 0; i < 600; i++) {
+        int id = (i * 7919) % 600;
+        triples.push_back(hdt::TripleString("<s" + std::to_string(id % 13) + ">", "<p>", "<o" + std::to_string(id) + ">"));
+    }
+
+    // A budget for only a few elements, so that most runs are spilled, in more runs than can be merged at once
+    IngestPipeline pipeline(dict, true, nullptr, 2, INGEST_CHUNK_SIZE, 1, 1024, TESTPATH);
+    pipeline.add_file(new IteratorTripleStringVector(&triples), true);
+    PatchElementIterator* it = pipeline.start();
+
+    PatchSorted expected(dict);
+    for (auto& triple : triples) {
+        expected.add_unsorted(PatchElement(Triple(triple.getSubject(), triple.getPredicate(), triple.getObject(), dict), true));
+    }
+    expected.sort();
+
+    PatchElement element;
+    for (unsigned long i = 0; i < expected.get_size(); i++) {
+        ASSERT_EQ(true, it->next(&element)) << "Iterator has a no next value";
+        ASSERT_EQ(expected.get(i).get_triple(), element.get_triple()) << "Element " << i << " is incorrect";
+    }
+    ASSERT_EQ(false, it->next(&element)) << "Iterator should be finished";
+    ASSERT_EQ(600, pipeline.finish()) << "Count is incorrect";
+
+    // All runs must have been removed
+    std::regex r("ingest_([0-9]+)_run_([0-9]+).tmp");
+    DIR *dir;
+    struct dirent *ent;
+    if ((dir = opendir(TESTPATH)) != nullptr) {
+        while ((ent = readdir(dir)) != nullptr) {
+            ASSERT_EQ(false, std::regex_match(std::string(ent->d_name), r)) << "Run was not removed: " << ent->d_name;
+        }
+        closedir(dir);
+    }
+}
+
 TEST_F(ControllerTest, GetVersionMaterializedSimple) {
     // Build a snapshot
     std::vector<hdt::TripleString> triples;
@@ -2977,6 +3142,100 @@ TEST_F(ControllerTest, GetVersion) {
     ASSERT_EQ(false, it18->next(&t)) << "Iterator should be finished";
 }
 
+TEST_F(ControllerTest, GetVersionRange) {
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->deletion(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->commit();
+
+    // Expected version 0: <a> <a> <a>, <a> <a> <b>
+    // Expected version 1: <a> <a> <a>
+    // Expected version 2: <a> <a> <a>, <a> <a> <c>
+    // Expected version 3: <a> <a> <b>, <a> <a> <c>
+    // Expected version 4: <a> <a> <b>
+
+    TripleVersions t;
+
+    // Request versions 1 to 3 for ? ? ?
+    TripleVersionsIterator* it0 = controller->get_version_range(StringTriple("", "", ""), 0, 1, 3);
+
+    ASSERT_EQ(true, it0->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<a> <a> <a>.", t.get_triple()->to_string(*(t.get_dictionary()))) << "Element is incorrect";
+    ASSERT_EQ(std::vector<int>({1, 2}), *(t.get_versions())) << "Element is incorrect";
+
+    ASSERT_EQ(true, it0->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<a> <a> <b>.", t.get_triple()->to_string(*(t.get_dictionary()))) << "Element is incorrect";
+    ASSERT_EQ(std::vector<int>({3}), *(t.get_versions())) << "Element is incorrect";
+
+    ASSERT_EQ(true, it0->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<a> <a> <c>.", t.get_triple()->to_string(*(t.get_dictionary()))) << "Element is incorrect";
+    ASSERT_EQ(std::vector<int>({2, 3}), *(t.get_versions())) << "Element is incorrect";
+
+    ASSERT_EQ(false, it0->next(&t)) << "Iterator should be finished";
+    delete it0;
+
+    // Request versions 1 to 3 for ? ? ? with offset 2
+    TripleVersionsIterator* it1 = controller->get_version_range(StringTriple("", "", ""), 2, 1, 3);
+
+    ASSERT_EQ(true, it1->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<a> <a> <c>.", t.get_triple()->to_string(*(t.get_dictionary()))) << "Element is incorrect";
+
+    ASSERT_EQ(false, it1->next(&t)) << "Iterator should be finished";
+    delete it1;
+
+    // Request versions 1 to 2 for ? ? <b>
+    TripleVersionsIterator* it2 = controller->get_version_range(StringTriple("", "", "<b>"), 0, 1, 2);
+    ASSERT_EQ(false, it2->next(&t)) << "Triples that are not valid in the range must be skipped";
+    delete it2;
+
+    // Request version 0 for ? ? ?
+    TripleVersionsIterator* it3 = controller->get_version_range(StringTriple("", "", ""), 0, 0, 0);
+    ASSERT_EQ(2, it3->get_count()) << "Count is incorrect";
+    delete it3;
+
+    // Every version in the range must have the same triples as a version materialization query
+    std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(0);
+    for (const StringTriple& pattern : {StringTriple("", "", ""), StringTriple("<a>", "", ""), StringTriple("", "", "<b>")}) {
+        std::vector<std::set<std::string>> versions(5);
+        TripleVersionsIterator* it = controller->get_version_range(pattern, 0, 0, 4);
+        while (it->next(&t)) {
+            for (int version : *(t.get_versions())) {
+                versions[version].insert(t.get_triple()->to_string(*dict));
+            }
+        }
+        delete it;
+        for (int version = 0; version <= 4; version++) {
+            std::set<std::string> expected;
+            TripleIterator* vm_it = controller->get_version_materialized(pattern, 0, version);
+            Triple triple;
+            while (vm_it->next(&triple)) {
+                expected.insert(triple.to_string(*dict));
+            }
+            delete vm_it;
+            ASSERT_EQ(expected, versions[version]) << "Triples are incorrect for " << pattern.to_string() << " in version " << version;
+        }
+    }
+
+    ASSERT_THROW(controller->get_version_range(StringTriple("", "", ""), 0, 3, 1), std::invalid_argument);
+}
+
 
 TEST_F(ControllerMSTest, GetVersionMS) {
     controller->new_patch_bulk()
@@ -3314,6 +3573,495 @@ TEST_F(ControllerMSTest, GetVersionMS) {
 }
 
 
+TEST_F(ControllerMSTest, GetVersionCountNonAdjacentMS) {
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->commit();
+
+    // Expected version 0 (snapshot): <a> <a> <a>, <a> <a> <b>
+    // Expected version 1: <a> <a> <a>
+    // Expected version 2 (snapshot): <a> <a> <a>, <a> <a> <c>
+    // Expected version 3: <a> <a> <a>, <a> <a> <b>, <a> <a> <c>
+    // Expected version 4 (snapshot): <a> <a> <a>, <a> <a> <b>
+    // <a> <a> <b> appears in the first and the last delta chain, but not in the middle one.
+
+    ASSERT_EQ(3, controller->get_version_count(StringTriple("", "", "")).first) << "Count is incorrect";
+    ASSERT_EQ(hdt::EXACT, controller->get_version_count(StringTriple("", "", "")).second) << "Count should be exact";
+    ASSERT_EQ(1, controller->get_version_count(StringTriple("", "", "<b>")).first) << "Count is incorrect";
+    ASSERT_EQ(1, controller->get_version_count(StringTriple("", "", "<c>")).first) << "Count is incorrect";
+    ASSERT_EQ(0, controller->get_version_count(StringTriple("", "", "<d>")).first) << "Count is incorrect";
+}
+
+TEST_F(ControllerMSTest, PlanDeltaMaterializedMS) {
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    // Expected version 0 (snapshot): <a> <a> <a>, <a> <a> <b>
+    // Expected version 1: <a> <a> <a>
+    // Expected version 2 (snapshot): <a> <a> <a>, <a> <a> <c>
+    // Expected version 3: <a> <a> <a>, <a> <a> <b>, <a> <a> <c>
+
+    ASSERT_EQ(DELTA_PLAN_EMPTY, controller->plan_delta_materialized(StringTriple("", "", ""), 1, 1).chosen) << "Plan is incorrect";
+    ASSERT_EQ(DELTA_PLAN_SINGLE_CHAIN, controller->plan_delta_materialized(StringTriple("", "", ""), 0, 1).chosen) << "Plan is incorrect";
+
+    // The diff between snapshots 0 and 2 was stored when snapshot 2 was created
+    DeltaQueryPlan plan = controller->plan_delta_materialized(StringTriple("", "", ""), 1, 3);
+    ASSERT_EQ(DELTA_PLAN_PERSISTED_DIFF, plan.chosen) << plan.to_string();
+    ASSERT_EQ(4, plan.estimates.size()) << plan.to_string();
+    for (const DeltaPlanEstimate& estimate : plan.estimates) {
+        ASSERT_EQ(estimate.type != DELTA_PLAN_PLAIN_DIFF, estimate.feasible) << "Plain diffs need sorted versions: " << plan.to_string();
+    }
+
+    DeltaQueryPlan plan_snapshots = controller->plan_delta_materialized(StringTriple("", "", ""), 0, 2);
+    for (const DeltaPlanEstimate& estimate : plan_snapshots.estimates) {
+        ASSERT_EQ(true, estimate.feasible) << "All plans can be used for ? ? ? between snapshots: " << plan_snapshots.to_string();
+    }
+
+    // Plain diffs are only emitted in SPO order
+    DeltaQueryPlan plan_pos = controller->plan_delta_materialized(StringTriple("", "<a>", ""), 1, 3);
+    for (const DeltaPlanEstimate& estimate : plan_pos.estimates) {
+        ASSERT_EQ(estimate.type != DELTA_PLAN_PLAIN_DIFF, estimate.feasible) << plan_pos.to_string();
+    }
+}
+
+TEST_F(ControllerMSTest, PlanDeltaMaterializedPlainDiffMS) {
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<d>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<e>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->deletion(hdt::TripleString("<a>", "<a>", "<d>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<e>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    // Expected version 0 (snapshot): <a> <a> <a>, <a> <a> <b>
+    // Expected version 2 (snapshot): <a> <a> <a>, <a> <a> <c>, <a> <a> <d>, <a> <a> <e>
+    // Expected version 4 (snapshot): <a> <a> <a>, <a> <a> <b>
+    // The persisted diffs in between are larger than both snapshots, which are compared directly.
+    DeltaQueryPlan plan = controller->plan_delta_materialized(StringTriple("", "", ""), 0, 4);
+    ASSERT_EQ(DELTA_PLAN_PLAIN_DIFF, plan.chosen) << plan.to_string();
+
+    TripleDelta t;
+    TripleDeltaIterator* it = controller->get_delta_materialized(StringTriple("", "", ""), 0, 0, 4);
+    ASSERT_EQ(false, it->next(&t)) << "The delta should be empty";
+    delete it;
+}
+
+TEST_F(ControllerMSTest, GetDeltaMaterializedPlansMS) {
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->addition(hdt::TripleString("<b>", "<b>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->deletion(hdt::TripleString("<b>", "<b>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    // Expected version 1: <a> <a> <a>, <b> <b> <b>
+    // Expected version 3: <a> <a> <a>, <a> <a> <b>, <a> <a> <c>
+    auto collect = [](TripleDeltaIterator* it) {
+        std::vector<std::string> elements;
+        TripleDelta t;
+        while (it->next(&t)) {
+            elements.push_back((t.is_addition() ? "+ " : "- ") + t.get_triple()->to_string(*(t.get_dictionary())));
+        }
+        delete it;
+        return elements;
+    };
+
+    std::vector<std::string> expected = {"+ <a> <a> <b>.", "+ <a> <a> <c>.", "- <b> <b> <b>."};
+    ASSERT_EQ(expected, collect(controller->get_delta_materialized(StringTriple("", "", ""), 0, 1, 3))) << "Elements are incorrect";
+    for (DeltaPlanType plan : {DELTA_PLAN_PLAIN_DIFF, DELTA_PLAN_PERSISTED_DIFF, DELTA_PLAN_PATCH_TREE_DIFF, DELTA_PLAN_SNAPSHOT_SCAN_DIFF}) {
+        ASSERT_EQ(expected, collect(controller->get_delta_materialized(StringTriple("", "", ""), 0, 1, 3, plan)))
+                                    << "Elements are incorrect for plan " << DeltaQueryPlan::get_name(plan);
+    }
+
+    std::vector<std::string> expected_offset = {"+ <a> <a> <c>.", "- <b> <b> <b>."};
+    for (DeltaPlanType plan : {DELTA_PLAN_AUTO, DELTA_PLAN_PLAIN_DIFF, DELTA_PLAN_PERSISTED_DIFF, DELTA_PLAN_PATCH_TREE_DIFF, DELTA_PLAN_SNAPSHOT_SCAN_DIFF}) {
+        ASSERT_EQ(expected_offset, collect(controller->get_delta_materialized(StringTriple("", "", ""), 1, 1, 3, plan)))
+                                    << "Elements are incorrect for plan " << DeltaQueryPlan::get_name(plan);
+    }
+}
+
+TEST_F(ControllerMSTest, GetDeltaMaterializedUnsortedPatchMS) {
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<b>", "<b>", "<b>"))
+    ->commit();
+
+    // The addition sorts before the snapshot triple
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<c>", "<c>", "<c>"))
+    ->commit();
+
+    // Expected version 1: <a> <a> <a>, <b> <b> <b>
+    // Expected version 2 (snapshot): <a> <a> <a>, <b> <b> <b>, <c> <c> <c>
+    std::vector<std::string> expected = {"+ <c> <c> <c>."};
+    for (DeltaPlanType plan : {DELTA_PLAN_AUTO, DELTA_PLAN_PLAIN_DIFF, DELTA_PLAN_PERSISTED_DIFF, DELTA_PLAN_PATCH_TREE_DIFF, DELTA_PLAN_SNAPSHOT_SCAN_DIFF}) {
+        std::vector<std::string> elements;
+        TripleDeltaIterator* it = controller->get_delta_materialized(StringTriple("", "", ""), 0, 1, 2, plan);
+        TripleDelta t;
+        while (it->next(&t)) {
+            elements.push_back((t.is_addition() ? "+ " : "- ") + t.get_triple()->to_string(*(t.get_dictionary())));
+        }
+        delete it;
+        ASSERT_EQ(expected, elements) << "Elements are incorrect for plan " << DeltaQueryPlan::get_name(plan);
+    }
+}
+
+TEST_F(ControllerMSTest, BatchQueryGroupMS) {
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->addition(hdt::TripleString("<a>", "<b>", "<c>"))
+    ->commit();
+
+    std::vector<StringTriple> patterns = {
+            StringTriple("<a>", "<a>", ""),
+            StringTriple("<a>", "<b>", ""),
+            StringTriple("", "<a>", ""),
+            StringTriple("<a>", "<a>", ""),
+            StringTriple("", "", "<c>"),
+            StringTriple("<a>", "<b>", "<c>"),
+    };
+    std::vector<BatchQueryGroup> groups = BatchQuery(controller, patterns).group(0);
+
+    ASSERT_EQ(3, groups.size()) << "Groups are incorrect";
+    ASSERT_EQ(StringTriple("<a>", "", ""), groups[0].scan_pattern) << "Shared pattern is incorrect";
+    ASSERT_EQ(std::vector<size_t>({0, 1, 3, 5}), groups[0].patterns) << "Group is incorrect";
+    ASSERT_EQ(StringTriple("", "<a>", ""), groups[1].scan_pattern) << "Shared pattern is incorrect";
+    ASSERT_EQ(std::vector<size_t>({2}), groups[1].patterns) << "Group is incorrect";
+    ASSERT_EQ(StringTriple("", "", "<c>"), groups[2].scan_pattern) << "Shared pattern is incorrect";
+    ASSERT_EQ(std::vector<size_t>({4}), groups[2].patterns) << "Group is incorrect";
+
+    ASSERT_EQ(StringTriple("<a>", "<b>", ""), BatchQuery::get_shared_pattern({StringTriple("<a>", "<b>", "<c>"), StringTriple("<a>", "<b>", "")}));
+    ASSERT_EQ(StringTriple("", "<b>", ""), BatchQuery::get_shared_pattern({StringTriple("", "<b>", "<c>"), StringTriple("", "<b>", "<d>")}));
+    ASSERT_EQ(StringTriple("<a>", "", "<c>"), BatchQuery::get_shared_pattern({StringTriple("<a>", "", "<c>"), StringTriple("<a>", "", "<c>")}));
+}
+
+TEST_F(ControllerMSTest, BatchQueryMS) {
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->addition(hdt::TripleString("<a>", "<b>", "<b>"))
+    ->addition(hdt::TripleString("<b>", "<b>", "<b>"))
+    ->commit();
+
+    // The first addition sorts before the snapshot triples
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<0>", "<a>", "<a>"))
+    ->deletion(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->addition(hdt::TripleString("<a>", "<b>", "<d>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->deletion(hdt::TripleString("<b>", "<b>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->deletion(hdt::TripleString("<a>", "<b>", "<b>"))
+    ->commit();
+
+    std::vector<StringTriple> patterns = {
+            StringTriple("<a>", "<a>", ""),
+            StringTriple("<a>", "<b>", ""),
+            StringTriple("<a>", "", ""),
+            StringTriple("", "<b>", ""),
+            StringTriple("", "<b>", "<b>"),
+            StringTriple("", "", "<b>"),
+            StringTriple("<a>", "", "<b>"),
+            StringTriple("<z>", "", ""),
+            StringTriple("", "", ""),
+    };
+
+    // Each pattern must have the same results as when it is queried separately
+    for (int patch_id = 0; patch_id <= 3; patch_id++) {
+        std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(patch_id);
+        std::vector<std::vector<Triple>> results = controller->get_version_materialized_batch(patterns, patch_id);
+        ASSERT_EQ(patterns.size(), results.size()) << "Number of results is incorrect";
+        for (size_t i = 0; i < patterns.size(); i++) {
+            std::multiset<std::string> expected;
+            TripleIterator* it = controller->get_version_materialized(patterns[i], 0, patch_id);
+            Triple t;
+            while (it->next(&t)) {
+                expected.insert(t.to_string(*dict));
+            }
+            delete it;
+            std::multiset<std::string> actual;
+            for (const Triple& triple : results[i]) {
+                actual.insert(triple.to_string(*dict));
+            }
+            ASSERT_EQ(expected, actual) << "Results are incorrect for " << patterns[i].to_string() << " in version " << patch_id;
+        }
+    }
+
+    for (int patch_id_start = 0; patch_id_start <= 3; patch_id_start++) {
+        for (int patch_id_end = patch_id_start + 1; patch_id_end <= 3; patch_id_end++) {
+            std::vector<std::vector<BatchTripleDelta>> results = controller->get_delta_materialized_batch(patterns, patch_id_start, patch_id_end);
+            ASSERT_EQ(patterns.size(), results.size()) << "Number of results is incorrect";
+            for (size_t i = 0; i < patterns.size(); i++) {
+                // The delta is derived from both materialized versions, independently of the delta plans
+                std::set<std::string> version_start;
+                std::set<std::string> version_end;
+                for (int patch_id : {patch_id_start, patch_id_end}) {
+                    std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(patch_id);
+                    TripleIterator* it = controller->get_version_materialized(patterns[i], 0, patch_id);
+                    Triple t;
+                    while (it->next(&t)) {
+                        (patch_id == patch_id_start ? version_start : version_end).insert(t.to_string(*dict));
+                    }
+                    delete it;
+                }
+                std::multiset<std::string> expected;
+                for (const std::string& triple : version_start) {
+                    if (version_end.find(triple) == version_end.end()) {
+                        expected.insert("- " + triple);
+                    }
+                }
+                for (const std::string& triple : version_end) {
+                    if (version_start.find(triple) == version_start.end()) {
+                        expected.insert("+ " + triple);
+                    }
+                }
+                std::multiset<std::string> actual;
+                for (const BatchTripleDelta& element : results[i]) {
+                    actual.insert((element.addition ? "+ " : "- ") + element.triple.to_string(*(element.dict)));
+                }
+                ASSERT_EQ(expected, actual) << "Results are incorrect for " << patterns[i].to_string()
+                                            << " between versions " << patch_id_start << " and " << patch_id_end;
+            }
+        }
+    }
+}
+
+TEST_F(ControllerMSTest, AsyncSnapshotCreationMS) {
+    controller->set_async_snapshot_creation(true);
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    // Triggers the creation of snapshot 2 in the background
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->commit();
+
+    // Can be provisionally appended to the previous delta chain
+    PatchBuilder* builder = controller->new_patch_bulk();
+    bool pending = controller->is_snapshot_creation_pending();
+    builder->addition(hdt::TripleString("<a>", "<a>", "<d>"))
+    ->deletion(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->commit();
+    if (pending) {
+        ASSERT_EQ(0, controller->get_snapshot_manager()->get_latest_snapshot(3)) << "Snapshot should not be visible yet";
+    }
+
+    ASSERT_EQ(true, controller->finish_snapshot_creation());
+    ASSERT_EQ(false, controller->is_snapshot_creation_pending());
+    ASSERT_EQ(2, controller->get_snapshot_manager()->get_latest_snapshot(3)) << "Snapshot should be registered";
+
+    Triple t;
+
+    // Expected version 2 (snapshot): <a> <a> <a>, <a> <a> <c>
+    std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(2);
+    ASSERT_EQ(2, controller->get_version_materialized_count(StringTriple("", "", ""), 2).first) << "Count is incorrect";
+    TripleIterator* it2 = controller->get_version_materialized(StringTriple("", "", ""), 0, 2);
+    ASSERT_EQ(true, it2->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<a> <a> <a>.", t.to_string(*dict)) << "Element is incorrect";
+    ASSERT_EQ(true, it2->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<a> <a> <c>.", t.to_string(*dict)) << "Element is incorrect";
+    ASSERT_EQ(false, it2->next(&t)) << "Iterator should be finished";
+    delete it2;
+
+    // Expected version 3 (rebased patch): <a> <a> <c>, <a> <a> <d>
+    ASSERT_EQ(2, controller->get_version_materialized_count(StringTriple("", "", ""), 3).first) << "Count is incorrect";
+    TripleIterator* it3 = controller->get_version_materialized(StringTriple("", "", ""), 0, 3);
+    ASSERT_EQ(true, it3->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<a> <a> <c>.", t.to_string(*dict)) << "Element is incorrect";
+    ASSERT_EQ(true, it3->next(&t)) << "Iterator has a no next value";
+    ASSERT_EQ("<a> <a> <d>.", t.to_string(*dict)) << "Element is incorrect";
+    ASSERT_EQ(false, it3->next(&t)) << "Iterator should be finished";
+    delete it3;
+}
+
+TEST_F(ControllerMSTest, AsyncSnapshotCreationVersionsMS) {
+    controller->set_async_snapshot_creation(true);
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->addition(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->deletion(hdt::TripleString("<a>", "<a>", "<b>"))
+    ->commit();
+
+    // Triggers the creation of snapshot 2 in the background
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<c>"))
+    ->commit();
+
+    // Provisionally appended to the previous delta chain, and kept there after rebasing
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<d>"))
+    ->deletion(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->commit();
+
+    ASSERT_EQ(true, controller->finish_snapshot_creation());
+
+    // Versions beyond snapshot 2 must only be taken from the new delta chain
+    std::vector<std::pair<std::string, std::vector<int>>> expected_versions = {
+            {"<a> <a> <a>.", {0, 1, 2}},
+            {"<a> <a> <b>.", {0}},
+            {"<a> <a> <c>.", {2, 3}},
+            {"<a> <a> <d>.", {3}},
+    };
+    ASSERT_EQ(4, controller->get_version_count(StringTriple("", "", "")).first) << "Count is incorrect";
+    std::vector<std::pair<std::string, std::vector<int>>> versions;
+    TripleVersionsIterator* it = controller->get_version(StringTriple("", "", ""), 0);
+    TripleVersions tv;
+    while (it->next(&tv)) {
+        versions.emplace_back(tv.get_triple()->to_string(*(tv.get_dictionary())), *(tv.get_versions()));
+    }
+    delete it;
+    ASSERT_EQ(expected_versions, versions) << "Versions are incorrect";
+
+    // Deltas from the previous delta chain to the rebased patch
+    std::map<std::pair<int, int>, std::vector<std::string>> expected_deltas = {
+            {{1, 3}, {"+ <a> <a> <c>.", "+ <a> <a> <d>.", "- <a> <a> <a>."}},
+            {{2, 3}, {"+ <a> <a> <d>.", "- <a> <a> <a>."}},
+            {{0, 3}, {"+ <a> <a> <c>.", "+ <a> <a> <d>.", "- <a> <a> <a>.", "- <a> <a> <b>."}},
+    };
+    for (auto& expected : expected_deltas) {
+        for (DeltaPlanType plan : {DELTA_PLAN_AUTO, DELTA_PLAN_PLAIN_DIFF, DELTA_PLAN_PERSISTED_DIFF, DELTA_PLAN_PATCH_TREE_DIFF, DELTA_PLAN_SNAPSHOT_SCAN_DIFF}) {
+            std::vector<std::string> elements;
+            TripleDeltaIterator* dm_it = controller->get_delta_materialized(StringTriple("", "", ""), 0, expected.first.first, expected.first.second, plan);
+            TripleDelta t;
+            while (dm_it->next(&t)) {
+                elements.push_back((t.is_addition() ? "+ " : "- ") + t.get_triple()->to_string(*(t.get_dictionary())));
+            }
+            delete dm_it;
+            std::sort(elements.begin(), elements.end());
+            ASSERT_EQ(expected.second, elements) << "Elements are incorrect for " << expected.first.first << "-" << expected.first.second
+                                                 << " with plan " << DeltaQueryPlan::get_name(plan);
+        }
+    }
+}
+
+TEST_F(ControllerMSTest, AsyncSnapshotCreationAppendMS) {
+    controller->set_async_snapshot_creation(true);
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<a>"))
+    ->commit();
+
+    controller->new_patch_bulk()
+    ->addition(hdt::TripleString("<a>", "<a>", "<o1>"))
+    ->commit();
+
+    // Triggers the creation of snapshot 2 in the background.
+    // The following patches are appended directly, so only append registers the snapshots.
+    for (int patch_id = 2; patch_id <= 6; patch_id++) {
+        if (patch_id > 2) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(
+                controller->get_snapshot_manager()->get_latest_snapshot(patch_id - 1));
+        PatchSorted patch(dict);
+        patch.add_unsorted(PatchElement(Triple("<a>", "<a>", "<o" + std::to_string(patch_id - 1) + ">", dict), false));
+        patch.add_unsorted(PatchElement(Triple("<a>", "<a>", "<o" + std::to_string(patch_id) + ">", dict), true));
+        patch.sort();
+        ASSERT_EQ(true, controller->append(patch, patch_id, dict)) << "Append of patch " << patch_id << " failed";
+    }
+    ASSERT_EQ(true, controller->finish_snapshot_creation());
+
+    // A snapshot after the one that was pending when appending patch 3 must have been triggered
+    ASSERT_EQ(2, controller->get_snapshot_manager()->get_latest_snapshot(3)) << "Snapshot 2 should be registered";
+    ASSERT_LT(2, controller->get_snapshot_manager()->get_latest_snapshot(6)) << "A second snapshot should be registered";
+
+    // Expected version n >= 1: <a> <a> <a>, <a> <a> <on>
+    for (int patch_id = 1; patch_id <= 6; patch_id++) {
+        std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(
+                controller->get_snapshot_manager()->get_latest_snapshot(patch_id));
+        ASSERT_EQ(2, controller->get_version_materialized_count(StringTriple("", "", ""), patch_id).first) << "Count is incorrect for version " << patch_id;
+        std::set<std::string> expected = {"<a> <a> <a>.", "<a> <a> <o" + std::to_string(patch_id) + ">."};
+        std::set<std::string> actual;
+        TripleIterator* it = controller->get_version_materialized(StringTriple("", "", ""), 0, patch_id);
+        Triple t;
+        while (it->next(&t)) {
+            actual.insert(t.to_string(*dict));
+        }
+        delete it;
+        ASSERT_EQ(expected, actual) << "Elements are incorrect for version " << patch_id;
+    }
+}
+
 TEST_F(ControllerMSTest2, GetVersionMS2) {
     // 0
     // <a> <a> <a>
@@ -3502,3 +4250,44 @@ TEST_F(ControllerMSTest2, GetVersionMS3) {
 
     ASSERT_EQ(false, it0->next(&t)) << "Iterator should be finished";
 }
+
+TEST_F(ControllerTest, Metrics) {
+    controller->new_patch_bulk()
+            ->addition(hdt::TripleString("a", "a", "a"))
+            ->addition(hdt::TripleString("b", "b", "b"))
+            ->commit();
+    controller->new_patch_bulk()
+            ->deletion(hdt::TripleString("a", "a", "a"))
+            ->addition(hdt::TripleString("c", "c", "c"))
+            ->commit();
+
+    std::shared_ptr<DictionaryManager> dict = controller->get_dictionary_manager(0);
+    TripleIterator* it = controller->get_version_materialized(Triple("", "", "", dict), 0, 1);
+    Triple t;
+    while (it->next(&t));
+    delete it;
+
+    StoreMetrics metrics = controller->get_metrics();
+    ASSERT_EQ(1, metrics.snapshots.loaded) << "The snapshot must be loaded";
+    ASSERT_LE(1, metrics.snapshots.misses) << "Loading the snapshot must count as a miss";
+    ASSERT_LE(1, metrics.snapshots.hits) << "Queries must hit the snapshot cache";
+    ASSERT_EQ(1, metrics.patch_trees.loaded) << "The patch tree must be loaded";
+    ASSERT_EQ(KC_TREE_COUNT, metrics.trees.size()) << "All KC trees of the patch tree must be reported";
+    int64_t records = 0;
+    for (const TreeMetrics& tree : metrics.trees) {
+        records += tree.records;
+    }
+    ASSERT_EQ(3 * 2, records) << "The addition and deletion must be stored in three trees";
+    ASSERT_EQ(1, metrics.dictionaries.count(0)) << "The dictionary lookups must be reported";
+    ASSERT_LE(1, metrics.dictionaries[0].hdt + metrics.dictionaries[0].patch + metrics.dictionaries[0].misses) << "Terms must be looked up";
+    ASSERT_EQ(1, metrics.ingest.appends) << "The patch must be counted";
+    ASSERT_EQ(2, metrics.ingest.elements) << "The patch elements must be counted";
+    ASSERT_EQ(0, metrics.ingest.failed_appends) << "The patch must be appended";
+
+    std::ostringstream json;
+    metrics.write_json(json);
+    ASSERT_EQ(0, json.str().find("{\"snapshots\":{\"hits\":")) << "Metrics must be written as JSON";
+    std::ostringstream prometheus;
+    metrics.write_prometheus(prometheus);
+    ASSERT_NE(std::string::npos, prometheus.str().find("ostrich_ingest_appends_total 1\n")) << "Metrics must be written in the Prometheus format";
+}
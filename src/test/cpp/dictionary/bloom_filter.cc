@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/dictionary/bloom_filter.h"
+
+// The fixture for testing class BloomFilter.
+class BloomFilterTest : public ::testing::Test {
+protected:
+    BloomFilter* filter;
+
+    BloomFilterTest() : filter(new BloomFilter(1000, 0.01)) {}
+
+    virtual void TearDown() {
+        delete filter;
+    }
+};
+
+TEST_F(BloomFilterTest, NoFalseNegatives) {
+    for (int i = 0; i < 1000; i++) {
+        filter->add("http://example.org/" + std::to_string(i));
+    }
+    for (int i = 0; i < 1000; i++) {
+        ASSERT_EQ(true, filter->might_contain("http://example.org/" + std::to_string(i))) << "Element " << i << " must be contained";
+    }
+}
+
+TEST_F(BloomFilterTest, FalsePositiveRate) {
+    for (int i = 0; i < 1000; i++) {
+        filter->add("http://example.org/" + std::to_string(i));
+    }
+    int false_positives = 0;
+    for (int i = 1000; i < 11000; i++) {
+        if (filter->might_contain("http://example.org/" + std::to_string(i))) {
+            false_positives++;
+        }
+    }
+    // Allow some margin above the targeted rate of 1%
+    ASSERT_LT(false_positives, 300) << "False positive rate is too high";
+}
+
+TEST_F(BloomFilterTest, Tags) {
+    filter->add("a", 0);
+    filter->add("b", 1);
+    ASSERT_EQ(true, filter->might_contain("a", 0)) << "Element must be contained";
+    ASSERT_EQ(true, filter->might_contain("b", 1)) << "Element must be contained";
+
+    int false_positives = 0;
+    for (size_t tag = 2; tag < 100; tag++) {
+        if (filter->might_contain("a", tag)) {
+            false_positives++;
+        }
+    }
+    ASSERT_LT(false_positives, 10) << "Tags must be separated";
+}
+
+TEST_F(BloomFilterTest, Empty) {
+    BloomFilter empty(0, 0.01);
+    ASSERT_EQ(false, empty.might_contain("a")) << "Empty filter must not contain anything";
+    ASSERT_LT(0, empty.get_size()) << "Filter must have bits";
+}
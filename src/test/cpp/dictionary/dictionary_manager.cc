@@ -7,6 +7,7 @@
 #include <hdt/BasicHDT.hpp>
 #include <dictionary/PlainDictionary.hpp>
 #include <gtest/gtest.h>
+#include <fstream>
 
 #define TESTPATH "./"
 
@@ -23,6 +24,8 @@ protected:
 
     virtual void SetUp() {
         std::remove((TESTPATH + PATCHDICT_FILENAME_BASE(0)).c_str());
+        std::remove((TESTPATH + PATCHDICT_LOG_FILENAME_BASE(0)).c_str());
+        std::remove((TESTPATH + PATCHDICT_MAPPED_FILENAME_BASE(0)).c_str());
         dict = new DictionaryManager(TESTPATH, 0);
 
         a = "http://example.org/a";
@@ -44,6 +47,8 @@ protected:
 
     virtual void TearDown() {
         std::remove((TESTPATH + PATCHDICT_FILENAME_BASE(0)).c_str());
+        std::remove((TESTPATH + PATCHDICT_LOG_FILENAME_BASE(0)).c_str());
+        std::remove((TESTPATH + PATCHDICT_MAPPED_FILENAME_BASE(0)).c_str());
     }
 };
 
@@ -264,3 +269,118 @@ TEST_F(DictionaryManagerTest, SaveAndLoad) {
     EXPECT_EQ(3, dict->stringToId(h, PREDICATE));
     EXPECT_EQ(3, dict->stringToId(i, OBJECT));
 }
+
+TEST_F(DictionaryManagerTest, SaveAppendsToLog) {
+    delete dict;
+    dict = new DictionaryManager(TESTPATH, 0);
+    dict->insert(a, SUBJECT);
+    dict->insert(b, PREDICATE);
+    delete dict;
+
+    // Only the log must have been written
+    EXPECT_EQ(false, std::ifstream(TESTPATH + PATCHDICT_FILENAME_BASE(0)).good());
+    EXPECT_EQ(true, std::ifstream(TESTPATH + PATCHDICT_LOG_FILENAME_BASE(0)).good());
+
+    dict = new DictionaryManager(TESTPATH, 0);
+    dict->insert(c, OBJECT);
+    dict->insert(d, SUBJECT);
+    delete dict;
+
+    dict = new DictionaryManager(TESTPATH, 0);
+    EXPECT_EQ(1, dict->stringToId(a, SUBJECT));
+    EXPECT_EQ(1, dict->stringToId(b, PREDICATE));
+    EXPECT_EQ(1, dict->stringToId(c, OBJECT));
+    EXPECT_EQ(2, dict->stringToId(d, SUBJECT));
+}
+
+TEST_F(DictionaryManagerTest, CompactAndReplay) {
+    delete dict;
+    dict = new DictionaryManager(TESTPATH, 0);
+    dict->insert(a, SUBJECT);
+    dict->insert(b, SUBJECT);
+    dict->compact();
+
+    EXPECT_EQ(true, std::ifstream(TESTPATH + PATCHDICT_MAPPED_FILENAME_BASE(0)).good());
+    EXPECT_EQ(false, std::ifstream(TESTPATH + PATCHDICT_LOG_FILENAME_BASE(0)).good());
+
+    dict->insert(c, SUBJECT);
+    delete dict;
+
+    // The base file and the log are combined
+    dict = new DictionaryManager(TESTPATH, 0);
+    EXPECT_EQ(1, dict->stringToId(a, SUBJECT));
+    EXPECT_EQ(2, dict->stringToId(b, SUBJECT));
+    EXPECT_EQ(3, dict->stringToId(c, SUBJECT));
+}
+
+TEST_F(DictionaryManagerTest, CompactedLookup) {
+    delete dict;
+    dict = new DictionaryManager(TESTPATH, 0);
+    size_t id_a = dict->insert(a, SUBJECT);
+    size_t id_b = dict->insert(b, OBJECT);
+    dict->compact();
+    size_t id_c = dict->insert(c, SUBJECT);
+    dict->compact();
+    size_t id_d = dict->insert(d, SUBJECT);
+    delete dict;
+
+    // Terms from the mapped file and from the log keep their IDs
+    dict = new DictionaryManager(TESTPATH, 0);
+    EXPECT_EQ(id_a, dict->stringToId(a, SUBJECT));
+    EXPECT_EQ(id_b, dict->stringToId(b, OBJECT));
+    EXPECT_EQ(id_c, dict->stringToId(c, SUBJECT));
+    EXPECT_EQ(id_d, dict->stringToId(d, SUBJECT));
+    EXPECT_EQ(a, dict->idToString(id_a, SUBJECT));
+    EXPECT_EQ(b, dict->idToString(id_b, OBJECT));
+    EXPECT_EQ(c, dict->idToString(id_c, SUBJECT));
+    EXPECT_EQ(d, dict->idToString(id_d, SUBJECT));
+    EXPECT_EQ(id_a, dict->insert(a, SUBJECT)) << "Existing terms must not be inserted again";
+    EXPECT_EQ(4, dict->insert(e, SUBJECT));
+    EXPECT_EQ(4, dict->getMaxSubjectID());
+    EXPECT_EQ(1, dict->getMaxObjectID());
+}
+
+TEST_F(DictionaryManagerTest, CompactedCounts) {
+    delete dict;
+    dict = new DictionaryManager(TESTPATH, 0);
+    uint64_t empty_size = dict->size();
+    dict->insert(a, SUBJECT);
+    dict->insert(b, OBJECT);
+    dict->insert(literal, OBJECT);
+    dict->insert(literal2, OBJECT);
+    dict->compact();
+    delete dict;
+
+    // The counts include the terms in the mapped file
+    dict = new DictionaryManager(TESTPATH, 0);
+    EXPECT_LT(empty_size, dict->size());
+    EXPECT_EQ(1, dict->getNsubjects());
+    EXPECT_EQ(3, dict->getNobjects());
+    EXPECT_EQ(2, dict->getNobjectsLiterals());
+    EXPECT_EQ(1, dict->getNobjectsNotLiterals());
+}
+
+TEST_F(DictionaryManagerTest, ReplayIgnoresIncompleteRecord) {
+    delete dict;
+    dict = new DictionaryManager(TESTPATH, 0);
+    dict->insert(a, SUBJECT);
+    dict->insert(b, SUBJECT);
+    delete dict;
+
+    // Simulate a crash while appending a record
+    {
+        std::ofstream log(TESTPATH + PATCHDICT_LOG_FILENAME_BASE(0), std::ios::app | std::ios::binary);
+        log.put((char) SUBJECT);
+        log.put((char) 100);
+    }
+
+    dict = new DictionaryManager(TESTPATH, 0);
+    EXPECT_EQ(1, dict->stringToId(a, SUBJECT));
+    EXPECT_EQ(2, dict->stringToId(b, SUBJECT));
+    EXPECT_EQ(3, dict->insert(c, SUBJECT));
+    delete dict;
+
+    // New records must follow the valid ones
+    dict = new DictionaryManager(TESTPATH, 0);
+    EXPECT_EQ(3, dict->stringToId(c, SUBJECT));
+}
@@ -0,0 +1,107 @@
+#include <fstream>
+#include <gtest/gtest.h>
+#include <HDTManager.hpp>
+#include <hdt/BasicHDT.hpp>
+#include "../../../main/cpp/dictionary/id_translation_map.h"
+#include "../../../main/cpp/snapshot/vector_triple_iterator.h"
+
+#define TESTPATH "./"
+#define TESTFILE (TESTPATH + SNAPSHOT_ID_MAP_FILENAME(0, 1))
+
+using namespace hdt;
+
+class IdTranslationMapTest : public ::testing::Test {
+protected:
+    HDT* hdt1;
+    HDT* hdt2;
+
+    IdTranslationMapTest() : hdt1(nullptr), hdt2(nullptr) {}
+
+    static HDT* build_hdt(std::vector<TripleString> triples, const std::string& file_name) {
+        VectorTripleIterator* it = new VectorTripleIterator(triples);
+        BasicHDT* basicHdt = new BasicHDT();
+        basicHdt->loadFromTriples(it, "<http://example.org>");
+        basicHdt->saveToHDT((TESTPATH + file_name).c_str());
+        delete basicHdt;
+        return HDTManager::mapHDT((TESTPATH + file_name).c_str());
+    }
+
+    virtual void SetUp() {
+        std::vector<TripleString> triples1;
+        triples1.push_back(TripleString("a", "p", "b"));
+        triples1.push_back(TripleString("b", "p", "c"));
+        triples1.push_back(TripleString("d", "q", "\"literal\""));
+        hdt1 = build_hdt(triples1, "temp1.hdt");
+
+        std::vector<TripleString> triples2;
+        triples2.push_back(TripleString("a", "p", "c"));
+        triples2.push_back(TripleString("c", "r", "e"));
+        triples2.push_back(TripleString("e", "q", "\"literal\""));
+        triples2.push_back(TripleString("f", "p", "a"));
+        hdt2 = build_hdt(triples2, "temp2.hdt");
+    }
+
+    virtual void TearDown() {
+        delete hdt1;
+        delete hdt2;
+        std::remove((TESTPATH + std::string("temp1.hdt")).c_str());
+        std::remove((TESTPATH + std::string("temp2.hdt")).c_str());
+        std::remove(TESTFILE.c_str());
+    }
+
+    static size_t max_id(Dictionary* dict, TripleComponentRole role) {
+        return role == SUBJECT ? dict->getMaxSubjectID() : (role == PREDICATE ? dict->getMaxPredicateID() : dict->getMaxObjectID());
+    }
+};
+
+TEST_F(IdTranslationMapTest, Compare) {
+    IdTranslationMap::build(hdt1->getDictionary(), hdt2->getDictionary(), 0, 1, TESTFILE);
+    IdTranslationMap map(TESTFILE);
+    ASSERT_EQ(0, map.get_from_snapshot());
+    ASSERT_EQ(1, map.get_to_snapshot());
+
+    // The ranks must order the terms exactly like comparing their strings does
+    for (TripleComponentRole role : {SUBJECT, PREDICATE, OBJECT}) {
+        for (size_t id1 = 1; id1 <= max_id(hdt1->getDictionary(), role); id1++) {
+            for (size_t id2 = 1; id2 <= max_id(hdt2->getDictionary(), role); id2++) {
+                std::string term1 = hdt1->getDictionary()->idToString(id1, role);
+                std::string term2 = hdt2->getDictionary()->idToString(id2, role);
+                int expected = term1.compare(term2);
+                int32_t result;
+                ASSERT_EQ(true, map.compare(id1, id2, role, result)) << "Both IDs must be covered";
+                ASSERT_EQ(expected < 0, result < 0) << "Wrong order of " << term1 << " and " << term2;
+                ASSERT_EQ(expected == 0, result == 0) << "Wrong equality of " << term1 << " and " << term2;
+            }
+        }
+    }
+}
+
+TEST_F(IdTranslationMapTest, CompareUnknown) {
+    IdTranslationMap::build(hdt1->getDictionary(), hdt2->getDictionary(), 0, 1, TESTFILE);
+    IdTranslationMap map(TESTFILE);
+    int32_t result;
+    ASSERT_EQ(false, map.compare(0, 1, SUBJECT, result)) << "Variables are not covered";
+    ASSERT_EQ(false, map.compare(1, hdt2->getDictionary()->getMaxSubjectID() + 1, SUBJECT, result)) << "Patch IDs are not covered";
+}
+
+TEST_F(IdTranslationMapTest, Translate) {
+    IdTranslationMap::build(hdt1->getDictionary(), hdt2->getDictionary(), 0, 1, TESTFILE);
+    IdTranslationMap map(TESTFILE);
+    Dictionary* dict1 = hdt1->getDictionary();
+    Dictionary* dict2 = hdt2->getDictionary();
+
+    ASSERT_EQ(dict2->stringToId("a", SUBJECT), map.translate(dict1->stringToId("a", SUBJECT), SUBJECT));
+    ASSERT_EQ(dict2->stringToId("c", OBJECT), map.translate(dict1->stringToId("c", OBJECT), OBJECT));
+    ASSERT_EQ(dict2->stringToId("q", PREDICATE), map.translate(dict1->stringToId("q", PREDICATE), PREDICATE));
+    ASSERT_EQ(dict2->stringToId("\"literal\"", OBJECT), map.translate(dict1->stringToId("\"literal\"", OBJECT), OBJECT));
+    ASSERT_EQ(0, map.translate(dict1->stringToId("d", SUBJECT), SUBJECT)) << "Removed terms have no translation";
+    ASSERT_EQ(0, map.translate(0, SUBJECT));
+}
+
+TEST_F(IdTranslationMapTest, Invalid) {
+    {
+        std::ofstream file(TESTFILE);
+        file << "invalid";
+    }
+    ASSERT_THROW(IdTranslationMap map(TESTFILE), std::runtime_error);
+}
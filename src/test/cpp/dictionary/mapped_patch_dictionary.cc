@@ -0,0 +1,91 @@
+#include <gtest/gtest.h>
+#include <fstream>
+
+#include "../../../main/cpp/dictionary/mapped_patch_dictionary.h"
+
+#define TESTPATH "./"
+#define TESTFILE (TESTPATH + PATCHDICT_MAPPED_FILENAME_BASE(0))
+
+// The fixture for testing class MappedPatchDictionary.
+class MappedPatchDictionaryTest : public ::testing::Test {
+protected:
+    std::array<std::vector<std::string>, 3> terms;
+
+    virtual void SetUp() {
+        // More terms than fit in a block, with shared prefixes, in no particular order
+        for (int i = 0; i < 3 * PATCHDICT_MAPPED_BLOCK_SIZE + 5; i++) {
+            terms[hdt::SUBJECT].push_back("http://example.org/s" + std::to_string((i * 7) % 53));
+        }
+        terms[hdt::PREDICATE].push_back("http://example.org/p");
+        terms[hdt::OBJECT].push_back("\"literal\"");
+        terms[hdt::OBJECT].push_back("http://example.org/o");
+        terms[hdt::OBJECT].push_back("http://example.org/");
+        terms[hdt::OBJECT].push_back("http://example.org/o2");
+        MappedPatchDictionary::write(TESTFILE, terms);
+    }
+
+    virtual void TearDown() {
+        std::remove(TESTFILE.c_str());
+    }
+};
+
+TEST_F(MappedPatchDictionaryTest, Counts) {
+    MappedPatchDictionary dict(TESTFILE);
+    ASSERT_EQ(terms[hdt::SUBJECT].size(), dict.get_count(hdt::SUBJECT));
+    ASSERT_EQ(1, dict.get_count(hdt::PREDICATE));
+    ASSERT_EQ(4, dict.get_count(hdt::OBJECT));
+    ASSERT_EQ(terms[hdt::SUBJECT].size() + 5, dict.get_total_count());
+}
+
+TEST_F(MappedPatchDictionaryTest, IdToString) {
+    MappedPatchDictionary dict(TESTFILE);
+    for (auto role : {hdt::SUBJECT, hdt::PREDICATE, hdt::OBJECT}) {
+        for (size_t id = 1; id <= terms[role].size(); id++) {
+            ASSERT_EQ(terms[role][id - 1], dict.id_to_string(id, role)) << "Term " << id << " is incorrect";
+        }
+    }
+    ASSERT_EQ("", dict.id_to_string(0, hdt::OBJECT)) << "Unknown ID must be empty";
+    ASSERT_EQ("", dict.id_to_string(5, hdt::OBJECT)) << "Unknown ID must be empty";
+}
+
+TEST_F(MappedPatchDictionaryTest, StringToId) {
+    MappedPatchDictionary dict(TESTFILE);
+    for (auto role : {hdt::SUBJECT, hdt::PREDICATE, hdt::OBJECT}) {
+        for (size_t id = 1; id <= terms[role].size(); id++) {
+            ASSERT_EQ(id, dict.string_to_id(terms[role][id - 1], role)) << "ID of " << terms[role][id - 1] << " is incorrect";
+        }
+    }
+    ASSERT_EQ(0, dict.string_to_id("http://example.org/p", hdt::SUBJECT)) << "Terms must be separated by role";
+    ASSERT_EQ(0, dict.string_to_id("http://example.org/o3", hdt::OBJECT)) << "Unknown term must be 0";
+    ASSERT_EQ(0, dict.string_to_id("", hdt::OBJECT)) << "Unknown term must be 0";
+}
+
+TEST_F(MappedPatchDictionaryTest, SharedAndLiterals) {
+    std::array<std::vector<std::string>, 3> shared;
+    shared[hdt::SUBJECT] = {"http://example.org/b", "_:c", "http://example.org/a"};
+    shared[hdt::OBJECT] = {"\"x\"", "http://example.org/b", "\"y\"@en", "_:c", "http://example.org/d"};
+    MappedPatchDictionary::write(TESTFILE, shared);
+    MappedPatchDictionary dict(TESTFILE);
+    ASSERT_EQ(2, dict.get_shared_count());
+    ASSERT_EQ(2, dict.get_literal_count());
+    ASSERT_LT(0, dict.get_data_size());
+}
+
+TEST_F(MappedPatchDictionaryTest, Empty) {
+    std::array<std::vector<std::string>, 3> empty;
+    MappedPatchDictionary::write(TESTFILE, empty);
+    MappedPatchDictionary dict(TESTFILE);
+    ASSERT_EQ(0, dict.get_total_count());
+    ASSERT_EQ(0, dict.get_shared_count());
+    ASSERT_EQ(0, dict.get_literal_count());
+    ASSERT_EQ(0, dict.string_to_id("a", hdt::SUBJECT));
+    ASSERT_EQ("", dict.id_to_string(1, hdt::SUBJECT));
+}
+
+TEST_F(MappedPatchDictionaryTest, Invalid) {
+    {
+        std::ofstream out(TESTFILE, std::ios::binary | std::ios::trunc);
+        out << "not a dictionary";
+    }
+    ASSERT_THROW(MappedPatchDictionary dict(TESTFILE), std::runtime_error);
+}
@@ -0,0 +1,97 @@
+#include <gtest/gtest.h>
+#include <thread>
+
+#include "../../../main/cpp/dictionary/term_cache.h"
+
+// The fixture for testing class TermCache.
+class TermCacheTest : public ::testing::Test {
+protected:
+    TermCache* cache;
+
+    // A single shard, so that the eviction order is predictable
+    TermCacheTest() : cache(new TermCache(4 * (TERM_CACHE_ENTRY_OVERHEAD + 1), 1)) {}
+
+    virtual void TearDown() {
+        delete cache;
+    }
+};
+
+TEST_F(TermCacheTest, GetAndPut) {
+    std::string value;
+    ASSERT_EQ(false, cache->get(1, value)) << "Empty cache must not contain anything";
+    cache->put(1, "a");
+    cache->put(2, "b");
+    ASSERT_EQ(true, cache->get(1, value)) << "Term must be cached";
+    ASSERT_EQ("a", value) << "Term is incorrect";
+    ASSERT_EQ(true, cache->get(2, value)) << "Term must be cached";
+    ASSERT_EQ("b", value) << "Term is incorrect";
+    ASSERT_EQ(false, cache->get(3, value)) << "Term must not be cached";
+
+    ASSERT_EQ(2, cache->get_hits()) << "Hit count is incorrect";
+    ASSERT_EQ(2, cache->get_misses()) << "Miss count is incorrect";
+    ASSERT_EQ(0.5, cache->get_hit_rate()) << "Hit rate is incorrect";
+}
+
+TEST_F(TermCacheTest, EvictUnreferenced) {
+    std::string value;
+    cache->put(1, "a");
+    cache->put(2, "b");
+    cache->put(3, "c");
+    cache->put(4, "d");
+    ASSERT_EQ(cache->get_capacity(), cache->get_size()) << "Cache must be full";
+
+    // Reference all but 2, which must be evicted first
+    cache->get(1, value);
+    cache->get(3, value);
+    cache->get(4, value);
+    cache->put(5, "e");
+
+    ASSERT_EQ(false, cache->get(2, value)) << "Unreferenced term must be evicted";
+    ASSERT_EQ(true, cache->get(1, value)) << "Referenced term must be cached";
+    ASSERT_EQ(true, cache->get(3, value)) << "Referenced term must be cached";
+    ASSERT_EQ(true, cache->get(4, value)) << "Referenced term must be cached";
+    ASSERT_EQ(true, cache->get(5, value)) << "New term must be cached";
+}
+
+TEST_F(TermCacheTest, TooLarge) {
+    std::string value;
+    cache->put(1, std::string(cache->get_capacity(), 'a'));
+    ASSERT_EQ(false, cache->get(1, value)) << "Terms larger than the cache must not be cached";
+    ASSERT_EQ(0, cache->get_size()) << "Cache must be empty";
+}
+
+TEST_F(TermCacheTest, SetCapacity) {
+    std::string value;
+    cache->put(1, "a");
+    cache->put(2, "b");
+    cache->put(3, "c");
+    cache->set_capacity(2 * (TERM_CACHE_ENTRY_OVERHEAD + 1));
+    ASSERT_EQ(2 * (TERM_CACHE_ENTRY_OVERHEAD + 1), cache->get_size()) << "Cache must be shrunk";
+
+    cache->clear();
+    ASSERT_EQ(0, cache->get_size()) << "Cache must be empty";
+    ASSERT_EQ(false, cache->get(1, value)) << "Cache must be empty";
+}
+
+TEST_F(TermCacheTest, Concurrent) {
+    TermCache shared(1024 * (TERM_CACHE_ENTRY_OVERHEAD + 8));
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&shared]() {
+            std::string value;
+            for (size_t i = 0; i < 10000; i++) {
+                size_t key = i % 2048;
+                if (shared.get(key, value)) {
+                    ASSERT_EQ(std::to_string(key), value) << "Term is incorrect";
+                } else {
+                    shared.put(key, std::to_string(key));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_LE(shared.get_size(), shared.get_capacity()) << "Cache must not exceed its capacity";
+    ASSERT_EQ(40000, shared.get_hits() + shared.get_misses()) << "All lookups must be counted";
+}
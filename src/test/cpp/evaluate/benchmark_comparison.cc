@@ -0,0 +1,98 @@
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/evaluate/benchmark_comparison.h"
+
+// The fixture for testing class BenchmarkComparison
+class BenchmarkComparisonTest : public ::testing::Test {
+protected:
+    BenchmarkReport baseline;
+    BenchmarkReport candidate;
+
+    // Add latencies around the given median, with a deterministic spread
+    static void add_times(BenchmarkReport& report, const std::string& query_type, uint64_t median, size_t count) {
+        for (size_t i = 0; i < count; i++) {
+            report.add_query_time(query_type, median - 10 + (i * 8) % 21);
+        }
+    }
+};
+
+TEST_F(BenchmarkComparisonTest, Regression) {
+    add_times(baseline, "vm", 100, 42);
+    add_times(candidate, "vm", 150, 42);
+    BenchmarkComparison comparison(baseline, candidate);
+
+    ASSERT_EQ(1, comparison.get_comparisons().size());
+    const QueryComparison& vm = comparison.get_comparisons()[0];
+    ASSERT_EQ("vm", vm.query_type);
+    ASSERT_DOUBLE_EQ(1.5, vm.ratio);
+    ASSERT_GT(0.001, vm.p_value);
+    ASSERT_TRUE(vm.regression) << "A significant slowdown must be flagged";
+    ASSERT_TRUE(comparison.has_regression());
+}
+
+TEST_F(BenchmarkComparisonTest, Speedup) {
+    add_times(baseline, "vm", 150, 42);
+    add_times(candidate, "vm", 100, 42);
+    BenchmarkComparison comparison(baseline, candidate);
+
+    ASSERT_LT(0.99, comparison.get_comparisons()[0].p_value);
+    ASSERT_FALSE(comparison.has_regression()) << "A speedup must not be flagged";
+}
+
+TEST_F(BenchmarkComparisonTest, Noise) {
+    add_times(baseline, "vm", 100, 42);
+    add_times(candidate, "vm", 100, 42);
+    BenchmarkComparison comparison(baseline, candidate);
+
+    ASSERT_LT(0.3, comparison.get_comparisons()[0].p_value);
+    ASSERT_FALSE(comparison.has_regression()) << "Equal distributions must not be flagged";
+}
+
+TEST_F(BenchmarkComparisonTest, Threshold) {
+    add_times(baseline, "vm", 1000, 200);
+    add_times(candidate, "vm", 1020, 200);
+    BenchmarkComparison comparison(baseline, candidate);
+
+    ASSERT_GT(0.01, comparison.get_comparisons()[0].p_value);
+    ASSERT_FALSE(comparison.has_regression()) << "Significant slowdowns below the threshold must not be flagged";
+}
+
+TEST_F(BenchmarkComparisonTest, FewSamples) {
+    add_times(baseline, "vm", 100, 2);
+    add_times(candidate, "vm", 200, 2);
+    BenchmarkComparison comparison(baseline, candidate);
+
+    ASSERT_FALSE(comparison.has_regression()) << "Too few samples can not be significant";
+}
+
+TEST_F(BenchmarkComparisonTest, MissingQueryTypes) {
+    add_times(baseline, "vm", 100, 10);
+    add_times(baseline, "dm", 100, 10);
+    add_times(candidate, "dm", 100, 10);
+    add_times(candidate, "vq", 100, 10);
+    BenchmarkComparison comparison(baseline, candidate);
+
+    ASSERT_EQ(1, comparison.get_comparisons().size()) << "Only shared query types must be compared";
+    ASSERT_EQ("dm", comparison.get_comparisons()[0].query_type);
+}
+
+TEST_F(BenchmarkComparisonTest, MannWhitney) {
+    ASSERT_EQ(1, BenchmarkComparison::mann_whitney_p_value({}, {1, 2}));
+    ASSERT_EQ(1, BenchmarkComparison::mann_whitney_p_value({5, 5}, {5, 5})) << "All ties can not be significant";
+    // U = 9 for the candidate, mean 4.5, sd sqrt(3*3*7/12), z = (9-4.5-0.5)/2.291
+    ASSERT_NEAR(0.0404, BenchmarkComparison::mann_whitney_p_value({1, 2, 3}, {4, 5, 6}), 0.0005);
+}
+
+TEST_F(BenchmarkComparisonTest, Write) {
+    add_times(baseline, "vm", 100, 42);
+    add_times(candidate, "vm", 150, 42);
+    std::stringstream out;
+    BenchmarkComparison(baseline, candidate).write(out);
+    std::string line;
+    std::getline(out, line);
+    ASSERT_EQ("type,baseline-p50-mus,candidate-p50-mus,baseline-p99-mus,candidate-p99-mus,ratio,p-value,regression", line);
+    std::getline(out, line);
+    ASSERT_EQ(0, line.find("vm,100,150,")) << line;
+    ASSERT_EQ("yes", line.substr(line.size() - 3));
+}
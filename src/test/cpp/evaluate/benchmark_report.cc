@@ -0,0 +1,73 @@
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/evaluate/benchmark_report.h"
+
+// The fixture for testing class BenchmarkReport
+class BenchmarkReportTest : public ::testing::Test {
+protected:
+    BenchmarkReport report;
+
+    virtual void SetUp() {
+        report.set_parameter("strategy", "interval");
+        report.set_parameter("path", "a \"quoted\"\\path");
+        report.add_ingest({0, 100, 20, 5000, 1024});
+        report.add_ingest({1, 10, 2, 5000, 2048});
+        report.add_query_time("vm", 3);
+        report.add_query_time("vm", 1);
+        report.add_query_time("vm", 2);
+        report.add_query_time("dm_count", 7);
+    }
+};
+
+TEST_F(BenchmarkReportTest, Environment) {
+    ASSERT_NE(report.get_environment().end(), report.get_environment().find("timestamp"));
+    ASSERT_NE(report.get_environment().end(), report.get_environment().find("cpus"));
+}
+
+TEST_F(BenchmarkReportTest, StoreSize) {
+    ASSERT_EQ(2048, report.get_store_size()) << "The store size must follow the last ingested version";
+    report.set_store_size(4096);
+    ASSERT_EQ(4096, report.get_store_size());
+}
+
+TEST_F(BenchmarkReportTest, WriteJson) {
+    std::stringstream out;
+    report.write_json(out);
+    std::string json = out.str();
+    ASSERT_NE(std::string::npos, json.find("\"vm\":{\"count\":3,\"mean\":2,\"p50\":2,\"p90\":3,\"p99\":3,\"max\":3,\"samples\":[3,1,2]}"));
+    ASSERT_NE(std::string::npos, json.find("\"path\":\"a \\\"quoted\\\"\\\\path\"")) << "Strings must be escaped";
+    ASSERT_NE(std::string::npos, json.find("{\"version\":1,\"added\":10,\"duration_ms\":2,\"rate\":5000,\"store_size\":2048}"));
+}
+
+TEST_F(BenchmarkReportTest, RoundTrip) {
+    std::stringstream out;
+    report.write_json(out);
+    std::stringstream in(out.str());
+    BenchmarkReport read = BenchmarkReport::read_json(in);
+
+    ASSERT_EQ(report.get_environment(), read.get_environment());
+    ASSERT_EQ(report.get_parameters(), read.get_parameters());
+    ASSERT_EQ(report.get_queries(), read.get_queries());
+    ASSERT_EQ(2048, read.get_store_size());
+    ASSERT_EQ(2, read.get_ingests().size());
+    ASSERT_EQ(1, read.get_ingests()[1].version);
+    ASSERT_EQ(10, read.get_ingests()[1].added);
+    ASSERT_EQ(2, read.get_ingests()[1].duration_ms);
+    ASSERT_EQ(5000, read.get_ingests()[1].rate);
+}
+
+TEST_F(BenchmarkReportTest, ReadUnknownFields) {
+    std::stringstream in("{\"future\":[1,{\"a\":true},null], \"queries\": {\"vq\": {\"p50\": 1.5, \"samples\": [4, 5]}}}");
+    BenchmarkReport read = BenchmarkReport::read_json(in);
+    ASSERT_EQ(std::vector<uint64_t>({4, 5}), read.get_queries().at("vq")) << "Unknown fields must be skipped";
+}
+
+TEST_F(BenchmarkReportTest, ReadInvalid) {
+    std::stringstream in1("{\"queries\": {\"vq\": {\"samples\": [4, ");
+    ASSERT_THROW(BenchmarkReport::read_json(in1), std::runtime_error);
+    std::stringstream in2("[]");
+    ASSERT_THROW(BenchmarkReport::read_json(in2), std::runtime_error);
+    std::stringstream in3("{\"store_size\": \"big\"}");
+    ASSERT_THROW(BenchmarkReport::read_json(in3), std::runtime_error);
+}
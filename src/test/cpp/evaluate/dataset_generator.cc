@@ -0,0 +1,128 @@
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/evaluate/dataset_generator.h"
+
+#define TESTPATH "./dataset_generator_test"
+#define TESTPATH_OTHER "./dataset_generator_test_other"
+
+// The fixture for testing class DatasetGenerator
+class DatasetGeneratorTest : public ::testing::Test {
+protected:
+    DatasetGeneratorOptions options;
+
+    virtual void SetUp() {
+        options.triples = 1000;
+        options.versions = 5;
+        options.change_ratio = 0.1;
+        options.churn = 0.5;
+    }
+
+    virtual void TearDown() {
+        std::filesystem::remove_all(TESTPATH);
+        std::filesystem::remove_all(TESTPATH_OTHER);
+    }
+
+    static std::vector<std::string> read_lines(const std::string& file_name) {
+        std::vector<std::string> lines;
+        std::ifstream file(file_name);
+        std::string line;
+        while (std::getline(file, line)) {
+            lines.push_back(line);
+        }
+        return lines;
+    }
+
+    static std::string read_file(const std::string& file_name) {
+        std::ifstream file(file_name);
+        return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+};
+
+TEST_F(DatasetGeneratorTest, Layout) {
+    DatasetGenerator generator(options);
+    generator.generate(TESTPATH);
+
+    ASSERT_EQ(1000, read_lines(DatasetGenerator::snapshot_file(TESTPATH)).size()) << "The first version must have the configured size";
+    for (int version = 1; version < 5; version++) {
+        ASSERT_TRUE(std::filesystem::exists(DatasetGenerator::changeset_file(TESTPATH, version, true)));
+        ASSERT_TRUE(std::filesystem::exists(DatasetGenerator::changeset_file(TESTPATH, version, false)));
+    }
+    ASSERT_FALSE(std::filesystem::exists(DatasetGenerator::changeset_file(TESTPATH, 5, true)));
+    ASSERT_EQ("./dataset_generator_test/alldata.CB.nt/data-added_1-2.nt", DatasetGenerator::changeset_file(TESTPATH, 1, true));
+}
+
+TEST_F(DatasetGeneratorTest, Deterministic) {
+    DatasetGenerator generator1(options);
+    generator1.generate(TESTPATH);
+    DatasetGenerator generator2(options);
+    generator2.generate(TESTPATH_OTHER);
+
+    ASSERT_EQ(read_file(DatasetGenerator::snapshot_file(TESTPATH)), read_file(DatasetGenerator::snapshot_file(TESTPATH_OTHER)));
+    for (int version = 1; version < 5; version++) {
+        ASSERT_EQ(read_file(DatasetGenerator::changeset_file(TESTPATH, version, true)),
+                  read_file(DatasetGenerator::changeset_file(TESTPATH_OTHER, version, true))) << "The same seed must produce the same additions";
+        ASSERT_EQ(read_file(DatasetGenerator::changeset_file(TESTPATH, version, false)),
+                  read_file(DatasetGenerator::changeset_file(TESTPATH_OTHER, version, false))) << "The same seed must produce the same deletions";
+    }
+
+    options.seed = 43;
+    DatasetGenerator generator3(options);
+    generator3.generate(TESTPATH_OTHER);
+    ASSERT_NE(read_file(DatasetGenerator::snapshot_file(TESTPATH)), read_file(DatasetGenerator::snapshot_file(TESTPATH_OTHER)))
+                                << "Another seed must produce another dataset";
+}
+
+TEST_F(DatasetGeneratorTest, Changesets) {
+    DatasetGenerator generator(options);
+    generator.generate(TESTPATH);
+
+    std::vector<std::string> first = read_lines(DatasetGenerator::snapshot_file(TESTPATH));
+    ASSERT_TRUE(std::is_sorted(first.begin(), first.end())) << "Files must be sorted";
+    std::set<std::string> triples(first.begin(), first.end());
+    std::set<std::string> ever_deleted;
+    bool readded = false;
+    for (int version = 1; version < 5; version++) {
+        std::vector<std::string> additions = read_lines(DatasetGenerator::changeset_file(TESTPATH, version, true));
+        std::vector<std::string> deletions = read_lines(DatasetGenerator::changeset_file(TESTPATH, version, false));
+        ASSERT_TRUE(std::is_sorted(additions.begin(), additions.end())) << "Files must be sorted";
+        ASSERT_TRUE(std::is_sorted(deletions.begin(), deletions.end())) << "Files must be sorted";
+        ASSERT_EQ(generator.get_version_changes()[version], additions.size() + deletions.size());
+        for (const std::string& triple : deletions) {
+            ASSERT_EQ(1, triples.erase(triple)) << "Deleted triples must exist in the previous version";
+            ever_deleted.insert(triple);
+        }
+        for (const std::string& triple : additions) {
+            ASSERT_TRUE(triples.insert(triple).second) << "Added triples must not exist in the previous version";
+            readded |= ever_deleted.find(triple) != ever_deleted.end();
+        }
+    }
+    ASSERT_EQ(triples.size(), generator.get_triple_count());
+    ASSERT_TRUE(readded) << "Churn must re-add deleted triples";
+}
+
+TEST_F(DatasetGeneratorTest, ChangeRatio) {
+    options.change_ratio = 0.2;
+    options.churn = 0;
+    DatasetGenerator generator(options);
+    generator.generate(TESTPATH);
+
+    ASSERT_EQ(1000, generator.get_version_changes()[0]);
+    ASSERT_EQ(200, generator.get_version_changes()[1]) << "A version must change the configured ratio of triples";
+    ASSERT_EQ(100, read_lines(DatasetGenerator::changeset_file(TESTPATH, 1, true)).size());
+    ASSERT_EQ(100, read_lines(DatasetGenerator::changeset_file(TESTPATH, 1, false)).size());
+}
+
+TEST_F(DatasetGeneratorTest, NewTerms) {
+    options.new_term_rate = 0;
+    DatasetGenerator generator1(options);
+    generator1.generate(TESTPATH);
+    ASSERT_EQ(250, generator1.get_entity_count()) << "Without new terms, the entities must remain the initial ones";
+
+    options.new_term_rate = 0.5;
+    DatasetGenerator generator2(options);
+    generator2.generate(TESTPATH_OTHER);
+    ASSERT_LT(250, generator2.get_entity_count()) << "New terms must be introduced";
+}
@@ -0,0 +1,42 @@
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/evaluate/latency_summary.h"
+
+TEST(LatencySummaryTest, Empty) {
+    LatencySummary summary = LatencySummary::summarize({});
+    ASSERT_EQ(0, summary.count);
+    ASSERT_EQ(0, summary.p50);
+    ASSERT_EQ(0, summary.max);
+}
+
+TEST(LatencySummaryTest, Single) {
+    LatencySummary summary = LatencySummary::summarize({7});
+    ASSERT_EQ(1, summary.count);
+    ASSERT_EQ(7, summary.mean);
+    ASSERT_EQ(7, summary.p50);
+    ASSERT_EQ(7, summary.p99);
+    ASSERT_EQ(7, summary.max);
+}
+
+TEST(LatencySummaryTest, Percentiles) {
+    std::vector<uint64_t> values;
+    for (uint64_t i = 100; i > 0; i--) {
+        values.push_back(i);
+    }
+    LatencySummary summary = LatencySummary::summarize(values);
+    ASSERT_EQ(100, summary.count);
+    ASSERT_EQ(5050, summary.total);
+    ASSERT_EQ(50, summary.mean);
+    ASSERT_EQ(50, summary.p50) << "Percentiles must use the nearest rank";
+    ASSERT_EQ(90, summary.p90) << "Percentiles must use the nearest rank";
+    ASSERT_EQ(99, summary.p99) << "Percentiles must use the nearest rank";
+    ASSERT_EQ(100, summary.max);
+}
+
+TEST(LatencySummaryTest, Percentile) {
+    std::vector<uint64_t> values = {1, 2, 3, 4};
+    ASSERT_EQ(1, LatencySummary::percentile(values, 0));
+    ASSERT_EQ(1, LatencySummary::percentile(values, 25));
+    ASSERT_EQ(2, LatencySummary::percentile(values, 26));
+    ASSERT_EQ(4, LatencySummary::percentile(values, 100));
+}
@@ -0,0 +1,91 @@
+#include <cstdio>
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/patch/buffer_pool.h"
+
+#define POOL_CAPACITY (BUFFER_POOL_TREE_KINDS * 2 * 64 * BUFFER_POOL_MIN_PAGE_CACHE_SIZE)
+
+// The fixture for testing class BufferPool.
+class BufferPoolTest : public ::testing::Test {
+protected:
+    BufferPool* pool;
+
+    // Two stores of six trees
+    BufferPoolTest() : pool(new BufferPool(POOL_CAPACITY, 2)) {}
+
+    virtual void TearDown() {
+        delete pool;
+    }
+};
+
+TEST_F(BufferPoolTest, EqualShares) {
+    for (int kind = 0; kind < BUFFER_POOL_TREE_KINDS; kind++) {
+        ASSERT_EQ(64 * BUFFER_POOL_MIN_PAGE_CACHE_SIZE, pool->get_page_cache_size((BufferPool::TreeKind) kind))
+                                    << "Unused trees must get equal parts";
+    }
+}
+
+TEST_F(BufferPoolTest, SkewedShares) {
+    for (int i = 0; i < 1000; i++) {
+        pool->record_access(BufferPool::SPO_DELETIONS);
+    }
+    pool->record_access(BufferPool::OSP_ADDITIONS);
+    ASSERT_EQ(1000, pool->get_accesses(BufferPool::SPO_DELETIONS)) << "Accesses must be counted";
+
+    size_t hot = pool->get_page_cache_size(BufferPool::SPO_DELETIONS);
+    size_t cold = pool->get_page_cache_size(BufferPool::POS_ADDITIONS);
+    ASSERT_GT(hot, 5 * 64 * BUFFER_POOL_MIN_PAGE_CACHE_SIZE) << "Hot trees must get most of the pool";
+    ASSERT_EQ(BUFFER_POOL_MIN_PAGE_CACHE_SIZE, cold) << "Cold trees must get the minimum";
+    ASSERT_LE(hot, POOL_CAPACITY / 2) << "Trees of one store must not exceed their part of the pool";
+}
+
+TEST_F(BufferPoolTest, SetCapacity) {
+    pool->set_capacity(POOL_CAPACITY, 4);
+    ASSERT_EQ(POOL_CAPACITY, pool->get_capacity()) << "Capacity is incorrect";
+    ASSERT_EQ(32 * BUFFER_POOL_MIN_PAGE_CACHE_SIZE, pool->get_page_cache_size(BufferPool::SPO_DELETIONS))
+                                << "More stores must get smaller parts";
+}
+
+TEST_F(BufferPoolTest, IngestScope) {
+    {
+        BufferPool::IngestScope ingest_scope;
+        pool->record_access(BufferPool::SPO_ADDITIONS);
+    }
+    pool->record_access(BufferPool::SPO_DELETIONS);
+    ASSERT_EQ(0, pool->get_accesses(BufferPool::SPO_ADDITIONS)) << "Accesses while ingesting must not be counted";
+    ASSERT_EQ(1, pool->get_accesses(BufferPool::SPO_DELETIONS)) << "Accesses after ingesting must be counted";
+}
+
+TEST_F(BufferPoolTest, Decay) {
+    for (int i = 0; i < BUFFER_POOL_ACCESS_WINDOW / 2; i++) {
+        pool->record_access(BufferPool::SPO_DELETIONS);
+    }
+    for (int i = 0; i < BUFFER_POOL_ACCESS_WINDOW / 2; i++) {
+        pool->record_access(BufferPool::OSP_ADDITIONS);
+    }
+    ASSERT_EQ(BUFFER_POOL_ACCESS_WINDOW / 4, pool->get_accesses(BufferPool::SPO_DELETIONS)) << "Counts must be halved after a window";
+    ASSERT_EQ(BUFFER_POOL_ACCESS_WINDOW / 4, pool->get_accesses(BufferPool::OSP_ADDITIONS)) << "Counts must be halved after a window";
+    for (int i = 0; i < BUFFER_POOL_ACCESS_WINDOW / 2; i++) {
+        pool->record_access(BufferPool::OSP_ADDITIONS);
+    }
+    ASSERT_GT(pool->get_page_cache_size(BufferPool::OSP_ADDITIONS), 2 * pool->get_page_cache_size(BufferPool::SPO_DELETIONS))
+                                << "Recent accesses must outweigh older ones";
+}
+
+TEST_F(BufferPoolTest, SaveLoad) {
+    std::string file_name = std::string("./") + BUFFER_POOL_ACCESSES_FILENAME;
+    for (int i = 0; i < 1000; i++) {
+        pool->record_access(BufferPool::POS_DELETIONS);
+    }
+    pool->save(file_name);
+
+    BufferPool loaded(POOL_CAPACITY, 2);
+    loaded.load(file_name);
+    std::remove(file_name.c_str());
+    ASSERT_EQ(500, loaded.get_accesses(BufferPool::POS_DELETIONS)) << "Counts of a previous session must count for half";
+    ASSERT_EQ(0, loaded.get_accesses(BufferPool::SPO_DELETIONS));
+
+    BufferPool missing(POOL_CAPACITY, 2);
+    missing.load(file_name);
+    ASSERT_EQ(0, missing.get_accesses(BufferPool::POS_DELETIONS)) << "A missing file must leave the counts empty";
+}
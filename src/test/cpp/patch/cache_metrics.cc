@@ -0,0 +1,54 @@
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/patch/cache_metrics.h"
+
+// The fixture for testing class CacheCounters.
+class CacheCountersTest : public ::testing::Test {
+protected:
+    CacheCounters counters;
+};
+
+TEST_F(CacheCountersTest, Empty) {
+    CacheMetrics metrics = counters.get_metrics(0);
+    ASSERT_EQ(0, metrics.hits) << "Hits are incorrect";
+    ASSERT_EQ(0, metrics.misses) << "Misses are incorrect";
+    ASSERT_EQ(0, metrics.evictions) << "Evictions are incorrect";
+    ASSERT_EQ(0, metrics.loaded) << "Loaded objects are incorrect";
+    ASSERT_EQ(0, metrics.load_seconds) << "Load time is incorrect";
+}
+
+TEST_F(CacheCountersTest, Count) {
+    counters.hit();
+    counters.hit();
+    counters.evicted();
+    counters.loaded(0.5);
+    counters.loaded(1.5);
+    CacheMetrics metrics = counters.get_metrics(3);
+    ASSERT_EQ(2, metrics.hits) << "Hits are incorrect";
+    ASSERT_EQ(2, metrics.misses) << "Every load must count as a miss";
+    ASSERT_EQ(1, metrics.evictions) << "Evictions are incorrect";
+    ASSERT_EQ(3, metrics.loaded) << "Loaded objects are incorrect";
+    ASSERT_NEAR(2.0, metrics.load_seconds, 1e-6) << "Load time must be the sum of all loads";
+    ASSERT_NEAR(1.5, metrics.max_load_seconds, 1e-6) << "Max load time must be the slowest load";
+}
+
+TEST_F(CacheCountersTest, Concurrent) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; i++) {
+        threads.emplace_back([this, i]() {
+            for (int j = 0; j < 1000; j++) {
+                counters.hit();
+            }
+            counters.loaded(i);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    CacheMetrics metrics = counters.get_metrics(0);
+    ASSERT_EQ(4000, metrics.hits) << "Concurrent hits must not be lost";
+    ASSERT_EQ(4, metrics.misses) << "Concurrent misses must not be lost";
+    ASSERT_NEAR(3.0, metrics.max_load_seconds, 1e-6) << "Max load time must be the slowest load";
+}
@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/patch/clock_eviction_policy.h"
+
+// The fixture for testing class ClockEvictionPolicy.
+class ClockEvictionPolicyTest : public ::testing::Test {
+protected:
+    ClockEvictionPolicy* policy;
+
+    ClockEvictionPolicyTest() : policy(new ClockEvictionPolicy()) {}
+
+    virtual void TearDown() {
+        delete policy;
+    }
+
+    static bool any(int) {
+        return true;
+    }
+};
+
+TEST_F(ClockEvictionPolicyTest, Empty) {
+    ASSERT_EQ(0, policy->size()) << "Empty policy must not track anything";
+    ASSERT_EQ(false, policy->touch(1)) << "Unknown id must not be tracked";
+    ASSERT_EQ(-1, policy->evict(any)) << "Empty policy must not evict anything";
+}
+
+TEST_F(ClockEvictionPolicyTest, EvictUnreferenced) {
+    policy->insert(1);
+    policy->insert(2);
+    policy->insert(3);
+    ASSERT_EQ(3, policy->size()) << "All ids must be tracked";
+
+    // The first pass clears all reference bits
+    ASSERT_EQ(1, policy->evict(any)) << "Oldest id must be evicted when all are referenced";
+    policy->touch(2);
+    ASSERT_EQ(3, policy->evict(any)) << "Unreferenced id must be evicted first";
+    ASSERT_EQ(2, policy->evict(any)) << "Last id must be evicted";
+    ASSERT_EQ(0, policy->size()) << "Policy must be empty";
+}
+
+TEST_F(ClockEvictionPolicyTest, EvictInUse) {
+    policy->insert(1);
+    policy->insert(2);
+    ASSERT_EQ(2, policy->evict([](int id) { return id != 1; })) << "Ids in use must not be evicted";
+    ASSERT_EQ(-1, policy->evict([](int id) { return id != 1; })) << "Ids in use must not be evicted";
+    ASSERT_EQ(true, policy->touch(1)) << "Ids in use must remain tracked";
+}
+
+TEST_F(ClockEvictionPolicyTest, Erase) {
+    policy->insert(1);
+    policy->insert(2);
+    policy->erase(1);
+    ASSERT_EQ(false, policy->touch(1)) << "Erased id must not be tracked";
+    policy->insert(3);
+    ASSERT_EQ(2, policy->size()) << "Erased slot must be reused";
+    ASSERT_EQ(3, policy->evict(any)) << "Reused slot must be passed first by the clock hand";
+    ASSERT_EQ(2, policy->evict(any)) << "Last id must be evicted";
+}
+
+TEST_F(ClockEvictionPolicyTest, EvictByPriority) {
+    policy->insert(1);
+    policy->insert(2);
+    policy->insert(3);
+    auto priority = [](int id) { return id == 2 ? 10.0 : 1.0; };
+    ASSERT_EQ(2, policy->evict(any, priority)) << "Id with the highest priority must be evicted";
+    policy->touch(1);
+    ASSERT_EQ(3, policy->evict(any, priority)) << "Unreferenced id must be evicted first";
+    ASSERT_EQ(-1, policy->evict([](int) { return false; }, priority)) << "Ids in use must not be evicted";
+    ASSERT_EQ(1, policy->size()) << "Ids in use must remain tracked";
+}
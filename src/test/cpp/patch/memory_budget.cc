@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/patch/memory_budget.h"
+
+// The fixture for testing class MemoryBudget.
+class MemoryBudgetTest : public ::testing::Test {
+protected:
+    MemoryBudget* budget;
+
+    MemoryBudgetTest() : budget(new MemoryBudget(1000)) {}
+
+    virtual void TearDown() {
+        delete budget;
+    }
+};
+
+TEST_F(MemoryBudgetTest, AddAndRelease) {
+    budget->add(600);
+    ASSERT_EQ(600, budget->get_used()) << "Used bytes are incorrect";
+    ASSERT_EQ(false, budget->is_exceeded()) << "Budget must not be exceeded";
+    budget->add(600);
+    ASSERT_EQ(true, budget->is_exceeded()) << "Budget must be exceeded";
+    budget->release(600);
+    ASSERT_EQ(false, budget->is_exceeded()) << "Budget must not be exceeded";
+    budget->release(1000);
+    ASSERT_EQ(0, budget->get_used()) << "Used bytes must not wrap around";
+}
+
+TEST_F(MemoryBudgetTest, Unbounded) {
+    budget->set_limit(0);
+    budget->add(1000000);
+    ASSERT_EQ(false, budget->is_exceeded()) << "Unbounded budget must never be exceeded";
+    ASSERT_EQ(1 << 25, budget->get_page_cache_size(24, 1 << 25)) << "Page caches must not be limited";
+}
+
+TEST_F(MemoryBudgetTest, PageCacheSize) {
+    budget->set_limit(24LL << 30);
+    ASSERT_EQ(1 << 25, budget->get_page_cache_size(24, 1 << 25)) << "Page caches must not grow beyond the maximum";
+    budget->set_limit(24LL << 25);
+    ASSERT_EQ(1 << 23, budget->get_page_cache_size(24, 1 << 25)) << "Page caches must use a part of the budget";
+    budget->set_limit(1000);
+    ASSERT_EQ(MEMORY_BUDGET_MIN_PAGE_CACHE_SIZE, budget->get_page_cache_size(24, 1 << 25)) << "Page caches must not shrink below the minimum";
+}
+
+TEST_F(MemoryBudgetTest, Shares) {
+    ASSERT_EQ(250, budget->get_share(MemoryBudget::PATCH_TREES)) << "Patch trees must get the part for page caches";
+    ASSERT_EQ(750, budget->get_share(MemoryBudget::SNAPSHOTS)) << "Snapshots must get the rest";
+
+    budget->add(700, MemoryBudget::SNAPSHOTS);
+    budget->add(300, MemoryBudget::PATCH_TREES);
+    ASSERT_EQ(1000, budget->get_used()) << "Used bytes are incorrect";
+    ASSERT_EQ(false, budget->is_exceeded(MemoryBudget::SNAPSHOTS)) << "Snapshots must not be charged for patch trees";
+    ASSERT_EQ(true, budget->is_exceeded(MemoryBudget::PATCH_TREES)) << "Patch trees must exceed their share";
+
+    budget->release(100, MemoryBudget::PATCH_TREES);
+    ASSERT_EQ(false, budget->is_exceeded(MemoryBudget::PATCH_TREES)) << "Patch trees must be within their share";
+    ASSERT_EQ(900, budget->get_used()) << "Released bytes must be released from the total";
+
+    budget->set_limit(0);
+    budget->add(1000000, MemoryBudget::SNAPSHOTS);
+    ASSERT_EQ(false, budget->is_exceeded(MemoryBudget::SNAPSHOTS)) << "Unbounded budget must never be exceeded";
+}
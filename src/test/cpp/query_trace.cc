@@ -0,0 +1,106 @@
+#include <sstream>
+#include <gtest/gtest.h>
+
+#include "../../main/cpp/query_trace.h"
+
+// The fixture for testing class QueryTrace
+class QueryTraceTest : public ::testing::Test {
+protected:
+    QueryTrace trace;
+
+    QueryTraceTest() : trace("<a> ? ?") {}
+};
+
+TEST_F(QueryTraceTest, Inactive) {
+    ASSERT_EQ(nullptr, QueryTrace::get_active()) << "No trace must be active by default";
+    {
+        QueryTraceSpan span("query");
+    }
+    ASSERT_EQ(0, trace.get_spans().size()) << "Spans without an active trace must not be recorded";
+}
+
+TEST_F(QueryTraceTest, Scope) {
+    QueryTrace other("other");
+    {
+        QueryTraceScope scope(&trace);
+        ASSERT_EQ(&trace, QueryTrace::get_active());
+        {
+            QueryTraceScope nested(&other);
+            ASSERT_EQ(&other, QueryTrace::get_active());
+        }
+        ASSERT_EQ(&trace, QueryTrace::get_active()) << "The previous trace must be restored";
+    }
+    ASSERT_EQ(nullptr, QueryTrace::get_active());
+}
+
+TEST_F(QueryTraceTest, Spans) {
+    {
+        QueryTraceScope scope(&trace);
+        QueryTraceSpan query("query");
+        for (int i = 0; i < 3; i++) {
+            QueryTraceSpan step("step");
+        }
+    }
+    const std::vector<QueryTrace::Span>& spans = trace.get_spans();
+    ASSERT_EQ(4, spans.size());
+    ASSERT_STREQ("query", spans[0].name);
+    ASSERT_EQ(0, spans[0].depth);
+    ASSERT_STREQ("step", spans[1].name);
+    ASSERT_EQ(1, spans[1].depth) << "Nested spans must be one level deeper";
+    ASSERT_LE(spans[0].begin, spans[1].begin);
+    ASSERT_GE(spans[0].duration, spans[1].duration + spans[2].duration + spans[3].duration) << "A span must include its nested spans";
+
+    const std::map<std::string, QueryTrace::Stage>& stages = trace.get_stages();
+    ASSERT_EQ(2, stages.size());
+    ASSERT_EQ(1, stages.at("query").count);
+    ASSERT_EQ(3, stages.at("step").count);
+}
+
+TEST_F(QueryTraceTest, MaxSpans) {
+    {
+        QueryTraceScope scope(&trace);
+        for (int i = 0; i < QUERY_TRACE_MAX_SPANS + 10; i++) {
+            QueryTraceSpan step("step");
+        }
+    }
+    ASSERT_EQ(QUERY_TRACE_MAX_SPANS, trace.get_spans().size()) << "Only a bounded number of spans must be kept";
+    ASSERT_EQ(QUERY_TRACE_MAX_SPANS + 10, trace.get_stages().at("step").count) << "All spans must be aggregated";
+}
+
+TEST_F(QueryTraceTest, StagesMergeEqualNames) {
+    const char first[] = "step";
+    const char second[] = "step";
+    {
+        QueryTraceScope scope(&trace);
+        QueryTraceSpan a(first);
+        QueryTraceSpan b(second);
+    }
+    ASSERT_EQ(1, trace.get_stages().size()) << "Spans with equal names must be one stage";
+    ASSERT_EQ(2, trace.get_stages().at("step").count);
+}
+
+TEST_F(QueryTraceTest, Counters) {
+    trace.count(TRACE_KC_CURSOR_STEPS);
+    trace.count(TRACE_KC_CURSOR_STEPS, 2);
+    trace.count(TRACE_TERMS_DECODED, 5);
+    ASSERT_EQ(3, trace.get_counter(TRACE_KC_CURSOR_STEPS));
+    ASSERT_EQ(0, trace.get_counter(TRACE_VALUES_DESERIALIZED));
+    ASSERT_EQ(5, trace.get_counter(TRACE_TERMS_DECODED));
+}
+
+TEST_F(QueryTraceTest, ChromeTrace) {
+    {
+        QueryTraceScope scope(&trace);
+        QueryTraceSpan query("query");
+        trace.count(TRACE_VALUES_DESERIALIZED, 7);
+    }
+    std::ostringstream out;
+    trace.write_chrome_trace(out);
+    std::string json = out.str();
+    ASSERT_EQ(0, json.find("{\"traceEvents\":[")) << "The trace must be a JSON object with trace events";
+    ASSERT_EQ('}', json.back());
+    ASSERT_NE(std::string::npos, json.find("\"name\":\"query\",\"cat\":\"ostrich\",\"ph\":\"X\""));
+    ASSERT_NE(std::string::npos, json.find("\"values_deserialized\":7"));
+    ASSERT_NE(std::string::npos, json.find("\"query\":\"<a> ? ?\""));
+    ASSERT_NE(std::string::npos, json.find("\"stages\":{\"query\":{\"count\":1"));
+}
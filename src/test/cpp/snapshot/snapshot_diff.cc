@@ -0,0 +1,103 @@
+#include <fstream>
+#include <gtest/gtest.h>
+
+#include "../../../main/cpp/snapshot/snapshot_diff.h"
+
+#define TESTPATH "./"
+#define TESTFILE (TESTPATH + SNAPSHOT_DIFF_FILENAME(0, 1))
+
+// The fixture for testing class SnapshotDiff
+class SnapshotDiffTest : public ::testing::Test {
+protected:
+    std::shared_ptr<DictionaryManager> dict;
+    std::vector<std::pair<Triple, bool>> elements;
+
+    SnapshotDiffTest() : dict() {}
+
+    virtual void SetUp() {
+        dict = std::make_shared<DictionaryManager>(TESTPATH, 0);
+        elements.emplace_back(Triple("<c>", "<p>", "<a>", dict), true);
+        elements.emplace_back(Triple("<a>", "<q>", "<b>", dict), false);
+        elements.emplace_back(Triple("<a>", "<p>", "<c>", dict), true);
+        elements.emplace_back(Triple("<b>", "<p>", "<a>", dict), false);
+        elements.emplace_back(Triple("<a>", "<p>", "<a>", dict), true);
+        SnapshotDiff::write(TESTFILE, 0, 1, elements, dict);
+    }
+
+    virtual void TearDown() {
+        dict = nullptr;
+        DictionaryManager::cleanup(TESTPATH, 0);
+        std::remove(TESTFILE.c_str());
+    }
+
+    std::vector<std::string> find(const Triple& triple_pattern, hdt::TripleComponentOrder order) {
+        SnapshotDiff diff(TESTFILE);
+        std::vector<std::string> result;
+        auto range = diff.find(triple_pattern, order, *dict);
+        for (size_t position = range.first; position < range.second; position++) {
+            Triple triple;
+            bool addition = diff.get(position, order, &triple);
+            result.push_back(triple.to_string(*dict) + (addition ? " +" : " -"));
+        }
+        return result;
+    }
+};
+
+TEST_F(SnapshotDiffTest, Header) {
+    SnapshotDiff diff(TESTFILE);
+    ASSERT_EQ(0, diff.get_from_snapshot());
+    ASSERT_EQ(1, diff.get_to_snapshot());
+    ASSERT_EQ(5, diff.get_count());
+}
+
+TEST_F(SnapshotDiffTest, FindAll) {
+    std::vector<std::string> expected = {
+            "<a> <p> <a>. +",
+            "<a> <p> <c>. +",
+            "<a> <q> <b>. -",
+            "<b> <p> <a>. -",
+            "<c> <p> <a>. +",
+    };
+    ASSERT_EQ(expected, find(Triple(0, 0, 0), hdt::SPO)) << "All elements must be sorted in SPO order";
+}
+
+TEST_F(SnapshotDiffTest, FindSubject) {
+    std::vector<std::string> expected = {
+            "<a> <p> <a>. +",
+            "<a> <p> <c>. +",
+            "<a> <q> <b>. -",
+    };
+    ASSERT_EQ(expected, find(Triple("<a>", "", "", dict), hdt::SPO));
+}
+
+TEST_F(SnapshotDiffTest, FindPredicate) {
+    std::vector<std::string> expected = {
+            "<a> <p> <a>. +",
+            "<b> <p> <a>. -",
+            "<c> <p> <a>. +",
+            "<a> <p> <c>. +",
+    };
+    ASSERT_EQ(expected, find(Triple("", "<p>", "", dict), hdt::POS)) << "Elements must be sorted in POS order";
+}
+
+TEST_F(SnapshotDiffTest, FindObject) {
+    std::vector<std::string> expected = {
+            "<a> <p> <a>. +",
+            "<b> <p> <a>. -",
+            "<c> <p> <a>. +",
+    };
+    ASSERT_EQ(expected, find(Triple("", "", "<a>", dict), hdt::OSP));
+}
+
+TEST_F(SnapshotDiffTest, FindNone) {
+    ASSERT_EQ(0, find(Triple("<d>", "", "", dict), hdt::SPO).size());
+    ASSERT_EQ(0, find(Triple("<a>", "<p>", "<b>", dict), hdt::SPO).size());
+}
+
+TEST_F(SnapshotDiffTest, Invalid) {
+    {
+        std::ofstream file(TESTFILE);
+        file << "invalid";
+    }
+    ASSERT_THROW(SnapshotDiff diff(TESTFILE), std::runtime_error);
+}
@@ -1,7 +1,9 @@
+#include <future>
 #include <gtest/gtest.h>
 
 #include "../../../main/cpp/snapshot/snapshot_manager.h"
 #include "../../../main/cpp/snapshot/vector_triple_iterator.h"
+#include "../../../main/cpp/snapshot/materialized_triple_iterator.h"
 
 #define BASEURI "<http://example.org>"
 #define TESTPATH "./"
@@ -79,4 +81,126 @@ TEST_F(SnapshotManagerTest, GetByPatchId) {
     ASSERT_EQ(10, snapshotManager->get_latest_snapshot(99));
     ASSERT_EQ(100, snapshotManager->get_latest_snapshot(100));
     ASSERT_EQ(100, snapshotManager->get_latest_snapshot(101));
-}
\ No newline at end of file
+}
+
+TEST_F(SnapshotManagerTest, ConstructSnapshotFromTripleIterator) {
+    std::shared_ptr<hdt::HDT> snapshot = snapshotManager->create_snapshot(100, it, BASEURI);
+    std::shared_ptr<DictionaryManager> dict = snapshotManager->get_dictionary_manager(100);
+
+    int passes = 0;
+    MaterializedTripleIterator snapshot_it([&]() {
+        passes++;
+        return new SnapshotTripleIterator(SnapshotManager::search_with_offset(snapshot, Triple(0, 0, 0), 0, dict));
+    }, dict);
+
+    ASSERT_EQ(true, snapshot_it.hasNext());
+    ASSERT_EQ("<a>", snapshot_it.next()->getObject());
+    ASSERT_EQ("<b>", snapshot_it.next()->getObject());
+    ASSERT_EQ("<c>", snapshot_it.next()->getObject());
+    ASSERT_EQ(false, snapshot_it.hasNext());
+
+    snapshot_it.goToStart();
+    ASSERT_EQ(true, snapshot_it.hasNext());
+    ASSERT_EQ(2, passes);
+
+    std::shared_ptr<hdt::HDT> snapshot2 = snapshotManager->create_snapshot(200, &snapshot_it, BASEURI);
+    ASSERT_EQ(3, snapshot2->getTriples()->getNumberOfElements());
+}
+
+class VectorIdTripleIterator : public TripleIterator {
+private:
+    std::vector<Triple> triples;
+    std::vector<Triple>::iterator pos;
+public:
+    explicit VectorIdTripleIterator(std::vector<Triple> triples) : triples(std::move(triples)) {
+        pos = this->triples.begin();
+    }
+    bool next(Triple* triple) override {
+        if (pos == triples.end()) return false;
+        *triple = *pos++;
+        return true;
+    }
+};
+
+TEST_F(SnapshotManagerTest, ConstructSnapshotFromIds) {
+    snapshotManager->create_snapshot(100, it, BASEURI);
+    std::shared_ptr<DictionaryManager> dict = snapshotManager->get_dictionary_manager(100);
+
+    // <a> <a> <b> is removed, <a> <a> <d> and <d> <a> <a> only exist in the patch dictionary
+    std::vector<Triple> triples;
+    triples.emplace_back("<a>", "<a>", "<a>", dict);
+    triples.emplace_back("<a>", "<a>", "<c>", dict);
+    triples.emplace_back("<a>", "<a>", "<d>", dict);
+    triples.emplace_back("<d>", "<a>", "<a>", dict);
+
+    std::shared_ptr<hdt::HDT> snapshot = snapshotManager->create_snapshot(200, [&]() {
+        return new VectorIdTripleIterator(triples);
+    }, dict, BASEURI);
+    ASSERT_EQ(4, snapshot->getTriples()->getNumberOfElements());
+    ASSERT_EQ(2, snapshot->getDictionary()->getNsubjects());
+    ASSERT_EQ(3, snapshot->getDictionary()->getNobjects());
+
+    hdt::IteratorTripleString* result = snapshot->search("", "", "");
+    std::vector<std::string> found;
+    while (result->hasNext()) {
+        hdt::TripleString* triple = result->next();
+        found.push_back(triple->getSubject() + " " + triple->getPredicate() + " " + triple->getObject());
+    }
+    std::sort(found.begin(), found.end());
+    std::vector<std::string> expected = {"<a> <a> <a>", "<a> <a> <c>", "<a> <a> <d>", "<d> <a> <a>"};
+    ASSERT_EQ(expected, found);
+    delete result;
+}
+
+TEST_F(SnapshotManagerTest, PreloadSnapshots) {
+    snapshotManager->create_snapshot(0, it, BASEURI);
+    VectorTripleIterator it10({hdt::TripleString("<a>", "<a>", "<d>")});
+    snapshotManager->create_snapshot(10, &it10, BASEURI);
+    delete snapshotManager;
+
+    // A new manager only detects the snapshot files
+    snapshotManager = new SnapshotManager(TESTPATH);
+    snapshotManager->preload_snapshots({0, 10}, true);
+    std::vector<std::future<std::shared_ptr<hdt::HDT>>> loads;
+    for (int i = 0; i < 4; i++) {
+        loads.push_back(std::async(std::launch::async, [this]() { return snapshotManager->get_snapshot(10); }));
+    }
+    std::shared_ptr<hdt::HDT> snapshot = snapshotManager->get_snapshot(10);
+    ASSERT_NE(nullptr, snapshot);
+    for (auto& load : loads) {
+        ASSERT_EQ(snapshot, load.get()) << "Concurrent loads must share the same snapshot";
+    }
+    ASSERT_EQ(1, snapshot->getTriples()->getNumberOfElements());
+    ASSERT_EQ(3, snapshotManager->get_snapshot(0)->getTriples()->getNumberOfElements());
+    ASSERT_NE(nullptr, snapshotManager->get_dictionary_manager(0));
+}
+
+TEST_F(SnapshotManagerTest, PreloadSnapshotsInBackground) {
+    snapshotManager->create_snapshot(0, it, BASEURI);
+    delete snapshotManager;
+
+    snapshotManager = new SnapshotManager(TESTPATH);
+    snapshotManager->preload_snapshots({0});
+    ASSERT_NE(nullptr, snapshotManager->get_snapshot(0)) << "Queries must wait for the preloaded snapshot";
+}
+
+TEST_F(SnapshotManagerTest, MemoryBudget) {
+    auto budget = std::make_shared<MemoryBudget>();
+    snapshotManager->set_memory_budget(budget);
+    snapshotManager->create_snapshot(0, it, BASEURI);
+    size_t usage = snapshotManager->get_memory_usage();
+    ASSERT_LT(0, usage) << "Loaded snapshots must be accounted for";
+    ASSERT_EQ(usage, budget->get_used()) << "The footprints must be reported to the budget";
+
+    // Only the snapshot that is loaded last remains loaded
+    budget->set_limit(1);
+    VectorTripleIterator it10({hdt::TripleString("<a>", "<a>", "<d>")});
+    snapshotManager->create_snapshot(10, &it10, BASEURI);
+    ASSERT_EQ(snapshotManager->get_memory_usage(), budget->get_used()) << "Unloaded snapshots must be released";
+    std::shared_ptr<hdt::HDT> snapshot = snapshotManager->get_snapshot(0);
+    ASSERT_NE(nullptr, snapshot) << "Unloaded snapshot must be reloaded";
+    ASSERT_EQ(usage, snapshotManager->get_memory_usage()) << "Only the reloaded snapshot must remain loaded";
+
+    snapshotManager->set_memory_budget(nullptr);
+    ASSERT_EQ(0, budget->get_used()) << "All footprints must be released";
+}